@@ -60,9 +60,10 @@ JSON::JSON(int type)
 JSON::JSON(const wxFileName& filename)
     : _json(NULL)
 {
-    wxString content;
-    if(!FileUtils::ReadFileContent(filename, content)) { return; }
-    _json = cJSON_Parse(content.mb_str(wxConvUTF8).data());
+    // The file is already UTF-8, parse it as is instead of decoding it into a wxString and encoding it back
+    std::string content;
+    if(!FileUtils::ReadFileContentRaw(filename, content)) { return; }
+    _json = cJSON_Parse(content.c_str());
 
     if(!_json) { _json = cJSON_CreateObject(); }
 }
@@ -101,6 +102,15 @@ JSONItem JSONItem::namedObject(const wxString& name) const
     return JSONItem(obj);
 }
 
+JSONItem JSONItem::namedObject(const char* name) const
+{
+    if(!_json) { return JSONItem(NULL); }
+
+    cJSON* obj = cJSON_GetObjectItem(_json, name);
+    if(!obj) { return JSONItem(NULL); }
+    return JSONItem(obj);
+}
+
 void JSON::clear()
 {
     int type = cJSON_Object;
@@ -127,33 +137,78 @@ cJSON* JSON::release()
 JSONItem::JSONItem(cJSON* json)
     : _json(json)
     , _type(-1)
+    , _nameIsSet(false)
     , _walker(NULL)
+    , _arrayCursor(NULL)
+    , _arrayCursorPos(0)
+    , _arrayTail(NULL)
+    , _arrayTailPos(0)
 {
-    if(_json) {
-        _name = wxString(_json->string, wxConvUTF8);
-        _type = _json->type;
-    }
+    if(_json) { _type = _json->type; }
 }
 
 JSONItem::JSONItem(const wxString& name, const wxVariant& val, int type)
     : _json(NULL)
     , _type(type)
+    , _nameIsSet(true)
     , _walker(NULL)
+    , _arrayCursor(NULL)
+    , _arrayCursorPos(0)
+    , _arrayTail(NULL)
+    , _arrayTailPos(0)
 {
     _value = val;
     _name = name;
 }
 
+const wxString& JSONItem::getName() const
+{
+    if(!_nameIsSet) {
+        if(_json && _json->string) { _name = wxString(_json->string, wxConvUTF8); }
+        _nameIsSet = true;
+    }
+    return _name;
+}
+
 JSONItem JSONItem::arrayItem(int pos) const
 {
     if(!_json) { return JSONItem(NULL); }
 
     if(_json->type != cJSON_Array) return JSONItem(NULL);
 
-    int size = cJSON_GetArraySize(_json);
-    if(pos >= size) return JSONItem(NULL);
+    if(pos < 0) return JSONItem(NULL);
+
+    // Continue from the last item returned when walking forward
+    cJSON* item = _json->child;
+    int curpos = 0;
+    if(_arrayCursor && _arrayCursorPos <= pos) {
+        item = _arrayCursor;
+        curpos = _arrayCursorPos;
+    }
+    while(item && curpos < pos) {
+        item = item->next;
+        ++curpos;
+    }
+    if(!item) return JSONItem(NULL);
+
+    _arrayCursor = item;
+    _arrayCursorPos = pos;
+    return JSONItem(item);
+}
 
-    return JSONItem(cJSON_GetArrayItem(_json, pos));
+cJSON* JSONItem::arrayTail() const
+{
+    // Items might have been appended using another JSONItem, so move forward from the cached tail
+    if(!_arrayTail) {
+        _arrayTail = _json->child;
+        _arrayTailPos = 0;
+    }
+    if(!_arrayTail) { return NULL; }
+    while(_arrayTail->next) {
+        _arrayTail = _arrayTail->next;
+        ++_arrayTailPos;
+    }
+    return _arrayTail;
 }
 
 bool JSONItem::isNull() const
@@ -180,6 +235,15 @@ wxString JSONItem::toString(const wxString& defaultValue) const
     return wxString(_json->valuestring, wxConvUTF8);
 }
 
+std::string JSONItem::toStdString(const std::string& defaultValue) const
+{
+    if(!_json) { return defaultValue; }
+
+    if(_json->type != cJSON_String) { return defaultValue; }
+
+    return _json->valuestring ? std::string(_json->valuestring) : std::string();
+}
+
 bool JSONItem::isBool() const
 {
     if(!_json) { return false; }
@@ -257,7 +321,16 @@ void JSONItem::arrayAppend(const JSONItem& element)
         p = element._json;
         break;
     }
-    if(p) { cJSON_AddItemToArray(_json, p); }
+    if(!p) { return; }
+
+    // Link the new item after the cached tail instead of walking the list (cJSON_AddItemToArray)
+    cJSON* tail = (_json->type == cJSON_Array) ? arrayTail() : NULL;
+    if(tail) {
+        tail->next = p;
+        p->prev = tail;
+    } else {
+        cJSON_AddItemToArray(_json, p);
+    }
 }
 
 JSONItem JSONItem::createArray(const wxString& name)
@@ -331,7 +404,8 @@ int JSONItem::arraySize() const
 
     if(_json->type != cJSON_Array) return 0;
 
-    return cJSON_GetArraySize(_json);
+    cJSON* tail = arrayTail();
+    return tail ? _arrayTailPos + 1 : 0;
 }
 
 JSONItem& JSONItem::addProperty(const wxString& name, bool value)
@@ -382,8 +456,8 @@ wxArrayString JSONItem::toArrayString(const wxArrayString& defaultValue) const
     if(_json->type != cJSON_Array) { return defaultValue; }
 
     wxArrayString arr;
-    for(int i = 0; i < arraySize(); i++) {
-        arr.Add(arrayItem(i).toString());
+    for(cJSON* child = _json->child; child; child = child->next) {
+        arr.Add(JSONItem(child).toString());
     }
     return arr;
 }
@@ -395,6 +469,13 @@ bool JSONItem::hasNamedObject(const wxString& name) const
     cJSON* obj = cJSON_GetObjectItem(_json, name.mb_str(wxConvUTF8).data());
     return obj != NULL;
 }
+
+bool JSONItem::hasNamedObject(const char* name) const
+{
+    if(!_json) { return false; }
+
+    return cJSON_GetObjectItem(_json, name) != NULL;
+}
 #if wxUSE_GUI
 JSONItem& JSONItem::addProperty(const wxString& name, const wxPoint& pt)
 {
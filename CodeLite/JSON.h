@@ -32,6 +32,7 @@
 #include <wx/gdicmn.h>
 #include "codelite_exports.h"
 #include <map>
+#include <string>
 #include "cJSON.h"
 #if wxUSE_GUI
 #include <wx/arrstr.h>
@@ -48,12 +49,23 @@ class WXDLLIMPEXP_CL JSONItem
 protected:
     cJSON* _json;
     int _type;
-    wxString _name;
+    // The name is converted to wxString on demand (see getName())
+    mutable wxString _name;
+    mutable bool _nameIsSet;
 
     // Values
     wxVariant _value;
     cJSON* _walker;
 
+    // Array cursors. The JSONItem API never removes items from an array, so the cached nodes remain valid: sequential
+    // calls to arrayItem() and arraySize() / arrayAppend() in a loop cost O(1) instead of walking the whole list
+    mutable cJSON* _arrayCursor;
+    mutable int _arrayCursorPos;
+    mutable cJSON* _arrayTail;
+    mutable int _arrayTailPos;
+
+    cJSON* arrayTail() const;
+
 public:
     JSONItem(cJSON* json);
     JSONItem(const wxString& name, const wxVariant& val, int type);
@@ -66,19 +78,32 @@ public:
 
     // Setters
     ////////////////////////////////////////////////
-    void setName(const wxString& _name) { this->_name = _name; }
+    void setName(const wxString& _name)
+    {
+        this->_name = _name;
+        this->_nameIsSet = true;
+    }
     void setType(int _type) { this->_type = _type; }
     int getType() const { return _type; }
-    const wxString& getName() const { return _name; }
+    const wxString& getName() const;
     const wxVariant& getValue() const { return _value; }
     void setValue(const wxVariant& _value) { this->_value = _value; }
     // Readers
     ////////////////////////////////////////////////
     JSONItem namedObject(const wxString& name) const;
     bool hasNamedObject(const wxString& name) const;
+    /**
+     * @brief same as above, without converting the name to wxString and back
+     */
+    JSONItem namedObject(const char* name) const;
+    bool hasNamedObject(const char* name) const;
 
     bool toBool(bool defaultValue = false) const;
     wxString toString(const wxString& defaultValue = wxEmptyString) const;
+    /**
+     * @brief return the string value as raw UTF-8 (no conversion)
+     */
+    std::string toStdString(const std::string& defaultValue = std::string()) const;
     wxArrayString toArrayString(const wxArrayString& defaultValue = wxArrayString()) const;
     JSONItem arrayItem(int pos) const;
 
@@ -174,6 +199,7 @@ public:
     {
         cJSON* temp = _json;
         _json = nullptr;
+        _walker = _arrayCursor = _arrayTail = nullptr;
         return temp;
     }
 };
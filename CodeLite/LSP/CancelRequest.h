@@ -0,0 +1,20 @@
+#ifndef CANCELREQUEST_H
+#define CANCELREQUEST_H
+
+#include "LSP/Notification.h"
+
+namespace LSP
+{
+
+/**
+ * @brief the '$/cancelRequest' notification: tell the server that we are no longer interested in the response of
+ * a request we sent earlier
+ */
+class WXDLLIMPEXP_CL CancelRequest : public LSP::Notification
+{
+public:
+    CancelRequest(int requestId);
+    virtual ~CancelRequest();
+};
+};     // namespace LSP
+#endif // CANCELREQUEST_H
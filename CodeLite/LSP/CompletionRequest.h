@@ -14,6 +14,7 @@ public:
     virtual ~CompletionRequest();
     void OnResponse(const LSP::ResponseMessage& response, wxEvtHandler* owner);
     bool IsPositionDependantRequest() const { return true; }
+    ePriority GetPriority() const { return kPriorityHigh; }
     bool IsValidAt(const wxFileName& filename, size_t line, size_t col) const;
 };
 };     // namespace LSP
@@ -2,7 +2,9 @@
 #define DIDCHANGE_TEXTDOCUMENTREQUEST_H
 
 #include <wx/filename.h>
+#include <vector>
 #include "LSP/Notification.h"
+#include "LSP/basic_types.h"
 
 namespace LSP
 {
@@ -10,7 +12,17 @@ namespace LSP
 class WXDLLIMPEXP_CL DidChangeTextDocumentRequest : public LSP::Notification
 {
 public:
-    DidChangeTextDocumentRequest(const wxFileName& filename, const wxString& fileContent);
+    /**
+     * @brief full sync: send the entire content of the document
+     */
+    DidChangeTextDocumentRequest(const wxFileName& filename, const wxString& fileContent, int version);
+
+    /**
+     * @brief incremental sync: send the edits made to the document since the previous version. The changes are
+     * applied by the server in order, each one on the document produced by its predecessor
+     */
+    DidChangeTextDocumentRequest(const wxFileName& filename, const std::vector<TextDocumentContentChangeEvent>& changes,
+                                 int version);
     virtual ~DidChangeTextDocumentRequest();
 };
 
@@ -0,0 +1,112 @@
+#include "LSP/MessageReader.h"
+#include "file_logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <wx/crt.h>
+
+#define HEADER_CONTENT_LENGTH "content-length"
+#define HEADERS_SEPARATOR "\r\n\r\n"
+
+void LSP::MessageReader::Append(const char* data, size_t len)
+{
+    DoCompact();
+    m_buffer.append(data, len);
+}
+
+void LSP::MessageReader::Clear()
+{
+    m_buffer.clear();
+    m_offset = 0;
+    m_scanOffset = 0;
+    m_bodyOffset = 0;
+    m_contentLength = -1;
+}
+
+void LSP::MessageReader::DoCompact()
+{
+    if(m_offset == 0) { return; }
+    if(m_offset == m_buffer.length()) {
+        // everything was consumed
+        Clear();
+        return;
+    }
+
+    // Move the remaining bytes to the start of the buffer only when the consumed part is the larger one, this way
+    // every byte is moved a bounded number of times and reading a stream stays linear
+    if(m_offset < (m_buffer.length() / 2)) { return; }
+    m_buffer.erase(0, m_offset);
+    m_scanOffset -= m_offset;
+    if(m_contentLength != -1) { m_bodyOffset -= m_offset; }
+    m_offset = 0;
+}
+
+long LSP::MessageReader::DoReadContentLength(size_t headersEnd) const
+{
+    // The headers are ASCII "name: value" lines separated by "\r\n"
+    size_t lineStart = m_offset;
+    while(lineStart < headersEnd) {
+        size_t lineEnd = m_buffer.find("\r\n", lineStart);
+        if(lineEnd == std::string::npos || lineEnd > headersEnd) { lineEnd = headersEnd; }
+
+        const char* line = m_buffer.c_str() + lineStart;
+        size_t nameLen = strlen(HEADER_CONTENT_LENGTH);
+        if((lineEnd - lineStart) > nameLen && wxStrnicmp(line, HEADER_CONTENT_LENGTH, nameLen) == 0 &&
+           line[nameLen] == ':') {
+            char* end = nullptr;
+            long length = strtol(line + nameLen + 1, &end, 10);
+            if(end != line + nameLen + 1 && length >= 0) { return length; }
+        }
+        lineStart = lineEnd + 2;
+    }
+    return -1;
+}
+
+bool LSP::MessageReader::Next(wxSharedPtr<JSON>& json)
+{
+    while(true) {
+        if(m_contentLength == -1) {
+            // Read the headers
+            size_t headersEnd = m_buffer.find(HEADERS_SEPARATOR, m_scanOffset);
+            if(headersEnd == std::string::npos) {
+                // Next time, continue from where we stopped (the separator might be split between two chunks)
+                size_t separatorLen = strlen(HEADERS_SEPARATOR);
+                m_scanOffset = m_buffer.length() >= (m_offset + separatorLen) ? m_buffer.length() - separatorLen + 1
+                                                                              : m_offset;
+                return false;
+            }
+
+            m_bodyOffset = headersEnd + strlen(HEADERS_SEPARATOR);
+            long contentLength = DoReadContentLength(headersEnd);
+            if(contentLength == -1) {
+                clWARNING() << "LSP: message without Content-Length header. Skipping it" << clEndl;
+                m_offset = m_scanOffset = m_bodyOffset;
+                continue;
+            }
+            m_contentLength = contentLength;
+        }
+
+        // Do we have the complete message?
+        if((m_buffer.length() - m_bodyOffset) < (size_t)m_contentLength) { return false; }
+
+        // Parse the message in place: terminate it by replacing the byte that follows it with a NULL
+        size_t messageEnd = m_bodyOffset + m_contentLength;
+        bool atEnd = (messageEnd == m_buffer.length());
+        if(atEnd) { m_buffer.push_back('\0'); }
+        char saved = m_buffer[messageEnd];
+        m_buffer[messageEnd] = '\0';
+        cJSON* root = cJSON_Parse(&m_buffer[m_bodyOffset]);
+        m_buffer[messageEnd] = saved;
+        if(atEnd) { m_buffer.pop_back(); }
+
+        // Consume the message
+        m_offset = m_scanOffset = messageEnd;
+        m_contentLength = -1;
+
+        if(!root) {
+            clWARNING() << "LSP: failed to parse message. Skipping it" << clEndl;
+            continue;
+        }
+        json.reset(new JSON(root));
+        return true;
+    }
+}
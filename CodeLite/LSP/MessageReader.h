@@ -0,0 +1,62 @@
+#ifndef LSP_MESSAGEREADER_H
+#define LSP_MESSAGEREADER_H
+
+#include "JSON.h"
+#include "codelite_exports.h"
+#include <string>
+#include <wx/sharedptr.h>
+
+namespace LSP
+{
+
+/**
+ * @class MessageReader
+ * @brief split the byte stream received from a language server into JSON-RPC messages.
+ * The data is appended as it arrives (in chunks of any size). The headers are read incrementally and every complete
+ * message is parsed directly from the buffer: there is no copy of the message and no wxString conversion.
+ * Content-Length counts bytes, so the buffer must contain the data exactly as it was received
+ */
+class WXDLLIMPEXP_CL MessageReader
+{
+    std::string m_buffer;
+    size_t m_offset = 0;         // the first byte that was not consumed yet
+    size_t m_scanOffset = 0;     // where to continue looking for the end of the headers
+    size_t m_bodyOffset = 0;     // the start of the current message content (valid once the headers are read)
+    long m_contentLength = -1;   // the length of the current message, -1 when its headers were not read yet
+
+protected:
+    /**
+     * @brief parse the headers found in [m_offset, headersEnd) and return the Content-Length value (or -1)
+     */
+    long DoReadContentLength(size_t headersEnd) const;
+    void DoCompact();
+
+public:
+    MessageReader() {}
+    virtual ~MessageReader() {}
+
+    /**
+     * @brief append bytes received from the server
+     */
+    void Append(const char* data, size_t len);
+    void Append(const std::string& data) { Append(data.c_str(), data.length()); }
+
+    /**
+     * @brief extract the next complete message from the buffer
+     * @return false if more data is needed. Messages that can not be parsed are skipped
+     */
+    bool Next(wxSharedPtr<JSON>& json);
+
+    /**
+     * @brief discard everything
+     */
+    void Clear();
+
+    /**
+     * @brief return the number of bytes received but not consumed yet
+     */
+    size_t GetPendingBytes() const { return m_buffer.length() - m_offset; }
+};
+}; // namespace LSP
+
+#endif // LSP_MESSAGEREADER_H
@@ -11,6 +11,13 @@ class WXDLLIMPEXP_SDK Request : public LSP::MessageWithParams
 {
     int m_id = wxNOT_FOUND;
 
+public:
+    enum ePriority {
+        kPriorityLow = 0,
+        kPriorityNormal,
+        kPriorityHigh,
+    };
+
 public:
     Request();
     virtual ~Request();
@@ -27,6 +34,12 @@ public:
      */
     virtual bool IsPositionDependantRequest() const { return false; }
 
+    /**
+     * @brief the order in which queued requests are sent to the server. Requests that the user is waiting for
+     * (e.g. code completion) should not wait behind background requests
+     */
+    virtual ePriority GetPriority() const { return kPriorityNormal; }
+
     /**
      * @brief in case 'IsPositionDependantRequest' is true, return true if the response is valid at
      * a given position. Usually, when the user moves while waiting for a response, it makes no sense on
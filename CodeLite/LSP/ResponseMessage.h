@@ -12,16 +12,12 @@ class WXDLLIMPEXP_CL ResponseMessage : public LSP::Message
 {
     int m_id = wxNOT_FOUND;
     wxSharedPtr<JSON> m_json;
-    wxString m_jsonMessage;
 
-protected:
+public:
     /**
-     * @brief read headers from buffer. Return the number of bytes consumed
+     * @brief construct a message from a parsed JSON-RPC message (see LSP::MessageReader)
      */
-    int ReadHeaders(const wxString& message, wxStringMap_t& headers);
-
-public:
-    ResponseMessage(wxString& message);
+    ResponseMessage(wxSharedPtr<JSON> json);
     virtual ~ResponseMessage();
     virtual JSONItem ToJSON(const wxString& name) const;
     virtual void FromJSON(const JSONItem& json);
@@ -32,7 +28,7 @@ public:
         this->m_id = id;
         return *this;
     }
-    const wxString& GetMessageString() const { return m_jsonMessage; }
+    wxString GetMessageString() const;
     int GetId() const { return m_id; }
     bool IsOk() const { return m_json && m_json->isOk(); }
     bool Has(const wxString& property) const;
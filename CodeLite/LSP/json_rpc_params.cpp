@@ -112,4 +112,18 @@ JSONItem CompletionParams::ToJSON(const wxString& name) const
     JSONItem json = TextDocumentPositionParams::ToJSON(name);
     return json;
 }
+
+//===----------------------------------------------------------------------------------
+// CancelParams
+//===----------------------------------------------------------------------------------
+CancelParams::CancelParams() {}
+
+void CancelParams::FromJSON(const JSONItem& json) { m_id = json.namedObject("id").toInt(wxNOT_FOUND); }
+
+JSONItem CancelParams::ToJSON(const wxString& name) const
+{
+    JSONItem json = JSONItem::createObject(name);
+    json.addProperty("id", m_id);
+    return json;
+}
 }; // namespace LSP
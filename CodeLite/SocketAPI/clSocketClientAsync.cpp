@@ -236,12 +236,13 @@ void clSocketAsyncThread::BufferLoop(clSocketBase::Ptr_t socket)
             }
 
             // timeout, test to see if we got something on the socket
-            wxString buffer;
+            wxMemoryBuffer buffer;
             if(socket->SelectReadMS(5) == clSocketBase::kSuccess) {
                 int rc = socket->Read(buffer);
                 if(rc == clSocketBase::kSuccess) {
                     clCommandEvent event(wxEVT_ASYNC_SOCKET_INPUT);
-                    event.SetString(buffer);
+                    event.SetString(wxString((const char*)buffer.GetData(), wxConvUTF8, buffer.GetDataLen()));
+                    event.SetStringRaw(std::string((const char*)buffer.GetData(), buffer.GetDataLen()));
                     m_sink->AddPendingEvent(event);
 
                 } else if(rc == clSocketBase::kError) {
@@ -148,7 +148,9 @@ static const char* parse_number(cJSON* item, const char* num)
             subscale = (subscale * 10) + (*num++ - '0'); /* Number? */
     }
 
-    n = sign * n * pow(10.0, (scale + subscale * signsubscale)); /* number = +/- number.fraction * 10^+/- exponent */
+    /* number = +/- number.fraction * 10^+/- exponent */
+    if(scale + subscale * signsubscale != 0) n *= pow(10.0, (scale + subscale * signsubscale));
+    n = sign * n;
 
     item->valuedouble = n;
     item->valueint = (int)n;
@@ -156,26 +158,77 @@ static const char* parse_number(cJSON* item, const char* num)
     return num;
 }
 
-/* Render the number nicely from the given item into a string. */
-static char* print_number(cJSON* item)
+/* The output buffer of the printer. All the values are rendered into a single buffer that grows geometrically, so
+   printing a document costs O(size of the output) instead of allocating and copying every value once per nesting
+   level. */
+typedef struct
+{
+    char* buffer;
+    size_t length;
+    size_t offset;
+} printbuffer;
+
+/* Make sure that 'needed' more bytes can be written at the end of the buffer. Returns the write position. */
+static char* ensure(printbuffer* p, size_t needed)
+{
+    char* newbuffer;
+    size_t newsize;
+    if(!p->buffer) return 0;
+    needed += p->offset;
+    if(needed <= p->length) return p->buffer + p->offset;
+
+    newsize = p->length * 2;
+    if(newsize < needed) newsize = needed;
+    newbuffer = (char*)cJSON_malloc(newsize);
+    if(!newbuffer) {
+        cJSON_free(p->buffer);
+        p->buffer = 0;
+        p->length = 0;
+        return 0;
+    }
+    memcpy(newbuffer, p->buffer, p->offset);
+    cJSON_free(p->buffer);
+    p->buffer = newbuffer;
+    p->length = newsize;
+    return newbuffer + p->offset;
+}
+
+/* Append 'len' bytes of 'str' to the buffer. */
+static int append_raw(printbuffer* p, const char* str, size_t len)
+{
+    char* out = ensure(p, len);
+    if(!out) return 0;
+    memcpy(out, str, len);
+    p->offset += len;
+    return 1;
+}
+
+/* Append 'count' copies of 'c' to the buffer. */
+static int append_chars(printbuffer* p, char c, size_t count)
+{
+    char* out = ensure(p, count);
+    if(!out) return 0;
+    memset(out, c, count);
+    p->offset += count;
+    return 1;
+}
+
+/* Render the number nicely from the given item into the buffer. */
+static int print_number(cJSON* item, printbuffer* p)
 {
-    char* str;
+    char str[512]; /* %.0f of DBL_MAX is 309 digits long */
     double d = item->valuedouble;
     if(fabs(((double)item->valueint) - d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN) {
-        str = (char*)cJSON_malloc(21); /* 2^64+1 can be represented in 21 chars. */
-        if(str) sprintf(str, "%d", item->valueint);
+        sprintf(str, "%d", item->valueint);
     } else {
-        str = (char*)cJSON_malloc(64); /* This is a nice tradeoff. */
-        if(str) {
-            if(fabs(floor(d) - d) <= DBL_EPSILON)
-                sprintf(str, "%.0f", d);
-            else if(fabs(d) < 1.0e-6 || fabs(d) > 1.0e9)
-                sprintf(str, "%e", d);
-            else
-                sprintf(str, "%f", d);
-        }
+        if(fabs(floor(d) - d) <= DBL_EPSILON)
+            snprintf(str, sizeof(str), "%.0f", d);
+        else if(fabs(d) < 1.0e-6 || fabs(d) > 1.0e9)
+            snprintf(str, sizeof(str), "%e", d);
+        else
+            snprintf(str, sizeof(str), "%f", d);
     }
-    return str;
+    return append_raw(p, str, strlen(str));
 }
 
 /* Parse the input text into an unescaped cstring, and populate item. */
@@ -274,78 +327,70 @@ static const char* parse_string(cJSON* item, const char* str)
     return ptr;
 }
 
-/* Render the cstring provided to an escaped version that can be printed. */
-static char* print_string_ptr(const char* str)
+/* Render the escaped version of the provided cstring into the buffer. */
+static int print_string_ptr(const char* str, printbuffer* p)
 {
     const char* ptr;
-    char *ptr2, *out;
-    int len = 0;
+    const char* run;
+    char* ptr2;
     unsigned char token;
 
-    if(!str) return cJSON_strdup("");
-    ptr = str;
-    while((token = *ptr) && ++len) {
-        if(strchr("\"\\\b\f\n\r\t", token))
-            len++;
-        else if(token < 32)
-            len += 5;
-        ptr++;
-    }
-
-    out = (char*)cJSON_malloc(len + 3);
-    if(!out) return 0;
-
-    ptr2 = out;
+    if(!str) return 1;
+    if(!append_raw(p, "\"", 1)) return 0;
     ptr = str;
-    *ptr2++ = '\"';
     while(*ptr) {
-        if((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\')
-            *ptr2++ = *ptr++;
-        else {
-            *ptr2++ = '\\';
-            switch(token = *ptr++) {
-            case '\\':
-                *ptr2++ = '\\';
-                break;
-            case '\"':
-                *ptr2++ = '\"';
-                break;
-            case '\b':
-                *ptr2++ = 'b';
-                break;
-            case '\f':
-                *ptr2++ = 'f';
-                break;
-            case '\n':
-                *ptr2++ = 'n';
-                break;
-            case '\r':
-                *ptr2++ = 'r';
-                break;
-            case '\t':
-                *ptr2++ = 't';
-                break;
-            default:
-                sprintf(ptr2, "u%04x", token);
-                ptr2 += 5;
-                break; /* escape and print */
-            }
+        /* Copy the characters that don't need escaping in one go */
+        run = ptr;
+        while((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\')
+            ptr++;
+        if(ptr != run && !append_raw(p, run, ptr - run)) return 0;
+        if(!*ptr) break;
+
+        /* 6 bytes for "\uXXXX" plus the NUL written by sprintf */
+        ptr2 = ensure(p, 7);
+        if(!ptr2) return 0;
+        *ptr2++ = '\\';
+        p->offset += 2;
+        switch(token = *ptr++) {
+        case '\\':
+            *ptr2 = '\\';
+            break;
+        case '\"':
+            *ptr2 = '\"';
+            break;
+        case '\b':
+            *ptr2 = 'b';
+            break;
+        case '\f':
+            *ptr2 = 'f';
+            break;
+        case '\n':
+            *ptr2 = 'n';
+            break;
+        case '\r':
+            *ptr2 = 'r';
+            break;
+        case '\t':
+            *ptr2 = 't';
+            break;
+        default:
+            sprintf(ptr2, "u%04x", token);
+            p->offset += 4;
+            break; /* escape and print */
         }
     }
-    *ptr2++ = '\"';
-    *ptr2++ = 0;
-    return out;
+    return append_raw(p, "\"", 1);
 }
 /* Invote print_string_ptr (which is useful) on an item. */
-static char* print_string(cJSON* item) { return print_string_ptr(item->valuestring); }
+static int print_string(cJSON* item, printbuffer* p) { return print_string_ptr(item->valuestring, p); }
 
 /* Predeclare these prototypes. */
 static const char* parse_value(cJSON* item, const char* value);
-static char* print_value(cJSON* item, int depth, int fmt);
+static int print_value(cJSON* item, int depth, int fmt, printbuffer* p);
 static const char* parse_array(cJSON* item, const char* value);
-static char* print_array(cJSON* item, int depth, int fmt);
+static int print_array(cJSON* item, int depth, int fmt, printbuffer* p);
 static const char* parse_object(cJSON* item, const char* value);
-static char* print_object(cJSON* item, int depth, int fmt);
+static int print_object(cJSON* item, int depth, int fmt, printbuffer* p);
 
 /* Utility to jump whitespace and cr/lf */
 static const char* skip(const char* in)
@@ -370,64 +415,93 @@ cJSON* cJSON_Parse(const char* value)
 }
 
 /* Render a cJSON item/entity/structure to text. */
-char* cJSON_Print(cJSON* item) { return print_value(item, 0, 1); }
-char* cJSON_PrintUnformatted(cJSON* item) { return print_value(item, 0, 0); }
+static char* print_buffered(cJSON* item, int fmt)
+{
+    char* out;
+    printbuffer p;
+    p.length = 256;
+    p.offset = 0;
+    p.buffer = (char*)cJSON_malloc(p.length);
+    if(!p.buffer) return 0;
+
+    if(!print_value(item, 0, fmt, &p) || !append_raw(&p, "", 1)) {
+        if(p.buffer) cJSON_free(p.buffer);
+        return 0;
+    }
+
+    /* Don't hand the slack of the buffer to the caller */
+    if(p.length - p.offset > 1024 && (out = (char*)cJSON_malloc(p.offset))) {
+        memcpy(out, p.buffer, p.offset);
+        cJSON_free(p.buffer);
+        return out;
+    }
+    return p.buffer;
+}
+
+char* cJSON_Print(cJSON* item) { return print_buffered(item, 1); }
+char* cJSON_PrintUnformatted(cJSON* item) { return print_buffered(item, 0); }
 
 /* Parser core - when encountering text, process appropriately. */
 static const char* parse_value(cJSON* item, const char* value)
 {
     if(!value) return 0; /* Fail on null. */
-    if(!strncmp(value, "null", 4)) {
-        item->type = cJSON_NULL;
-        return value + 4;
-    }
-    if(!strncmp(value, "false", 5)) {
-        item->type = cJSON_False;
-        return value + 5;
-    }
-    if(!strncmp(value, "true", 4)) {
-        item->type = cJSON_True;
-        item->valueint = 1;
-        return value + 4;
+    /* Dispatch on the first character: strings, numbers and containers are far more common than the literals */
+    switch(*value) {
+    case '\"':
+        return parse_string(item, value);
+    case '[':
+        return parse_array(item, value);
+    case '{':
+        return parse_object(item, value);
+    case 'n':
+        if(!strncmp(value, "null", 4)) {
+            item->type = cJSON_NULL;
+            return value + 4;
+        }
+        break;
+    case 'f':
+        if(!strncmp(value, "false", 5)) {
+            item->type = cJSON_False;
+            return value + 5;
+        }
+        break;
+    case 't':
+        if(!strncmp(value, "true", 4)) {
+            item->type = cJSON_True;
+            item->valueint = 1;
+            return value + 4;
+        }
+        break;
+    default:
+        if(*value == '-' || (*value >= '0' && *value <= '9')) { return parse_number(item, value); }
+        break;
     }
-    if(*value == '\"') { return parse_string(item, value); }
-    if(*value == '-' || (*value >= '0' && *value <= '9')) { return parse_number(item, value); }
-    if(*value == '[') { return parse_array(item, value); }
-    if(*value == '{') { return parse_object(item, value); }
 
     ep = value;
     return 0; /* failure. */
 }
 
 /* Render a value to text. */
-static char* print_value(cJSON* item, int depth, int fmt)
+static int print_value(cJSON* item, int depth, int fmt, printbuffer* p)
 {
-    char* out = 0;
     if(!item) return 0;
     switch((item->type) & 255) {
     case cJSON_NULL:
-        out = cJSON_strdup("null");
-        break;
+        return append_raw(p, "null", 4);
     case cJSON_False:
-        out = cJSON_strdup("false");
-        break;
+        return append_raw(p, "false", 5);
     case cJSON_True:
-        out = cJSON_strdup("true");
-        break;
+        return append_raw(p, "true", 4);
     case cJSON_Number:
-        out = print_number(item);
-        break;
+        return print_number(item, p);
     case cJSON_String:
-        out = print_string(item);
-        break;
+        return print_string(item, p);
     case cJSON_Array:
-        out = print_array(item, depth, fmt);
-        break;
+        return print_array(item, depth, fmt, p);
     case cJSON_Object:
-        out = print_object(item, depth, fmt);
-        break;
+        return print_object(item, depth, fmt, p);
     }
-    return out;
+    return 0;
 }
 
 /* Build an array from input text. */
@@ -464,64 +538,17 @@ static const char* parse_array(cJSON* item, const char* value)
 }
 
 /* Render an array to text */
-static char* print_array(cJSON* item, int depth, int fmt)
+static int print_array(cJSON* item, int depth, int fmt, printbuffer* p)
 {
-    char** entries;
-    char *out = 0, *ptr, *ret;
-    int len = 5;
     cJSON* child = item->child;
-    int numentries = 0, i = 0, fail = 0;
-
-    /* How many entries in the array? */
-    while(child)
-        numentries++, child = child->next;
-    /* Allocate an array to hold the values for each */
-    entries = (char**)cJSON_malloc(numentries * sizeof(char*));
-    if(!entries) return 0;
-    memset(entries, 0, numentries * sizeof(char*));
-    /* Retrieve all the results: */
-    child = item->child;
-    while(child && !fail) {
-        ret = print_value(child, depth + 1, fmt);
-        entries[i++] = ret;
-        if(ret)
-            len += strlen(ret) + 2 + (fmt ? 1 : 0);
-        else
-            fail = 1;
-        child = child->next;
-    }
-
-    /* If we didn't fail, try to malloc the output string */
-    if(!fail) out = (char*)cJSON_malloc(len);
-    /* If that fails, we fail. */
-    if(!out) fail = 1;
-
-    /* Handle failure. */
-    if(fail) {
-        for(i = 0; i < numentries; i++)
-            if(entries[i]) cJSON_free(entries[i]);
-        cJSON_free(entries);
-        return 0;
-    }
 
-    /* Compose the output array. */
-    *out = '[';
-    ptr = out + 1;
-    *ptr = 0;
-    for(i = 0; i < numentries; i++) {
-        strcpy(ptr, entries[i]);
-        ptr += strlen(entries[i]);
-        if(i != numentries - 1) {
-            *ptr++ = ',';
-            if(fmt) *ptr++ = ' ';
-            *ptr = 0;
-        }
-        cJSON_free(entries[i]);
+    if(!append_raw(p, "[", 1)) return 0;
+    while(child) {
+        if(!print_value(child, depth + 1, fmt, p)) return 0;
+        child = child->next;
+        if(child && !append_raw(p, ", ", fmt ? 2 : 1)) return 0;
     }
-    cJSON_free(entries);
-    *ptr++ = ']';
-    *ptr++ = 0;
-    return out;
+    return append_raw(p, "]", 1);
 }
 
 /* Build an object from the text. */
@@ -574,86 +601,23 @@ static const char* parse_object(cJSON* item, const char* value)
 }
 
 /* Render an object to text. */
-static char* print_object(cJSON* item, int depth, int fmt)
+static int print_object(cJSON* item, int depth, int fmt, printbuffer* p)
 {
-    char **entries = 0, **names = 0;
-    char *out = 0, *ptr, *ret, *str;
-    int len = 7, i = 0, j;
     cJSON* child = item->child;
-    int numentries = 0, fail = 0;
-    /* Count the number of entries. */
-    while(child)
-        numentries++, child = child->next;
-    /* Allocate space for the names and the objects */
-    entries = (char**)cJSON_malloc(numentries * sizeof(char*));
-    if(!entries) return 0;
-    names = (char**)cJSON_malloc(numentries * sizeof(char*));
-    if(!names) {
-        cJSON_free(entries);
-        return 0;
-    }
-    memset(entries, 0, sizeof(char*) * numentries);
-    memset(names, 0, sizeof(char*) * numentries);
 
-    /* Collect all the results into our arrays: */
-    child = item->child;
     depth++;
-    if(fmt) len += depth;
+    if(!append_raw(p, "{\n", fmt ? 2 : 1)) return 0;
     while(child) {
-        names[i] = str = print_string_ptr(child->string);
-        entries[i++] = ret = print_value(child, depth, fmt);
-        if(str && ret)
-            len += strlen(ret) + strlen(str) + 2 + (fmt ? 2 + depth : 0);
-        else
-            fail = 1;
+        if(fmt && !append_chars(p, FMT_WHITESPACE_CHAR, depth)) return 0;
+        if(!print_string_ptr(child->string, p)) return 0;
+        if(!append_raw(p, ": ", fmt ? 2 : 1)) return 0;
+        if(!print_value(child, depth, fmt, p)) return 0;
+        if(child->next && !append_raw(p, ",", 1)) return 0;
+        if(fmt && !append_raw(p, "\n", 1)) return 0;
         child = child->next;
     }
-
-    /* Try to allocate the output string */
-    if(!fail) out = (char*)cJSON_malloc(len);
-    if(!out) fail = 1;
-
-    /* Handle failure */
-    if(fail) {
-        for(i = 0; i < numentries; i++) {
-            if(names[i]) cJSON_free(names[i]);
-            if(entries[i]) cJSON_free(entries[i]);
-        }
-        cJSON_free(names);
-        cJSON_free(entries);
-        return 0;
-    }
-
-    /* Compose the output: */
-    *out = '{';
-    ptr = out + 1;
-    if(fmt) *ptr++ = '\n';
-    *ptr = 0;
-    for(i = 0; i < numentries; i++) {
-        if(fmt)
-            for(j = 0; j < depth; j++)
-                *ptr++ = FMT_WHITESPACE_CHAR;
-        strcpy(ptr, names[i]);
-        ptr += strlen(names[i]);
-        *ptr++ = ':';
-        if(fmt) *ptr++ = FMT_WHITESPACE_CHAR;
-        strcpy(ptr, entries[i]);
-        ptr += strlen(entries[i]);
-        if(i != numentries - 1) *ptr++ = ',';
-        if(fmt) *ptr++ = '\n';
-        *ptr = 0;
-        cJSON_free(names[i]);
-        cJSON_free(entries[i]);
-    }
-
-    cJSON_free(names);
-    cJSON_free(entries);
-    if(fmt)
-        for(i = 0; i < depth - 1; i++)
-            *ptr++ = FMT_WHITESPACE_CHAR;
-    *ptr++ = '}';
-    *ptr++ = 0;
-    return out;
+    if(fmt && !append_chars(p, FMT_WHITESPACE_CHAR, depth - 1)) return 0;
+    return append_raw(p, "}", 1);
 }
 
 /* Get Array size/item / object item. */
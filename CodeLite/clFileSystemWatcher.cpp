@@ -1,7 +1,17 @@
 #include "clFileSystemWatcher.h"
 #include <algorithm>
 #include <set>
+#include <vector>
+#include "clFilesCollector.h"
+#include "file_logger.h"
 #include "fileutils.h"
+#include <wx/dir.h>
+
+#if CL_FSW_USE_INOTIFY
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 wxDEFINE_EVENT(wxEVT_FILE_MODIFIED, clFileSystemEvent);
 wxDEFINE_EVENT(wxEVT_FILE_NOT_FOUND, clFileSystemEvent);
@@ -9,11 +19,31 @@ wxDEFINE_EVENT(wxEVT_FILE_NOT_FOUND, clFileSystemEvent);
 // In milliseconds
 #define FILE_CHECK_INTERVAL 500
 
+#if CL_FSW_USE_INOTIFY
+// How often the inotify events are collected (in milliseconds)
+#define INOTIFY_CHECK_INTERVAL 250
+// The changes are reported once a check interval passed without new changes, but no later than this number of
+// intervals (e.g. a log file that is written continuously)
+#define INOTIFY_MAX_PENDING_TICKS 2
+#define INOTIFY_EVENTS_MASK                                                                                      \
+    (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | \
+     IN_EXCL_UNLINK)
+#define TIMER_INTERVAL INOTIFY_CHECK_INTERVAL
+#else
+#define TIMER_INTERVAL FILE_CHECK_INTERVAL
+#endif
+
 clFileSystemWatcher::clFileSystemWatcher()
     : m_owner(NULL)
 #if CL_FSW_USE_TIMER
     , m_timer(NULL)
 #endif
+#if CL_FSW_USE_INOTIFY
+    , m_inotifyFd(wxNOT_FOUND)
+    , m_changesTicks(0)
+    , m_ticks(0)
+    , m_limitReached(false)
+#endif
 {
 #if CL_FSW_USE_TIMER
     Bind(wxEVT_TIMER, &clFileSystemWatcher::OnTimer, this);
@@ -21,6 +51,14 @@ clFileSystemWatcher::clFileSystemWatcher()
     m_watcher.SetOwner(this);
     Bind(wxEVT_FSWATCHER, &clFileSystemWatcher::OnFileModified, this);
 #endif
+
+#if CL_FSW_USE_INOTIFY
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_inotifyFd == wxNOT_FOUND) {
+        clWARNING() << "clFileSystemWatcher: inotify is not available, files will be checked periodically. errno:"
+                    << errno;
+    }
+#endif
 }
 
 clFileSystemWatcher::~clFileSystemWatcher()
@@ -32,18 +70,22 @@ clFileSystemWatcher::~clFileSystemWatcher()
     m_watcher.RemoveAll();
     Unbind(wxEVT_FSWATCHER, &clFileSystemWatcher::OnFileModified, this);
 #endif
+
+#if CL_FSW_USE_INOTIFY
+    if(m_inotifyFd != wxNOT_FOUND) { ::close(m_inotifyFd); }
+#endif
 }
 
 void clFileSystemWatcher::SetFile(const wxFileName& filename)
 {
 #if CL_FSW_USE_TIMER
     if(filename.Exists()) {
+#if CL_FSW_USE_INOTIFY
+        DoRemoveAll();
+#else
         m_files.clear();
-        File f;
-        f.filename = filename;
-        f.lastModified = FileUtils::GetFileModificationTime(filename);
-        f.file_size = FileUtils::GetFileSize(filename);
-        m_files.insert(std::make_pair(filename.GetFullPath(), f));
+#endif
+        AddFile(filename);
     }
 #else
     m_watcher.RemoveAll();
@@ -54,13 +96,50 @@ void clFileSystemWatcher::SetFile(const wxFileName& filename)
 #endif
 }
 
+void clFileSystemWatcher::AddFile(const wxFileName& filename)
+{
+#if CL_FSW_USE_TIMER
+    if(!filename.Exists()) { return; }
+#if CL_FSW_USE_INOTIFY
+    // Watch the file folder. Only the changes of the files that were added are reported
+    wxString fullpath = filename.GetFullPath();
+    if(m_watchedFiles.count(fullpath)) { return; }
+    if(m_files.count(fullpath) == 0 && DoWatchFolder(filename.GetPath(), false)) {
+        m_watchedFiles.insert(fullpath);
+        m_folders[m_watchDescriptors[filename.GetPath()]].filesCount++;
+        return;
+    }
+#endif
+    DoAddPolledFile(filename);
+#else
+    // wxFileSystemWatcher based implementation supports a single file
+    SetFile(filename);
+#endif
+}
+
+void clFileSystemWatcher::AddFolder(const wxString& folder)
+{
+#if CL_FSW_USE_INOTIFY
+    DoWatchTree(folder, false);
+#elif CL_FSW_USE_TIMER
+    clFilesScanner scanner;
+    std::vector<wxString> files;
+    scanner.Scan(folder, files);
+    for(const wxString& file : files) {
+        DoAddPolledFile(file);
+    }
+#else
+    m_watcher.AddTree(wxFileName(folder, ""));
+#endif
+}
+
 void clFileSystemWatcher::Start()
 {
 #if CL_FSW_USE_TIMER
     Stop();
 
     m_timer = new wxTimer(this);
-    m_timer->Start(FILE_CHECK_INTERVAL, true);
+    m_timer->Start(TIMER_INTERVAL, true);
 #else
 #endif
 }
@@ -81,7 +160,11 @@ void clFileSystemWatcher::Clear()
 {
 #if CL_FSW_USE_TIMER
     Stop();
+#if CL_FSW_USE_INOTIFY
+    DoRemoveAll();
+#else
     m_files.clear();
+#endif
 #else
     m_watcher.RemoveAll();
 #endif
@@ -89,6 +172,37 @@ void clFileSystemWatcher::Clear()
 
 #if CL_FSW_USE_TIMER
 void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
+{
+#if CL_FSW_USE_INOTIFY
+    bool newChanges = DoReadChanges();
+    if(!m_changes.empty()) {
+        // Let the changes settle: a file that is being written is reported once
+        ++m_changesTicks;
+        if(!newChanges || m_changesTicks >= INOTIFY_MAX_PENDING_TICKS) { DoReportChanges(); }
+    }
+
+    // The files that inotify could not watch are checked at the usual interval
+    ++m_ticks;
+    if(!m_files.empty() && (m_ticks % (FILE_CHECK_INTERVAL / INOTIFY_CHECK_INTERVAL)) == 0) { DoCheckFiles(); }
+#else
+    DoCheckFiles();
+#endif
+
+    if(m_timer) {
+        m_timer->Start(TIMER_INTERVAL, true);
+    }
+}
+
+void clFileSystemWatcher::DoAddPolledFile(const wxFileName& filename)
+{
+    File f;
+    f.filename = filename;
+    f.lastModified = FileUtils::GetFileModificationTime(filename);
+    f.file_size = FileUtils::GetFileSize(filename);
+    m_files[filename.GetFullPath()] = f;
+}
+
+void clFileSystemWatcher::DoCheckFiles()
 {
     std::set<wxString> nonExistingFiles;
     std::for_each(m_files.begin(), m_files.end(), [&](const std::pair<wxString, clFileSystemWatcher::File>& p) {
@@ -106,7 +220,7 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
             // add the missing file to a set
             nonExistingFiles.insert(fn.GetFullPath());
         } else {
-            
+
 #ifdef __WXMSW__
             size_t prev_value = f.file_size;
             size_t curr_value = FileUtils::GetFileSize(fn);
@@ -137,10 +251,6 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
 
     // Remove the non existing files
     std::for_each(nonExistingFiles.begin(), nonExistingFiles.end(), [&](const wxString& fn) { m_files.erase(fn); });
-
-    if(m_timer) {
-        m_timer->Start(FILE_CHECK_INTERVAL, true);
-    }
 }
 #endif
 
@@ -160,8 +270,227 @@ void clFileSystemWatcher::OnFileModified(wxFileSystemWatcherEvent& event)
 }
 #endif
 
+#if CL_FSW_USE_INOTIFY
+bool clFileSystemWatcher::DoWatchFolder(const wxString& path, bool recursive, bool* alreadyWatched)
+{
+    if(alreadyWatched) { *alreadyWatched = false; }
+    std::unordered_map<wxString, int>::iterator iter = m_watchDescriptors.find(path);
+    if(iter != m_watchDescriptors.end()) {
+        Folder& folder = m_folders[iter->second];
+        folder.recursive = folder.recursive || recursive;
+        if(alreadyWatched) { *alreadyWatched = true; }
+        return true;
+    }
+
+    if(m_inotifyFd == wxNOT_FOUND || m_limitReached) { return false; }
+    int wd = ::inotify_add_watch(m_inotifyFd, path.mb_str(wxConvUTF8).data(), INOTIFY_EVENTS_MASK);
+    if(wd < 0) {
+        if(errno == ENOSPC) {
+            m_limitReached = true;
+            clWARNING() << "clFileSystemWatcher: the inotify watches limit is reached (fs.inotify.max_user_watches),"
+                        << "the remaining files will be checked periodically";
+        }
+        return false;
+    }
+
+    std::unordered_map<int, Folder>::iterator folderIter = m_folders.find(wd);
+    if(folderIter != m_folders.end()) {
+        // The same folder through a different path (symlink). Its changes are reported with the other path: this is
+        // good enough for a tree, but the files added with AddFile() would not be recognized
+        if(alreadyWatched) { *alreadyWatched = true; }
+        return recursive;
+    }
+
+    Folder folder;
+    folder.path = path;
+    folder.recursive = recursive;
+    m_folders.insert({ wd, folder });
+    m_watchDescriptors.insert({ path, wd });
+    return true;
+}
+
+void clFileSystemWatcher::DoUnwatchFolder(const wxString& path)
+{
+    std::unordered_map<wxString, int>::iterator iter = m_watchDescriptors.find(path);
+    if(iter == m_watchDescriptors.end()) { return; }
+    ::inotify_rm_watch(m_inotifyFd, iter->second);
+    m_folders.erase(iter->second);
+    m_watchDescriptors.erase(iter);
+}
+
+void clFileSystemWatcher::DoWatchTree(const wxString& path, bool reportFiles)
+{
+    std::vector<wxString> folders;
+    folders.push_back(path);
+    while(!folders.empty()) {
+        wxString folder = folders.back();
+        folders.pop_back();
+
+        bool alreadyWatched = false;
+        if(!DoWatchFolder(folder, true, &alreadyWatched)) {
+            // No more watches: check the files of this sub tree with the timer
+            clFilesScanner scanner;
+            std::vector<wxString> files;
+            scanner.Scan(folder, files);
+            for(const wxString& file : files) {
+                DoAddPolledFile(file);
+                if(reportFiles) { m_changes.insert(file); }
+            }
+            continue;
+        }
+        if(alreadyWatched) { continue; }
+
+        wxDir dir(folder);
+        if(!dir.IsOpened()) { continue; }
+
+        // wxDIR_HIDDEN is not set: hidden folders (.git, .codelite...) are not watched
+        wxString name;
+        bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS);
+        while(cont) {
+            folders.push_back(folder + "/" + name);
+            cont = dir.GetNext(&name);
+        }
+
+        if(reportFiles) {
+            // A new folder: its files were created before we started watching it
+            cont = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN);
+            while(cont) {
+                m_changes.insert(folder + "/" + name);
+                cont = dir.GetNext(&name);
+            }
+        }
+    }
+}
+
+bool clFileSystemWatcher::DoReadChanges()
+{
+    if(m_inotifyFd == wxNOT_FOUND) { return false; }
+
+    bool newChanges = false;
+    bool overflow = false;
+    std::vector<wxString> newFolders;
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    while(true) {
+        ssize_t len = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if(len <= 0) { break; } // EAGAIN: no more events
+
+        for(char* p = buffer; p < buffer + len;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+
+            std::unordered_map<int, Folder>::iterator iter = m_folders.find(event->wd);
+            if(iter == m_folders.end()) { continue; }
+
+            if(event->mask & IN_IGNORED) {
+                // The folder was deleted (or unmounted)
+                m_watchDescriptors.erase(iter->second.path);
+                m_folders.erase(iter);
+                continue;
+            }
+            if(event->len == 0) { continue; }
+
+            const Folder& folder = iter->second;
+            wxString path;
+            path << folder.path << "/" << wxString::FromUTF8(event->name);
+            if(event->mask & IN_ISDIR) {
+                if(!folder.recursive) { continue; }
+                if(event->mask & (IN_CREATE | IN_MOVED_TO)) { newFolders.push_back(path); }
+                // the folders created or deleted in a tree are reported like files
+                if(event->mask & (IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)) {
+                    m_changes.insert(path);
+                    newChanges = true;
+                }
+                continue;
+            }
+
+            if(folder.recursive || m_watchedFiles.count(path)) {
+                m_changes.insert(path);
+                newChanges = true;
+            }
+        }
+    }
+
+    for(const wxString& folder : newFolders) {
+        DoWatchTree(folder, true);
+        newChanges = true;
+    }
+
+    if(overflow) {
+        // Events were lost: report everything we watch
+        clWARNING() << "clFileSystemWatcher: inotify queue overflow";
+        m_changes.insert(m_watchedFiles.begin(), m_watchedFiles.end());
+        for(const auto& p : m_folders) {
+            if(!p.second.recursive) { continue; }
+            wxDir dir(p.second.path);
+            if(!dir.IsOpened()) { continue; }
+            wxString name;
+            bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN);
+            while(cont) {
+                m_changes.insert(p.second.path + "/" + name);
+                cont = dir.GetNext(&name);
+            }
+        }
+        newChanges = true;
+    }
+    return newChanges;
+}
+
+void clFileSystemWatcher::DoReportChanges()
+{
+    wxStringSet_t changes;
+    changes.swap(m_changes);
+    m_changesTicks = 0;
+
+    for(const wxString& path : changes) {
+        bool exists = wxFileName::Exists(path);
+        // Like the timer: a file that no longer exists is removed from the watch list
+        if(!exists && m_watchedFiles.count(path)) { RemoveFile(path); }
+        if(GetOwner()) {
+            clFileSystemEvent evt(exists ? wxEVT_FILE_MODIFIED : wxEVT_FILE_NOT_FOUND);
+            evt.SetPath(path);
+            GetOwner()->AddPendingEvent(evt);
+        }
+    }
+}
+
+void clFileSystemWatcher::DoRemoveAll()
+{
+    // Closing the inotify instance is faster than removing the watches one by one
+    if(m_inotifyFd != wxNOT_FOUND) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+    m_folders.clear();
+    m_watchDescriptors.clear();
+    m_watchedFiles.clear();
+    m_changes.clear();
+    m_changesTicks = 0;
+    m_limitReached = false;
+    m_files.clear();
+}
+#endif
+
 void clFileSystemWatcher::RemoveFile(const wxFileName& filename)
 {
+#if CL_FSW_USE_INOTIFY
+    wxString fullpath = filename.GetFullPath();
+    if(m_watchedFiles.erase(fullpath)) {
+        m_changes.erase(fullpath);
+        // Stop watching the folder when its last file is removed
+        std::unordered_map<wxString, int>::iterator iter = m_watchDescriptors.find(filename.GetPath());
+        if(iter != m_watchDescriptors.end()) {
+            Folder& folder = m_folders[iter->second];
+            if(folder.filesCount) { --folder.filesCount; }
+            if(folder.filesCount == 0 && !folder.recursive) { DoUnwatchFolder(folder.path); }
+        }
+        return;
+    }
+#endif
 #if CL_FSW_USE_TIMER
     if(m_files.count(filename.GetFullPath())) {
         m_files.erase(filename.GetFullPath());
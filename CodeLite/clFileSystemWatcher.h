@@ -3,7 +3,9 @@
 
 #include "codelite_exports.h"
 #include "clFileSystemEvent.h"
+#include "macros.h"
 #include <map>
+#include <unordered_map>
 #include <wx/timer.h>
 #include <wx/filename.h>
 
@@ -13,6 +15,13 @@
 #define CL_FSW_USE_TIMER 1
 #endif
 
+// On Linux the timer collects the changes reported by inotify instead of checking every file
+#if CL_FSW_USE_TIMER && defined(__linux__)
+#define CL_FSW_USE_INOTIFY 1
+#else
+#define CL_FSW_USE_INOTIFY 0
+#endif
+
 #if !CL_FSW_USE_TIMER
 #include <wx/fswatcher.h>
 #endif
@@ -29,6 +38,7 @@ public:
 
     wxEvtHandler* m_owner;
 #if CL_FSW_USE_TIMER
+    // The files checked on every timer tick. With inotify, these are only the files that could not be watched
     clFileSystemWatcher::File::Map_t m_files;
     wxTimer* m_timer;
 #else
@@ -36,16 +46,48 @@ public:
     wxFileName m_watchedFile;
 #endif
 
+#if CL_FSW_USE_INOTIFY
+    struct Folder {
+        wxString path;
+        bool recursive = false; // report all the files in this folder (and watch its sub folders)
+        size_t filesCount = 0;  // number of files added with AddFile() in this folder
+    };
+
+    int m_inotifyFd;
+    std::unordered_map<int, Folder> m_folders;           // watch descriptor -> folder
+    std::unordered_map<wxString, int> m_watchDescriptors; // folder path -> watch descriptor
+    wxStringSet_t m_watchedFiles;                         // files added with AddFile() and watched by inotify
+    wxStringSet_t m_changes;                              // changes not reported yet
+    size_t m_changesTicks;
+    size_t m_ticks;
+    bool m_limitReached;
+#endif
+
 public:
     typedef wxSharedPtr<clFileSystemWatcher> Ptr_t;
 
 protected:
 #if CL_FSW_USE_TIMER
     void OnTimer(wxTimerEvent& event);
+    void DoCheckFiles();
+    void DoAddPolledFile(const wxFileName& filename);
 #else
     void OnFileModified(wxFileSystemWatcherEvent& event);
 #endif
 
+#if CL_FSW_USE_INOTIFY
+    /**
+     * @brief add an inotify watch for 'path'. Return false if the folder can not be watched (e.g. the watches limit
+     * is reached). 'alreadyWatched' is set to true when the folder was already watched (maybe through a symlink)
+     */
+    bool DoWatchFolder(const wxString& path, bool recursive, bool* alreadyWatched = nullptr);
+    void DoUnwatchFolder(const wxString& path);
+    void DoWatchTree(const wxString& path, bool reportFiles);
+    bool DoReadChanges();
+    void DoReportChanges();
+    void DoRemoveAll();
+#endif
+
 public:
     clFileSystemWatcher();
     virtual ~clFileSystemWatcher();
@@ -58,15 +100,29 @@ public:
      */
     void SetFile(const wxFileName& filename);
 
+    /**
+     * @brief add a file to the watch list, the files that are already watched are kept
+     */
+    void AddFile(const wxFileName& filename);
+
     /**
      * @brief remove file from the watch list
      */
     void RemoveFile(const wxFileName& filename);
 
+    /**
+     * @brief watch all the files of a folder tree (hidden folders excluded), including the files that are created
+     * after this call. With inotify, the cost does not depend on the number of files in the tree, and the folders
+     * created or deleted in the tree are reported as well.
+     * When the inotify watches limit is reached, the files found in the tree are checked by the timer instead
+     */
+    void AddFolder(const wxString& folder);
+
     /**
      * @brief start to watching list of files.
      * This object fires the following events (clFileSystemEvent):
-     * wxEVT_FILE_MODIFIED, wxEVT_FILE_DELETED
+     * wxEVT_FILE_MODIFIED, wxEVT_FILE_NOT_FOUND
+     * Changes are coalesced: a file that is modified several times in a short period is reported once
      */
     void Start();
 
@@ -6,6 +6,267 @@
 #include <wx/filename.h>
 #include <wx/tokenzr.h>
 
+#ifndef __WXMSW__
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace
+{
+// The number of files passed to the callback at once (unless the caller is idle)
+const size_t FILES_BATCH_SIZE = 512;
+
+#ifndef __WXMSW__
+std::string ToUTF8(const wxString& str)
+{
+    const wxScopedCharBuffer cb = str.utf8_str();
+    return std::string(cb.data(), cb.length());
+}
+
+std::string RealPath(const std::string& path)
+{
+    char* buf = ::realpath(path.c_str(), NULL);
+    if(!buf) { return path; }
+    std::string result(buf);
+    free(buf);
+    return result;
+}
+
+/**
+ * @class ParallelScanner
+ * @brief traverse a folder tree with a pool of threads. Every thread takes a folder from the shared stack, reads it
+ * with getdents64 (readdir() on other systems) and pushes the sub folders it finds back to the stack. The entry type
+ * is taken from d_type, so there is no stat() per entry (only for symlinks and file systems that do not report the
+ * type). The files are collected in batches and handed to the calling thread
+ */
+class ParallelScanner
+{
+    struct Folder {
+        std::string path;     // as it will be reported to the caller
+        std::string realPath; // symlinks resolved, this is what we compare against the excluded folders
+    };
+
+    const wxArrayString& m_spec;
+    const wxArrayString& m_excludeSpec;
+    std::unordered_set<std::string> m_excludeFolders;
+
+    std::mutex m_lock;
+    std::condition_variable m_workCond;
+    std::condition_variable m_resultsCond;
+    std::vector<Folder> m_folders;
+    std::unordered_set<std::string> m_visitedLinks;
+    std::vector<std::vector<wxString> > m_batches;
+    size_t m_busy = 0;
+    size_t m_finished = 0;
+    bool m_cancelled = false;
+
+protected:
+    void Worker();
+    void ReadFolder(const Folder& folder, std::vector<Folder>& subFolders, std::vector<wxString>& files);
+    void AddEntry(int dirfd, const Folder& folder, const char* name, unsigned char type,
+                  std::vector<Folder>& subFolders, std::vector<wxString>& files);
+    bool IsExcluded(const std::string& realPath) const { return m_excludeFolders.count(realPath) != 0; }
+
+public:
+    ParallelScanner(const wxArrayString& spec, const wxArrayString& excludeSpec, const wxStringSet_t& excludeFolders)
+        : m_spec(spec)
+        , m_excludeSpec(excludeSpec)
+    {
+        for(const wxString& folder : excludeFolders) {
+            m_excludeFolders.insert(ToUTF8(folder));
+        }
+    }
+
+    size_t Run(const wxString& rootFolder, const clFilesScanner::ScanCallback_t& callback);
+};
+
+size_t ParallelScanner::Run(const wxString& rootFolder, const clFilesScanner::ScanCallback_t& callback)
+{
+    Folder root;
+    root.path = ToUTF8(rootFolder);
+    while(root.path.size() > 1 && root.path.back() == '/') {
+        root.path.pop_back();
+    }
+    root.realPath = RealPath(root.path);
+    m_visitedLinks.insert(root.realPath);
+    m_folders.push_back(root);
+
+    size_t threadsCount = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < threadsCount; ++i) {
+        threads.push_back(std::thread([this]() { Worker(); }));
+    }
+
+    // Pass the results to the caller as they come
+    size_t count = 0;
+    std::unique_lock<std::mutex> locker(m_lock);
+    while(true) {
+        m_resultsCond.wait(locker, [&]() { return !m_batches.empty() || m_finished == threadsCount; });
+        if(m_batches.empty()) { break; }
+
+        std::vector<std::vector<wxString> > batches;
+        batches.swap(m_batches);
+        bool cancel = m_cancelled; // drain the queue without calling the callback again
+        locker.unlock();
+        for(const std::vector<wxString>& batch : batches) {
+            if(cancel) { break; }
+            count += batch.size();
+            cancel = !callback(batch);
+        }
+        locker.lock();
+        if(cancel && !m_cancelled) {
+            m_cancelled = true;
+            m_workCond.notify_all();
+        }
+    }
+    locker.unlock();
+
+    for(std::thread& thr : threads) {
+        thr.join();
+    }
+    return count;
+}
+
+void ParallelScanner::Worker()
+{
+    std::vector<wxString> files;
+    std::vector<Folder> subFolders;
+    std::unique_lock<std::mutex> locker(m_lock);
+    while(true) {
+        m_workCond.wait(locker, [&]() { return m_cancelled || !m_folders.empty() || m_busy == 0; });
+        if(m_cancelled || m_folders.empty()) { break; } // cancelled, or nothing left to scan
+
+        Folder folder = std::move(m_folders.back());
+        m_folders.pop_back();
+        ++m_busy;
+        locker.unlock();
+
+        ReadFolder(folder, subFolders, files);
+
+        locker.lock();
+        --m_busy;
+        bool done = m_folders.empty() && subFolders.empty() && m_busy == 0;
+        for(Folder& subFolder : subFolders) {
+            m_folders.push_back(std::move(subFolder));
+        }
+        subFolders.clear();
+
+        // Don't keep the caller waiting when it is idle
+        if(!files.empty() && (files.size() >= FILES_BATCH_SIZE || m_batches.empty())) {
+            m_batches.push_back(std::move(files));
+            files.clear();
+            m_resultsCond.notify_one();
+        }
+        if(!m_folders.empty() || done) { m_workCond.notify_all(); }
+    }
+
+    if(!files.empty()) { m_batches.push_back(std::move(files)); }
+    ++m_finished;
+    m_resultsCond.notify_one();
+}
+
+void ParallelScanner::ReadFolder(const Folder& folder, std::vector<Folder>& subFolders, std::vector<wxString>& files)
+{
+    int dirfd = ::openat(AT_FDCWD, folder.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirfd < 0) { return; }
+
+#ifdef __linux__
+    struct linux_dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    alignas(linux_dirent64) char buffer[32 * 1024];
+    while(true) {
+        long bytes = ::syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+        if(bytes <= 0) { break; }
+        for(long offset = 0; offset < bytes;) {
+            const linux_dirent64* entry = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+            AddEntry(dirfd, folder, entry->d_name, entry->d_type, subFolders, files);
+        }
+    }
+    ::close(dirfd);
+#else
+    DIR* dir = ::fdopendir(dirfd);
+    if(!dir) {
+        ::close(dirfd);
+        return;
+    }
+    struct dirent* entry = NULL;
+    while((entry = ::readdir(dir)) != NULL) {
+        AddEntry(dirfd, folder, entry->d_name, entry->d_type, subFolders, files);
+    }
+    ::closedir(dir); // closes dirfd as well
+#endif
+}
+
+void ParallelScanner::AddEntry(int dirfd, const Folder& folder, const char* name, unsigned char type,
+                               std::vector<Folder>& subFolders, std::vector<wxString>& files)
+{
+    if(name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) { return; }
+
+    struct stat st;
+    if(type == DT_UNKNOWN) {
+        // The file system does not report the type
+        if(::fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) { return; }
+        type = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISLNK(st.st_mode) ? DT_LNK : DT_REG);
+    }
+
+    std::string fullpath = folder.path;
+    if(fullpath.empty() || fullpath.back() != '/') { fullpath += '/'; }
+    fullpath += name;
+
+    if(type == DT_DIR) {
+        Folder subFolder;
+        subFolder.realPath = folder.realPath;
+        if(subFolder.realPath.empty() || subFolder.realPath.back() != '/') { subFolder.realPath += '/'; }
+        subFolder.realPath += name;
+        if(IsExcluded(subFolder.realPath)) { return; }
+        subFolder.path.swap(fullpath);
+        subFolders.push_back(std::move(subFolder));
+        return;
+    }
+
+    if(type == DT_LNK && ::fstatat(dirfd, name, &st, 0) == 0 && S_ISDIR(st.st_mode)) {
+        // A symlink to a folder: follow it, but only once (symlinks can create loops)
+        Folder subFolder;
+        subFolder.realPath = RealPath(fullpath);
+        if(IsExcluded(subFolder.realPath)) { return; }
+        {
+            std::lock_guard<std::mutex> locker(m_lock);
+            if(!m_visitedLinks.insert(subFolder.realPath).second) { return; }
+        }
+        subFolder.path.swap(fullpath);
+        subFolders.push_back(std::move(subFolder));
+        return;
+    }
+
+    // Anything else (including broken symlinks) is a file
+    wxString filename = wxString::FromUTF8(name);
+    if(FileUtils::WildMatch(m_excludeSpec, filename) || !FileUtils::WildMatch(m_spec, filename)) { return; }
+    files.push_back(wxString::FromUTF8(fullpath.c_str(), fullpath.length()));
+}
+#endif
+} // namespace
+
 clFilesScanner::clFilesScanner() {}
 
 clFilesScanner::~clFilesScanner() {}
@@ -14,6 +275,18 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& f
                             const wxString& excludeFilespec, const wxStringSet_t& excludeFolders)
 {
     filesOutput.clear();
+    Scan(rootFolder,
+         [&](const std::vector<wxString>& files) {
+             filesOutput.insert(filesOutput.end(), files.begin(), files.end());
+             return true;
+         },
+         filespec, excludeFilespec, excludeFolders);
+    return filesOutput.size();
+}
+
+size_t clFilesScanner::Scan(const wxString& rootFolder, const ScanCallback_t& callback, const wxString& filespec,
+                            const wxString& excludeFilespec, const wxStringSet_t& excludeFolders)
+{
     if(!wxFileName::DirExists(rootFolder)) {
         clDEBUG() << "clFilesScanner: No such dir:" << rootFolder << clEndl;
         return 0;
@@ -21,6 +294,13 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& f
 
     wxArrayString specArr = ::wxStringTokenize(filespec.Lower(), ";,|", wxTOKEN_STRTOK);
     wxArrayString excludeSpecArr = ::wxStringTokenize(excludeFilespec.Lower(), ";,|", wxTOKEN_STRTOK);
+
+#ifndef __WXMSW__
+    ParallelScanner scanner(specArr, excludeSpecArr, excludeFolders);
+    return scanner.Run(rootFolder, callback);
+#else
+    size_t count = 0;
+    std::vector<wxString> filesOutput;
     std::queue<wxString> Q;
     Q.push(rootFolder);
 
@@ -38,7 +318,6 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& f
             wxString fullpath;
             fullpath << dir.GetNameWithSep() << filename;
             bool isDirectory = wxFileName::DirExists(fullpath);
-            // Use FileUtils::RealPath() here to cope with symlinks on Linux
             if(isDirectory && (excludeFolders.count(FileUtils::RealPath(fullpath)) == 0)) {
                 // Traverse into this folder
                 Q.push(fullpath);
@@ -50,8 +329,20 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& f
             }
             cont = dir.GetNext(&filename);
         }
+
+        if(filesOutput.size() >= FILES_BATCH_SIZE) {
+            count += filesOutput.size();
+            if(!callback(filesOutput)) { return count; }
+            filesOutput.clear();
+        }
     }
-    return filesOutput.size();
+
+    if(!filesOutput.empty()) {
+        count += filesOutput.size();
+        callback(filesOutput);
+    }
+    return count;
+#endif
 }
 
 size_t clFilesScanner::ScanNoRecurse(const wxString& rootFolder, clFilesScanner::EntryData::Vec_t& results,
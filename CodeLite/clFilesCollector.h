@@ -3,6 +3,7 @@
 
 #include "codelite_exports.h"
 #include "macros.h"
+#include <functional>
 #include <vector>
 #include <wx/string.h>
 
@@ -23,6 +24,11 @@ public:
         kIsSymlink = (1 << 3),
     };
 
+    /**
+     * @brief receives the files found by Scan(), in batches. Return false to stop the scan
+     */
+    typedef std::function<bool(const std::vector<wxString>& files)> ScanCallback_t;
+
 public:
     clFilesScanner();
     virtual ~clFilesScanner();
@@ -38,6 +44,15 @@ public:
     size_t Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const wxString& filespec = "*",
                 const wxString& excludeFilespec = "", const wxStringSet_t& excludeFolders = wxStringSet_t());
 
+    /**
+     * @brief same as above, but the files are passed to 'callback' while the scan is in progress instead of being
+     * collected. On Unix, the folders are read in parallel by a pool of threads; the files come in no particular order.
+     * 'callback' is always called from the calling thread
+     * @return number of files found
+     */
+    size_t Scan(const wxString& rootFolder, const ScanCallback_t& callback, const wxString& filespec = "*",
+                const wxString& excludeFilespec = "", const wxStringSet_t& excludeFolders = wxStringSet_t());
+
     /**
      * @brief scan folder for files and folders. This function does not recurse into folders. Everything that matches
      * "matchSpec" will get collected.
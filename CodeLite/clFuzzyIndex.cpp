@@ -0,0 +1,119 @@
+#include "clFuzzyIndex.h"
+#include "clFuzzyMatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <wx/tokenzr.h>
+
+// Indexes smaller than this are searched by the calling thread
+#define FUZZY_INDEX_PARALLEL_THRESHOLD 8192
+#define FUZZY_INDEX_CHUNK_SIZE 2048
+#define FUZZY_INDEX_MAX_THREADS 8
+// Added to the score of the words matched in the candidate name
+#define FUZZY_INDEX_NAME_BONUS 16
+
+namespace
+{
+/// Best match first. Equal scores keep the order in which the candidates were added
+struct BetterMatch {
+    bool operator()(const clFuzzyIndex::Match& a, const clFuzzyIndex::Match& b) const
+    {
+        if(a.score != b.score) { return a.score > b.score; }
+        return a.index < b.index;
+    }
+};
+
+/// Keep the 'maxResults' best matches in 'heap'. The heap front is the worst of them
+void PushMatch(clFuzzyIndex::Vec_t& heap, size_t maxResults, const clFuzzyIndex::Match& match)
+{
+    if(heap.size() < maxResults) {
+        heap.push_back(match);
+        std::push_heap(heap.begin(), heap.end(), BetterMatch());
+    } else if(BetterMatch()(match, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), BetterMatch());
+        heap.back() = match;
+        std::push_heap(heap.begin(), heap.end(), BetterMatch());
+    }
+}
+} // namespace
+
+clFuzzyIndex::clFuzzyIndex() {}
+
+clFuzzyIndex::~clFuzzyIndex() {}
+
+size_t clFuzzyIndex::Add(const wxString& text, const wxString& name)
+{
+    Entry entry;
+    entry.text = text;
+    entry.lcText = text.Lower();
+    entry.name = name;
+    entry.lcName = name.Lower();
+    m_entries.push_back(entry);
+    return m_entries.size() - 1;
+}
+
+void clFuzzyIndex::Query(const wxString& pattern, size_t maxResults, Vec_t& matches) const
+{
+    matches.clear();
+    if(maxResults == 0 || m_entries.empty()) { return; }
+
+    std::vector<clFuzzyMatcher> matchers;
+    wxArrayString words = ::wxStringTokenize(pattern, " \t", wxTOKEN_STRTOK);
+    for(size_t i = 0; i < words.GetCount(); ++i) {
+        matchers.push_back(clFuzzyMatcher(words.Item(i)));
+    }
+
+    // Every word must match, the candidate score is the sum of the words scores
+    auto scoreEntry = [&](const Entry& entry) {
+        int total = 0;
+        for(const clFuzzyMatcher& matcher : matchers) {
+            int score = wxNOT_FOUND;
+            if(!entry.lcName.IsEmpty() && matcher.Matches(entry.lcName)) {
+                score = matcher.Score(entry.name, entry.lcName) + FUZZY_INDEX_NAME_BONUS;
+            } else if(matcher.Matches(entry.lcText)) {
+                score = matcher.Score(entry.text, entry.lcText);
+            }
+            if(score == wxNOT_FOUND) { return wxNOT_FOUND; }
+            total += score;
+        }
+        return total;
+    };
+
+    // Each thread keeps its own best matches, they are merged once all the chunks are scanned
+    size_t chunks = (m_entries.size() + FUZZY_INDEX_CHUNK_SIZE - 1) / FUZZY_INDEX_CHUNK_SIZE;
+    size_t threadsCount = 1;
+    if(m_entries.size() >= FUZZY_INDEX_PARALLEL_THRESHOLD) {
+        threadsCount = std::max(1u, std::thread::hardware_concurrency());
+        threadsCount = std::min<size_t>(std::min<size_t>(threadsCount, FUZZY_INDEX_MAX_THREADS), chunks);
+    }
+
+    std::vector<Vec_t> results(threadsCount);
+    std::atomic_size_t nextChunk(0);
+    auto worker = [&](Vec_t& heap) {
+        for(size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+            size_t last = std::min(m_entries.size(), (chunk + 1) * FUZZY_INDEX_CHUNK_SIZE);
+            for(size_t i = chunk * FUZZY_INDEX_CHUNK_SIZE; i < last; ++i) {
+                int score = scoreEntry(m_entries[i]);
+                if(score != wxNOT_FOUND) { PushMatch(heap, maxResults, { i, score }); }
+            }
+        }
+    };
+
+    if(threadsCount == 1) {
+        worker(results[0]);
+    } else {
+        std::vector<std::thread> threads;
+        for(size_t i = 0; i < threadsCount; ++i) {
+            threads.push_back(std::thread(worker, std::ref(results[i])));
+        }
+        for(std::thread& thr : threads) {
+            thr.join();
+        }
+    }
+
+    for(const Vec_t& result : results) {
+        matches.insert(matches.end(), result.begin(), result.end());
+    }
+    std::sort(matches.begin(), matches.end(), BetterMatch());
+    if(matches.size() > maxResults) { matches.resize(maxResults); }
+}
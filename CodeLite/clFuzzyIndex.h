@@ -0,0 +1,62 @@
+#ifndef CLFUZZYINDEX_H
+#define CLFUZZYINDEX_H
+
+#include "codelite_exports.h"
+#include <vector>
+#include <wx/string.h>
+
+/**
+ * @class clFuzzyIndex
+ * @brief an in-memory list of candidates (file paths, symbols, actions...) that can be searched with a fuzzy pattern.
+ * The lower case form of every candidate is computed once, when it is added. A query scores all the candidates with
+ * clFuzzyMatcher, splitting large indexes between threads, and returns the best matches only
+ */
+class WXDLLIMPEXP_CL clFuzzyIndex
+{
+public:
+    struct Match {
+        size_t index; // the value returned by Add()
+        int score;
+    };
+    typedef std::vector<Match> Vec_t;
+
+protected:
+    struct Entry {
+        wxString text;
+        wxString lcText;
+        wxString name; // optional: the short name of the candidate (i.e. the file name of a path)
+        wxString lcName;
+    };
+
+    std::vector<Entry> m_entries;
+
+public:
+    clFuzzyIndex();
+    virtual ~clFuzzyIndex();
+
+    void Clear() { m_entries.clear(); }
+    void Swap(clFuzzyIndex& other) { m_entries.swap(other.m_entries); }
+    void Reserve(size_t count) { m_entries.reserve(count); }
+    size_t GetCount() const { return m_entries.size(); }
+    bool IsEmpty() const { return m_entries.empty(); }
+
+    /**
+     * @brief add a candidate and return its index. When 'name' is provided, matches found in the name rank higher than
+     * matches found elsewhere in 'text'
+     */
+    size_t Add(const wxString& text, const wxString& name = wxEmptyString);
+
+    /**
+     * @brief return the text of the candidate at 'index'
+     */
+    const wxString& GetText(size_t index) const { return m_entries[index].text; }
+
+    /**
+     * @brief find the candidates that match 'pattern' and return at most 'maxResults' of them, best match first.
+     * The pattern is split on whitespace and every word must match. Can be called from multiple threads as long as
+     * the index is not modified
+     */
+    void Query(const wxString& pattern, size_t maxResults, Vec_t& matches) const;
+};
+
+#endif // CLFUZZYINDEX_H
@@ -0,0 +1,99 @@
+#include "clFuzzyMatcher.h"
+#include <algorithm>
+#include <wx/wxcrt.h>
+
+// Scores given to every matched character
+#define FUZZY_MATCH_SCORE 1
+#define FUZZY_WORD_START_BONUS 8
+#define FUZZY_CONSECUTIVE_BONUS 4
+#define FUZZY_SAME_CASE_BONUS 1
+
+namespace
+{
+/// Does 'cur' start a word? (first char, after a separator, or a camelCase hump)
+inline bool IsWordStart(wxUniChar prev, wxUniChar cur)
+{
+    if(prev == 0 || !wxIsalnum(prev)) { return wxIsalnum(cur); }
+    return wxIsupper(cur) && !wxIsupper(prev);
+}
+
+/// Greedily match the pattern from 'start'. 'prev' is the character before 'start' (0 at the beginning of the text)
+int ScoreFrom(const wxString& text, const wxString& lcText, wxString::const_iterator iter,
+              wxString::const_iterator lcIter, wxUniChar prev, const wxString& pattern, const wxString& lcPattern,
+              size_t offset)
+{
+    wxString::const_iterator patternIter = pattern.begin();
+    wxString::const_iterator lcPatternIter = lcPattern.begin();
+    int score = 0;
+    int gaps = 0;
+    bool consecutive = false;
+    for(; lcIter != lcText.end() && lcPatternIter != lcPattern.end(); ++iter, ++lcIter) {
+        wxUniChar cur = *iter;
+        if(*lcIter == *lcPatternIter) {
+            score += FUZZY_MATCH_SCORE;
+            if(IsWordStart(prev, cur)) { score += FUZZY_WORD_START_BONUS; }
+            if(consecutive) { score += FUZZY_CONSECUTIVE_BONUS; }
+            if(cur == *patternIter) { score += FUZZY_SAME_CASE_BONUS; }
+            consecutive = true;
+            ++patternIter;
+            ++lcPatternIter;
+        } else {
+            consecutive = false;
+            ++gaps;
+        }
+        prev = cur;
+    }
+    if(lcPatternIter != lcPattern.end()) { return wxNOT_FOUND; }
+
+    // Prefer compact matches, close to the start of shorter texts
+    score -= gaps / 2;
+    score -= std::min<size_t>(offset, 16) / 4;
+    score -= std::min<size_t>(text.length() - pattern.length(), 32) / 8;
+    return std::max(score, 0);
+}
+} // namespace
+
+clFuzzyMatcher::clFuzzyMatcher(const wxString& pattern) { SetPattern(pattern); }
+
+clFuzzyMatcher::~clFuzzyMatcher() {}
+
+void clFuzzyMatcher::SetPattern(const wxString& pattern)
+{
+    m_pattern = pattern;
+    m_lcPattern = pattern.Lower();
+}
+
+bool clFuzzyMatcher::Matches(const wxString& lcText) const
+{
+    wxString::const_iterator patternIter = m_lcPattern.begin();
+    for(wxString::const_iterator iter = lcText.begin(); iter != lcText.end() && patternIter != m_lcPattern.end();
+        ++iter) {
+        if(*iter == *patternIter) { ++patternIter; }
+    }
+    return patternIter == m_lcPattern.end();
+}
+
+int clFuzzyMatcher::Score(const wxString& text, const wxString& lcText) const
+{
+    if(m_lcPattern.IsEmpty()) { return 0; }
+    if(text.length() != lcText.length() || text.length() < m_pattern.length()) { return wxNOT_FOUND; }
+
+    // The greedy match is tried from the first occurrence of the pattern's first char and from every word that starts
+    // with it, so "val" scores the "Value" of "intervalValue" and not the "val" of "interval"
+    wxUniChar first = *m_lcPattern.begin();
+    wxUniChar prev = 0;
+    int best = wxNOT_FOUND;
+    size_t offset = 0;
+    wxString::const_iterator iter = text.begin();
+    for(wxString::const_iterator lcIter = lcText.begin(); lcIter != lcText.end(); ++iter, ++lcIter, ++offset) {
+        wxUniChar cur = *iter;
+        if(*lcIter == first && (best == wxNOT_FOUND || IsWordStart(prev, cur))) {
+            int score = ScoreFrom(text, lcText, iter, lcIter, prev, m_pattern, m_lcPattern, offset);
+            // no match from here means no match further to the right either
+            if(score == wxNOT_FOUND) { break; }
+            best = std::max(best, score);
+        }
+        prev = cur;
+    }
+    return best;
+}
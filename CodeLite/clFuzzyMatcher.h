@@ -0,0 +1,39 @@
+#ifndef CLFUZZYMATCHER_H
+#define CLFUZZYMATCHER_H
+
+#include "codelite_exports.h"
+#include <wx/string.h>
+
+/**
+ * @class clFuzzyMatcher
+ * @brief match a pattern against candidates as a (case insensitive) subsequence and score the match.
+ * Matches that start a word ("get_value", "Value" in "getValue", a path component...) and consecutive matches score
+ * higher. The candidates are passed together with their lower case form, so callers that filter the same list over
+ * and over (i.e. on every keystroke) can compute it once. Scoring does not allocate memory
+ */
+class WXDLLIMPEXP_CL clFuzzyMatcher
+{
+    wxString m_pattern;
+    wxString m_lcPattern;
+
+public:
+    clFuzzyMatcher(const wxString& pattern = wxEmptyString);
+    virtual ~clFuzzyMatcher();
+
+    void SetPattern(const wxString& pattern);
+    const wxString& GetPattern() const { return m_pattern; }
+    const wxString& GetLowerPattern() const { return m_lcPattern; }
+
+    /**
+     * @brief return true if the pattern is a subsequence of 'lcText' (the lower case form of the candidate)
+     */
+    bool Matches(const wxString& lcText) const;
+
+    /**
+     * @brief score 'text' (its lower case form is 'lcText'). Return wxNOT_FOUND if the pattern is not a subsequence
+     * of the text, otherwise a non negative score: the higher the better
+     */
+    int Score(const wxString& text, const wxString& lcText) const;
+};
+
+#endif // CLFUZZYMATCHER_H
@@ -0,0 +1,131 @@
+#include "clMappedFile.h"
+#include "fileutils.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+clMappedFile::clMappedFile() {}
+
+clMappedFile::~clMappedFile() { Close(); }
+
+bool clMappedFile::Open(const wxFileName& fn, size_t maxSize)
+{
+    Close();
+    wxString filename = fn.GetFullPath();
+
+#ifdef __WXMSW__
+    HANDLE file = ::CreateFileW(filename.wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        clERROR() << "Failed to open file:" << filename << "." << (int)::GetLastError();
+        return false;
+    }
+
+    LARGE_INTEGER fsize;
+    if(!::GetFileSizeEx(file, &fsize) || (maxSize && (size_t)fsize.QuadPart > maxSize)) {
+        ::CloseHandle(file);
+        return false;
+    }
+
+    if(fsize.QuadPart == 0) {
+        // empty files can not be mapped
+        ::CloseHandle(file);
+        m_data = m_buffer.c_str();
+        return true;
+    }
+
+    HANDLE mapping = ::CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) {
+        clERROR() << "Failed to map file:" << filename << "." << (int)::GetLastError();
+        ::CloseHandle(file);
+        return false;
+    }
+
+    m_data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!m_data) {
+        clERROR() << "Failed to map file:" << filename << "." << (int)::GetLastError();
+        ::CloseHandle(mapping);
+        ::CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_size = (size_t)fsize.QuadPart;
+    m_mapped = true;
+    return true;
+#else
+    const wxCharBuffer cfile = filename.mb_str(wxConvUTF8);
+    int fd = ::open(cfile.data(), O_RDONLY);
+    if(fd < 0) {
+        clERROR() << "Failed to open file:" << filename << "." << strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if((::fstat(fd, &st) != 0) || (maxSize && (size_t)st.st_size > maxSize)) {
+        ::close(fd);
+        return false;
+    }
+
+    if(!S_ISREG(st.st_mode) || st.st_size == 0) {
+        // pipes, devices and empty files can not be mapped, read them instead
+        ::close(fd);
+        if(!FileUtils::ReadFileContentRaw(fn, m_buffer)) { return false; }
+        m_data = m_buffer.c_str();
+        m_size = m_buffer.size();
+        return true;
+    }
+
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if(addr == MAP_FAILED) {
+        clERROR() << "Failed to map file:" << filename << "." << strerror(errno);
+        return false;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    // we usually scan the file from top to bottom
+    ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    m_data = static_cast<const char*>(addr);
+    m_size = st.st_size;
+    m_mapped = true;
+    return true;
+#endif
+}
+
+void clMappedFile::Close()
+{
+    if(m_mapped) {
+#ifdef __WXMSW__
+        ::UnmapViewOfFile(m_data);
+        ::CloseHandle(m_mapping);
+        ::CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = nullptr;
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    m_mapped = false;
+    m_data = nullptr;
+    m_size = 0;
+    m_buffer.clear();
+}
+
+bool clMappedFile::IsBinary(size_t headerSize) const
+{
+    return FileUtils::IsBinaryContent(m_data, std::min(headerSize, m_size));
+}
@@ -0,0 +1,63 @@
+#ifndef CLMAPPEDFILE_H
+#define CLMAPPEDFILE_H
+
+#include "codelite_exports.h"
+#include <string>
+#include <wx/filename.h>
+
+/**
+ * @class clMappedFile
+ * @brief a read-only, zero-copy view of a file content. The file is mapped into the process address space, so only the
+ * pages that are actually inspected are read from the disk. Use it when the content is going to be scanned as raw bytes
+ * (search, binary detection etc) and there is no need to convert it into wxString
+ */
+class WXDLLIMPEXP_CL clMappedFile
+{
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+#ifdef __WXMSW__
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+
+    // files that can not be mapped (e.g. empty files) are read into this buffer instead
+    std::string m_buffer;
+
+private:
+    clMappedFile(const clMappedFile&);
+    clMappedFile& operator=(const clMappedFile&);
+
+public:
+    clMappedFile();
+    virtual ~clMappedFile();
+
+    /**
+     * @brief map 'fn' into memory. Any previously opened file is closed
+     * @param maxSize when set to a non zero value, files larger than maxSize are rejected before they are mapped
+     * @return true on success
+     */
+    bool Open(const wxFileName& fn, size_t maxSize = 0);
+
+    /**
+     * @brief unmap the file
+     */
+    void Close();
+
+    bool IsOpened() const { return m_data != nullptr; }
+
+    /**
+     * @brief return true if the first 'headerSize' bytes of the file contain a NULL byte. Only the header bytes are
+     * touched
+     */
+    bool IsBinary(size_t headerSize = 4096) const;
+
+    // std::string_view like accessors
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+};
+
+#endif // CLMAPPEDFILE_H
@@ -0,0 +1,400 @@
+#include "clProcessIOReactor.h"
+
+#if defined(__WXGTK__) || defined(__WXMAC__)
+#include "StringUtils.h"
+#include "asyncprocess.h"
+#include "file_logger.h"
+#include "processreaderthread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#define BUFF_SIZE 1024 * 64
+
+// When processes without redirection are registered, check if they are still alive every 50ms
+#define ALIVE_CHECK_INTERVAL_MS 50
+
+namespace
+{
+/**
+ * @brief return the length of the longest prefix of 'buffer' that does not end in the middle of a UTF-8 sequence
+ */
+size_t CompleteUTF8Length(const std::string& buffer)
+{
+    size_t len = buffer.length();
+    for(size_t i = len; i > 0 && (len - i) < 4; --i) {
+        unsigned char ch = buffer[i - 1];
+        if((ch & 0xC0) == 0x80) { continue; } // continuation byte
+        size_t needed = 1;
+        if((ch & 0xE0) == 0xC0) {
+            needed = 2;
+        } else if((ch & 0xF0) == 0xE0) {
+            needed = 3;
+        } else if((ch & 0xF8) == 0xF0) {
+            needed = 4;
+        }
+        return (len - (i - 1)) >= needed ? len : (i - 1);
+    }
+    return len;
+}
+
+/**
+ * @brief convert the complete part of 'buffer' to wxString and remove it from the buffer.
+ * When 'all' is false, an incomplete UTF-8 sequence at the end of the buffer is kept for the next round
+ */
+wxString TakeOutput(std::string& buffer, bool rawOutput, bool all)
+{
+    size_t len = all ? buffer.length() : CompleteUTF8Length(buffer);
+    if(len == 0) { return wxEmptyString; }
+
+    std::string chunk = buffer.substr(0, len);
+    buffer.erase(0, len);
+
+    // Remove coloring chars from the incomnig buffer
+    // colors are marked with ESC and terminates with lower case 'm'
+    if(!rawOutput) {
+        std::string stripped;
+        StringUtils::StripTerminalColouring(chunk, stripped);
+        chunk.swap(stripped);
+    }
+    wxString output = wxString(chunk.c_str(), wxConvUTF8);
+    if(output.IsEmpty()) { output = wxString::From8BitData(chunk.c_str()); }
+    return output;
+}
+
+void SetCloseOnExec(int fd) { ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC); }
+} // namespace
+
+clProcessIOReactor::clProcessIOReactor() { m_shutdown.store(false); }
+
+clProcessIOReactor::~clProcessIOReactor()
+{
+    if(m_thread) {
+        m_shutdown.store(true);
+        Wakeup();
+        m_thread->join();
+        wxDELETE(m_thread);
+    }
+    if(m_pollFd != wxNOT_FOUND) { ::close(m_pollFd); }
+    DoClosePipe();
+}
+
+void clProcessIOReactor::DoClosePipe()
+{
+    for(int& fd : m_wakeupPipe) {
+        if(fd != wxNOT_FOUND) { ::close(fd); }
+        fd = wxNOT_FOUND;
+    }
+}
+
+clProcessIOReactor& clProcessIOReactor::Get()
+{
+    static clProcessIOReactor reactor;
+    return reactor;
+}
+
+void clProcessIOReactor::Start()
+{
+    // Called with m_mutex locked
+    if(m_thread) { return; }
+
+    if(::pipe(m_wakeupPipe) != 0) {
+        clERROR() << "clProcessIOReactor: failed to create the wakeup pipe." << strerror(errno) << clEndl;
+        return;
+    }
+    // The processes we spawn must not inherit our file descriptors
+    for(int fd : m_wakeupPipe) {
+        SetCloseOnExec(fd);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+#ifdef __linux__
+    m_pollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if(m_pollFd < 0) {
+        clERROR() << "clProcessIOReactor: epoll_create1 error." << strerror(errno) << clEndl;
+        m_pollFd = wxNOT_FOUND;
+        DoClosePipe();
+        return;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    if(::epoll_ctl(m_pollFd, EPOLL_CTL_ADD, m_wakeupPipe[0], &ev) != 0) {
+        clERROR() << "clProcessIOReactor: epoll_ctl(ADD) error." << strerror(errno) << clEndl;
+        ::close(m_pollFd);
+        m_pollFd = wxNOT_FOUND;
+        DoClosePipe();
+        return;
+    }
+#endif
+    m_thread = new std::thread(&clProcessIOReactor::WorkerMain, this);
+}
+
+void clProcessIOReactor::Wakeup()
+{
+    if(m_wakeupPipe[1] == wxNOT_FOUND) { return; }
+    char ch = 'x';
+    // the pipe is non-blocking: if it is full, the reactor is going to wake up anyway
+    ssize_t rc = ::write(m_wakeupPipe[1], &ch, 1);
+    wxUnusedVar(rc);
+}
+
+uint64_t clProcessIOReactor::WatchFd(IProcess* process, int fd, bool isStderr)
+{
+    uint64_t token = m_nextToken++;
+#ifdef __linux__
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = token;
+    if(::epoll_ctl(m_pollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        clERROR() << "clProcessIOReactor: epoll_ctl(ADD) error." << strerror(errno) << clEndl;
+        return 0;
+    }
+#endif
+    WatchedFd& watched = m_watches[token];
+    watched.process = process;
+    watched.fd = fd;
+    watched.isStderr = isStderr;
+    return token;
+}
+
+void clProcessIOReactor::UnwatchFd(uint64_t& token)
+{
+    auto iter = m_watches.find(token);
+    token = 0;
+    if(iter == m_watches.end()) { return; }
+#ifdef __linux__
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ::epoll_ctl(m_pollFd, EPOLL_CTL_DEL, iter->second.fd, &ev);
+#endif
+    m_watches.erase(iter);
+}
+
+bool clProcessIOReactor::Register(IProcess* process, wxEvtHandler* parent, IProcessCallback* callback, int stdoutFd,
+                                  int stderrFd, size_t flags)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Start();
+    if(!m_thread) { return false; }
+
+    Channel& channel = m_channels[process];
+    channel.parent = parent;
+    channel.callback = callback;
+    channel.rawOutput = (flags & IProcessRawOutput);
+    channel.redirect = !(flags & IProcessNoRedirect);
+
+    if(channel.redirect) {
+        channel.stdoutToken = WatchFd(process, stdoutFd, false);
+        if(stderrFd != wxNOT_FOUND) { channel.stderrToken = WatchFd(process, stderrFd, true); }
+    } else {
+        ++m_unredirectedCount;
+    }
+    // let the reactor pick up the new descriptors (and the new timeout)
+    Wakeup();
+    return true;
+}
+
+void clProcessIOReactor::Unregister(IProcess* process)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_channels.find(process);
+    if(iter == m_channels.end()) { return; }
+
+    Channel& channel = iter->second;
+    UnwatchFd(channel.stdoutToken);
+    UnwatchFd(channel.stderrToken);
+    if(!channel.redirect && !channel.terminated) { --m_unredirectedCount; }
+    m_channels.erase(iter);
+    Wakeup();
+}
+
+bool clProcessIOReactor::DoRead(int fd, std::string& output)
+{
+    char buffer[BUFF_SIZE];
+    ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
+    if(bytesRead > 0) {
+        output.append(buffer, bytesRead);
+        return true;
+    }
+    if(bytesRead < 0 && (errno == EINTR || errno == EAGAIN)) { return true; }
+    // EOF (the pty returns EIO once the process closed its end)
+    return false;
+}
+
+void clProcessIOReactor::DoTerminate(Channel& channel)
+{
+    UnwatchFd(channel.stdoutToken);
+    UnwatchFd(channel.stderrToken);
+    if(!channel.redirect) { --m_unredirectedCount; }
+    channel.terminated = true;
+}
+
+void clProcessIOReactor::DoScheduleFlush()
+{
+    if(m_flushPending) { return; }
+    m_flushPending = true;
+    CallAfter(&clProcessIOReactor::Flush);
+}
+
+void clProcessIOReactor::WorkerMain()
+{
+    std::vector<uint64_t> readyTokens;
+#ifdef __linux__
+    struct epoll_event events[64];
+#else
+    std::vector<struct pollfd> pollFds;
+    std::vector<uint64_t> pollTokens;
+#endif
+
+    while(!m_shutdown.load()) {
+        int timeout = -1;
+        readyTokens.clear();
+#ifdef __linux__
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_unredirectedCount) { timeout = ALIVE_CHECK_INTERVAL_MS; }
+        }
+        int count = ::epoll_wait(m_pollFd, events, sizeof(events) / sizeof(events[0]), timeout);
+        if(count < 0 && errno != EINTR) {
+            clERROR() << "clProcessIOReactor: epoll_wait error." << strerror(errno) << clEndl;
+            break;
+        }
+        for(int i = 0; i < count; ++i) {
+            readyTokens.push_back(events[i].data.u64);
+        }
+#else
+        pollFds.clear();
+        pollTokens.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_unredirectedCount) { timeout = ALIVE_CHECK_INTERVAL_MS; }
+            struct pollfd pfd = { m_wakeupPipe[0], POLLIN, 0 };
+            pollFds.push_back(pfd);
+            pollTokens.push_back(0);
+            for(const auto& vt : m_watches) {
+                pfd.fd = vt.second.fd;
+                pollFds.push_back(pfd);
+                pollTokens.push_back(vt.first);
+            }
+        }
+        int count = ::poll(pollFds.data(), pollFds.size(), timeout);
+        if(count < 0 && errno != EINTR) {
+            clERROR() << "clProcessIOReactor: poll error." << strerror(errno) << clEndl;
+            break;
+        }
+        for(size_t i = 0; count > 0 && i < pollFds.size(); ++i) {
+            if(pollFds[i].revents) { readyTokens.push_back(pollTokens[i]); }
+        }
+#endif
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool notify = false;
+        for(uint64_t token : readyTokens) {
+            if(token == 0) {
+                // drain the wakeup pipe
+                char buffer[64];
+                while(::read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0) {}
+                continue;
+            }
+
+            // the process might have been unregistered while we were waiting
+            auto iter = m_watches.find(token);
+            if(iter == m_watches.end()) { continue; }
+            WatchedFd watched = iter->second;
+            Channel& channel = m_channels[watched.process];
+            if(DoRead(watched.fd, watched.isStderr ? channel.errors : channel.output)) {
+                notify = true;
+            } else if(!watched.isStderr) {
+                // Process terminated
+                // the exit code will be set in the sigchld event handler
+                DoTerminate(channel);
+                notify = true;
+            } else {
+                // stderr was closed, keep reading stdout
+                UnwatchFd(channel.stderrToken);
+            }
+        }
+
+        // Processes without redirection: all we can do is check that they are still alive
+        if(m_unredirectedCount) {
+            for(auto& vt : m_channels) {
+                if(!vt.second.redirect && !vt.second.terminated && !vt.first->IsAlive()) {
+                    DoTerminate(vt.second);
+                    notify = true;
+                }
+            }
+        }
+        if(notify) { DoScheduleFlush(); }
+    }
+    clDEBUG() << "clProcessIOReactor: going down" << clEndl;
+}
+
+void clProcessIOReactor::Flush()
+{
+    struct Notification {
+        IProcess* process;
+        wxEvtHandler* parent;
+        IProcessCallback* callback;
+        wxString output;
+        wxString errors;
+        bool terminated;
+    };
+
+    std::vector<Notification> notifications;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flushPending = false;
+        for(auto iter = m_channels.begin(); iter != m_channels.end();) {
+            Channel& channel = iter->second;
+            Notification n = { iter->first, channel.parent, channel.callback,
+                               TakeOutput(channel.output, channel.rawOutput, channel.terminated),
+                               TakeOutput(channel.errors, channel.rawOutput, channel.terminated), channel.terminated };
+            if(!n.output.IsEmpty() || !n.errors.IsEmpty() || n.terminated) { notifications.push_back(n); }
+            if(channel.terminated) {
+                iter = m_channels.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    for(const Notification& n : notifications) {
+        // If we got a callback object, use it
+        if(n.callback) {
+            if(!n.output.IsEmpty()) { n.callback->CallAfter(&IProcessCallback::OnProcessOutput, n.output); }
+            if(n.terminated) { n.callback->CallAfter(&IProcessCallback::OnProcessTerminated); }
+            continue;
+        }
+        if(!n.parent) { continue; }
+
+        // We fire an event per data (stderr/stdout)
+        if(!n.output.IsEmpty()) {
+            clProcessEvent e(wxEVT_ASYNC_PROCESS_OUTPUT);
+            e.SetOutput(n.output);
+            e.SetProcess(n.process);
+            n.parent->AddPendingEvent(e);
+        }
+        if(!n.errors.IsEmpty()) {
+            clProcessEvent e(wxEVT_ASYNC_PROCESS_STDERR);
+            e.SetOutput(n.errors);
+            e.SetProcess(n.process);
+            n.parent->AddPendingEvent(e);
+        }
+        if(n.terminated) {
+            clProcessEvent e(wxEVT_ASYNC_PROCESS_TERMINATED);
+            e.SetProcess(n.process);
+            n.parent->AddPendingEvent(e);
+        }
+    }
+}
+#endif // defined(__WXGTK__) || defined(__WXMAC__)
@@ -0,0 +1,105 @@
+#ifndef CLPROCESSIOREACTOR_H
+#define CLPROCESSIOREACTOR_H
+
+#if defined(__WXGTK__) || defined(__WXMAC__)
+#include "codelite_exports.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <wx/event.h>
+
+class IProcess;
+class IProcessCallback;
+
+/**
+ * @class clProcessIOReactor
+ * @brief a single thread that waits for the output of all the async processes (epoll on Linux, poll() elsewhere).
+ * The output is delivered on the main thread: everything that arrived from a process between two iterations of the
+ * event loop is coalesced into a single wxEVT_ASYNC_PROCESS_OUTPUT / wxEVT_ASYNC_PROCESS_STDERR event.
+ * This replaces the reader thread per process (ProcessReaderThread) that polled each process every 10ms
+ */
+class WXDLLIMPEXP_CL clProcessIOReactor : public wxEvtHandler
+{
+    struct Channel {
+        wxEvtHandler* parent = nullptr;
+        IProcessCallback* callback = nullptr;
+        uint64_t stdoutToken = 0;
+        uint64_t stderrToken = 0;
+        bool rawOutput = false;
+        bool redirect = true;
+        bool terminated = false;
+        std::string output;
+        std::string errors;
+    };
+
+    // A watched file descriptor. The poller reports the token instead of the fd: a stale readiness notification for a
+    // descriptor that was closed (and maybe reused by another process) can never be mistaken for a new one
+    struct WatchedFd {
+        IProcess* process = nullptr;
+        int fd = wxNOT_FOUND;
+        bool isStderr = false;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<IProcess*, Channel> m_channels;
+    std::unordered_map<uint64_t, WatchedFd> m_watches;
+    uint64_t m_nextToken = 1; // 0 is the wakeup pipe
+    size_t m_unredirectedCount = 0;
+    bool m_flushPending = false;
+
+    std::thread* m_thread = nullptr;
+    std::atomic_bool m_shutdown;
+    int m_pollFd = wxNOT_FOUND;
+    int m_wakeupPipe[2] = { wxNOT_FOUND, wxNOT_FOUND };
+
+protected:
+    clProcessIOReactor();
+    virtual ~clProcessIOReactor();
+
+    void Start();
+    void Wakeup();
+    void DoClosePipe();
+    void WorkerMain();
+    /**
+     * @brief start polling 'fd'. Return its token, 0 on failure. Must be called with m_mutex locked
+     */
+    uint64_t WatchFd(IProcess* process, int fd, bool isStderr);
+    void UnwatchFd(uint64_t& token);
+    /**
+     * @brief read the data available on 'fd'. Return false when the fd reached EOF (or failed)
+     * must be called with m_mutex locked
+     */
+    bool DoRead(int fd, std::string& output);
+    /**
+     * @brief mark the process as terminated. Must be called with m_mutex locked
+     */
+    void DoTerminate(Channel& channel);
+    /**
+     * @brief schedule a call to Flush() on the main thread. Must be called with m_mutex locked
+     */
+    void DoScheduleFlush();
+    void Flush();
+
+public:
+    static clProcessIOReactor& Get();
+
+    /**
+     * @brief start delivering the output of 'process' to 'parent'
+     * @param stderrFd the process stderr, wxNOT_FOUND if stderr is not redirected separately
+     * @param flags the process creation flags
+     * @return false if the reactor could not be started
+     */
+    bool Register(IProcess* process, wxEvtHandler* parent, IProcessCallback* callback, int stdoutFd, int stderrFd,
+                  size_t flags);
+
+    /**
+     * @brief stop watching 'process'. No events are sent for the process once this function returns.
+     * Call this before closing the process file descriptors
+     */
+    void Unregister(IProcess* process);
+};
+#endif // defined(__WXGTK__) || defined(__WXMAC__)
+#endif // CLPROCESSIOREACTOR_H
@@ -0,0 +1,712 @@
+#include "clRegexDFA.h"
+#include <algorithm>
+#include <ctype.h>
+#include <memory>
+#include <wx/regex.h>
+
+namespace
+{
+// Limits that protect us from patterns that would explode into huge automatons. When exceeded, the compilation fails
+// (NFA) or the DFA cache is flushed and rebuilt as the scan goes on (DFA)
+const size_t MAX_NFA_STATES = 20000;
+const size_t MAX_DFA_STATES = 2000;
+const int MAX_REPEAT = 255;
+
+typedef clRegexDFA::ByteSet_t ByteSet_t;
+
+/**
+ * @brief a set of characters. ASCII characters are kept as is, all other characters are represented by a single flag
+ */
+struct CharClass {
+    ByteSet_t ascii;
+    bool nonAscii = false;
+
+    void Add(unsigned char ch) { ascii.set(ch); }
+    void AddRange(unsigned char from, unsigned char to)
+    {
+        for(int ch = from; ch <= to; ++ch) {
+            ascii.set(ch);
+        }
+    }
+    void AddIf(int (*pred)(int))
+    {
+        for(int ch = 0; ch < 128; ++ch) {
+            if(pred(ch)) { ascii.set(ch); }
+        }
+    }
+    void FoldCase()
+    {
+        for(int ch = 'a'; ch <= 'z'; ++ch) {
+            int upper = ch - ('a' - 'A');
+            if(ascii.test(ch) || ascii.test(upper)) {
+                ascii.set(ch);
+                ascii.set(upper);
+            }
+        }
+    }
+    void Negate()
+    {
+        for(int ch = 0; ch < 128; ++ch) {
+            ascii.flip(ch);
+        }
+        nonAscii = true;
+    }
+};
+
+struct Node;
+typedef std::shared_ptr<Node> NodePtr;
+
+struct Node {
+    enum eType { kEmpty, kChar, kConcat, kAlternate, kRepeat };
+    eType type = kEmpty;
+    // kChar: the alternative byte sequences that make up the character
+    std::vector<std::vector<ByteSet_t> > sequences;
+    std::vector<NodePtr> children;
+    int min = 0;
+    int max = -1; // kRepeat: -1 means unbounded
+};
+
+NodePtr MakeNode(Node::eType type)
+{
+    NodePtr node(new Node());
+    node->type = type;
+    return node;
+}
+
+NodePtr MakeCharNode(const CharClass& cls)
+{
+    NodePtr node = MakeNode(Node::kChar);
+    ByteSet_t ascii = cls.ascii;
+    // a match never spans more than a single line
+    ascii.reset('\n');
+    if(ascii.any()) { node->sequences.push_back(std::vector<ByteSet_t>(1, ascii)); }
+    if(cls.nonAscii) {
+        // any lead byte followed by up to 3 continuation bytes. This also accepts invalid UTF-8 sequences, which is
+        // fine as we only need to find a superset of the matching lines
+        ByteSet_t lead, cont;
+        for(int ch = 0x80; ch < 0x100; ++ch) {
+            lead.set(ch);
+        }
+        for(int ch = 0x80; ch < 0xC0; ++ch) {
+            cont.set(ch);
+        }
+        std::vector<ByteSet_t> seq(1, lead);
+        for(size_t i = 0; i < 4; ++i) {
+            node->sequences.push_back(seq);
+            seq.push_back(cont);
+        }
+    }
+    return node;
+}
+
+NodePtr MakeAnyChar()
+{
+    CharClass cls;
+    cls.Negate();
+    return MakeCharNode(cls);
+}
+
+/**
+ * @brief a recursive descent parser for the wxRegEx (Tcl) syntax
+ */
+class Parser
+{
+    const std::wstring& m_pattern;
+    size_t m_pos = 0;
+    bool m_matchCase;
+    bool m_advanced;
+
+protected:
+    bool AtEnd() const { return m_pos >= m_pattern.length(); }
+    wchar_t Peek(size_t offset = 0) const
+    {
+        return (m_pos + offset) < m_pattern.length() ? m_pattern[m_pos + offset] : 0;
+    }
+    static bool IsAlNum(wchar_t ch) { return ch < 128 && isalnum((int)ch); }
+    static bool IsDigit(wchar_t ch) { return ch >= '0' && ch <= '9'; }
+
+    void AddChar(CharClass& cls, wchar_t ch) const
+    {
+        if(ch >= 128) {
+            cls.nonAscii = true;
+        } else {
+            cls.Add((unsigned char)ch);
+        }
+    }
+
+    bool ParseNumber(int& num)
+    {
+        if(!IsDigit(Peek())) { return false; }
+        num = 0;
+        while(IsDigit(Peek())) {
+            num = num * 10 + (Peek() - '0');
+            if(num > MAX_REPEAT) { return false; }
+            ++m_pos;
+        }
+        return true;
+    }
+
+    /**
+     * @brief control characters escapes, e.g. \t
+     */
+    static bool GetControlEscape(wchar_t ch, wchar_t& value)
+    {
+        switch(ch) {
+        case 'a':
+            value = 0x07;
+            return true;
+        case 'b':
+            value = 0x08;
+            return true;
+        case 'e':
+            value = 0x1B;
+            return true;
+        case 'f':
+            value = 0x0C;
+            return true;
+        case 'n':
+            value = 0x0A;
+            return true;
+        case 'r':
+            value = 0x0D;
+            return true;
+        case 't':
+            value = 0x09;
+            return true;
+        case 'v':
+            value = 0x0B;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief class shorthand escapes, e.g. \d. Non ASCII characters are always considered as members
+     */
+    static bool GetClassEscape(wchar_t ch, CharClass& cls)
+    {
+        CharClass shorthand;
+        switch(tolower((int)ch)) {
+        case 'd':
+            shorthand.AddIf(isdigit);
+            break;
+        case 's':
+            shorthand.AddIf(isspace);
+            break;
+        case 'w':
+            shorthand.AddIf(isalnum);
+            shorthand.Add('_');
+            break;
+        default:
+            return false;
+        }
+        if(isupper((int)ch)) { shorthand.Negate(); }
+        cls.ascii |= shorthand.ascii;
+        cls.nonAscii = true;
+        return true;
+    }
+
+    bool ParseNamedClass(CharClass& cls)
+    {
+        // we are placed after the "[:"
+        size_t end = m_pattern.find(L":]", m_pos);
+        if(end == std::wstring::npos) { return false; }
+        std::wstring name = m_pattern.substr(m_pos, end - m_pos);
+        m_pos = end + 2;
+
+        if(name == L"alpha") {
+            cls.AddIf(isalpha);
+        } else if(name == L"digit") {
+            cls.AddIf(isdigit);
+        } else if(name == L"alnum") {
+            cls.AddIf(isalnum);
+        } else if(name == L"upper") {
+            cls.AddIf(isupper);
+        } else if(name == L"lower") {
+            cls.AddIf(islower);
+        } else if(name == L"space") {
+            cls.AddIf(isspace);
+        } else if(name == L"blank") {
+            cls.Add(' ');
+            cls.Add('\t');
+        } else if(name == L"punct") {
+            cls.AddIf(ispunct);
+        } else if(name == L"xdigit") {
+            cls.AddIf(isxdigit);
+        } else if(name == L"cntrl") {
+            cls.AddIf(iscntrl);
+        } else if(name == L"print") {
+            cls.AddIf(isprint);
+        } else if(name == L"graph") {
+            cls.AddIf(isgraph);
+        } else {
+            return false;
+        }
+        cls.nonAscii = true;
+        return true;
+    }
+
+    NodePtr ParseBracket()
+    {
+        // we are placed after the '['
+        CharClass cls;
+        bool negate = false;
+        if(Peek() == '^') {
+            negate = true;
+            ++m_pos;
+        }
+
+        bool first = true;
+        while(true) {
+            if(AtEnd()) { return nullptr; }
+            wchar_t ch = Peek();
+            if(ch == ']' && !first) {
+                ++m_pos;
+                break;
+            }
+            first = false;
+
+            if(ch == '[' && Peek(1) == ':') {
+                m_pos += 2;
+                if(!ParseNamedClass(cls)) { return nullptr; }
+                continue;
+            } else if(ch == '[' && (Peek(1) == '.' || Peek(1) == '=')) {
+                // collating elements and equivalence classes are not supported
+                return nullptr;
+            }
+
+            ++m_pos;
+            if(ch == '\\' && m_advanced) {
+                wchar_t escaped = Peek();
+                ++m_pos;
+                if(GetClassEscape(escaped, cls)) {
+                    // \D, \S and \W are not allowed within brackets
+                    if(isupper((int)escaped)) { return nullptr; }
+                    continue;
+                } else if(GetControlEscape(escaped, ch)) {
+                    // 'ch' was updated
+                } else if(escaped && !IsAlNum(escaped)) {
+                    ch = escaped;
+                } else {
+                    return nullptr;
+                }
+            }
+
+            if(Peek() == '-' && Peek(1) != ']' && Peek(1) != 0) {
+                wchar_t to = Peek(1);
+                if(to == '[' || to == '\\') { return nullptr; }
+                m_pos += 2;
+                if(to < ch) { return nullptr; }
+                if(ch < 128) { cls.AddRange((unsigned char)ch, (unsigned char)std::min(to, (wchar_t)127)); }
+                if(to >= 128) { cls.nonAscii = true; }
+            } else {
+                AddChar(cls, ch);
+            }
+        }
+
+        if(!m_matchCase) { cls.FoldCase(); }
+        if(negate) { cls.Negate(); }
+        return MakeCharNode(cls);
+    }
+
+    NodePtr ParseEscape()
+    {
+        // we are placed after the '\\'
+        if(AtEnd()) { return nullptr; }
+        wchar_t ch = Peek();
+        ++m_pos;
+
+        CharClass cls;
+        if(!m_advanced) {
+            if(IsAlNum(ch)) { return nullptr; }
+            AddChar(cls, ch);
+        } else if(ch >= '1' && ch <= '9') {
+            // a back reference. We don't track the captured text, so accept anything
+            NodePtr node = MakeNode(Node::kRepeat);
+            node->children.push_back(MakeAnyChar());
+            return node;
+        } else if(ch == 'A' || ch == 'Z' || ch == 'm' || ch == 'M' || ch == 'y' || ch == 'Y') {
+            // constraint escapes are zero width, ignoring them makes the pattern more permissive
+            return MakeNode(Node::kEmpty);
+        } else if(GetClassEscape(ch, cls)) {
+            // 'cls' was updated
+        } else if(GetControlEscape(ch, ch)) {
+            AddChar(cls, ch);
+        } else if(!IsAlNum(ch)) {
+            AddChar(cls, ch);
+        } else {
+            // hex, octal, unicode escapes
+            return nullptr;
+        }
+
+        if(!m_matchCase) { cls.FoldCase(); }
+        return MakeCharNode(cls);
+    }
+
+    NodePtr ParseAtom()
+    {
+        wchar_t ch = Peek();
+        ++m_pos;
+        switch(ch) {
+        case '(': {
+            bool discard = false;
+            if(Peek() == '?' && m_advanced) {
+                // (?:...) is a non capturing group, (?=...) and (?!...) are lookahead constraints which are ignored
+                wchar_t kind = Peek(1);
+                if(kind != ':' && kind != '=' && kind != '!') { return nullptr; }
+                discard = (kind != ':');
+                m_pos += 2;
+            }
+            NodePtr node = ParseAlternate();
+            if(!node || Peek() != ')') { return nullptr; }
+            ++m_pos;
+            return discard ? MakeNode(Node::kEmpty) : node;
+        }
+        case '[':
+            return ParseBracket();
+        case '.':
+            return MakeAnyChar();
+        case '^':
+        case '$':
+            // anchors are ignored, see ParseEscape()
+            return MakeNode(Node::kEmpty);
+        case '\\':
+            return ParseEscape();
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case ')':
+            return nullptr;
+        default: {
+            CharClass cls;
+            AddChar(cls, ch);
+            if(!m_matchCase) { cls.FoldCase(); }
+            return MakeCharNode(cls);
+        }
+        }
+    }
+
+    NodePtr ParseRepeat()
+    {
+        NodePtr atom = ParseAtom();
+        if(!atom) { return nullptr; }
+
+        int min = 0;
+        int max = -1;
+        wchar_t ch = Peek();
+        if(ch == '*') {
+            ++m_pos;
+        } else if(ch == '+') {
+            min = 1;
+            ++m_pos;
+        } else if(ch == '?') {
+            max = 1;
+            ++m_pos;
+        } else if(ch == '{') {
+            ++m_pos;
+            if(!ParseNumber(min)) { return nullptr; }
+            max = min;
+            if(Peek() == ',') {
+                ++m_pos;
+                max = -1;
+                if(IsDigit(Peek()) && !ParseNumber(max)) { return nullptr; }
+            }
+            if(Peek() != '}' || (max != -1 && max < min)) { return nullptr; }
+            ++m_pos;
+        } else {
+            return atom;
+        }
+
+        // a non greedy quantifier matches the same lines
+        if(Peek() == '?' && m_advanced) { ++m_pos; }
+        ch = Peek();
+        if(ch == '*' || ch == '+' || ch == '?' || ch == '{') { return nullptr; }
+
+        NodePtr node = MakeNode(Node::kRepeat);
+        node->min = min;
+        node->max = max;
+        node->children.push_back(atom);
+        return node;
+    }
+
+    NodePtr ParseConcat()
+    {
+        NodePtr node = MakeNode(Node::kConcat);
+        while(!AtEnd() && Peek() != '|' && Peek() != ')') {
+            NodePtr child = ParseRepeat();
+            if(!child) { return nullptr; }
+            node->children.push_back(child);
+        }
+        return node;
+    }
+
+public:
+    Parser(const std::wstring& pattern, bool matchCase, bool advanced)
+        : m_pattern(pattern)
+        , m_matchCase(matchCase)
+        , m_advanced(advanced)
+    {
+    }
+
+    NodePtr ParseAlternate()
+    {
+        NodePtr node = MakeNode(Node::kAlternate);
+        while(true) {
+            NodePtr child = ParseConcat();
+            if(!child) { return nullptr; }
+            node->children.push_back(child);
+            if(Peek() != '|') { break; }
+            ++m_pos;
+        }
+        return node;
+    }
+
+    NodePtr Parse()
+    {
+        // "***" directors are not supported
+        if(m_advanced && m_pattern.compare(0, 3, L"***") == 0) { return nullptr; }
+        NodePtr node = ParseAlternate();
+        if(!node || !AtEnd()) { return nullptr; }
+        return node;
+    }
+};
+} // namespace
+
+/**
+ * @brief builds the NFA backward: every node is emitted with the state that follows it already known
+ */
+class clRegexDFAEmitter
+{
+    std::vector<clRegexDFA::NfaState>& m_nfa;
+
+public:
+    clRegexDFAEmitter(std::vector<clRegexDFA::NfaState>& nfa)
+        : m_nfa(nfa)
+    {
+    }
+
+    int Add(const clRegexDFA::NfaState& state)
+    {
+        if(m_nfa.size() >= MAX_NFA_STATES) { return -1; }
+        m_nfa.push_back(state);
+        return (int)m_nfa.size() - 1;
+    }
+
+    int Split(int out, int out1)
+    {
+        if(out < 0 || out1 < 0) { return -1; }
+        clRegexDFA::NfaState state;
+        state.split = true;
+        state.out = out;
+        state.out1 = out1;
+        return Add(state);
+    }
+
+    int Emit(const NodePtr& node, int next)
+    {
+        if(next < 0) { return -1; }
+        switch(node->type) {
+        case Node::kEmpty:
+            return next;
+        case Node::kChar: {
+            int start = -1;
+            for(size_t i = 0; i < node->sequences.size(); ++i) {
+                const std::vector<ByteSet_t>& seq = node->sequences[i];
+                int s = next;
+                for(size_t j = seq.size(); j > 0 && s >= 0; --j) {
+                    clRegexDFA::NfaState state;
+                    state.bytes = seq[j - 1];
+                    state.out = s;
+                    s = Add(state);
+                }
+                start = (start == -1) ? s : Split(s, start);
+                if(start < 0) { return -1; }
+            }
+            // an empty class never matches
+            if(start == -1) {
+                clRegexDFA::NfaState state;
+                state.out = next;
+                start = Add(state);
+            }
+            return start;
+        }
+        case Node::kConcat: {
+            for(size_t i = node->children.size(); i > 0 && next >= 0; --i) {
+                next = Emit(node->children[i - 1], next);
+            }
+            return next;
+        }
+        case Node::kAlternate: {
+            int start = -1;
+            for(size_t i = 0; i < node->children.size(); ++i) {
+                int s = Emit(node->children[i], next);
+                start = (start == -1) ? s : Split(s, start);
+                if(start < 0) { return -1; }
+            }
+            return start;
+        }
+        case Node::kRepeat: {
+            const NodePtr& child = node->children[0];
+            int s = next;
+            if(node->max == -1) {
+                // loop: the split state is patched once the body is emitted
+                s = Split(next, next);
+                if(s < 0) { return -1; }
+                int body = Emit(child, s);
+                if(body < 0) { return -1; }
+                m_nfa[s].out = body;
+            } else {
+                for(int i = node->min; i < node->max && s >= 0; ++i) {
+                    s = Split(Emit(child, s), next);
+                }
+            }
+            for(int i = 0; i < node->min && s >= 0; ++i) {
+                s = Emit(child, s);
+            }
+            return s;
+        }
+        }
+        return -1;
+    }
+};
+
+clRegexDFA::clRegexDFA() {}
+
+clRegexDFA::~clRegexDFA() {}
+
+bool clRegexDFA::Compile(const wxString& pattern, int flags)
+{
+    m_valid = false;
+    m_matchesEmpty = false;
+    m_nfa.clear();
+    m_dfaIds.clear();
+    m_dfaStates.clear();
+    m_dfaAccepting.clear();
+    m_dfaTable.clear();
+    m_startSet.clear();
+
+    if(flags & wxRE_BASIC) { return false; }
+    bool matchCase = !(flags & wxRE_ICASE);
+    bool advanced = (flags & wxRE_ADVANCED);
+    m_valid = DoCompile(pattern.ToStdWstring(), matchCase, advanced);
+    if(!m_valid) { m_nfa.clear(); }
+    return m_valid;
+}
+
+bool clRegexDFA::DoCompile(const std::wstring& pattern, bool matchCase, bool advanced)
+{
+    Parser parser(pattern, matchCase, advanced);
+    NodePtr root = parser.Parse();
+    if(!root) { return false; }
+
+    NfaState match;
+    match.match = true;
+    m_nfa.push_back(match);
+
+    clRegexDFAEmitter emitter(m_nfa);
+    m_nfaStart = emitter.Emit(root, 0);
+    if(m_nfaStart < 0) { return false; }
+
+    m_visited.assign(m_nfa.size(), 0);
+    bool startMatch = false;
+    Closure(m_nfaStart, m_startSet, startMatch);
+    std::sort(m_startSet.begin(), m_startSet.end());
+    m_matchesEmpty = startMatch;
+    DoResetCache();
+    return true;
+}
+
+void clRegexDFA::Closure(int nfaState, std::vector<int>& states, bool& match)
+{
+    // iterative DFS over the epsilon edges
+    std::vector<int> stack(1, nfaState);
+    while(!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        if(m_visited[s]) { continue; }
+        m_visited[s] = 1;
+
+        const NfaState& state = m_nfa[s];
+        if(state.match) {
+            // keep the match state in the set, so accepting and non accepting states never share a DFA state
+            match = true;
+            states.push_back(s);
+        } else if(state.split) {
+            stack.push_back(state.out1);
+            stack.push_back(state.out);
+        } else {
+            states.push_back(s);
+        }
+    }
+}
+
+void clRegexDFA::DoResetCache()
+{
+    m_dfaIds.clear();
+    m_dfaStates.clear();
+    m_dfaAccepting.clear();
+    m_dfaTable.clear();
+
+    // the start state is always the first state
+    std::vector<int> start = m_startSet;
+    DoInternState(start, m_matchesEmpty);
+}
+
+int clRegexDFA::DoInternState(std::vector<int>& states, bool match)
+{
+    std::map<std::vector<int>, int>::iterator iter = m_dfaIds.find(states);
+    if(iter != m_dfaIds.end()) { return iter->second; }
+
+    int id = (int)m_dfaStates.size();
+    m_dfaIds.insert(std::make_pair(states, id));
+    m_dfaStates.push_back(std::vector<int>());
+    m_dfaStates.back().swap(states);
+    m_dfaAccepting.push_back(match ? 1 : 0);
+    m_dfaTable.resize(m_dfaTable.size() + 256, -1);
+    return id;
+}
+
+int clRegexDFA::DoComputeTransition(int dfaState, unsigned char byte)
+{
+    std::fill(m_visited.begin(), m_visited.end(), 0);
+    std::vector<int> next;
+    bool match = false;
+    const std::vector<int>& current = m_dfaStates[dfaState];
+    for(size_t i = 0; i < current.size(); ++i) {
+        const NfaState& state = m_nfa[current[i]];
+        if(state.bytes.test(byte)) { Closure(state.out, next, match); }
+    }
+
+    // a match may start at any position
+    Closure(m_nfaStart, next, match);
+    std::sort(next.begin(), next.end());
+
+    if(m_dfaStates.size() >= MAX_DFA_STATES && m_dfaIds.count(next) == 0) {
+        // flush the cache. 'dfaState' is no longer valid so we don't record the transition
+        DoResetCache();
+        return DoInternState(next, match);
+    }
+
+    int id = DoInternState(next, match);
+    m_dfaTable[dfaState * 256 + byte] = id;
+    return id;
+}
+
+const char* clRegexDFA::Find(const char* begin, const char* end)
+{
+    if(!m_valid) { return nullptr; }
+    if(m_matchesEmpty) { return begin; }
+
+    int state = 0;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(begin);
+    const unsigned char* last = reinterpret_cast<const unsigned char*>(end);
+    for(; p < last; ++p) {
+        int next = m_dfaTable[state * 256 + *p];
+        if(next < 0) { next = DoComputeTransition(state, *p); }
+        state = next;
+        if(m_dfaAccepting[state]) { return reinterpret_cast<const char*>(p + 1); }
+    }
+    return nullptr;
+}
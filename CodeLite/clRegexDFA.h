@@ -0,0 +1,90 @@
+#ifndef CLREGEXDFA_H
+#define CLREGEXDFA_H
+
+#include "codelite_exports.h"
+#include <bitset>
+#include <map>
+#include <string>
+#include <vector>
+#include <wx/string.h>
+
+/**
+ * @class clRegexDFA
+ * @brief a regular expression engine that scans a UTF-8 buffer in a single pass, one byte at a time.
+ * The pattern is compiled into an NFA which is converted lazily (state by state, as the input requires) into a DFA, so
+ * every byte of the input costs a single table lookup.
+ *
+ * The engine is used as a line filter: it answers the question "which lines contain a match?". It accepts the
+ * wxRegEx syntax (advanced or extended) but some constructs are approximated so that the engine always matches a
+ * superset of what wxRegEx matches (e.g. anchors and lookahead constraints are ignored, a back reference matches
+ * anything and a non ASCII character matches any non ASCII character). The exact match positions should be taken
+ * by running wxRegEx on the lines found by this class
+ */
+class WXDLLIMPEXP_CL clRegexDFA
+{
+    friend class clRegexDFAEmitter;
+
+public:
+    typedef std::bitset<256> ByteSet_t;
+
+protected:
+    struct NfaState {
+        // the bytes accepted by this state, when empty this is an epsilon (split) state
+        ByteSet_t bytes;
+        int out = -1;
+        int out1 = -1;
+        bool split = false;
+        bool match = false;
+    };
+
+    std::vector<NfaState> m_nfa;
+    int m_nfaStart = -1;
+    bool m_valid = false;
+    bool m_matchesEmpty = false;
+
+    // The lazily built DFA. A DFA state is the set of NFA states the machine can be in
+    std::map<std::vector<int>, int> m_dfaIds;
+    std::vector<std::vector<int> > m_dfaStates;
+    std::vector<char> m_dfaAccepting;
+    std::vector<int> m_dfaTable; // 256 entries per state, -1 means "not computed yet"
+    std::vector<int> m_startSet;
+    std::vector<char> m_visited;
+
+protected:
+    void Closure(int nfaState, std::vector<int>& states, bool& match);
+    int DoInternState(std::vector<int>& states, bool match);
+    int DoComputeTransition(int dfaState, unsigned char byte);
+    void DoResetCache();
+    bool DoCompile(const std::wstring& pattern, bool matchCase, bool advanced);
+
+public:
+    clRegexDFA();
+    virtual ~clRegexDFA();
+
+    /**
+     * @brief compile 'pattern'
+     * @param pattern the expression, in wxRegEx syntax
+     * @param flags wxRegEx compile flags (wxRE_ADVANCED, wxRE_ICASE ...)
+     * @return false if the pattern uses syntax that this engine does not support (or is invalid)
+     */
+    bool Compile(const wxString& pattern, int flags);
+
+    /**
+     * @brief did the last call to Compile() succeed?
+     */
+    bool IsValid() const { return m_valid; }
+
+    /**
+     * @brief return true if the compiled pattern matches the empty string (and thus, every line)
+     */
+    bool MatchesEmpty() const { return m_matchesEmpty; }
+
+    /**
+     * @brief find the first match in [begin, end)
+     * @return a pointer past the last byte of the shortest match found, or nullptr when there is no match.
+     * The match never spans more than a single line
+     */
+    const char* Find(const char* begin, const char* end);
+};
+
+#endif // CLREGEXDFA_H
@@ -0,0 +1,723 @@
+#include "clTrigramIndex.h"
+#include "clMappedFile.h"
+#include "codelite_events.h"
+#include "event_notifier.h"
+#include "file_logger.h"
+#include "fileutils.h"
+#include "wx/wxsqlite3.h"
+#include <algorithm>
+#include <unordered_set>
+#include <wx/filefn.h>
+
+#define TRIGRAM_INDEX_SCHEMA_VERSION "1"
+
+// Files bigger than this are not indexed, so they are always searched
+#define TRIGRAM_INDEX_MAX_FILE_SIZE (16 * 1024 * 1024)
+
+// Number of files to index before committing the transaction
+#define TRIGRAM_INDEX_COMMIT_INTERVAL 500
+
+namespace
+{
+inline unsigned char FoldByte(unsigned char ch) { return (ch >= 'A' && ch <= 'Z') ? (ch + ('a' - 'A')) : ch; }
+
+/**
+ * @brief split the string into its ASCII parts. We only index ASCII trigrams when querying so the result does not
+ * depend on the file encoding
+ */
+void AddAsciiRuns(const wxString& str, std::vector<std::string>& literals)
+{
+    std::string run;
+    for(size_t i = 0; i < str.length(); ++i) {
+        wxChar ch = str[i];
+        if(ch < 0x80 && ch != '\n' && ch != '\r') {
+            run.push_back((char)ch);
+        } else {
+            if(run.length() >= 3) { literals.push_back(run); }
+            run.clear();
+        }
+    }
+    if(run.length() >= 3) { literals.push_back(run); }
+}
+
+/**
+ * @brief return the position of the ']' that closes the bracket expression starting at 'pos', or npos. A ']' right
+ * after the opening bracket (or after "[^") is a literal, as well as an escaped one. Character classes, collating
+ * elements and equivalence classes ("[:alpha:]", "[.-.]", "[=a=]") are skipped as a whole
+ */
+size_t FindBracketEnd(const wxString& re, size_t pos)
+{
+    size_t i = pos + 1;
+    if(i < re.length() && re[i] == '^') { ++i; }
+    if(i < re.length() && re[i] == ']') { ++i; }
+    while(i < re.length()) {
+        wxChar ch = re[i];
+        if(ch == ']') { return i; }
+        if(ch == '\\') {
+            i += 2;
+            continue;
+        }
+        if(ch == '[' && i + 1 < re.length() && (re[i + 1] == ':' || re[i + 1] == '.' || re[i + 1] == '=')) {
+            wxString terminator;
+            terminator << re[i + 1] << ']';
+            size_t end = re.find(terminator, i + 2);
+            if(end == wxString::npos) { return wxString::npos; }
+            i = end + 2;
+            continue;
+        }
+        ++i;
+    }
+    return wxString::npos;
+}
+
+/// Does the file on the disk still have the modification time and size it was indexed with?
+bool IsUnchanged(const wxString& path, time_t lastModified, size_t size)
+{
+    wxStructStat buff;
+    if(wxStat(path, &buff) != 0) { return false; }
+    return buff.st_mtime == lastModified && (size_t)buff.st_size == size;
+}
+} // namespace
+
+struct clTrigramIndexRequest : public ThreadRequest {
+    enum eType {
+        kLoad,
+        kUpdate,
+        kRemove,
+        kClose,
+    };
+    eType type;
+    wxFileName dbfile;
+    wxArrayString files;
+
+    clTrigramIndexRequest(eType t)
+        : type(t)
+    {
+    }
+};
+
+//===-------------------------------------------------------------
+// The indexer thread. It owns the database connection
+//===-------------------------------------------------------------
+class clTrigramIndexThread : public WorkerThread
+{
+    clTrigramIndex* m_index;
+    wxSQLite3Database m_db;
+
+protected:
+    void OpenDatabase(const wxFileName& dbfile)
+    {
+        CloseDatabase();
+        try {
+            wxFileName::Mkdir(dbfile.GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+            m_db.Open(dbfile.GetFullPath());
+            m_db.ExecuteUpdate("PRAGMA journal_mode = WAL;");
+            m_db.ExecuteUpdate("PRAGMA synchronous = OFF;");
+            m_db.ExecuteUpdate("PRAGMA temp_store = MEMORY;");
+
+            wxString schemaVersion;
+            m_db.ExecuteUpdate("create table if not exists METADATA (KEY TEXT PRIMARY KEY, VALUE TEXT)");
+            wxSQLite3ResultSet res = m_db.ExecuteQuery("select VALUE from METADATA where KEY='SCHEMA_VERSION'");
+            if(res.NextRow()) { schemaVersion = res.GetString(0); }
+
+            if(schemaVersion != TRIGRAM_INDEX_SCHEMA_VERSION) {
+                m_db.ExecuteUpdate("drop table if exists FILES");
+                m_db.ExecuteUpdate("replace into METADATA (KEY, VALUE) VALUES ('SCHEMA_VERSION', '" +
+                                   wxString(TRIGRAM_INDEX_SCHEMA_VERSION) + "')");
+            }
+            m_db.ExecuteUpdate("create table if not exists FILES (ID INTEGER PRIMARY KEY AUTOINCREMENT, PATH TEXT, "
+                               "LAST_MODIFIED INTEGER, SIZE INTEGER, TRIGRAMS BLOB)");
+            m_db.ExecuteUpdate("create unique index if not exists FILES_IDX_1 on FILES(PATH)");
+
+        } catch(wxSQLite3Exception& e) {
+            clWARNING() << "clTrigramIndex: failed to open database:" << dbfile << "." << e.GetMessage() << clEndl;
+            CloseDatabase();
+        }
+    }
+
+    void CloseDatabase()
+    {
+        try {
+            if(m_db.IsOpen()) { m_db.Close(); }
+        } catch(wxSQLite3Exception& e) {
+            wxUnusedVar(e);
+        }
+    }
+
+    /**
+     * @brief index a single file and store it in the database
+     */
+    void IndexFile(const wxString& path)
+    {
+        if(!wxFileName::FileExists(path)) {
+            DeleteEntry(path);
+            return;
+        }
+
+        time_t lastModified = FileUtils::GetFileModificationTime(path);
+        size_t size = FileUtils::GetFileSize(path);
+
+        clMappedFile file;
+        if((size > TRIGRAM_INDEX_MAX_FILE_SIZE) || !file.Open(path, TRIGRAM_INDEX_MAX_FILE_SIZE)) {
+            // Files that are not in the index are always searched
+            DeleteEntry(path);
+            return;
+        }
+
+        clTrigramIndex::Trigrams_t trigrams;
+        clTrigramIndex::ExtractTrigrams(file.data(), file.size(), trigrams);
+        m_index->DoAddFile(path, lastModified, size, trigrams);
+
+        if(m_db.IsOpen()) {
+            try {
+                wxSQLite3Statement st = m_db.PrepareStatement(
+                    "replace into FILES (ID, PATH, LAST_MODIFIED, SIZE, TRIGRAMS) VALUES (NULL, ?, ?, ?, ?)");
+                st.Bind(1, path);
+                st.Bind(2, (wxLongLong)lastModified);
+                st.Bind(3, (wxLongLong)size);
+                st.Bind(4, (const unsigned char*)trigrams.data(), (int)(trigrams.size() * sizeof(wxUint32)));
+                st.ExecuteUpdate();
+            } catch(wxSQLite3Exception& e) {
+                clWARNING() << "clTrigramIndex: failed to store file:" << path << "." << e.GetMessage() << clEndl;
+            }
+        }
+    }
+
+    void DeleteEntry(const wxString& path)
+    {
+        m_index->DoRemoveFile(path);
+        if(!m_db.IsOpen()) { return; }
+        try {
+            wxSQLite3Statement st = m_db.PrepareStatement("delete from FILES where PATH=?");
+            st.Bind(1, path);
+            st.ExecuteUpdate();
+        } catch(wxSQLite3Exception& e) {
+            wxUnusedVar(e);
+        }
+    }
+
+    void Begin()
+    {
+        try {
+            if(m_db.IsOpen()) { m_db.Begin(); }
+        } catch(wxSQLite3Exception& e) {
+            wxUnusedVar(e);
+        }
+    }
+
+    void Commit()
+    {
+        try {
+            if(m_db.IsOpen() && !m_db.GetAutoCommit()) { m_db.Commit(); }
+        } catch(wxSQLite3Exception& e) {
+            clWARNING() << "clTrigramIndex: commit error." << e.GetMessage() << clEndl;
+        }
+    }
+
+    void IndexFiles(const wxArrayString& files)
+    {
+        Begin();
+        for(size_t i = 0; i < files.size(); ++i) {
+            if(TestDestroy()) { break; }
+            IndexFile(files.Item(i));
+            if(((i + 1) % TRIGRAM_INDEX_COMMIT_INTERVAL) == 0) {
+                Commit();
+                Begin();
+            }
+        }
+        Commit();
+    }
+
+    void Load(const wxFileName& dbfile, const wxArrayString& files)
+    {
+        wxStopWatch sw;
+        m_index->DoClear();
+        OpenDatabase(dbfile);
+
+        wxStringSet_t workspaceFiles;
+        workspaceFiles.insert(files.begin(), files.end());
+
+        // Load all the entries that are still valid. Entries of modified files are re-indexed and entries of files
+        // that are no longer part of the workspace are deleted
+        wxArrayString staleFiles;
+        wxStringSet_t loadedFiles;
+        if(m_db.IsOpen()) {
+            try {
+                wxSQLite3ResultSet res = m_db.ExecuteQuery("select PATH, LAST_MODIFIED, SIZE, TRIGRAMS from FILES");
+                clTrigramIndex::Trigrams_t trigrams;
+                while(res.NextRow() && !TestDestroy()) {
+                    wxString path = res.GetString(0);
+                    if(workspaceFiles.count(path) == 0) {
+                        staleFiles.Add(path);
+                        continue;
+                    }
+
+                    time_t lastModified = (time_t)res.GetInt64(1).GetValue();
+                    size_t size = (size_t)res.GetInt64(2).GetValue();
+                    if(FileUtils::GetFileModificationTime(path) != lastModified || FileUtils::GetFileSize(path) != size) {
+                        // will be re-indexed below
+                        continue;
+                    }
+
+                    int len = 0;
+                    const unsigned char* blob = res.GetBlob(3, len);
+                    trigrams.resize(len / sizeof(wxUint32));
+                    if(!trigrams.empty()) { memcpy(trigrams.data(), blob, trigrams.size() * sizeof(wxUint32)); }
+                    m_index->DoAddFile(path, lastModified, size, trigrams);
+                    loadedFiles.insert(path);
+                }
+            } catch(wxSQLite3Exception& e) {
+                clWARNING() << "clTrigramIndex: failed to load index." << e.GetMessage() << clEndl;
+            }
+        }
+
+        Begin();
+        for(size_t i = 0; i < staleFiles.size(); ++i) {
+            DeleteEntry(staleFiles.Item(i));
+        }
+        Commit();
+
+        wxArrayString filesToIndex;
+        std::for_each(files.begin(), files.end(), [&](const wxString& file) {
+            if(loadedFiles.count(file) == 0) { filesToIndex.Add(file); }
+        });
+        clDEBUG() << "clTrigramIndex: loaded" << loadedFiles.size() << "files from the database. Indexing"
+                  << filesToIndex.size() << "files" << clEndl;
+        IndexFiles(filesToIndex);
+        clDEBUG() << "clTrigramIndex: index is ready (" << m_index->GetFileCount() << "files," << sw.Time() << "ms)"
+                  << clEndl;
+    }
+
+public:
+    clTrigramIndexThread(clTrigramIndex* index)
+        : m_index(index)
+    {
+    }
+
+    virtual ~clTrigramIndexThread() { CloseDatabase(); }
+
+    void ProcessRequest(ThreadRequest* request)
+    {
+        clTrigramIndexRequest* req = static_cast<clTrigramIndexRequest*>(request);
+        switch(req->type) {
+        case clTrigramIndexRequest::kLoad:
+            Load(req->dbfile, req->files);
+            break;
+        case clTrigramIndexRequest::kUpdate:
+            IndexFiles(req->files);
+            break;
+        case clTrigramIndexRequest::kRemove:
+            Begin();
+            for(size_t i = 0; i < req->files.size(); ++i) {
+                DeleteEntry(req->files.Item(i));
+            }
+            Commit();
+            break;
+        case clTrigramIndexRequest::kClose:
+            CloseDatabase();
+            m_index->DoClear();
+            break;
+        }
+    }
+};
+
+//===-------------------------------------------------------------
+// clTrigramIndex
+//===-------------------------------------------------------------
+static clTrigramIndex* gs_trigramIndex = nullptr;
+clTrigramIndex& clTrigramIndex::Get()
+{
+    if(!gs_trigramIndex) { gs_trigramIndex = new clTrigramIndex(); }
+    return *gs_trigramIndex;
+}
+
+void clTrigramIndex::Release() { wxDELETE(gs_trigramIndex); }
+
+bool clTrigramIndex::IsCreated() { return gs_trigramIndex != nullptr; }
+
+clTrigramIndex::clTrigramIndex()
+{
+    m_thread = new clTrigramIndexThread(this);
+    m_thread->Start(WXTHREAD_MIN_PRIORITY);
+
+    EventNotifier::Get()->Bind(wxEVT_FILE_SAVED, &clTrigramIndex::OnFileSaved, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_DELETED, &clTrigramIndex::OnFileDeleted, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_RENAMED, &clTrigramIndex::OnFileRenamed, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_ADDED, &clTrigramIndex::OnProjectFilesAdded, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_REMOVED, &clTrigramIndex::OnProjectFilesRemoved, this);
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_CLOSED, &clTrigramIndex::OnWorkspaceClosed, this);
+}
+
+clTrigramIndex::~clTrigramIndex()
+{
+    EventNotifier::Get()->Unbind(wxEVT_FILE_SAVED, &clTrigramIndex::OnFileSaved, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_DELETED, &clTrigramIndex::OnFileDeleted, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_RENAMED, &clTrigramIndex::OnFileRenamed, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_ADDED, &clTrigramIndex::OnProjectFilesAdded, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_REMOVED, &clTrigramIndex::OnProjectFilesRemoved, this);
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_CLOSED, &clTrigramIndex::OnWorkspaceClosed, this);
+
+    m_thread->Stop();
+    wxDELETE(m_thread);
+}
+
+void clTrigramIndex::Load(const wxFileName& dbfile, const wxArrayString& files)
+{
+    clTrigramIndexRequest* req = new clTrigramIndexRequest(clTrigramIndexRequest::kLoad);
+    req->dbfile = dbfile;
+    req->files = files;
+    m_thread->Add(req);
+}
+
+void clTrigramIndex::Close()
+{
+    m_thread->Add(new clTrigramIndexRequest(clTrigramIndexRequest::kClose));
+}
+
+void clTrigramIndex::DoUpdateFiles(const wxArrayString& files)
+{
+    if(files.IsEmpty()) { return; }
+    {
+        // until the indexer thread processes them, treat these files as search candidates
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(size_t i = 0; i < files.size(); ++i) {
+            std::unordered_map<wxString, wxUint32>::iterator iter = m_pathToId.find(files.Item(i));
+            if(iter != m_pathToId.end()) { m_files[iter->second].verified = false; }
+        }
+    }
+    clTrigramIndexRequest* req = new clTrigramIndexRequest(clTrigramIndexRequest::kUpdate);
+    req->files = files;
+    m_thread->Add(req);
+}
+
+void clTrigramIndex::DoRemoveFiles(const wxArrayString& files)
+{
+    if(files.IsEmpty()) { return; }
+    clTrigramIndexRequest* req = new clTrigramIndexRequest(clTrigramIndexRequest::kRemove);
+    req->files = files;
+    m_thread->Add(req);
+}
+
+void clTrigramIndex::DoClear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.clear();
+    m_pathToId.clear();
+    m_postings.clear();
+    m_deadCount = 0;
+}
+
+void clTrigramIndex::DoAddFile(const wxString& path, time_t lastModified, size_t size, const Trigrams_t& trigrams)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unordered_map<wxString, wxUint32>::iterator iter = m_pathToId.find(path);
+    if(iter != m_pathToId.end()) {
+        // the old entry is kept in the posting lists until the next compaction
+        m_files[iter->second].alive = false;
+        ++m_deadCount;
+    }
+
+    // ids are allocated in increasing order, so the posting lists remain sorted
+    wxUint32 id = (wxUint32)m_files.size();
+    FileEntry entry;
+    entry.path = path;
+    entry.lastModified = lastModified;
+    entry.size = size;
+    entry.verified = true;
+    m_files.push_back(entry);
+    m_pathToId[path] = id;
+
+    for(size_t i = 0; i < trigrams.size(); ++i) {
+        m_postings[trigrams[i]].push_back(id);
+    }
+
+    if(m_deadCount > 1000 && m_deadCount > (m_files.size() - m_deadCount)) { DoCompact(); }
+}
+
+void clTrigramIndex::DoRemoveFile(const wxString& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unordered_map<wxString, wxUint32>::iterator iter = m_pathToId.find(path);
+    if(iter == m_pathToId.end()) { return; }
+    m_files[iter->second].alive = false;
+    m_pathToId.erase(iter);
+    ++m_deadCount;
+}
+
+void clTrigramIndex::DoCompact()
+{
+    // Called with the lock held. Drop the dead entries and renumber the live ones. The new ids keep the order of the
+    // old ones, so the posting lists remain sorted
+    static const wxUint32 deadId = (wxUint32)-1;
+    std::vector<wxUint32> newIds(m_files.size(), deadId);
+    std::vector<FileEntry> files;
+    files.reserve(m_files.size() - m_deadCount);
+    for(size_t i = 0; i < m_files.size(); ++i) {
+        if(!m_files[i].alive) { continue; }
+        newIds[i] = (wxUint32)files.size();
+        m_pathToId[m_files[i].path] = newIds[i];
+        files.push_back(m_files[i]);
+    }
+    m_files.swap(files);
+
+    std::unordered_map<wxUint32, std::vector<wxUint32> >::iterator iter = m_postings.begin();
+    while(iter != m_postings.end()) {
+        std::vector<wxUint32>& ids = iter->second;
+        size_t count = 0;
+        for(size_t i = 0; i < ids.size(); ++i) {
+            if(newIds[ids[i]] != deadId) { ids[count++] = newIds[ids[i]]; }
+        }
+        ids.resize(count);
+        if(ids.empty()) {
+            iter = m_postings.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    m_deadCount = 0;
+}
+
+size_t clTrigramIndex::GetFileCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pathToId.size();
+}
+
+void clTrigramIndex::ExtractTrigrams(const char* buffer, size_t len, Trigrams_t& trigrams)
+{
+    trigrams.clear();
+    if(len < 3) { return; }
+
+    trigrams.reserve(len);
+    const unsigned char* p = (const unsigned char*)buffer;
+    for(size_t i = 0; i + 2 < len; ++i) {
+        unsigned char c0 = p[i];
+        unsigned char c1 = p[i + 1];
+        unsigned char c2 = p[i + 2];
+        // a match never spans multiple lines
+        if(c0 == '\n' || c1 == '\n' || c2 == '\n' || c0 == '\r' || c1 == '\r' || c2 == '\r') { continue; }
+        trigrams.push_back((FoldByte(c0) << 16) | (FoldByte(c1) << 8) | FoldByte(c2));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    trigrams.shrink_to_fit();
+}
+
+bool clTrigramIndex::GetRequiredLiterals(const wxString& findWhat, bool isRegex, std::vector<std::string>& literals)
+{
+    literals.clear();
+    if(!isRegex) {
+        AddAsciiRuns(findWhat, literals);
+        return !literals.empty();
+    }
+
+    // Only "simple" regular expressions are supported: no alternation, no director prefix ("***=" etc) and no
+    // embedded options (e.g. "(?x)" where the white spaces are not literals)
+    if(findWhat.Contains("|") || findWhat.StartsWith("***") || findWhat.StartsWith("(?")) { return false; }
+
+    // Collect the literal runs at the top level of the expression. Characters followed by a quantifier that allows
+    // zero occurrences are dropped from the run
+    wxString run;
+    int depth = 0;
+    size_t i = 0;
+    while(i < findWhat.length()) {
+        wxChar ch = findWhat[i];
+        switch(ch) {
+        case '\\':
+            if(i + 1 < findWhat.length() && !wxIsalnum(findWhat[i + 1])) {
+                // escaped literal
+                if(depth == 0) { run << findWhat[i + 1]; }
+                i += 2;
+            } else {
+                // a class escape, e.g. \d, \w
+                AddAsciiRuns(run, literals);
+                run.clear();
+                i += 2;
+            }
+            continue;
+        case '(':
+            AddAsciiRuns(run, literals);
+            run.clear();
+            ++depth;
+            break;
+        case ')':
+            --depth;
+            break;
+        case '[': {
+            AddAsciiRuns(run, literals);
+            run.clear();
+            // skip the bracket expression
+            size_t closePos = FindBracketEnd(findWhat, i);
+            if(closePos == wxString::npos) { return false; }
+            i = closePos + 1;
+            continue;
+        }
+        case '?':
+        case '*':
+        case '{':
+            // the previous char is optional
+            if(!run.IsEmpty()) { run.RemoveLast(); }
+            AddAsciiRuns(run, literals);
+            run.clear();
+            if(ch == '{') {
+                size_t closePos = findWhat.find('}', i);
+                if(closePos == wxString::npos) { return !literals.empty(); }
+                i = closePos + 1;
+                continue;
+            }
+            break;
+        case '+':
+            // the previous char appears at least once and it may be repeated
+            if(!run.IsEmpty()) {
+                wxChar last = run.Last();
+                AddAsciiRuns(run, literals);
+                run.clear();
+                run << last;
+            }
+            break;
+        case '.':
+        case '^':
+        case '$':
+            AddAsciiRuns(run, literals);
+            run.clear();
+            break;
+        default:
+            if(depth == 0) { run << ch; }
+            break;
+        }
+        ++i;
+    }
+    AddAsciiRuns(run, literals);
+    return !literals.empty();
+}
+
+bool clTrigramIndex::FilterFiles(const wxString& findWhat, bool isRegex, const wxArrayString& filters,
+                                 wxArrayString& files)
+{
+    std::vector<std::string> literals;
+    GetRequiredLiterals(findWhat, isRegex, literals);
+    for(size_t i = 0; i < filters.size(); ++i) {
+        AddAsciiRuns(filters.Item(i), literals);
+    }
+    if(literals.empty()) { return false; }
+
+    std::unordered_set<wxUint32> querySet;
+    Trigrams_t trigrams;
+    for(size_t i = 0; i < literals.size(); ++i) {
+        ExtractTrigrams(literals[i].c_str(), literals[i].length(), trigrams);
+        querySet.insert(trigrams.begin(), trigrams.end());
+    }
+    if(querySet.empty()) { return false; }
+
+    std::vector<ExcludedFile> excluded;
+    std::vector<bool> keep(files.size(), true);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_pathToId.empty()) { return false; }
+        DoFilterFiles(querySet, files, excluded);
+    }
+
+    // A file modified outside of the editor may contain a match now: search it and queue it for re-indexing
+    wxArrayString modifiedFiles;
+    for(const ExcludedFile& entry : excluded) {
+        const wxString& file = files.Item(entry.index);
+        if(IsUnchanged(file, entry.lastModified, entry.size)) {
+            keep[entry.index] = false;
+        } else {
+            modifiedFiles.Add(file);
+        }
+    }
+    DoUpdateFiles(modifiedFiles);
+
+    wxArrayString result;
+    result.reserve(files.size() - excluded.size() + modifiedFiles.size());
+    for(size_t i = 0; i < files.size(); ++i) {
+        if(keep[i]) { result.Add(files.Item(i)); }
+    }
+    clDEBUG1() << "clTrigramIndex: narrowed search from" << files.size() << "to" << result.size() << "files ("
+               << modifiedFiles.size() << "modified files)" << clEndl;
+    files.swap(result);
+    return true;
+}
+
+void clTrigramIndex::DoFilterFiles(const std::unordered_set<wxUint32>& querySet, const wxArrayString& files,
+                                   std::vector<ExcludedFile>& excluded) const
+{
+    // Intersect the posting lists, starting with the shortest one
+    std::vector<const std::vector<wxUint32>*> lists;
+    static const std::vector<wxUint32> emptyList;
+    for(std::unordered_set<wxUint32>::const_iterator iter = querySet.begin(); iter != querySet.end(); ++iter) {
+        std::unordered_map<wxUint32, std::vector<wxUint32> >::const_iterator postings = m_postings.find(*iter);
+        lists.push_back(postings == m_postings.end() ? &emptyList : &postings->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<wxUint32>* a, const std::vector<wxUint32>* b) {
+        return a->size() < b->size();
+    });
+
+    std::vector<wxUint32> candidates = *lists[0];
+    std::vector<wxUint32> tmp;
+    for(size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        tmp.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(tmp));
+        candidates.swap(tmp);
+    }
+
+    for(size_t i = 0; i < files.size(); ++i) {
+        std::unordered_map<wxString, wxUint32>::const_iterator iter = m_pathToId.find(files.Item(i));
+        // unknown or saved files are always searched
+        if(iter == m_pathToId.end() || !m_files[iter->second].verified ||
+           std::binary_search(candidates.begin(), candidates.end(), iter->second)) {
+            continue;
+        }
+        const FileEntry& entry = m_files[iter->second];
+        excluded.push_back({ i, entry.lastModified, entry.size });
+    }
+}
+
+//===-------------------------------------------------------------
+// Event handlers
+//===-------------------------------------------------------------
+void clTrigramIndex::OnFileSaved(clCommandEvent& event)
+{
+    event.Skip();
+    wxArrayString files;
+    files.Add(event.GetFileName());
+    DoUpdateFiles(files);
+}
+
+void clTrigramIndex::OnFileDeleted(clFileSystemEvent& event)
+{
+    event.Skip();
+    wxArrayString files = event.GetPaths();
+    if(!event.GetPath().IsEmpty()) { files.Add(event.GetPath()); }
+    DoRemoveFiles(files);
+}
+
+void clTrigramIndex::OnFileRenamed(clFileSystemEvent& event)
+{
+    event.Skip();
+    wxArrayString oldFiles, newFiles;
+    oldFiles.Add(event.GetPath());
+    newFiles.Add(event.GetNewpath());
+    DoRemoveFiles(oldFiles);
+    DoUpdateFiles(newFiles);
+}
+
+void clTrigramIndex::OnProjectFilesAdded(clCommandEvent& event)
+{
+    event.Skip();
+    DoUpdateFiles(event.GetStrings());
+}
+
+void clTrigramIndex::OnProjectFilesRemoved(clCommandEvent& event)
+{
+    event.Skip();
+    DoRemoveFiles(event.GetStrings());
+}
+
+void clTrigramIndex::OnWorkspaceClosed(wxCommandEvent& event)
+{
+    event.Skip();
+    Close();
+}
@@ -0,0 +1,141 @@
+#ifndef CLTRIGRAMINDEX_H
+#define CLTRIGRAMINDEX_H
+
+#include "clFileSystemEvent.h"
+#include "cl_command_event.h"
+#include "codelite_exports.h"
+#include "worker_thread.h"
+#include "wxStringHash.h"
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <wx/event.h>
+#include <wx/filename.h>
+
+class clTrigramIndexThread;
+
+/**
+ * @class clTrigramIndex
+ * @brief a persistent trigram index of the workspace files.
+ * For every file we keep the set of (case folded) 3 bytes sequences that appear in it. Before running a search, the
+ * search thread asks the index to drop all the files that can not possibly contain a match, so only the candidate
+ * files are read from the disk.
+ *
+ * The index is kept in memory as an inverted index (trigram -> files) and is stored in a SQLite database next to the
+ * tags database. It is updated incrementally when files are saved, added or removed. Files are not watched: a file
+ * that the index rules out is checked against the disk when searching, and re-indexed if it was modified externally
+ */
+class WXDLLIMPEXP_CL clTrigramIndex : public wxEvtHandler
+{
+    friend class clTrigramIndexThread;
+
+public:
+    typedef std::vector<wxUint32> Trigrams_t;
+
+protected:
+    struct FileEntry {
+        wxString path;
+        time_t lastModified = 0;
+        size_t size = 0;
+        // false when the file was removed (or re-indexed under a new id)
+        bool alive = true;
+        // false when the file was saved since it was indexed. Such files are always search candidates
+        bool verified = false;
+    };
+
+    // A file ruled out by the index: its position in the searched files and the state it was indexed with
+    struct ExcludedFile {
+        size_t index;
+        time_t lastModified;
+        size_t size;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<FileEntry> m_files;
+    std::unordered_map<wxString, wxUint32> m_pathToId;
+    std::unordered_map<wxUint32, std::vector<wxUint32> > m_postings;
+    size_t m_deadCount = 0;
+    clTrigramIndexThread* m_thread = nullptr;
+
+protected:
+    void OnFileSaved(clCommandEvent& event);
+    void OnFileDeleted(clFileSystemEvent& event);
+    void OnFileRenamed(clFileSystemEvent& event);
+    void OnProjectFilesAdded(clCommandEvent& event);
+    void OnProjectFilesRemoved(clCommandEvent& event);
+    void OnWorkspaceClosed(wxCommandEvent& event);
+
+    /**
+     * @brief mark the files as modified and ask the indexer thread to re-index them
+     */
+    void DoUpdateFiles(const wxArrayString& files);
+    void DoRemoveFiles(const wxArrayString& files);
+
+    /**
+     * @brief collect the indexed files that can not contain the query trigrams. Called with the lock held
+     */
+    void DoFilterFiles(const std::unordered_set<wxUint32>& querySet, const wxArrayString& files,
+                       std::vector<ExcludedFile>& excluded) const;
+
+    // The below methods are called by the indexer thread
+    void DoClear();
+    void DoAddFile(const wxString& path, time_t lastModified, size_t size, const Trigrams_t& trigrams);
+    void DoRemoveFile(const wxString& path);
+    void DoCompact();
+
+public:
+    static clTrigramIndex& Get();
+    static void Release();
+
+    /**
+     * @brief return true if the index instance was created. Use this from worker threads, since Get() must be called
+     * for the first time from the main thread
+     */
+    static bool IsCreated();
+
+    clTrigramIndex();
+    virtual ~clTrigramIndex();
+
+    /**
+     * @brief load the index from 'dbfile' and bring it up to date with the workspace 'files'. The work is done in the
+     * background, files that are not indexed yet are considered as search candidates
+     */
+    void Load(const wxFileName& dbfile, const wxArrayString& files);
+
+    /**
+     * @brief unload the index
+     */
+    void Close();
+
+    /**
+     * @brief drop all the files from 'files' that can not contain a match for the search string. The files that were
+     * modified since they were indexed (last modification time or size changed) are kept and queued for re-indexing.
+     * The index only holds byte trigrams: do not use it when searching files with an encoding that is not ASCII
+     * compatible (e.g. UTF-16)
+     * @param findWhat the search string
+     * @param isRegex is 'findWhat' a regular expression? For regular expressions only the literal parts that must
+     * appear in every match are used
+     * @param filters additional strings that must appear in the matched line (pipe support)
+     * @return true if the index was used, false if the query can not be answered by the index
+     */
+    bool FilterFiles(const wxString& findWhat, bool isRegex, const wxArrayString& filters, wxArrayString& files);
+
+    /**
+     * @brief return the number of live files in the index
+     */
+    size_t GetFileCount() const;
+
+    /**
+     * @brief collect the (sorted, unique) case folded trigrams of a buffer
+     */
+    static void ExtractTrigrams(const char* buffer, size_t len, Trigrams_t& trigrams);
+
+    /**
+     * @brief collect the strings that must appear in every match of 'findWhat'
+     * @return false if there is no such string
+     */
+    static bool GetRequiredLiterals(const wxString& findWhat, bool isRegex, std::vector<std::string>& literals);
+};
+
+#endif // CLTRIGRAMINDEX_H
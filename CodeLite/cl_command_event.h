@@ -31,6 +31,7 @@
 #include "codelite_exports.h"
 #include "entry.h"
 #include "wxCodeCompletionBoxEntry.h"
+#include <string>
 #include <vector>
 #include <wx/arrstr.h>
 #include <wx/event.h>
@@ -146,6 +147,7 @@ protected:
     bool m_allowed;
     int m_lineNumber;
     bool m_selected;
+    std::string m_stringRaw;
 
 public:
     clCommandEvent(wxEventType commandType = wxEVT_NULL, int winid = 0);
@@ -206,6 +208,15 @@ public:
         this->m_strings = strings;
         return *this;
     }
+    /**
+     * @brief the data as received from a process or a socket, before it was converted into a wxString
+     */
+    clCommandEvent& SetStringRaw(const std::string& stringRaw)
+    {
+        this->m_stringRaw = stringRaw;
+        return *this;
+    }
+    const std::string& GetStringRaw() const { return m_stringRaw; }
     bool IsAllowed() const { return m_allowed; }
     bool IsAnswer() const { return m_answer; }
     const wxString& GetFileName() const { return m_fileName; }
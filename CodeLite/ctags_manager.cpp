@@ -66,6 +66,7 @@
 #include <wx/stdpaths.h>
 #include <wx/string.h>
 #include <wx/txtstrm.h>
+#include <wx/utils.h>
 #include <wx/wfstream.h>
 
 //#define __PERFORMANCE
@@ -141,6 +142,8 @@ TagsManager::TagsManager()
     , m_codeliteIndexerPath(wxT("codelite_indexer"))
     , m_codeliteIndexerProcess(NULL)
     , m_canRestartIndexer(true)
+    , m_indexerRestarting(false)
+    , m_indexerGeneration(0)
     , m_lang(NULL)
     , m_evtHandler(NULL)
     , m_encoding(wxFONTENCODING_DEFAULT)
@@ -311,32 +314,80 @@ void TagsManager::StartCodeLiteIndexer()
     }
 
     // concatenate the PID to identifies this channel to this instance of codelite
-    cmd << wxT("\"") << m_codeliteIndexerPath.GetFullPath() << wxT("\" ") << uid << wxT(" --pid");
+    cmd << wxT("\"") << m_codeliteIndexerPath.GetFullPath() << wxT("\" ") << uid << wxT(" --pid")
+        << wxT(" --workers ") << GetIndexerWorkers();
     m_codeliteIndexerProcess =
         CreateAsyncProcess(this, cmd, IProcessCreateDefault, clStandardPaths::Get().GetUserDataDir());
+    ++m_indexerGeneration;
 }
 
 void TagsManager::RestartCodeLiteIndexer()
 {
-    if(m_codeliteIndexerProcess) { m_codeliteIndexerProcess->Terminate(); }
+    // The process object is deleted and re-created by the main thread (see OnIndexerTerminated). Several parser
+    // threads may find the indexer broken at the same time, only the first request restarts it
+    bool expected = false;
+    if(!m_indexerRestarting.compare_exchange_strong(expected, true)) { return; }
+    if(wxThread::IsMain()) {
+        DoRestartCodeLiteIndexer();
+    } else {
+        CallAfter(&TagsManager::DoRestartCodeLiteIndexer);
+    }
+}
 
-    // no need to call StartCodeLiteIndexer(), since it will be called automatically
-    // by the termination handler
+void TagsManager::DoRestartCodeLiteIndexer()
+{
+    if(m_codeliteIndexerProcess) {
+        // no need to call StartCodeLiteIndexer(), since it will be called automatically
+        // by the termination handler
+        m_codeliteIndexerProcess->Terminate();
+    } else {
+        m_indexerRestarting = false;
+    }
+}
+
+void TagsManager::DoRestartBrokenIndexer(size_t generation)
+{
+    if(generation == m_indexerGeneration) { RestartCodeLiteIndexer(); }
+}
+
+bool TagsManager::WaitForIndexer(long timeoutMs)
+{
+    wxStopWatch sw;
+    while(m_indexerRestarting && sw.Time() < timeoutMs) {
+        wxMilliSleep(50);
+    }
+    return !m_indexerRestarting && IsIndexerRunning();
 }
 
 void TagsManager::SetCodeLiteIndexerPath(const wxString& path) { m_codeliteIndexerPath = path; }
 
+size_t TagsManager::GetIndexerWorkers() const
+{
+#ifdef __WXMSW__
+    // the indexer runs a single worker on Windows
+    return 1;
+#else
+    size_t workers = m_tagsOptions.GetIndexerWorkers();
+    if(workers == 0) {
+        int cpus = wxThread::GetCPUCount();
+        workers = cpus > 0 ? (size_t)cpus : 1;
+    }
+    return workers;
+#endif
+}
+
 void TagsManager::OnIndexerTerminated(clProcessEvent& event)
 {
     wxUnusedVar(event);
     wxDELETE(m_codeliteIndexerProcess);
     StartCodeLiteIndexer();
+    m_indexerRestarting = false;
 }
 
 //---------------------------------------------------------------------
 // Parsing
 //---------------------------------------------------------------------
-void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
+std::string TagsManager::DoGetIndexerChannelName() const
 {
     std::stringstream s;
     s << wxGetProcessId();
@@ -344,8 +395,32 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
     char channel_name[1024];
     memset(channel_name, 0, sizeof(channel_name));
     sprintf(channel_name, PIPE_NAME, s.str().c_str());
+    return channel_name;
+}
 
-    clNamedPipeClient client(channel_name);
+std::string TagsManager::DoGetCtagsOptions() const
+{
+    wxString ctagsCmd;
+    ctagsCmd << wxT(" ") << m_tagsOptions.ToString()
+             << wxT(" --excmd=pattern --sort=no --fields=aKmSsnit --c-kinds=+p --C++-kinds=+p ");
+    clDEBUG1() << "CTAGS options:" << ctagsCmd << clEndl;
+    return ctagsCmd.mb_str(wxConvUTF8).data();
+}
+
+wxString TagsManager::DoConvertTags(const std::string& reply) const
+{
+    wxString tags;
+    if(m_encoding == wxFONTENCODING_DEFAULT || m_encoding == wxFONTENCODING_SYSTEM)
+        tags = wxString(reply.c_str(), wxConvUTF8);
+    else
+        tags = wxString(reply.c_str(), wxCSConv(m_encoding));
+    if(tags.empty()) { tags = wxString::From8BitData(reply.c_str()); }
+    return tags;
+}
+
+void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
+{
+    clNamedPipeClient client(DoGetIndexerChannelName().c_str());
 
     // Build a request for the indexer
     clIndexerRequest req;
@@ -358,13 +433,10 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
     req.setFiles(files);
 
     // set ctags options to be used
-    wxString ctagsCmd;
-    ctagsCmd << wxT(" ") << m_tagsOptions.ToString()
-             << wxT(" --excmd=pattern --sort=no --fields=aKmSsnit --c-kinds=+p --C++-kinds=+p ");
-    req.setCtagOptions(ctagsCmd.mb_str(wxConvUTF8).data());
+    req.setCtagOptions(DoGetCtagsOptions());
 
-    clDEBUG1() << "Sending CTAGS command:" << ctagsCmd << clEndl;
     // connect to the indexer
+    size_t generation = m_indexerGeneration;
     if(!client.connect()) {
         clWARNING() << "Failed to connect to indexer process. Indexer ID:" << wxGetProcessId() << clEndl;
         return;
@@ -383,7 +455,7 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
         std::string errmsg;
         if(!clIndexerProtocol::ReadReply(&client, reply, errmsg)) {
             clWARNING() << "Failed to read indexer reply: " << (wxString() << errmsg) << clEndl;
-            RestartCodeLiteIndexer();
+            DoRestartBrokenIndexer(generation);
             return;
         }
     } catch(std::bad_alloc& ex) {
@@ -395,15 +467,68 @@ void TagsManager::SourceToTags(const wxFileName& source, wxString& tags)
     clDEBUG1() << "SourceToTags: [" << reply.getTags() << "]" << clEndl;
 
     // convert the data into wxString
-    if(m_encoding == wxFONTENCODING_DEFAULT || m_encoding == wxFONTENCODING_SYSTEM)
-        tags = wxString(reply.getTags().c_str(), wxConvUTF8);
-    else
-        tags = wxString(reply.getTags().c_str(), wxCSConv(m_encoding));
-    if(tags.empty()) { tags = wxString::From8BitData(reply.getTags().c_str()); }
-
+    tags = DoConvertTags(reply.getTags());
     clDEBUG1() << "Tags:\n" << tags << clEndl;
 }
 
+size_t TagsManager::SourceToTags(const wxArrayString& files, const SourceToTagsCallback_t& callback,
+                                 bool* streamBroken)
+{
+    if(streamBroken) { *streamBroken = false; }
+    if(files.IsEmpty()) { return 0; }
+
+    clNamedPipeClient client(DoGetIndexerChannelName().c_str());
+
+    // a single request for all the files, the indexer replies once per file
+    clIndexerRequest req;
+    req.setCmd(clIndexerRequest::CLI_PARSE_BATCH);
+
+    std::vector<std::string> paths;
+    paths.reserve(files.size());
+    for(size_t i = 0; i < files.size(); ++i) {
+        paths.push_back(files.Item(i).mb_str(wxConvUTF8).data());
+    }
+    req.setFiles(paths);
+    req.setCtagOptions(DoGetCtagsOptions());
+
+    size_t generation = m_indexerGeneration;
+    if(!client.connect()) {
+        clWARNING() << "Failed to connect to indexer process. Indexer ID:" << wxGetProcessId() << clEndl;
+        return 0;
+    }
+
+    if(!clIndexerProtocol::SendRequest(&client, req)) {
+        clWARNING() << "Failed to send request to indexer. Indexer ID:" << wxGetProcessId() << clEndl;
+        return 0;
+    }
+
+    // A broken stream restarts the indexer, the caller decides what to do with the files that were not parsed
+    size_t count = 0;
+    while(count < files.size()) {
+        clIndexerReply reply;
+        try {
+            std::string errmsg;
+            if(!clIndexerProtocol::ReadReply(&client, reply, errmsg)) {
+                clWARNING() << "Failed to read indexer reply: " << (wxString() << errmsg) << ". Parsed" << count
+                            << "out of" << files.size() << "files" << clEndl;
+                if(streamBroken) { *streamBroken = true; }
+                DoRestartBrokenIndexer(generation);
+                break;
+            }
+        } catch(std::bad_alloc& ex) {
+            clWARNING() << "std::bad_alloc exception caught" << clEndl;
+            break;
+        }
+
+        if(reply.getCompletionCode() == clIndexerReply::CLI_REPLY_END_OF_STREAM) { break; }
+
+        wxString tags;
+        if(reply.getCompletionCode() == clIndexerReply::CLI_REPLY_TAGS) { tags = DoConvertTags(reply.getTags()); }
+        if(!callback(count++, tags)) { break; }
+    }
+    return count;
+}
+
 TagTreePtr TagsManager::TreeFromTags(const wxString& tags, int& count)
 {
     // Load the records and build a language tree
@@ -1251,7 +1376,7 @@ void TagsManager::DeleteFilesTags(const std::vector<wxFileName>& projectFiles)
     ParseThreadST::Get()->Add(req);
 }
 
-void TagsManager::RetagFiles(const std::vector<wxFileName>& files, RetagType type, wxEvtHandler* cb)
+void TagsManager::RetagFiles(const std::vector<wxFileName>& files, RetagType type, wxEvtHandler* cb, bool bulkLoad)
 {
     wxArrayString strFiles;
     strFiles.Alloc(files.size()); // At most files.size() entries
@@ -1304,6 +1429,8 @@ void TagsManager::RetagFiles(const std::vector<wxFileName>& files, RetagType typ
 
     req->setType(type == Retag_Quick_No_Scan ? ParseRequest::PR_PARSE_FILE_NO_INCLUDES
                                              : ParseRequest::PR_PARSE_AND_STORE);
+    req->_quickRetag = (type != Retag_Full);
+    req->_bulkLoad = bulkLoad && (type == Retag_Full);
     req->_workspaceFiles.clear();
     req->_workspaceFiles.reserve(strFiles.size());
     for(size_t i = 0; i < strFiles.GetCount(); i++) {
@@ -2579,30 +2706,8 @@ bool TagsManager::IsBinaryFile(const wxString& filepath)
        type == FileExtManager::TypeSourceCpp)
         return false;
 
-    // examine the file based on the content of the first 4K (max) bytes
-    FILE* fp = fopen(filepath.To8BitData(), "rb");
-    if(fp) {
-
-        char buffer[1];
-        int textLen(0);
-        const int maxTextToExamine(4096);
-
-        // examine up to maxTextToExamine first chars in the file and search for '\0'
-        while(fread(buffer, sizeof(char), sizeof(buffer), fp) == 1 && textLen < maxTextToExamine) {
-            textLen++;
-            // if we found a NULL, return true
-            if(buffer[0] == 0) {
-                fclose(fp);
-                return true;
-            }
-        }
-
-        fclose(fp);
-        return false;
-    }
-
-    // if we could not open it, return true
-    return true;
+    // examine the file based on the content of the first 4K (max) bytes. If we could not open it, return true
+    return FileUtils::IsBinaryFile(filepath, 4096);
 }
 
 wxString TagsManager::WrapLines(const wxString& str)
@@ -3044,3 +3149,8 @@ void TagsManager::GetTagsByPartialNames(const wxArrayString& partialNames, std::
 {
     GetDatabase()->GetTagsByPartName(partialNames, tags);
 }
+
+void TagsManager::GetTagsByPaths(const wxArrayString& paths, std::vector<TagEntryPtr>& tags)
+{
+    GetDatabase()->GetTagsByPath(paths, tags);
+}
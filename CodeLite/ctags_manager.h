@@ -45,6 +45,8 @@
 #include "wx/event.h"
 #include "wx/process.h"
 #include "wxStringHash.h"
+#include <atomic>
+#include <functional>
 #include <set>
 #include <wx/stopwatch.h>
 #include <wx/thread.h>
@@ -150,6 +152,9 @@ private:
     TagsOptionsData m_tagsOptions;
     bool m_parseComments;
     bool m_canRestartIndexer;
+    // set while the indexer is being restarted. The generation changes every time a new indexer is started
+    std::atomic_bool m_indexerRestarting;
+    std::atomic_size_t m_indexerGeneration;
     Language* m_lang;
     std::vector<TagEntryPtr> m_cachedFileFunctionsTags;
     wxString m_cachedFile;
@@ -252,6 +257,16 @@ public:
      */
     void SetCodeLiteIndexerPath(const wxString& path);
 
+    /**
+     * @brief return the number of files the indexer can parse in parallel
+     */
+    size_t GetIndexerWorkers() const;
+
+    /**
+     * @brief is the codelite_indexer process running?
+     */
+    bool IsIndexerRunning() const { return m_codeliteIndexerProcess != NULL; }
+
     /**
      * @brief Store tree of tags into db.
      * @param tree Tags tree to store
@@ -299,10 +314,17 @@ public:
     void StartCodeLiteIndexer();
 
     /**
-     * Restart ctags process.
+     * Restart ctags process. Can be called from any thread: the restart is done by the main thread and
+     * concurrent requests result in a single restart
      */
     void RestartCodeLiteIndexer();
 
+    /**
+     * @brief wait (at most 'timeoutMs') for a pending indexer restart to complete. Return true if the indexer is
+     * running
+     */
+    bool WaitForIndexer(long timeoutMs);
+
     /**
      * Test if filename matches the current ctags file spec.
      * @param filename file name to test
@@ -394,8 +416,10 @@ public:
      * - parse the files
      * - update the database again
      * @param files list of files, in absolute path, to retag
+     * @param bulkLoad the files are the whole workspace (a full workspace retag), the database is loaded in bulk mode
      */
-    void RetagFiles(const std::vector<wxFileName>& files, RetagType type, wxEvtHandler* cb = NULL);
+    void RetagFiles(const std::vector<wxFileName>& files, RetagType type, wxEvtHandler* cb = NULL,
+                    bool bulkLoad = false);
 
     /**
      * Close the workspace database
@@ -532,6 +556,22 @@ public:
      */
     void SourceToTags(const wxFileName& source, wxString& tags);
 
+    /**
+     * @brief callback for the batch version of SourceToTags. 'index' is the index of the file in the input array.
+     * Return false to stop the parsing of the remaining files
+     */
+    typedef std::function<bool(size_t index, const wxString& tags)> SourceToTagsCallback_t;
+
+    /**
+     * @brief send all the files to ctags process in a single request. The tags of each file are streamed back and
+     * passed to 'callback' as soon as the file is parsed, in the order of the input array
+     * @return the number of files passed to the callback. This is less than the number of files when the callback
+     * asked to stop, when the indexer could not be reached or when the stream broke. In the latter case 'streamBroken'
+     * is set to true and the indexer is restarted (the caller may resend the remaining files)
+     */
+    size_t SourceToTags(const wxArrayString& files, const SourceToTagsCallback_t& callback,
+                        bool* streamBroken = nullptr);
+
     /**
      * return list of files from the database(s). The returned list is ordered
      * by name (ascending)
@@ -670,6 +710,11 @@ public:
      */
     void GetTagsByPartialNames(const wxArrayString& partialNames, std::vector<TagEntryPtr>& tags);
 
+    /**
+     * @brief return list of tags by their exact paths (scope::name)
+     */
+    void GetTagsByPaths(const wxArrayString& paths, std::vector<TagEntryPtr>& tags);
+
     /**
      * @brief return list of tags by KIND
      * @param tags [output]
@@ -844,6 +889,11 @@ protected:
      * Handler ctags process termination
      */
     void OnIndexerTerminated(clProcessEvent& event);
+    void DoRestartCodeLiteIndexer();
+    /**
+     * @brief restart the indexer after a broken stream, unless it was already restarted since 'generation'
+     */
+    void DoRestartBrokenIndexer(size_t generation);
 
 private:
     /**
@@ -919,6 +969,9 @@ protected:
     wxString DoReplaceMacrosFromDatabase(const wxString& name);
     void DoSortByVisibility(TagEntryPtrVector_t& tags);
     void GetScopesByScopeName(const wxString& scopeName, wxArrayString& scopes);
+    std::string DoGetIndexerChannelName() const;
+    std::string DoGetCtagsOptions() const;
+    wxString DoConvertTags(const std::string& tags) const;
 };
 
 /// create the singleton typedef
@@ -24,6 +24,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "fc_fileopener.h"
+#include "fileutils.h"
 #include <cstdio>
 #include <cctype>
 #include <algorithm>
@@ -36,6 +37,29 @@
 #define FC_PATH_SEP "/"
 #endif
 
+// Files larger than this are not scanned for include statements
+#define FC_MAX_FILE_SIZE (10 * 1024 * 1024)
+#define FC_HEADER_SIZE 4096
+
+/**
+ * @brief return true if the file is too big or a binary file. Only the first FC_HEADER_SIZE bytes are read, and the file
+ * position is restored to the start of the file
+ */
+static bool fc_should_skip(FILE* fp)
+{
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if(fsize < 0 || fsize > FC_MAX_FILE_SIZE) {
+        return true;
+    }
+
+    char header[FC_HEADER_SIZE];
+    size_t bytes_read = fread(header, 1, sizeof(header), fp);
+    fseek(fp, 0, SEEK_SET);
+    return FileUtils::IsBinaryContent(header, bytes_read);
+}
+
 fcFileOpener* fcFileOpener::ms_instance = 0;
 
 fcFileOpener::fcFileOpener()
@@ -127,6 +151,11 @@ FILE* fcFileOpener::try_open(const wxString& path, const wxString& name, wxStrin
             }
         }
 
+        if(fc_should_skip(fp)) {
+            ::fclose(fp);
+            return NULL;
+        }
+
         _matchedfiles.insert(fullpath);
         filepath = fullpath;
         return fp;
@@ -132,6 +132,49 @@ bool FileUtils::ReadFileContent(const wxFileName& fn, wxString& data, const wxMB
     return true;
 }
 
+bool FileUtils::ReadFileContentRaw(const wxFileName& fn, std::string& data)
+{
+    data.clear();
+    const wxCharBuffer cfile = fn.GetFullPath().mb_str(wxConvUTF8);
+    FILE* fp = fopen(cfile.data(), "rb");
+    if(!fp) {
+        clERROR() << "Failed to open file:" << fn << "." << strerror(errno);
+        return false;
+    }
+
+    // Get the file size
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    data.resize(fsize);
+    long bytes_read = fsize > 0 ? fread(&data[0], 1, fsize, fp) : 0;
+    fclose(fp);
+    if(bytes_read != fsize) {
+        clERROR() << "Failed to read file content:" << fn << "." << strerror(errno);
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool FileUtils::IsBinaryContent(const char* buffer, size_t len)
+{
+    return buffer && len && (memchr(buffer, 0, len) != nullptr);
+}
+
+bool FileUtils::IsBinaryFile(const wxFileName& fn, size_t headerSize)
+{
+    const wxCharBuffer cfile = fn.GetFullPath().mb_str(wxConvUTF8);
+    FILE* fp = fopen(cfile.data(), "rb");
+    if(!fp) { return true; }
+
+    std::vector<char> header(headerSize);
+    size_t bytes_read = fread(header.data(), 1, header.size(), fp);
+    fclose(fp);
+    return IsBinaryContent(header.data(), bytes_read);
+}
+
 void FileUtils::OpenFileExplorerAndSelect(const wxFileName& filename)
 {
 #ifdef __WXMSW__
@@ -55,6 +55,22 @@ public:
 public:
     static bool ReadFileContent(const wxFileName& fn, wxString& data, const wxMBConv& conv = wxConvUTF8);
 
+    /**
+     * @brief read the file content as-is, without converting it into wxString
+     */
+    static bool ReadFileContentRaw(const wxFileName& fn, std::string& data);
+
+    /**
+     * @brief return true if the buffer contains a NULL byte
+     */
+    static bool IsBinaryContent(const char* buffer, size_t len);
+
+    /**
+     * @brief return true if the first 'headerSize' bytes of the file contain a NULL byte.
+     * Only the header is read from the disk. A file that can not be opened is considered binary
+     */
+    static bool IsBinaryFile(const wxFileName& fn, size_t headerSize = 4096);
+
     /**
      * @brief attempt to read up to bufferSize from the beginning of file
      */
@@ -319,6 +319,13 @@ public:
      */
     virtual void GetTagsNames(const wxArrayString& kind, wxArrayString& names) = 0;
 
+    /**
+     * @brief return the unique paths (scope::name) of all the tags in the database. Unlike the above, the list is not
+     * limited
+     * @param paths
+     */
+    virtual void GetAllTagsPaths(std::vector<wxString>& paths) = 0;
+
     /**
      * Store tree of tags into db.
      * @param tree Tags tree to store
@@ -361,6 +368,13 @@ public:
     virtual void Commit() = 0;
     virtual void Rollback() = 0;
 
+    /**
+     * @brief bracket the storing of a large number of files (e.g. a full retag) so the storage can optimize for bulk
+     * writes. Lookups made between the two calls may be slow
+     */
+    virtual void BeginBulkLoad() = 0;
+    virtual void EndBulkLoad() = 0;
+
     /**
      * Delete all entries from database that are related to filename.
      * @param path Database name
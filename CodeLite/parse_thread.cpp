@@ -37,15 +37,208 @@
 #include "pptable.h"
 #include "precompiled_header.h"
 #include "tags_storage_sqlite3.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <tags_options_data.h>
 #include <wx/ffile.h>
 #include <wx/stopwatch.h>
 #include <wx/tokenzr.h>
+#include <wx/utils.h>
 #include "fileextmanager.h"
 
 #define DEBUG_MESSAGE(x) CL_DEBUG1(x.c_str())
 
+namespace
+{
+/**
+ * @class SourceToTagsPool
+ * @brief convert a list of files into tags using several streaming connections to the indexer at once, so all the
+ * indexer workers are kept busy. Each connection sends a batch of files in a single request and the tags of every file
+ * are handed to the consumer as soon as they arrive, in no particular order
+ */
+class SourceToTagsPool
+{
+    struct FileTags {
+        size_t index;
+        wxString tags;
+    };
+
+    // number of files sent in a single request
+    static const size_t BATCH_SIZE = 100;
+    // how long a worker waits for the indexer to come back after a restart, in milliseconds
+    static const long INDEXER_WAIT_TIMEOUT = 10000;
+    // the maximum number of parsed files waiting for the consumer before the workers stop reading
+    static const size_t MAX_READY = 1000;
+
+    const wxArrayString& m_files;
+    bool m_skipBinaryFiles;
+    size_t m_batches;
+    std::atomic_size_t m_nextBatch;
+    bool m_stop;
+    size_t m_pending; // files that were not delivered yet
+    std::deque<FileTags> m_ready;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    std::condition_variable m_cvSpace;
+    std::vector<std::thread> m_threads;
+
+protected:
+    /**
+     * @brief pass the tags of a file to the consumer. When 'tags' is null the file is skipped
+     * @return false if the pool is going down
+     */
+    bool Deliver(size_t index, const wxString* tags)
+    {
+        std::unique_lock<std::mutex> guard(m_lock);
+        if(tags) {
+            m_cvSpace.wait(guard, [&]() { return m_stop || m_ready.size() < MAX_READY; });
+            if(m_stop) { return false; }
+            m_ready.push_back(FileTags());
+            m_ready.back().index = index;
+            m_ready.back().tags = *tags;
+        }
+        --m_pending;
+        m_cv.notify_one();
+        return !m_stop;
+    }
+
+    bool IsStopping()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_stop;
+    }
+
+    /**
+     * @brief parse 'files' (the files at 'indexes'). When the stream breaks, the indexer is restarted (once for all the
+     * workers) and the rest of the files are sent to the new indexer. A file that breaks the stream twice in a row
+     * (i.e. the indexer crashes on it) is skipped
+     * @return false if the pool is going down
+     */
+    bool ParseBatch(const wxArrayString& files, const std::vector<size_t>& indexes)
+    {
+        size_t start = 0;
+        size_t brokenAt = wxString::npos;
+        wxStopWatch sw; // time since the last progress
+        while(start < files.size()) {
+            wxArrayString rest;
+            rest.insert(rest.end(), files.begin() + start, files.end());
+            bool streamBroken = false;
+            size_t done = TagsManagerST::Get()->SourceToTags(
+                rest, [&](size_t i, const wxString& tags) { return Deliver(indexes[start + i], &tags); },
+                &streamBroken);
+            if(IsStopping()) { return false; }
+
+            if(done) { sw.Start(); }
+            start += done;
+            if(start == files.size()) { break; }
+
+            if(streamBroken) {
+                if(brokenAt == start) {
+                    clWARNING() << "The indexer failed to parse file:" << files.Item(start) << ". Skipping it"
+                                << clEndl;
+                    if(!Deliver(indexes[start], nullptr)) { return false; }
+                    ++start;
+                    brokenAt = wxString::npos;
+                    sw.Start();
+                    continue;
+                }
+                brokenAt = start;
+            }
+
+            // The indexer is being restarted or does not accept connections yet: wait for it instead of skipping the
+            // rest of the files
+            if(!TagsManagerST::Get()->WaitForIndexer(INDEXER_WAIT_TIMEOUT) || sw.Time() > INDEXER_WAIT_TIMEOUT) {
+                clWARNING() << "The indexer is not available." << (files.size() - start) << "files were not parsed"
+                            << clEndl;
+                for(; start < files.size(); ++start) {
+                    if(!Deliver(indexes[start], nullptr)) { return false; }
+                }
+                break;
+            }
+            if(!streamBroken) { wxMilliSleep(100); }
+        }
+        return true;
+    }
+
+    void Run()
+    {
+        while(true) {
+            size_t batch = m_nextBatch.fetch_add(1);
+            if(batch >= m_batches) { break; }
+
+            size_t first = batch * BATCH_SIZE;
+            size_t last = std::min(first + BATCH_SIZE, m_files.size());
+            wxArrayString files;
+            std::vector<size_t> indexes;
+            for(size_t i = first; i < last; ++i) {
+                if(m_skipBinaryFiles && TagsManagerST::Get()->IsBinaryFile(m_files.Item(i))) {
+                    if(!Deliver(i, nullptr)) { return; }
+                    continue;
+                }
+                files.Add(m_files.Item(i));
+                indexes.push_back(i);
+            }
+
+            if(!ParseBatch(files, indexes)) { return; }
+        }
+    }
+
+public:
+    SourceToTagsPool(const wxArrayString& files, size_t workers, bool skipBinaryFiles)
+        : m_files(files)
+        , m_skipBinaryFiles(skipBinaryFiles)
+        , m_batches((files.size() + BATCH_SIZE - 1) / BATCH_SIZE)
+        , m_nextBatch(0)
+        , m_stop(false)
+        , m_pending(files.size())
+    {
+        workers = std::min(std::max(workers, (size_t)1), m_batches);
+        m_threads.reserve(workers);
+        for(size_t i = 0; i < workers; ++i) {
+            m_threads.push_back(std::thread([this]() { Run(); }));
+        }
+    }
+
+    ~SourceToTagsPool()
+    {
+        {
+            // don't let the workers pick any more files
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stop = true;
+            m_nextBatch.store(m_batches);
+            m_cvSpace.notify_all();
+        }
+        for(size_t i = 0; i < m_threads.size(); ++i) {
+            m_threads[i].join();
+        }
+    }
+
+    /**
+     * @brief wait for the next parsed file
+     * @param index [output] the index of the file in the files list
+     * @param tags [output] the file tags
+     * @return false when all the files were consumed
+     */
+    bool Next(size_t& index, wxString& tags)
+    {
+        std::unique_lock<std::mutex> guard(m_lock);
+        m_cv.wait(guard, [&]() { return !m_ready.empty() || m_pending == 0; });
+        if(m_ready.empty()) { return false; }
+        index = m_ready.front().index;
+        tags.swap(m_ready.front().tags);
+        m_ready.pop_front();
+        m_cvSpace.notify_one();
+        return true;
+    }
+};
+} // namespace
+
 #define TEST_DESTROY()                                                                                        \
     {                                                                                                         \
         if(TestDestroy()) {                                                                                   \
@@ -341,15 +534,17 @@ void ParseThread::ParseAndStoreFiles(ParseRequest* req, const wxArrayString& arr
     // Loop over the files and parse them
     int totalSymbols(0);
     DEBUG_MESSAGE(wxString::Format(wxT("Parsing and saving files to database....")));
-    for(size_t i = 0; i < arrFiles.GetCount(); i++) {
+
+    // Stream the files through the indexer and store each file as soon as its tags arrive
+    SourceToTagsPool pool(arrFiles, TagsManagerST::Get()->GetIndexerWorkers(), false);
+    size_t index(0);
+    wxString tags; // output
+    while(pool.Next(index, tags)) {
 
         // give a shutdown request a chance
         TEST_DESTROY();
 
-        wxString tags; // output
-        TagsManagerST::Get()->SourceToTags(arrFiles.Item(i), tags);
-
-        if(tags.IsEmpty() == false) { DoStoreTags(tags, arrFiles.Item(i), totalSymbols, db); }
+        if(tags.IsEmpty() == false) { DoStoreTags(tags, arrFiles.Item(index), totalSymbols, db); }
     }
 
     DEBUG_MESSAGE(wxString(wxT("Done")));
@@ -413,10 +608,16 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
     reportingPoint = ceil(reportingPoint);
     if(reportingPoint == 0.0) { reportingPoint = 1.0; }
 
+    wxStopWatch sw;
     ITagsStoragePtr db(new TagsStorageSQLite());
     db->OpenDatabase(dbfile);
 
-    // We commit every 10 files
+    // A full workspace retag stores everything: drop the lookup indexes while storing and commit in large batches.
+    // Rebuilding the indexes is not worth it for a smaller set of files (e.g. a single project)
+    bool bulkLoad = req->_bulkLoad;
+    size_t commitInterval = bulkLoad ? 1000 : 50;
+    if(bulkLoad) { db->BeginBulkLoad(); }
+
     db->Begin();
     int precent(0);
     int lastPercentageReported(0);
@@ -426,27 +627,10 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
     req->_workspaceFiles.insert(req->_workspaceFiles.begin(), hackfile.ToStdString());
     PPTable::Instance()->Clear();
 
-    for(size_t i = 0; i < maxVal; i++) {
-
-        // give a shutdown request a chance
-        if(TestDestroy()) {
-            // Do an ordered shutdown:
-            // rollback any transaction
-            // and close the database
-            db->Rollback();
-            return;
-        }
-
-        wxFileName curFile(wxString(req->_workspaceFiles[i].c_str(), wxConvUTF8));
-
-        // Skip binary files
-        if(TagsManagerST::Get()->IsBinaryFile(curFile.GetFullPath())) {
-            DEBUG_MESSAGE(wxString::Format(wxT("Skipping binary file %s"), curFile.GetFullPath().c_str()));
-            continue;
-        }
-
+    size_t processed(0);
+    auto storeFile = [&](const wxFileName& curFile, TagTreePtr tree) {
         // Send notification to the main window with our progress report
-        precent = (int)((i / maxVal) * 100);
+        precent = (int)((processed / maxVal) * 100);
 
         if(req->_evtHandler && lastPercentageReported != precent) {
             lastPercentageReported = precent;
@@ -455,7 +639,6 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
             req->_evtHandler->AddPendingEvent(retaggingProgressEvent);
         }
 
-        TagTreePtr tree = TagsManagerST::Get()->ParseSourceFile(curFile);
         PPScan(curFile.GetFullPath(), false);
 
         db->Store(tree, wxFileName(), false);
@@ -463,12 +646,61 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
             db->UpdateFileEntry(curFile.GetFullPath(), (int)time(NULL));
         }
 
-        if(i % 50 == 0) {
+        if(processed % commitInterval == 0) {
             // Commit what we got so far
             db->Commit();
             // Start a new transaction
             db->Begin();
         }
+        ++processed;
+    };
+
+    if(TagsManagerST::Get()->IsIndexerRunning()) {
+        // Let the indexer workers parse the files ahead of us, and store the files in the order they are parsed
+        wxArrayString files;
+        files.Alloc(req->_workspaceFiles.size());
+        for(size_t i = 0; i < req->_workspaceFiles.size(); ++i) {
+            files.Add(wxString(req->_workspaceFiles[i].c_str(), wxConvUTF8));
+        }
+
+        SourceToTagsPool pool(files, TagsManagerST::Get()->GetIndexerWorkers(), true);
+        size_t index(0);
+        wxString tags;
+        while(pool.Next(index, tags)) {
+            // give a shutdown request a chance
+            if(TestDestroy()) {
+                // Do an ordered shutdown:
+                // rollback any transaction
+                // and close the database
+                db->Rollback();
+                return;
+            }
+
+            int count(0);
+            storeFile(wxFileName(files.Item(index)), TagsManagerST::Get()->TreeFromTags(tags, count));
+        }
+
+    } else {
+        for(size_t i = 0; i < maxVal; i++) {
+
+            // give a shutdown request a chance
+            if(TestDestroy()) {
+                // Do an ordered shutdown:
+                // rollback any transaction
+                // and close the database
+                db->Rollback();
+                return;
+            }
+
+            wxFileName curFile(wxString(req->_workspaceFiles[i].c_str(), wxConvUTF8));
+
+            // Skip binary files
+            if(TagsManagerST::Get()->IsBinaryFile(curFile.GetFullPath())) {
+                DEBUG_MESSAGE(wxString::Format(wxT("Skipping binary file %s"), curFile.GetFullPath().c_str()));
+                continue;
+            }
+            storeFile(curFile, TagsManagerST::Get()->ParseSourceFile(curFile));
+        }
     }
 
     // Process the macros
@@ -480,6 +712,13 @@ void ParseThread::ProcessParseAndStore(ParseRequest* req)
 
     // Commit whats left
     db->Commit();
+    long storeTime = sw.Time();
+
+    // Rebuild the indexes. An aborted bulk load (the 'return' statements above) is fixed the next time the database
+    // is opened
+    if(bulkLoad) { db->EndBulkLoad(); }
+    clSYSTEM() << "Retagging" << processed << "files took" << sw.Time() << "ms (storing:" << storeTime
+               << "ms, rebuilding indexes:" << (sw.Time() - storeTime) << "ms)" << clEndl;
 
     // Clear the results
     PPTable::Instance()->Clear();
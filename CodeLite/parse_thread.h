@@ -60,6 +60,7 @@ public:
     wxEvtHandler* _evtHandler;
     std::vector<std::string> _workspaceFiles;
     bool _quickRetag;
+    bool _bulkLoad; // the files are the whole workspace (full retag): store them in bulk load mode
     int _uid;
 
 public:
@@ -80,6 +81,7 @@ public:
         : _type(PR_FILESAVED)
         , _evtHandler(handler)
         , _quickRetag(false)
+        , _bulkLoad(false)
         , _uid(-1)
     {
     }
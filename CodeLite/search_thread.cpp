@@ -23,6 +23,9 @@
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 #include "clFilesCollector.h"
+#include "clMappedFile.h"
+#include "clRegexDFA.h"
+#include "clTrigramIndex.h"
 #include "cppwordscanner.h"
 #include "dirtraverser.h"
 #include "fileutils.h"
@@ -30,8 +33,14 @@
 #include "search_thread.h"
 #include "wx/event.h"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <wx/dir.h>
 #if wxUSE_GUI
 #include <wx/fontmap.h>
@@ -115,6 +124,23 @@ void SearchThread::SetWordChars(const wxString& chars)
     IndexWordChars();
 }
 
+int SearchThread::GetRegexFlags(bool matchCase)
+{
+#ifndef __WXMAC__
+    int flags = wxRE_ADVANCED;
+#else
+    int flags = wxRE_DEFAULT;
+#endif
+
+    if(!matchCase) flags |= wxRE_ICASE;
+    return flags;
+}
+
+void SearchThread::CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase)
+{
+    re.Compile(expr, GetRegexFlags(matchCase));
+}
+
 wxRegEx& SearchThread::GetRegex(const wxString& expr, bool matchCase)
 {
     if(m_reExpr == expr && matchCase == m_matchCase) {
@@ -122,14 +148,7 @@ wxRegEx& SearchThread::GetRegex(const wxString& expr, bool matchCase)
     } else {
         m_reExpr = expr;
         m_matchCase = matchCase;
-#ifndef __WXMAC__
-        int flags = wxRE_ADVANCED;
-#else
-        int flags = wxRE_DEFAULT;
-#endif
-
-        if(!matchCase) flags |= wxRE_ICASE;
-        m_regex.Compile(m_reExpr, flags);
+        CompileRegex(m_regex, m_reExpr, m_matchCase);
     }
     return m_regex;
 }
@@ -178,6 +197,26 @@ void SearchThread::GetFiles(const SearchData* data, wxArrayString& files)
     FilterFiles(files, data);
 }
 
+static bool IsAsciiCompatibleEncoding(const SearchData* data)
+{
+#if wxUSE_GUI
+    // The trigram index holds the bytes of the files. In these encodings, ASCII text is not stored as ASCII bytes
+    switch(wxFontMapper::GetEncodingFromName(data->GetEncoding())) {
+    case wxFONTENCODING_UTF7:
+    case wxFONTENCODING_UTF16BE:
+    case wxFONTENCODING_UTF16LE:
+    case wxFONTENCODING_UTF32BE:
+    case wxFONTENCODING_UTF32LE:
+        return false;
+    default:
+        return true;
+    }
+#else
+    wxUnusedVar(data);
+    return true;
+#endif
+}
+
 void SearchThread::DoSearchFiles(ThreadRequest* req)
 {
     SearchData* data = static_cast<SearchData*>(req);
@@ -192,6 +231,18 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
     wxArrayString fileList;
     GetFiles(data, fileList);
 
+    // Use the workspace trigram index to drop the files that can not contain a match
+    if(clTrigramIndex::IsCreated() && IsAsciiCompatibleEncoding(data)) {
+        if(data->IsRegularExpression()) {
+            clTrigramIndex::Get().FilterFiles(data->GetFindString(), true, wxArrayString(), fileList);
+        } else {
+            wxString findString;
+            wxArrayString filters;
+            PrepareFindString(data, findString, filters);
+            clTrigramIndex::Get().FilterFiles(findString, false, filters, fileList);
+        }
+    }
+
     wxStopWatch sw;
 
     // Send startup message to main thread
@@ -206,17 +257,134 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
         }
     }
 
+    PrepareByteSearch(data);
+
+    int cpus = wxThread::GetCPUCount();
+    size_t workers = m_maxWorkers == 0 ? (size_t)std::max(cpus, 1) : m_maxWorkers;
+    // no point in starting more threads than we have files
+    workers = std::min(workers, (size_t)fileList.size());
+    if(workers > 1) {
+        DoSearchFilesParallel(fileList, data, workers);
+    } else {
+        DoSearchFilesSerial(fileList, data);
+    }
+}
+
+static wxMBConv* CreateSearchConv(const SearchData* data)
+{
+#if wxUSE_GUI
+    // support for other encoding
+    wxFontEncoding enc = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
+    return new wxCSConv(enc);
+#else
+    wxUnusedVar(data);
+    return wxConvLibc.Clone();
+#endif
+}
+
+bool SearchThread::DoMergeFileResults(size_t fileIndex, const wxString& fileName, bool readOk,
+                                      SearchResultList& fileResults, const SearchData* data)
+{
+    m_summary.SetNumFileScanned((int)fileIndex + 1);
+
+    // give user chance to cancel the search ...
+    if(TestStopSearch()) {
+        // Send cancel event
+        SendEvent(wxEVT_SEARCH_THREAD_SEARCHCANCELED, data->GetOwner());
+        StopSearch(false);
+        return false;
+    }
+
+    if(!readOk) {
+        m_summary.GetFailedFiles().Add(fileName);
+        return true;
+    }
+
+    if(!fileResults.empty()) {
+        m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + (int)fileResults.size());
+        m_results.splice(m_results.end(), fileResults);
+    }
+    if(m_results.empty() == false) { SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner()); }
+    return true;
+}
+
+void SearchThread::DoSearchFilesSerial(const wxArrayString& fileList, const SearchData* data)
+{
+    std::unique_ptr<wxMBConv> conv(CreateSearchConv(data));
+    wxRegEx noRegex;
+    wxRegEx& re = data->IsRegularExpression() ? GetRegex(data->GetFindString(), data->IsMatchCase()) : noRegex;
+    clRegexDFA dfa;
+    if(m_regexSearch) { dfa.Compile(data->GetFindString(), GetRegexFlags(data->IsMatchCase())); }
     for(size_t i = 0; i < fileList.Count(); i++) {
-        m_summary.SetNumFileScanned((int)i + 1);
+        SearchResultList fileResults;
+        bool readOk = true;
+        if(!TestStopSearch()) { readOk = DoSearchFile(fileList.Item(i), data, *conv, re, dfa, fileResults); }
+        if(!DoMergeFileResults(i, fileList.Item(i), readOk, fileResults, data)) { break; }
+    }
+}
+
+void SearchThread::DoSearchFilesParallel(const wxArrayString& fileList, const SearchData* data, size_t workers)
+{
+    // Each file gets its own slot. The workers fill the slots in whatever order they complete, while this thread
+    // consumes them sequentially so the results are reported in the same order as the serial search
+    struct FileSlot {
+        SearchResultList results;
+        bool readOk = true;
+        bool done = false;
+    };
+
+    std::vector<FileSlot> slots(fileList.size());
+    std::atomic_size_t nextFile(0);
+    std::mutex lock;
+    std::condition_variable cv;
+
+    std::unique_ptr<wxMBConv> protoConv(CreateSearchConv(data));
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for(size_t w = 0; w < workers; ++w) {
+        // wxMBConv, wxRegEx and clRegexDFA are not safe to share between threads, give each worker its own copy
+        std::shared_ptr<wxMBConv> conv(protoConv->Clone());
+        threads.push_back(std::thread([&, conv]() {
+            wxRegEx re;
+            clRegexDFA dfa;
+            if(data->IsRegularExpression()) { CompileRegex(re, data->GetFindString(), data->IsMatchCase()); }
+            if(m_regexSearch) { dfa.Compile(data->GetFindString(), GetRegexFlags(data->IsMatchCase())); }
+            while(true) {
+                size_t index = nextFile.fetch_add(1);
+                if(index >= slots.size()) { break; }
+
+                SearchResultList results;
+                bool readOk = true;
+                if(!TestStopSearch()) { readOk = DoSearchFile(fileList.Item(index), data, *conv, re, dfa, results); }
+
+                std::lock_guard<std::mutex> guard(lock);
+                slots[index].results.swap(results);
+                slots[index].readOk = readOk;
+                slots[index].done = true;
+                cv.notify_all();
+            }
+        }));
+    }
 
-        // give user chance to cancel the search ...
-        if(TestStopSearch()) {
-            // Send cancel event
-            SendEvent(wxEVT_SEARCH_THREAD_SEARCHCANCELED, data->GetOwner());
-            StopSearch(false);
+    for(size_t i = 0; i < slots.size(); ++i) {
+        SearchResultList fileResults;
+        bool readOk = true;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cv.wait(guard, [&]() { return slots[i].done; });
+            fileResults.swap(slots[i].results);
+            readOk = slots[i].readOk;
+        }
+
+        if(!DoMergeFileResults(i, fileList.Item(i), readOk, fileResults, data)) {
+            // DoMergeFileResults cleared the stop flag: make sure that the workers won't pick any more files
+            nextFile.store(slots.size());
             break;
         }
-        DoSearchFile(fileList.Item(i), data);
+    }
+
+    for(size_t w = 0; w < threads.size(); ++w) {
+        threads[w].join();
     }
 }
 
@@ -236,31 +404,30 @@ void SearchThread::StopSearch(bool stop)
     m_stopSearch = stop;
 }
 
-void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data)
+bool SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data, wxMBConv& conv, wxRegEx& re,
+                                clRegexDFA& dfa, SearchResultList& results)
 {
     // Process single lines
     int lineNumber = 1;
-    if(!wxFileName::FileExists(fileName)) { return; }
+    if(!wxFileName::FileExists(fileName)) { return true; }
 
     size_t size = FileUtils::GetFileSize(fileName);
-    if(size == 0) { return; }
+    if(size == 0) { return true; }
+
+    if(m_byteSearch) {
+        bool readOk = true;
+        if(DoSearchFileBytes(fileName, data, readOk, results)) { return readOk; }
+        // could not search this file at the byte level, use the line by line search
+    } else if(m_regexSearch) {
+        bool readOk = true;
+        if(DoSearchFileRegex(fileName, data, dfa, re, readOk, results)) { return readOk; }
+    }
+
     wxString fileData;
     fileData.Alloc(size);
 
-#if wxUSE_GUI
-    // support for other encoding
-    wxFontEncoding enc = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
-    wxCSConv fontEncConv(enc);
-    if(!FileUtils::ReadFileContent(fileName, fileData, fontEncConv)) {
-        m_summary.GetFailedFiles().Add(fileName);
-        return;
-    }
-#else
-    if(!FileUtils::ReadFileContent(fileName, fileData, wxConvLibc)) {
-        m_summary.GetFailedFiles().Add(fileName);
-        return;
-    }
-#endif
+    if(!FileUtils::ReadFileContent(fileName, fileData, conv)) { return false; }
+
     // take a wild guess and see if we really need to construct
     // a TextStatesPtr object (it is quite an expensive operation)
     bool shouldCreateStates(true);
@@ -289,7 +456,7 @@ void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data
         while(tkz.HasMoreTokens()) {
             // Read the next line
             wxString line = tkz.NextToken();
-            DoSearchLineRE(line, lineNumber, lineOffset, fileName, data, states);
+            DoSearchLineRE(line, lineNumber, lineOffset, fileName, data, states, re, results);
             lineOffset += line.Length() + 1;
             lineNumber++;
         }
@@ -297,40 +464,262 @@ void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data
         // simple search
         wxString findString;
         wxArrayString filters;
-        findString = data->GetFindString();
-        if(data->IsEnablePipeSupport()) {
-            if(data->GetFindString().Find('|') != wxNOT_FOUND) {
-                findString = data->GetFindString().BeforeFirst('|');
-
-                wxString filtersString = data->GetFindString().AfterFirst('|');
-                filters = ::wxStringTokenize(filtersString, "|", wxTOKEN_STRTOK);
-                if(!data->IsMatchCase()) {
-                    for(size_t i = 0; i < filters.size(); ++i) {
-                        filters.Item(i).MakeLower();
-                    }
-                }
-            }
-        }
-
-        if(!data->IsMatchCase()) { findString.MakeLower(); }
+        PrepareFindString(data, findString, filters);
 
         while(tkz.HasMoreTokens()) {
 
             // Read the next line
             wxString line = tkz.NextToken();
-            DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters, states);
+            DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters, states, results);
             lineOffset += line.Length() + 1;
             lineNumber++;
         }
     }
+    return true;
+}
 
-    if(m_results.empty() == false) { SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner()); }
+void SearchThread::PrepareFindString(const SearchData* data, wxString& findString, wxArrayString& filters)
+{
+    findString = data->GetFindString();
+    filters.clear();
+    if(data->IsEnablePipeSupport()) {
+        if(data->GetFindString().Find('|') != wxNOT_FOUND) {
+            findString = data->GetFindString().BeforeFirst('|');
+
+            wxString filtersString = data->GetFindString().AfterFirst('|');
+            filters = ::wxStringTokenize(filtersString, "|", wxTOKEN_STRTOK);
+            if(!data->IsMatchCase()) {
+                for(size_t i = 0; i < filters.size(); ++i) {
+                    filters.Item(i).MakeLower();
+                }
+            }
+        }
+    }
+
+    if(!data->IsMatchCase()) { findString.MakeLower(); }
+}
+
+void SearchThread::PrepareByteSearch(const SearchData* data)
+{
+    m_byteSearch = false;
+    m_regexSearch = false;
+    m_byteNeedle.clear();
+
+    // The byte level search works on UTF-8 files only
+#if wxUSE_GUI
+    if(wxFontMapper::GetEncodingFromName(data->GetEncoding()) != wxFONTENCODING_UTF8) { return; }
+#else
+    return;
+#endif
+
+    if(data->IsRegularExpression()) {
+        // A pattern that matches the empty string matches every line, there is nothing to gain from scanning the buffer
+        clRegexDFA dfa;
+        m_regexSearch =
+            dfa.Compile(data->GetFindString(), GetRegexFlags(data->IsMatchCase())) && !dfa.MatchesEmpty();
+        return;
+    }
+
+    wxString findString;
+    wxArrayString filters;
+    PrepareFindString(data, findString, filters);
+    if(findString.IsEmpty()) { return; }
+
+    m_byteNeedle = findString.ToStdString(wxConvUTF8);
+    if(m_byteNeedle.empty()) { return; }
+
+    if(!data->IsMatchCase()) {
+        // we only know how to fold ASCII characters
+        for(size_t i = 0; i < m_byteNeedle.length(); ++i) {
+            if((unsigned char)m_byteNeedle[i] >= 0x80) { return; }
+        }
+    }
+    m_byteSearch = true;
+}
+
+namespace
+{
+inline char AsciiToLower(char ch) { return (ch >= 'A' && ch <= 'Z') ? (ch + ('a' - 'A')) : ch; }
+
+inline const char* FindByte(const char* p, const char* last, char ch)
+{
+    if(p > last) { return nullptr; }
+    return static_cast<const char*>(memchr(p, ch, last - p + 1));
+}
+
+/**
+ * @brief locate 'needle' in the range [begin, end). When matchCase is false, the needle must be in lower case and ASCII
+ * only. The candidates are found with memchr() which the C runtime implements with SIMD instructions, so we only fall
+ * to a byte by byte comparison when the first character of the needle is found
+ */
+const char* FindBytes(const char* begin, const char* end, const std::string& needle, bool matchCase)
+{
+    size_t len = needle.length();
+    if((size_t)(end - begin) < len) { return nullptr; }
+
+    // the last position where the needle can start
+    const char* last = end - len;
+    const char* rest = needle.c_str() + 1;
+    if(matchCase) {
+        const char* p = begin;
+        while((p = FindByte(p, last, needle[0]))) {
+            if(memcmp(p + 1, rest, len - 1) == 0) { return p; }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    char lower = needle[0];
+    char upper = (lower >= 'a' && lower <= 'z') ? (lower - ('a' - 'A')) : lower;
+    const char* nextLower = FindByte(begin, last, lower);
+    const char* nextUpper = (upper == lower) ? nullptr : FindByte(begin, last, upper);
+    while(nextLower || nextUpper) {
+        const char* p = (nextLower && (!nextUpper || nextLower < nextUpper)) ? nextLower : nextUpper;
+        size_t i = 0;
+        for(; i < len - 1; ++i) {
+            if(AsciiToLower(p[i + 1]) != rest[i]) { break; }
+        }
+        if(i == len - 1) { return p; }
+        if(p == nextLower) { nextLower = FindByte(p + 1, last, lower); }
+        if(p == nextUpper) { nextUpper = FindByte(p + 1, last, upper); }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief count the number of wxChars the UTF-8 sequence [begin, end) occupies once converted into wxString
+ */
+int CountChars(const char* begin, const char* end)
+{
+    int count = 0;
+    for(const unsigned char* p = (const unsigned char*)begin; p < (const unsigned char*)end; ++p) {
+        // skip continuation bytes
+        if((*p & 0xC0) != 0x80) { ++count; }
+        // code points above the BMP are stored as surrogate pairs in UTF-16 strings
+        if(sizeof(wxChar) == 2 && *p >= 0xF0) { ++count; }
+    }
+    return count;
+}
+
+/**
+ * @brief locate the boundaries of the line that contains 'pos'. 'lineStart' is never placed before 'begin'
+ */
+void LocateLine(const char* begin, const char* end, const char* pos, const char*& lineStart, const char*& lineEnd)
+{
+    lineStart = pos;
+    while(lineStart > begin && lineStart[-1] != '\n') {
+        --lineStart;
+    }
+    lineEnd = static_cast<const char*>(memchr(pos, '\n', end - pos));
+    if(!lineEnd) { lineEnd = end; }
+}
+
+int CountLines(const char* begin, const char* end)
+{
+    int count = 0;
+    const char* p = begin;
+    while(p < end && (p = static_cast<const char*>(memchr(p, '\n', end - p)))) {
+        ++count;
+        ++p;
+    }
+    return count;
+}
+} // namespace
+
+bool SearchThread::DoSearchFileBytes(const wxString& fileName, const SearchData* data, bool& readOk,
+                                     SearchResultList& results)
+{
+    // map the file instead of reading it, most of the files do not contain a match and will only be scanned once
+    clMappedFile file;
+    if(!file.Open(fileName)) {
+        readOk = false;
+        return true;
+    }
+
+    const char* begin = file.begin();
+    const char* end = file.end();
+    const char* cur = begin;
+
+    // line number and character offset of 'countedUpTo'
+    const char* countedUpTo = begin;
+    int lineNumber = 1;
+    int lineOffset = 0;
+
+    wxString findString;
+    wxArrayString filters;
+    SearchResultList fileResults;
+    const char* match = nullptr;
+    while(cur < end && (match = FindBytes(cur, end, m_byteNeedle, data->IsMatchCase()))) {
+        // we got a match, locate the line boundaries
+        const char* lineStart = nullptr;
+        const char* lineEnd = nullptr;
+        LocateLine(cur, end, match, lineStart, lineEnd);
+
+        lineNumber += CountLines(countedUpTo, lineStart);
+        lineOffset += CountChars(countedUpTo, lineStart);
+        countedUpTo = lineStart;
+
+        wxString line = wxString::FromUTF8(lineStart, lineEnd - lineStart);
+        if(line.IsEmpty()) {
+            // not a valid UTF-8 content
+            return false;
+        }
+
+        if(findString.IsEmpty()) { PrepareFindString(data, findString, filters); }
+        DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters, nullptr, fileResults);
+        cur = lineEnd + 1;
+    }
+    results.splice(results.end(), fileResults);
+    return true;
+}
+
+bool SearchThread::DoSearchFileRegex(const wxString& fileName, const SearchData* data, clRegexDFA& dfa, wxRegEx& re,
+                                     bool& readOk, SearchResultList& results)
+{
+    clMappedFile file;
+    if(!file.Open(fileName)) {
+        readOk = false;
+        return true;
+    }
+
+    const char* end = file.end();
+    const char* cur = file.begin();
+
+    // line number and character offset of 'countedUpTo'
+    const char* countedUpTo = cur;
+    int lineNumber = 1;
+    int lineOffset = 0;
+
+    SearchResultList fileResults;
+    const char* matchEnd = nullptr;
+    while(cur < end && (matchEnd = dfa.Find(cur, end))) {
+        // the DFA only tells us that the line contains a match, let wxRegEx find the exact matches within it.
+        // The match is never empty, so its last byte is part of the line
+        const char* lineStart = nullptr;
+        const char* lineEnd = nullptr;
+        LocateLine(cur, end, matchEnd - 1, lineStart, lineEnd);
+
+        lineNumber += CountLines(countedUpTo, lineStart);
+        lineOffset += CountChars(countedUpTo, lineStart);
+        countedUpTo = lineStart;
+
+        wxString line = wxString::FromUTF8(lineStart, lineEnd - lineStart);
+        if(line.IsEmpty()) {
+            // not a valid UTF-8 content
+            return false;
+        }
+
+        DoSearchLineRE(line, lineNumber, lineOffset, fileName, data, nullptr, re, fileResults);
+        cur = lineEnd + 1;
+    }
+    results.splice(results.end(), fileResults);
+    return true;
 }
 
 void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset,
-                                  const wxString& fileName, const SearchData* data, TextStatesPtr statesPtr)
+                                  const wxString& fileName, const SearchData* data, TextStatesPtr statesPtr,
+                                  wxRegEx& re, SearchResultList& results)
 {
-    wxRegEx& re = GetRegex(data->GetFindString(), data->IsMatchCase());
     size_t col = 0;
     int iCorrectedCol = 0;
     int iCorrectedLen = 0;
@@ -395,10 +784,7 @@ void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const
                 }
             }
 
-            if(canAdd) {
-                m_results.push_back(result);
-                m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
-            }
+            if(canAdd) { results.push_back(result); }
 
             col += len;
 
@@ -411,7 +797,7 @@ void SearchThread::DoSearchLineRE(const wxString& line, const int lineNum, const
 
 void SearchThread::DoSearchLine(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
                                 const SearchData* data, const wxString& findWhat, const wxArrayString& filters,
-                                TextStatesPtr statesPtr)
+                                TextStatesPtr statesPtr, SearchResultList& results)
 {
     wxString modLine = line;
 
@@ -522,10 +908,7 @@ void SearchThread::DoSearchLine(const wxString& line, const int lineNum, const i
                 }
             }
 
-            if(canAdd) {
-                m_results.push_back(result);
-                m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
-            }
+            if(canAdd) { results.push_back(result); }
 
             if(!AdjustLine(modLine, pos, findWhat)) { break; }
             col += (int)findWhat.Length();
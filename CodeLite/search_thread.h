@@ -35,11 +35,13 @@
 #include <deque>
 #include <list>
 #include <map>
+#include <vector>
 #include <wx/regex.h>
 #include <wx/string.h>
 #include "JSON.h"
 
 class wxEvtHandler;
+class clRegexDFA;
 class SearchResult;
 class SearchThread;
 
@@ -333,6 +335,10 @@ class WXDLLIMPEXP_CL SearchThread : public WorkerThread
     bool m_matchCase;
     wxCriticalSection m_cs;
     int m_counter = 0;
+    size_t m_maxWorkers = 0;
+    bool m_byteSearch = false;
+    bool m_regexSearch = false;
+    std::string m_byteNeedle;
 
 public:
     /**
@@ -371,6 +377,13 @@ public:
      */
     void SetWordChars(const wxString& chars);
 
+    /**
+     * @brief set the maximum number of worker threads used to scan files in parallel.
+     * Passing 0 (the default) means: use the number of CPUs available. Passing 1 disables the parallel search
+     */
+    void SetMaxWorkers(size_t maxWorkers) { m_maxWorkers = maxWorkers; }
+    size_t GetMaxWorkers() const { return m_maxWorkers; }
+
 private:
     /**
      * Return files to search
@@ -393,17 +406,65 @@ private:
      */
     void DoSearchFiles(ThreadRequest* data);
 
-    // Perform search on a single file
-    void DoSearchFile(const wxString& fileName, const SearchData* data);
+    /**
+     * @brief scan the files one by one from the context of the search thread
+     */
+    void DoSearchFilesSerial(const wxArrayString& fileList, const SearchData* data);
+
+    /**
+     * @brief split the files between a pool of workers. The matches are merged back in the same order as 'fileList'
+     */
+    void DoSearchFilesParallel(const wxArrayString& fileList, const SearchData* data, size_t workers);
+
+    /**
+     * @brief merge the results of a single file into the pending results and update the summary
+     * @return false if the search was cancelled by the user
+     */
+    bool DoMergeFileResults(size_t fileIndex, const wxString& fileName, bool readOk, SearchResultList& fileResults,
+                            const SearchData* data);
+
+    // Perform search on a single file. Return false if the file could not be read
+    bool DoSearchFile(const wxString& fileName, const SearchData* data, wxMBConv& conv, wxRegEx& re, clRegexDFA& dfa,
+                      SearchResultList& results);
+
+    /**
+     * @brief search the raw UTF-8 bytes of the file. Only lines that contains a match are converted into wxString
+     * and passed to DoSearchLine()
+     * @param readOk [output] set to false if the file could not be read
+     * @return false if the file can not be handled at the byte level (e.g. it is not a valid UTF-8 file). In this case
+     * the caller should fallback to the line by line search
+     */
+    bool DoSearchFileBytes(const wxString& fileName, const SearchData* data, bool& readOk, SearchResultList& results);
+
+    /**
+     * @brief scan the raw UTF-8 bytes of the file with 'dfa' in a single pass. Only the lines that contain a match
+     * are converted into wxString and passed to DoSearchLineRE()
+     * @param readOk [output] set to false if the file could not be read
+     * @return false if the file can not be handled at the byte level. In this case the caller should fallback to the
+     * line by line search
+     */
+    bool DoSearchFileRegex(const wxString& fileName, const SearchData* data, clRegexDFA& dfa, wxRegEx& re,
+                           bool& readOk, SearchResultList& results);
+
+    /**
+     * @brief prepare the byte level search for the current request. Sets m_byteSearch (plain text) or m_regexSearch
+     * (regular expression) to true if the request can use the byte level search
+     */
+    void PrepareByteSearch(const SearchData* data);
+
+    /**
+     * @brief split the find-what string into the string to search and the pipe filters
+     */
+    static void PrepareFindString(const SearchData* data, wxString& findString, wxArrayString& filters);
 
     // Perform search on a line
     void DoSearchLine(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
                       const SearchData* data, const wxString& findWhat, const wxArrayString& filters,
-                      TextStatesPtr statesPtr);
+                      TextStatesPtr statesPtr, SearchResultList& results);
 
     // Perform search on a line using regular expression
     void DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
-                        const SearchData* data, TextStatesPtr statesPtr);
+                        const SearchData* data, TextStatesPtr statesPtr, wxRegEx& re, SearchResultList& results);
 
     // Send an event to the notified window
     void SendEvent(wxEventType type, wxEvtHandler* owner);
@@ -411,6 +472,12 @@ private:
     // return a compiled regex object for the expression
     wxRegEx& GetRegex(const wxString& expr, bool matchCase);
 
+    // return the wxRegEx compile flags used for the find-in-files regular expressions
+    static int GetRegexFlags(bool matchCase);
+
+    // compile 'expr' into 're' using the same flags as GetRegex()
+    static void CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase);
+
     // Internal function
     bool AdjustLine(wxString& line, int& pos, const wxString& findString);
 
@@ -84,6 +84,7 @@ TagsOptionsData::TagsOptionsData()
     , m_clangBinary(wxT(""))
     , m_clangCachePolicy(TagsOptionsData::CLANG_CACHE_ON_FILE_LOAD)
     , m_ccNumberOfDisplayItems(500)
+    , m_indexerWorkers(0)
     , m_version(0)
 {
     // Initialize defaults
@@ -391,6 +392,7 @@ void TagsOptionsData::FromJSON(const JSONItem& json)
     m_clangMacros = json.namedObject(wxT("m_clangMacros")).toString();
     m_clangCachePolicy = json.namedObject(wxT("m_clangCachePolicy")).toString();
     m_ccNumberOfDisplayItems = json.namedObject(wxT("m_ccNumberOfDisplayItems")).toSize_t(m_ccNumberOfDisplayItems);
+    m_indexerWorkers = json.namedObject(wxT("m_indexerWorkers")).toSize_t(m_indexerWorkers);
 
     if(!m_fileSpec.Contains("*.hxx")) {
         m_fileSpec = "*.cpp;*.cc;*.cxx;*.h;*.hpp;*.c;*.c++;*.tcc;*.hxx;*.h++";
@@ -424,6 +426,7 @@ JSONItem TagsOptionsData::ToJSON() const
     json.addProperty("m_clangMacros", m_clangMacros);
     json.addProperty("m_clangCachePolicy", m_clangCachePolicy);
     json.addProperty("m_ccNumberOfDisplayItems", m_ccNumberOfDisplayItems);
+    json.addProperty("m_indexerWorkers", m_indexerWorkers);
     return json;
 }
 
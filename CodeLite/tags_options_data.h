@@ -105,6 +105,7 @@ protected:
     wxString m_clangMacros;
     wxString m_clangCachePolicy;
     size_t m_ccNumberOfDisplayItems;
+    size_t m_indexerWorkers;
     size_t m_version;
 
 public:
@@ -135,6 +136,11 @@ public:
         this->m_ccNumberOfDisplayItems = ccNumberOfDisplayItems;
     }
     size_t GetCcNumberOfDisplayItems() const { return m_ccNumberOfDisplayItems; }
+    /**
+     * @brief the number of ctags workers the indexer runs. 0 means: use the number of CPUs
+     */
+    void SetIndexerWorkers(size_t indexerWorkers) { this->m_indexerWorkers = indexerWorkers; }
+    size_t GetIndexerWorkers() const { return m_indexerWorkers; }
     void SetClangCachePolicy(const wxString& clangCachePolicy) { this->m_clangCachePolicy = clangCachePolicy; }
     const wxString& GetClangCachePolicy() const { return m_clangCachePolicy; }
     void SetClangMacros(const wxString& clangMacros) { this->m_clangMacros = clangMacros; }
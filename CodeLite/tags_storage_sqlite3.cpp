@@ -28,13 +28,54 @@
 #include "tags_storage_sqlite3.h"
 #include <algorithm>
 #include <wx/longlong.h>
+#include <wx/thread.h>
 #include <wx/tokenzr.h>
+#include <wx/utils.h>
+
+namespace
+{
+// Indexes that are only needed for lookups. They are dropped while bulk loading and rebuilt afterwards (the unique
+// indexes are kept, "INSERT OR REPLACE" depends on them)
+struct SecondaryIndex {
+    const wxChar* name;
+    const wxChar* sql;
+};
+
+const SecondaryIndex s_secondaryIndexes[] = {
+    { wxT("KIND_IDX"), wxT("CREATE INDEX IF NOT EXISTS KIND_IDX on tags(kind);") },
+    { wxT("FILE_IDX"), wxT("CREATE INDEX IF NOT EXISTS FILE_IDX on tags(file);") },
+    { wxT("global_tags_idx_1"), wxT("CREATE INDEX IF NOT EXISTS global_tags_idx_1 on global_tags(name);") },
+    { wxT("global_tags_idx_2"), wxT("CREATE INDEX IF NOT EXISTS global_tags_idx_2 on global_tags(tag_id);") },
+    { wxT("TAGS_NAME"), wxT("CREATE INDEX IF NOT EXISTS TAGS_NAME on tags(name);") },
+    { wxT("TAGS_SCOPE"), wxT("CREATE INDEX IF NOT EXISTS TAGS_SCOPE on tags(scope);") },
+    { wxT("TAGS_PATH"), wxT("CREATE INDEX IF NOT EXISTS TAGS_PATH on tags(path);") },
+    { wxT("TAGS_PARENT"), wxT("CREATE INDEX IF NOT EXISTS TAGS_PARENT on tags(parent);") },
+    { wxT("TAGS_TYPEREF"), wxT("CREATE INDEX IF NOT EXISTS TAGS_TYPEREF on tags(typeref);") },
+};
+
+/**
+ * @brief return 'text' as an FTS5 string, quoted for an SQL literal. With the trigram tokenizer, the string matches
+ * any value that contains it (case insensitive, like the LIKE operator)
+ */
+wxString FullTextString(const wxString& text)
+{
+    wxString str(text);
+    str.Replace(wxT("\""), wxT("\"\""));
+    str.Replace(wxT("'"), wxT("''"));
+    return wxString() << wxT("\"") << str << wxT("\"");
+}
+
+// the trigram index can only serve strings of at least 3 characters
+const size_t FULL_TEXT_MIN_LENGTH = 3;
+} // namespace
 
 //-------------------------------------------------
 // Tags database class implementation
 //-------------------------------------------------
 TagsStorageSQLite::TagsStorageSQLite()
     : ITagsStorage()
+    , m_bulkLoad(false)
+    , m_hasFullTextIndex(false)
 {
     m_db = new clSqliteDB();
     SetUseCache(true);
@@ -43,6 +84,14 @@ TagsStorageSQLite::TagsStorageSQLite()
 TagsStorageSQLite::~TagsStorageSQLite()
 {
     if(m_db) {
+        if(m_bulkLoad) {
+            // An aborted bulk load: let the next connection restore the indexes
+            try {
+                m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS bulk_load;"));
+            } catch(wxSQLite3Exception& e) {
+                wxUnusedVar(e);
+            }
+        }
         m_db->Close();
         delete m_db;
         m_db = NULL;
@@ -100,6 +149,11 @@ void TagsStorageSQLite::CreateSchema()
         sql = wxT("PRAGMA temp_store = MEMORY;");
         m_db->ExecuteUpdate(sql);
 
+        // Rows deleted by "INSERT OR REPLACE" should fire the delete triggers too, or the tables maintained by the
+        // triggers (global_tags, tags_fts) keep entries of tags that no longer exist
+        sql = wxT("PRAGMA recursive_triggers = ON;");
+        m_db->ExecuteUpdate(sql);
+
         sql = wxT("create  table if not exists tags (ID INTEGER PRIMARY KEY AUTOINCREMENT, name string, file string, "
                   "line integer, kind string, access string, signature string, pattern string, parent string, inherits "
                   "string, path string, typeref string, scope string, return_value string);");
@@ -142,55 +196,172 @@ void TagsStorageSQLite::CreateSchema()
         sql = wxT("CREATE UNIQUE INDEX IF NOT EXISTS TAGS_UNIQ on tags(kind, path, signature, typeref);");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS KIND_IDX on tags(kind);");
-        m_db->ExecuteUpdate(sql);
-
-        sql = wxT("CREATE INDEX IF NOT EXISTS FILE_IDX on tags(file);");
-        m_db->ExecuteUpdate(sql);
-
         sql = wxT("CREATE UNIQUE INDEX IF NOT EXISTS MACROS_UNIQ on MACROS(name);");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS global_tags_idx_1 on global_tags(name);");
-        m_db->ExecuteUpdate(sql);
+        // Create search indexes. This also restores the indexes of a bulk load that did not complete, but leaves
+        // alone the indexes dropped by a bulk load that is still running
+        if(!IsBulkLoadInProgress()) {
+            DoCreateSecondaryIndexes();
+            m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS bulk_load;"));
+        }
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS global_tags_idx_2 on global_tags(tag_id);");
+        sql = wxT("CREATE INDEX IF NOT EXISTS MACROS_NAME on MACROS(name);");
         m_db->ExecuteUpdate(sql);
 
-        // Create search indexes
-        sql = wxT("CREATE INDEX IF NOT EXISTS TAGS_NAME on tags(name);");
+        sql = wxT("CREATE INDEX IF NOT EXISTS SIMPLE_MACROS_FILE on SIMPLE_MACROS(file);");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS TAGS_SCOPE on tags(scope);");
+        sql = wxT("create table if not exists tags_version (version string primary key);");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS TAGS_PATH on tags(path);");
+        sql = wxT("create unique index if not exists tags_version_uniq on tags_version(version);");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS TAGS_PARENT on tags(parent);");
+        sql = wxString(wxT("replace into tags_version values ('")) << GetVersion() << wxT("');");
         m_db->ExecuteUpdate(sql);
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS TAGS_TYPEREF on tags(typeref);");
-        m_db->ExecuteUpdate(sql);
+    } catch(wxSQLite3Exception& e) {
+        wxUnusedVar(e);
+    }
+    DoCreateFullTextIndex();
+}
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS MACROS_NAME on MACROS(name);");
-        m_db->ExecuteUpdate(sql);
+void TagsStorageSQLite::DoCreateFullTextIndex()
+{
+    // Substring lookups (Open Type, Goto Anything, #include completion) are served by FTS5 tables using the trigram
+    // tokenizer (SQLite 3.34 and later). When the SQLite library does not provide them, or while the tables are not
+    // built, these lookups fall back to a LIKE scan of the table
+    m_hasFullTextIndex = false;
+    try {
+        m_db->ExecuteUpdate(wxT("CREATE VIRTUAL TABLE temp.fts_probe USING fts5(name, tokenize='trigram');"));
+        m_db->ExecuteUpdate(wxT("DROP TABLE temp.fts_probe;"));
 
-        sql = wxT("CREATE INDEX IF NOT EXISTS SIMPLE_MACROS_FILE on SIMPLE_MACROS(file);");
-        m_db->ExecuteUpdate(sql);
+    } catch(wxSQLite3Exception& e) {
+        clDEBUG() << "Tags full text index is not available:" << e.GetMessage() << clEndl;
+        try {
+            // Don't keep triggers (created by a library that does support FTS5) that we can not execute
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS tags_fts_insert;"));
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS tags_fts_delete;"));
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS files_fts_insert;"));
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS files_fts_delete;"));
+        } catch(wxSQLite3Exception& e1) {
+            wxUnusedVar(e1);
+        }
+        return;
+    }
+    m_hasFullTextIndex = true;
 
-        sql = wxT("create table if not exists tags_version (version string primary key);");
-        m_db->ExecuteUpdate(sql);
+    // Filling the index of an existing database can take a while: it is left to the parser thread, the connections
+    // of the main thread use the index once it is there. A running bulk load builds it when it completes
+    if(wxThread::IsMain() || IsBulkLoadInProgress()) { return; }
 
-        sql = wxT("create unique index if not exists tags_version_uniq on tags_version(version);");
-        m_db->ExecuteUpdate(sql);
+    try {
+        // In one transaction, so other connections see either no index or a complete one
+        m_db->Begin();
+        bool tagsIndexExists = m_db->TableExists(wxT("tags_fts"));
+        bool filesIndexExists = m_db->TableExists(wxT("files_fts"));
+        m_db->ExecuteUpdate(wxT("CREATE VIRTUAL TABLE IF NOT EXISTS tags_fts USING fts5(name, path, tokenize='trigram');"));
+        m_db->ExecuteUpdate(wxT("CREATE VIRTUAL TABLE IF NOT EXISTS files_fts USING fts5(file, tokenize='trigram');"));
+
+        // Index the content of a database that was created before the full text index was added
+        if(!tagsIndexExists) {
+            m_db->ExecuteUpdate(wxT("INSERT INTO tags_fts(rowid, name, path) SELECT ID, name, path FROM tags;"));
+        }
+        if(!filesIndexExists) {
+            m_db->ExecuteUpdate(wxT("INSERT INTO files_fts(rowid, file) SELECT ID, file FROM files;"));
+        }
+        DoCreateFullTextTriggers();
+        m_db->Commit();
 
-        sql = wxString(wxT("replace into tags_version values ('")) << GetVersion() << wxT("');");
-        m_db->ExecuteUpdate(sql);
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to create the tags full text index:" << e.GetMessage() << clEndl;
+        try {
+            m_db->Rollback();
+        } catch(wxSQLite3Exception& e1) {
+            wxUnusedVar(e1);
+        }
+    }
+}
 
+void TagsStorageSQLite::DoCreateFullTextTriggers()
+{
+    m_db->ExecuteUpdate(wxT("CREATE TRIGGER IF NOT EXISTS tags_fts_insert AFTER INSERT ON tags FOR EACH ROW BEGIN ")
+                            wxT("INSERT INTO tags_fts(rowid, name, path) VALUES (NEW.ID, NEW.name, NEW.path); END;"));
+    m_db->ExecuteUpdate(wxT("CREATE TRIGGER IF NOT EXISTS tags_fts_delete AFTER DELETE ON tags FOR EACH ROW BEGIN ")
+                            wxT("DELETE FROM tags_fts WHERE rowid = OLD.ID; END;"));
+    m_db->ExecuteUpdate(wxT("CREATE TRIGGER IF NOT EXISTS files_fts_insert AFTER INSERT ON files FOR EACH ROW BEGIN ")
+                            wxT("INSERT INTO files_fts(rowid, file) VALUES (NEW.ID, NEW.file); END;"));
+    m_db->ExecuteUpdate(wxT("CREATE TRIGGER IF NOT EXISTS files_fts_delete AFTER DELETE ON files FOR EACH ROW BEGIN ")
+                            wxT("DELETE FROM files_fts WHERE rowid = OLD.ID; END;"));
+}
+
+bool TagsStorageSQLite::IsBulkLoadInProgress()
+{
+    try {
+        if(!m_db->TableExists(wxT("bulk_load"))) { return false; }
+        // The marker of a process that went down in the middle of a bulk load is stale
+        wxSQLite3ResultSet res = m_db->ExecuteQuery(wxT("SELECT pid FROM bulk_load;"));
+        while(res.NextRow()) {
+            if((unsigned long)res.GetInt64(0).GetValue() == ::wxGetProcessId()) { return true; }
+        }
     } catch(wxSQLite3Exception& e) {
         wxUnusedVar(e);
     }
+    return false;
+}
+
+void TagsStorageSQLite::DoCreateSecondaryIndexes()
+{
+    for(size_t i = 0; i < sizeof(s_secondaryIndexes) / sizeof(s_secondaryIndexes[0]); ++i) {
+        m_db->ExecuteUpdate(s_secondaryIndexes[i].sql);
+    }
+}
+
+void TagsStorageSQLite::BeginBulkLoad()
+{
+    if(m_bulkLoad) { return; }
+    try {
+        // keep the pages of the unique indexes in memory (64MB)
+        m_db->ExecuteUpdate(wxT("PRAGMA cache_size = -65536;"));
+
+        // Tell the other connections (opened meanwhile by this process) not to restore what we drop below
+        m_db->ExecuteUpdate(wxT("CREATE TABLE IF NOT EXISTS bulk_load (pid integer);"));
+        m_db->ExecuteUpdate(wxT("DELETE FROM bulk_load;"));
+        m_db->ExecuteUpdate(wxString() << wxT("INSERT INTO bulk_load VALUES (") << ::wxGetProcessId() << wxT(");"));
+
+        for(size_t i = 0; i < sizeof(s_secondaryIndexes) / sizeof(s_secondaryIndexes[0]); ++i) {
+            m_db->ExecuteUpdate(wxString() << wxT("DROP INDEX IF EXISTS ") << s_secondaryIndexes[i].name);
+        }
+
+        // Building the full text index in one go is much faster than updating it for every inserted tag. The index
+        // is rebuilt by EndBulkLoad() (or by CreateSchema() if the bulk load is aborted). Meanwhile, the other
+        // connections look the tags up with LIKE
+        if(m_hasFullTextIndex) {
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS tags_fts_insert;"));
+            m_db->ExecuteUpdate(wxT("DROP TRIGGER IF EXISTS tags_fts_delete;"));
+            m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS tags_fts;"));
+        }
+        m_bulkLoad = true;
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to prepare the database for bulk load:" << e.GetMessage() << clEndl;
+    }
+    ClearCache();
+}
+
+void TagsStorageSQLite::EndBulkLoad()
+{
+    if(!m_bulkLoad) { return; }
+    m_bulkLoad = false;
+    try {
+        m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS bulk_load;"));
+        DoCreateSecondaryIndexes();
+        if(m_hasFullTextIndex) { DoCreateFullTextIndex(); }
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "Failed to rebuild the database indexes:" << e.GetMessage() << clEndl;
+    }
+    ClearCache();
 }
 
 void TagsStorageSQLite::RecreateDatabase()
@@ -234,6 +405,14 @@ void TagsStorageSQLite::RecreateDatabase()
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS GLOBAL_TAGS_IDX_1"));
             m_db->ExecuteUpdate(wxT("DROP INDEX IF EXISTS GLOBAL_TAGS_IDX_2"));
 
+            try {
+                m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS tags_fts"));
+                m_db->ExecuteUpdate(wxT("DROP TABLE IF EXISTS files_fts"));
+            } catch(wxSQLite3Exception& e) {
+                // the SQLite library does not support FTS5
+                wxUnusedVar(e);
+            }
+
             // Recreate the schema
             CreateSchema();
         } else {
@@ -278,6 +457,7 @@ void TagsStorageSQLite::Store(TagTreePtr tree, const wxFileName& path, bool auto
     OpenDatabase(path);
     TreeWalker<wxString, TagEntry> walker(tree->GetRoot());
 
+    bool stored = false;
     try {
         // Create the statements before the execution
         std::vector<TagEntry> updateList;
@@ -290,6 +470,7 @@ void TagsStorageSQLite::Store(TagTreePtr tree, const wxFileName& path, bool auto
             if(walker.GetNode() == tree->GetRoot()) continue;
 
             DoInsertTagEntry(walker.GetNode()->GetData());
+            stored = true;
         }
 
         if(autoCommit) m_db->Commit();
@@ -301,6 +482,9 @@ void TagsStorageSQLite::Store(TagTreePtr tree, const wxFileName& path, bool auto
             wxUnusedVar(e);
         }
     }
+
+    // New tags can match any cached query. A bulk load clears the whole cache once, when it starts and when it ends
+    if(GetUseCache() && !m_bulkLoad && stored) { m_cache.Clear(); }
 }
 
 void TagsStorageSQLite::SelectTagsByFile(const wxString& file, std::vector<TagEntryPtr>& tags, const wxFileName& path)
@@ -335,6 +519,8 @@ void TagsStorageSQLite::DeleteByFileName(const wxFileName& path, const wxString&
         m_db->ExecuteUpdate(sql);
 
         if(autoCommit) m_db->Commit();
+
+        if(GetUseCache()) { m_cache.Clear(); }
     } catch(wxSQLite3Exception& e) {
         wxUnusedVar(e);
         if(autoCommit) { m_db->Rollback(); }
@@ -375,23 +561,43 @@ void TagsStorageSQLite::GetFilesForCC(const wxString& userTyped, wxArrayString&
         // separator
         tmpName.Replace("\\", "/");
         tmpName.Replace("/", wxString() << wxFILE_SEP_PATH);
-        tmpName.Replace(wxT("_"), wxT("^_"));
-        query << wxT("select * from files where file like '%%") << tmpName << wxT("%%' ESCAPE '^' ")
-              << wxT("order by file");
+        wxString likeName(tmpName);
+        likeName.Replace(wxT("_"), wxT("^_"));
+        wxString likeQuery;
+        likeQuery << wxT("select * from files where file like '%%") << likeName << wxT("%%' ESCAPE '^' ")
+                  << wxT("order by file");
+        if(m_hasFullTextIndex && tmpName.length() >= FULL_TEXT_MIN_LENGTH && m_db->TableExists(wxT("files_fts"))) {
+            query << wxT("select files.* from files_fts join files on files.ID = files_fts.rowid ")
+                  << wxT("where files_fts match '") << FullTextString(tmpName) << wxT("' order by files.file");
+        } else {
+            query = likeQuery;
+        }
 
         wxString pattern = userTyped;
         pattern.Replace("\\", "/");
 
-        wxSQLite3ResultSet res = m_db->ExecuteQuery(query);
-        while(res.NextRow()) {
-            // Keep the part from where the user typed and until the end of the file name
-            wxString matchedFile = res.GetString(1);
-            matchedFile.Replace("\\", "/");
-
-            int where = matchedFile.Find(pattern);
-            if(where == wxNOT_FOUND) continue;
-            matchedFile = matchedFile.Mid(where);
-            matches.Add(matchedFile);
+        auto fetchFiles = [&](const wxString& sql) {
+            wxSQLite3ResultSet res = m_db->ExecuteQuery(sql);
+            while(res.NextRow()) {
+                // Keep the part from where the user typed and until the end of the file name
+                wxString matchedFile = res.GetString(1);
+                matchedFile.Replace("\\", "/");
+
+                int where = matchedFile.Find(pattern);
+                if(where == wxNOT_FOUND) continue;
+                matchedFile = matchedFile.Mid(where);
+                matches.Add(matchedFile);
+            }
+        };
+
+        size_t count = matches.size();
+        try {
+            fetchFiles(query);
+        } catch(wxSQLite3Exception& e) {
+            if(query == likeQuery) { throw; }
+            clDEBUG() << "Full text lookup failed, using LIKE instead:" << e.GetMessage() << clEndl;
+            matches.resize(count);
+            fetchFiles(likeQuery);
         }
 
     } catch(wxSQLite3Exception& e) {
@@ -602,6 +808,32 @@ void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr
     }
 }
 
+void TagsStorageSQLite::DoFetchTagsFullText(const wxString& fullTextSql, const wxString& sql,
+                                            std::vector<TagEntryPtr>& tags)
+{
+    // The full text index is built by the parser thread and dropped during a bulk load: use the LIKE query whenever
+    // the index is not there or can not be queried
+    if(!fullTextSql.IsEmpty()) {
+        if(GetUseCache() && m_cache.Get(fullTextSql, tags)) { return; }
+        try {
+            if(m_db->TableExists(wxT("tags_fts"))) {
+                std::vector<TagEntryPtr> matches;
+                wxSQLite3ResultSet rs = Query(fullTextSql);
+                while(rs.NextRow()) {
+                    matches.push_back(TagEntryPtr(FromSQLite3ResultSet(rs)));
+                }
+                rs.Finalize();
+                tags.insert(tags.end(), matches.begin(), matches.end());
+                if(GetUseCache()) { m_cache.Store(fullTextSql, tags); }
+                return;
+            }
+        } catch(wxSQLite3Exception& e) {
+            clDEBUG() << "Full text lookup failed, using LIKE instead:" << e.GetMessage() << clEndl;
+        }
+    }
+    DoFetchTags(sql, tags);
+}
+
 void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds)
 {
     if(GetUseCache()) {
@@ -855,11 +1087,8 @@ int TagsStorageSQLite::DoInsertTagEntry(const TagEntry& tag)
     // If this node is a dummy, (IsOk() == false) we dont insert it to database
     if(!tag.IsOk()) return TagOk;
 
-    // does not matter if we insert or update, the cache must be cleared for any related tags
-    if(GetUseCache()) { ClearCache(); }
-
     try {
-        wxSQLite3Statement statement = m_db->GetPrepareStatement(
+        wxSQLite3Statement& statement = m_db->GetCachedStatement(
             wxT("INSERT OR REPLACE INTO TAGS VALUES (NULL, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
         statement.Bind(1, tag.GetName());
         statement.Bind(2, tag.GetFile());
@@ -1069,6 +1298,19 @@ void TagsStorageSQLite::GetAllTagsNames(wxArrayString& names)
     }
 }
 
+void TagsStorageSQLite::GetAllTagsPaths(std::vector<wxString>& paths)
+{
+    try {
+        wxSQLite3ResultSet res = Query(wxT("SELECT distinct path FROM tags"));
+        while(res.NextRow()) {
+            paths.push_back(res.GetString(0));
+        }
+
+    } catch(wxSQLite3Exception& e) {
+        clWARNING() << "GetAllTagsPaths:" << e.GetMessage() << clEndl;
+    }
+}
+
 void TagsStorageSQLite::GetTagsNames(const wxArrayString& kind, wxArrayString& names)
 {
     if(kind.IsEmpty()) return;
@@ -1334,9 +1576,16 @@ void TagsStorageSQLite::GetSubscriptOperator(const wxString& scope, std::vector<
 //-----------------------------TagsStorageSQLiteCache -----------------
 //---------------------------------------------------------------------
 
-TagsStorageSQLiteCache::TagsStorageSQLiteCache() {}
+TagsStorageSQLiteCache::TagsStorageSQLiteCache()
+    : m_maxTags(200000)
+    , m_tagsCount(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+{
+}
 
-TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { m_cache.clear(); }
+TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { Clear(); }
 
 bool TagsStorageSQLiteCache::Get(const wxString& sql, std::vector<TagEntryPtr>& tags) { return DoGet(sql, tags); }
 
@@ -1355,8 +1604,11 @@ void TagsStorageSQLiteCache::Store(const wxString& sql, const std::vector<TagEnt
 
 void TagsStorageSQLiteCache::Clear()
 {
-    // CL_DEBUG1(wxT("[CACHE CLEARED]"));
-    m_cache.clear();
+    clDEBUG1() << "Tags cache cleared. Hits:" << m_hits << "Misses:" << m_misses << "Evictions:" << m_evictions
+               << "Tags:" << m_tagsCount << clEndl;
+    m_entries.clear();
+    m_index.clear();
+    m_tagsCount = 0;
 }
 
 void TagsStorageSQLiteCache::Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags)
@@ -1371,23 +1623,68 @@ void TagsStorageSQLiteCache::Store(const wxString& sql, const wxArrayString& kin
 
 bool TagsStorageSQLiteCache::DoGet(const wxString& key, std::vector<TagEntryPtr>& tags)
 {
-    std::unordered_map<wxString, std::vector<TagEntryPtr> >::iterator iter = m_cache.find(key);
-    if(iter != m_cache.end()) {
-        // Append the results to the output tags
-        tags.insert(tags.end(), iter->second.begin(), iter->second.end());
-        return true;
+    std::unordered_map<wxString, EntryList_t::iterator>::iterator iter = m_index.find(key);
+    if(iter == m_index.end()) {
+        ++m_misses;
+        return false;
     }
-    return false;
+
+    // Move the entry to the front of the list
+    m_entries.splice(m_entries.begin(), m_entries, iter->second);
+    ++m_hits;
+
+    // Append the results to the output tags
+    const std::vector<TagEntryPtr>& entryTags = iter->second->tags;
+    tags.insert(tags.end(), entryTags.begin(), entryTags.end());
+    return true;
 }
 
 void TagsStorageSQLiteCache::DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags)
 {
-    m_cache[key].reserve(tags.size());
-    m_cache[key] = tags;
+    std::unordered_map<wxString, EntryList_t::iterator>::iterator iter = m_index.find(key);
+    if(iter != m_index.end()) { DoErase(iter->second); }
+
+    // an entry that can not fit in the cache is not worth evicting everything else
+    if(tags.size() > m_maxTags) { return; }
+
+    m_entries.push_front(Entry());
+    Entry& entry = m_entries.front();
+    entry.key = key;
+    entry.tags = tags;
+    m_index.insert(std::make_pair(key, m_entries.begin()));
+    m_tagsCount += tags.size();
+
+    DoShrink();
+}
+
+void TagsStorageSQLiteCache::DoShrink()
+{
+    // Evict the least recently used entries (but never the newest). Each entry is counted as an extra tag so that the
+    // number of entries with no tags is bounded too
+    while(m_tagsCount + m_entries.size() > m_maxTags && m_entries.size() > 1) {
+        EntryList_t::iterator last = m_entries.end();
+        --last;
+        DoErase(last);
+        ++m_evictions;
+    }
+}
+
+void TagsStorageSQLiteCache::DoErase(EntryList_t::iterator iter)
+{
+    m_tagsCount -= iter->tags.size();
+    m_index.erase(iter->key);
+    m_entries.erase(iter);
+}
+
+void TagsStorageSQLiteCache::SetMaxTags(size_t maxTags)
+{
+    m_maxTags = maxTags;
+    DoShrink();
 }
 
 void TagsStorageSQLite::ClearCache() { m_cache.Clear(); }
 
+
 void TagsStorageSQLite::SetUseCache(bool useCache) { ITagsStorage::SetUseCache(useCache); }
 
 PPToken TagsStorageSQLite::GetMacro(const wxString& name)
@@ -1572,20 +1869,21 @@ TagEntryPtr TagsStorageSQLite::GetTagsByNameLimitOne(const wxString& name)
 
 void TagsStorageSQLite::GetTagsByPartName(const wxString& partname, std::vector<TagEntryPtr>& tags)
 {
-    try {
-        if(partname.IsEmpty()) return;
-
-        wxString tmpName(partname);
-        tmpName.Replace(wxT("_"), wxT("^_"));
-
-        wxString sql;
-        sql << wxT("select * from tags where name like '%%") << tmpName << wxT("%%' ESCAPE '^' ");
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+    if(partname.IsEmpty()) return;
 
-    } catch(wxSQLite3Exception& e) {
-        CL_DEBUG(wxT("%s"), e.GetMessage().c_str());
+    wxString fullTextSql;
+    if(m_hasFullTextIndex && partname.length() >= FULL_TEXT_MIN_LENGTH) {
+        fullTextSql << wxT("select tags.* from tags_fts join tags on tags.ID = tags_fts.rowid where tags_fts match ")
+                    << wxT("'name:") << FullTextString(partname) << wxT("' ");
+        DoAddLimitPartToQuery(fullTextSql, tags);
     }
+
+    wxString tmpName(partname);
+    tmpName.Replace(wxT("_"), wxT("^_"));
+    wxString sql;
+    sql << wxT("select * from tags where name like '%%") << tmpName << wxT("%%' ESCAPE '^' ");
+    DoAddLimitPartToQuery(sql, tags);
+    DoFetchTagsFullText(fullTextSql, sql, tags);
 }
 
 void TagsStorageSQLite::RemoveNonWorkspaceSymbols(const std::vector<wxString>& symbols,
@@ -1662,22 +1960,36 @@ const wxString& TagsStorageSQLite::GetVersion() const
 
 void TagsStorageSQLite::GetTagsByPartName(const wxArrayString& parts, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    try {
-        if(parts.IsEmpty()) { return; }
+    if(parts.IsEmpty()) { return; }
 
-        wxString filterQuery = "where ";
-        for(size_t i = 0; i < parts.size(); ++i) {
-            wxString tmpName = parts.Item(i);
-            tmpName.Replace(wxT("_"), wxT("^_"));
-            filterQuery << "path like '%%" << tmpName << "%%' " << ((i == (parts.size() - 1)) ? "" : "AND ");
-        }
+    // parts that are long enough are looked up in the full text index, the others are filtered with LIKE
+    wxString matchQuery;
+    wxString filterQuery;
+    wxString likeQuery;
+    for(size_t i = 0; i < parts.size(); ++i) {
+        wxString tmpName = parts.Item(i);
+        tmpName.Replace(wxT("_"), wxT("^_"));
+        wxString like;
+        like << "tags.path like '%%" << tmpName << "%%' ESCAPE '^'";
+        likeQuery << (likeQuery.IsEmpty() ? "" : " AND ") << like;
 
-        sql << "select * from tags " << filterQuery << " ESCAPE '^' ";
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        if(m_hasFullTextIndex && parts.Item(i).length() >= FULL_TEXT_MIN_LENGTH) {
+            matchQuery << (matchQuery.IsEmpty() ? "" : " AND ") << "path:" << FullTextString(parts.Item(i));
+        } else {
+            filterQuery << (filterQuery.IsEmpty() ? "" : " AND ") << like;
+        }
+    }
 
-    } catch(wxSQLite3Exception& e) {
-        clWARNING() << sql << ":" << e.GetMessage() << clEndl;
+    wxString fullTextSql;
+    if(!matchQuery.IsEmpty()) {
+        fullTextSql << "select tags.* from tags_fts join tags on tags.ID = tags_fts.rowid where tags_fts match '"
+                    << matchQuery << "'";
+        if(!filterQuery.IsEmpty()) { fullTextSql << " AND " << filterQuery; }
+        DoAddLimitPartToQuery(fullTextSql, tags);
     }
+
+    wxString sql;
+    sql << "select * from tags where " << likeQuery;
+    DoAddLimitPartToQuery(sql, tags);
+    DoFetchTagsFullText(fullTextSql, sql, tags);
 }
@@ -28,12 +28,14 @@
 #include "tag_tree.h"
 #include "entry.h"
 #include <wx/filename.h>
+#include <list>
 #include <unordered_map>
 #include "fileentry.h"
 #include "istorage.h"
 #include <wx/wxsqlite3.h>
 #include "codelite_exports.h"
 #include "wxStringHash.h"
+#include "macros.h"
 
 /**
  * TagsDatabase is a wrapper around wxSQLite3 database with tags specific functions.
@@ -90,13 +92,34 @@
  * @ingroup CodeLite
  */
 
-class TagsStorageSQLiteCache
+/**
+ * @class TagsStorageSQLiteCache
+ * @brief a least recently used cache of query results, keyed by the SQL text. The cache size is bounded by the total
+ * number of tags it holds. Any change to the tags can affect any query (e.g. a new tag matching a cached lookup), so the
+ * cache is cleared whenever tags are stored or deleted
+ */
+class WXDLLIMPEXP_CL TagsStorageSQLiteCache
 {
-    std::unordered_map<wxString, std::vector<TagEntryPtr> > m_cache;
+    struct Entry {
+        wxString key;
+        std::vector<TagEntryPtr> tags;
+    };
+    typedef std::list<Entry> EntryList_t;
+
+    // the most recently used entry is at the front
+    EntryList_t m_entries;
+    std::unordered_map<wxString, EntryList_t::iterator> m_index;
+    size_t m_maxTags;
+    size_t m_tagsCount;
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_evictions;
 
 protected:
     bool DoGet(const wxString& key, std::vector<TagEntryPtr>& tags);
     void DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags);
+    void DoErase(EntryList_t::iterator iter);
+    void DoShrink();
 
 public:
     TagsStorageSQLiteCache();
@@ -107,6 +130,20 @@ public:
     void Store(const wxString& sql, const std::vector<TagEntryPtr>& tags);
     void Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags);
     void Clear();
+
+    /**
+     * @brief set the maximum number of tags kept by the cache. The least recently used entries are evicted when the
+     * cache grows beyond this size
+     */
+    void SetMaxTags(size_t maxTags);
+    size_t GetMaxTags() const { return m_maxTags; }
+
+    // Statistics
+    size_t GetTagsCount() const { return m_tagsCount; }
+    size_t GetEntriesCount() const { return m_entries.size(); }
+    size_t GetHits() const { return m_hits; }
+    size_t GetMisses() const { return m_misses; }
+    size_t GetEvictions() const { return m_evictions; }
 };
 
 class WXDLLIMPEXP_CL clSqliteDB : public wxSQLite3Database
@@ -121,18 +158,37 @@ public:
 
     void Close()
     {
-        if(IsOpen()) wxSQLite3Database::Close();
-
+        // the cached statements must be finalized before the database is closed
         m_statements.clear();
+
+        if(IsOpen()) wxSQLite3Database::Close();
     }
 
     wxSQLite3Statement GetPrepareStatement(const wxString& sql) { return wxSQLite3Database::PrepareStatement(sql); }
+
+    /**
+     * @brief return a prepared statement which is kept until the database is closed. Use this for statements that
+     * are executed many times (e.g. inserting tags) so the SQL is compiled only once
+     */
+    wxSQLite3Statement& GetCachedStatement(const wxString& sql)
+    {
+        std::unordered_map<wxString, wxSQLite3Statement>::iterator iter = m_statements.find(sql);
+        if(iter == m_statements.end()) {
+            wxSQLite3Statement statement = wxSQLite3Database::PrepareStatement(sql);
+            iter = m_statements.insert(std::make_pair(sql, wxSQLite3Statement())).first;
+            // wxSQLite3Statement assignment transfers the ownership of the statement
+            iter->second = statement;
+        }
+        return iter->second;
+    }
 };
 
 class WXDLLIMPEXP_CL TagsStorageSQLite : public ITagsStorage
 {
     clSqliteDB* m_db;
     TagsStorageSQLiteCache m_cache;
+    bool m_bulkLoad;
+    bool m_hasFullTextIndex; // the SQLite library supports the full text index. The tables might not be built yet
 
 private:
     /**
@@ -149,9 +205,23 @@ private:
      */
     void DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds);
 
+    /**
+     * @brief fetch tags with a full text query. When 'fullTextSql' is empty, or when the full text index is missing
+     * or fails, 'sql' (the equivalent LIKE query) is used instead
+     */
+    void DoFetchTagsFullText(const wxString& fullTextSql, const wxString& sql, std::vector<TagEntryPtr>& tags);
+
     void DoAddNamePartToQuery(wxString& sql, const wxString& name, bool partial, bool prependAnd);
     void DoAddLimitPartToQuery(wxString& sql, const std::vector<TagEntryPtr>& tags);
     int DoInsertTagEntry(const TagEntry& tag);
+    void DoCreateSecondaryIndexes();
+    /**
+     * @brief is a bulk load running in this process (on any connection)? The connection that starts a bulk load
+     * leaves a marker in the database
+     */
+    bool IsBulkLoadInProgress();
+    void DoCreateFullTextIndex();
+    void DoCreateFullTextTriggers();
 
 public:
     static TagEntry* FromSQLite3ResultSet(wxSQLite3ResultSet& rs);
@@ -285,6 +355,17 @@ public:
      */
     void Rollback() { return m_db->Rollback(); }
 
+    /**
+     * @brief prepare the database for storing the tags of many files (e.g. a full retag): the secondary indexes are
+     * dropped until EndBulkLoad() is called. The other connections opened meanwhile don't restore them
+     */
+    void BeginBulkLoad();
+
+    /**
+     * @brief rebuild the indexes dropped by BeginBulkLoad()
+     */
+    void EndBulkLoad();
+
     /**
      * Test whether the database is opened
      * @return true if database is attached to a file
@@ -541,6 +622,11 @@ public:
      */
     virtual void ClearCache();
 
+    /**
+     * @brief return the query cache (for its statistics)
+     */
+    const TagsStorageSQLiteCache& GetCache() const { return m_cache; }
+
     /**
      * @brief
      * @param fileName
@@ -554,6 +640,8 @@ public:
 
     virtual void GetTagsNames(const wxArrayString& kind, wxArrayString& names);
 
+    virtual void GetAllTagsPaths(std::vector<wxString>& paths);
+
     /**
      * @brief
      * @param files
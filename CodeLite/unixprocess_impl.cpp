@@ -25,6 +25,7 @@
 
 #include "file_logger.h"
 #include "unixprocess_impl.h"
+#include "clProcessIOReactor.h"
 #include <cstring>
 #include "file_logger.h"
 #include "fileutils.h"
@@ -267,6 +268,8 @@ UnixProcessImpl::~UnixProcessImpl() { Cleanup(); }
 
 void UnixProcessImpl::Cleanup()
 {
+    // Stop reading before the descriptors are closed (and maybe reused)
+    clProcessIOReactor::Get().Unregister(this);
     close(GetReadHandle());
     close(GetWriteHandle());
     if(GetStderrHandle() != wxNOT_FOUND) { close(GetStderrHandle()); }
@@ -496,7 +499,12 @@ IProcess* UnixProcessImpl::Execute(wxEvtHandler* parent, const wxString& cmd, si
 
 void UnixProcessImpl::StartReaderThread()
 {
-    // Launch the 'Reader' thread
+    // All the processes are served by a single I/O thread
+    if(clProcessIOReactor::Get().Register(this, m_parent, m_callback, GetReadHandle(), GetStderrHandle(), m_flags)) {
+        return;
+    }
+
+    // Fallback: launch a 'Reader' thread for this process
     m_thr = new ProcessReaderThread();
     m_thr->SetProcess(this);
     m_thr->SetNotifyWindow(m_parent);
@@ -523,6 +531,7 @@ bool UnixProcessImpl::WriteToConsole(const wxString& buff)
 
 void UnixProcessImpl::Detach()
 {
+    clProcessIOReactor::Get().Unregister(this);
     if(m_thr) {
         // Stop the reader thread
         m_thr->Stop();
@@ -0,0 +1,379 @@
+#include "JSON.h"
+#include "clCompilerOutputMatcher.h"
+#include "clFilesCollector.h"
+#include "clRegexDFA.h"
+#include "compiler.h"
+#include "fileutils.h"
+#include "tester.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+#include <wx/regex.h>
+#include <wx/stopwatch.h>
+#include <wx/tokenzr.h>
+
+// Micro benchmarks for the performance sensitive code of libcodelite. Each benchmark also verifies that the fast
+// implementation produces the same results as the code it replaces
+
+namespace
+{
+/**
+ * @brief generate a C++ like corpus of 'lines' lines
+ */
+wxString MakeCorpus(size_t lines)
+{
+    const char* templates[] = { "#include <wx/string.h>",
+                                "    int value = compute(arg1, arg2); // some comment here",
+                                "    wxString name = GetName();",
+                                "",
+                                "    for(size_t i = 0; i < items.size(); ++i) {",
+                                "        m_items.push_back(items.at(i));",
+                                "    }",
+                                "void MyClass::OnButtonClicked(wxCommandEvent& event) { event.Skip(); }",
+                                "    // TODO: handle the error ",
+                                "    const std::string greeting = \"h\xC3\xA9llo\";" };
+    const size_t count = sizeof(templates) / sizeof(templates[0]);
+    wxString corpus;
+    for(size_t i = 0; i < lines; ++i) {
+        corpus << wxString::FromUTF8(templates[i % count]);
+        if(i % 97 == 0) { corpus << " m_counter" << i; }
+        corpus << "\n";
+    }
+    return corpus;
+}
+
+// The current wxRegEx path: run the expression on every line
+void SearchLinesRE(const wxString& corpus, wxRegEx& re, std::vector<int>& lines)
+{
+    wxStringTokenizer tkz(corpus, "\n", wxTOKEN_RET_EMPTY_ALL);
+    int lineNumber = 1;
+    while(tkz.HasMoreTokens()) {
+        wxString line = tkz.NextToken();
+        if(re.Matches(line)) { lines.push_back(lineNumber); }
+        ++lineNumber;
+    }
+}
+
+// The DFA path: scan the UTF-8 buffer once and confirm the candidate lines with wxRegEx
+void SearchLinesDFA(const std::string& buffer, clRegexDFA& dfa, wxRegEx& re, std::vector<int>& lines)
+{
+    const char* cur = buffer.c_str();
+    const char* end = cur + buffer.length();
+    const char* countedUpTo = cur;
+    int lineNumber = 1;
+    const char* matchEnd = nullptr;
+    while(cur < end && (matchEnd = dfa.Find(cur, end))) {
+        const char* lineStart = matchEnd - 1;
+        while(lineStart > cur && lineStart[-1] != '\n') {
+            --lineStart;
+        }
+        const char* lineEnd = static_cast<const char*>(memchr(matchEnd, '\n', end - matchEnd));
+        if(!lineEnd) { lineEnd = end; }
+        for(const char* p = countedUpTo; p < lineStart; ++p) {
+            if(*p == '\n') { ++lineNumber; }
+        }
+        countedUpTo = lineStart;
+        if(re.Matches(wxString::FromUTF8(lineStart, lineEnd - lineStart))) { lines.push_back(lineNumber); }
+        cur = lineEnd + 1;
+    }
+}
+/**
+ * @brief a textDocument/completion reply with 'count' items, as sent by clangd
+ */
+wxString MakeCompletionReply(int count)
+{
+    wxString reply = "{\"jsonrpc\":\"2.0\",\"id\":12,\"result\":{\"isIncomplete\":false,\"items\":[";
+    for(int i = 0; i < count; ++i) {
+        if(i) { reply << ","; }
+        reply << "{\"label\":\" m_member" << i << "\",\"kind\":5,\"detail\":\"std::vector<wxString>\","
+              << "\"documentation\":\"Line one\\nLine \\\"two\\\"\",\"sortText\":\"3f8" << i << "\","
+              << "\"filterText\":\"m_member" << i << "\",\"insertTextFormat\":1,\"textEdit\":{\"range\":{"
+              << "\"start\":{\"line\":120,\"character\":8},\"end\":{\"line\":120,\"character\":10}},"
+              << "\"newText\":\"m_member" << i << "\"}}";
+    }
+    reply << "]}}";
+    return reply;
+}
+
+/**
+ * @brief a gcc / clang build log of 'lines' lines: mostly compilation commands with a few diagnostics
+ */
+wxString MakeBuildLog(size_t lines)
+{
+    const char* templates[] = {
+        "g++  -c  \"/home/user/project/src/file%d.cpp\" -g -O0 -Wall -std=c++11 -o ./Debug/src_file%d.cpp.o -I. "
+        "-I/usr/include/wx-3.0 -D__WXGTK__",
+        "clang++ -c /home/user/project/src/view%d.cpp -O2 -fPIC -MMD -MP -MF ./Release/view%d.cpp.o.d -o "
+        "./Release/view%d.cpp.o",
+        "make[1]: Entering directory '/home/user/project/src%d'",
+        "/home/user/project/src/file%d.cpp:42:17: warning: unused variable 'count' [-Wunused-variable]",
+        "[ 45%%] Building CXX object CMakeFiles/app.dir/src/widget%d.cpp.o",
+        "/home/user/project/src/file%d.cpp:108:5: error: 'm_value' was not declared in this scope",
+        "In file included from /home/user/project/include/header%d.h:3:0,",
+        "   %d |     int count = 0;",
+        "file%d.o: In function `main':",
+        "/home/user/project/src/main.cpp:(.text+0x%d): undefined reference to `Foo::Bar()'",
+        "make: *** [Makefile:%d: All] Error 2",
+        "/home/user/project/include/header%d.h:7:6: note: declared here",
+    };
+    // diagnostics are rare in a real build log
+    const size_t weights[] = { 40, 30, 4, 2, 20, 1, 1, 1, 1, 1, 1, 1 };
+    std::vector<size_t> picks;
+    for(size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); ++i) {
+        picks.insert(picks.end(), weights[i], i);
+    }
+
+    wxString log;
+    for(size_t i = 0; i < lines; ++i) {
+        wxString line = wxString::Format(templates[picks[(i * 7) % picks.size()]], (int)i, (int)i, (int)i);
+        log << line << "\n";
+    }
+    return log;
+}
+
+// The previous build tab matching: try every pattern (wxRegEx) in turn, warnings first
+struct RegexPattern {
+    wxSharedPtr<wxRegEx> regex;
+    long fileIndex;
+    bool warning;
+};
+
+void CompilePatterns(const Compiler::CmpListInfoPattern& patterns, bool warning, std::vector<RegexPattern>& compiled)
+{
+    Compiler::CmpListInfoPattern::const_iterator iter = patterns.begin();
+    for(; iter != patterns.end(); ++iter) {
+        RegexPattern pattern;
+        pattern.regex.reset(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE));
+        iter->fileNameIndex.ToLong(&pattern.fileIndex);
+        pattern.warning = warning;
+        compiled.push_back(pattern);
+    }
+}
+
+// The previous JSONItem::arrayItem(): count the items and walk from the head on every call
+cJSON* ArrayItemFromHead(cJSON* array, int pos)
+{
+    if(pos >= cJSON_GetArraySize(array)) { return nullptr; }
+    return cJSON_GetArrayItem(array, pos);
+}
+} // namespace
+
+BENCHMARK_FUNC(benchmark_json)
+{
+    // Parse, walk and format a large completion reply
+    wxString reply = MakeCompletionReply(20000);
+    wxStopWatch sw;
+    JSON root(reply);
+    long parseTime = sw.Time();
+    CHECK_BOOL(root.isOk());
+
+    JSONItem items = root.toElement().namedObject("result").namedObject("items");
+    // The raw array, still owned by root
+    cJSON* itemsRaw = root.toElement().namedObject("result").namedObject("items").release();
+    int count = items.arraySize();
+    CHECK_SIZE(count, 20000);
+
+    std::vector<wxString> expected, actual;
+    sw.Start();
+    for(int i = 0; i < cJSON_GetArraySize(itemsRaw); ++i) {
+        expected.push_back(JSONItem(ArrayItemFromHead(itemsRaw, i)).namedObject(wxString("label")).toString());
+    }
+    long walkFromHeadTime = sw.Time();
+
+    sw.Start();
+    for(int i = 0; i < items.arraySize(); ++i) {
+        actual.push_back(items.arrayItem(i).namedObject("label").toString());
+    }
+    long walkTime = sw.Time();
+    CHECK_BOOL(expected == actual);
+
+    sw.Start();
+    wxString unformatted = root.toElement().format(false);
+    wxString formatted = root.toElement().format(true);
+    long formatTime = sw.Time();
+
+    // Formatting must round trip
+    CHECK_BOOL(JSON(unformatted).toElement().format(true) == formatted);
+    CHECK_BOOL(JSON(formatted).toElement().format(false) == unformatted);
+
+    printf("completion reply (%d bytes): parse %ldms, walk from head %ldms, walk %ldms, format %ldms\n",
+           (int)reply.length(), parseTime, walkFromHeadTime, walkTime, formatTime);
+
+    // Build and format a compile_commands.json with 20K entries
+    sw.Start();
+    JSON compileCommands(cJSON_Array);
+    JSONItem arr = compileCommands.toElement();
+    for(int i = 0; i < 20000; ++i) {
+        JSONItem entry = JSONItem::createObject();
+        entry.addProperty("file", wxString() << "/home/user/src/project/module" << (i % 50) << "/file" << i << ".cpp");
+        entry.addProperty("directory", wxString("/home/user/src/project/build-debug"));
+        entry.addProperty("command", wxString() << "/usr/bin/g++ -c -g -O0 -Wall -I/home/user/src/project/include "
+                                                << "-DDEBUG=1 -o file" << i << ".o file" << i << ".cpp");
+        arr.arrayAppend(entry);
+    }
+    long buildTime = sw.Time();
+    CHECK_SIZE(arr.arraySize(), 20000);
+
+    sw.Start();
+    wxString content = compileCommands.toElement().format();
+    long saveTime = sw.Time();
+    JSON reparsed(content);
+    CHECK_SIZE(reparsed.toElement().arraySize(), 20000);
+    CHECK_BOOL(reparsed.toElement().format() == content);
+    printf("compile_commands.json (%d bytes): build %ldms, format %ldms\n", (int)content.length(), buildTime,
+           saveTime);
+    return true;
+}
+
+BENCHMARK_FUNC(benchmark_regex_dfa_search)
+{
+    wxString corpus = MakeCorpus(200000);
+    std::string buffer = corpus.ToStdString(wxConvUTF8);
+    const char* patterns[] = { "m_counter1[0-9]+", "compute\\(arg[0-9], arg[0-9]\\)", "TODO:?\\s+handle",
+                               "On[A-Z][a-z]+Clicked", "h.llo", "^#include\\s+<wx/" };
+
+    for(size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i) {
+        for(int icase = 0; icase < 2; ++icase) {
+            int flags = wxRE_ADVANCED | (icase ? wxRE_ICASE : 0);
+            wxRegEx re(patterns[i], flags);
+            clRegexDFA dfa;
+            CHECK_BOOL(dfa.Compile(patterns[i], flags));
+
+            std::vector<int> expected, actual;
+            wxStopWatch sw;
+            SearchLinesRE(corpus, re, expected);
+            long reTime = sw.Time();
+
+            sw.Start();
+            SearchLinesDFA(buffer, dfa, re, actual);
+            long dfaTime = sw.Time();
+
+            printf("%-32s icase=%d: wxRegEx %5ldms, DFA %5ldms (%d matching lines)\n", patterns[i], icase, reTime,
+                   dfaTime, (int)expected.size());
+            CHECK_BOOL(expected == actual);
+        }
+    }
+    return true;
+}
+
+BENCHMARK_FUNC(benchmark_compiler_output_matcher)
+{
+    wxString log = MakeBuildLog(100000);
+    wxArrayString lines = ::wxStringTokenize(log, "\n", wxTOKEN_RET_DELIMS);
+    Compiler compiler(NULL);
+
+    std::vector<RegexPattern> patterns;
+    CompilePatterns(compiler.GetWarnPatterns(), true, patterns);
+    CompilePatterns(compiler.GetErrPatterns(), false, patterns);
+
+    clCompilerOutputMatcher matcher;
+    matcher.Compile(compiler.GetErrPatterns(), compiler.GetWarnPatterns());
+
+    // Each line is encoded as: 0 no match, 1 warning, 2 error (+ the file name)
+    wxArrayString expected, actual;
+    wxStopWatch sw;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        const wxString& line = lines.Item(i);
+        wxString result = "0";
+        for(size_t j = 0; j < patterns.size(); ++j) {
+            wxRegEx& re = *patterns[j].regex;
+            if(re.Matches(line)) {
+                result = patterns[j].warning ? "1" : "2";
+                if(patterns[j].fileIndex >= 0 && re.GetMatchCount() > (size_t)patterns[j].fileIndex) {
+                    result << re.GetMatch(line, patterns[j].fileIndex);
+                }
+                break;
+            }
+        }
+        expected.Add(result);
+    }
+    long reTime = sw.Time();
+
+    sw.Start();
+    for(size_t i = 0; i < lines.size(); ++i) {
+        clCompilerOutputMatcher::Match match;
+        wxString result = "0";
+        if(matcher.Matches(lines.Item(i), match)) {
+            result = (match.severity == clCompilerOutputMatcher::kWarning) ? "1" : "2";
+            result << match.filename;
+        }
+        actual.Add(result);
+    }
+    long matcherTime = sw.Time();
+
+    printf("build log (%d lines, %d patterns): wxRegEx %ldms, clCompilerOutputMatcher %ldms\n", (int)lines.size(),
+           (int)patterns.size(), reTime, matcherTime);
+    CHECK_BOOL(expected == actual);
+    return true;
+}
+
+BENCHMARK_FUNC(benchmark_files_scanner)
+{
+    // Build a tree of 200 folders (4 levels deep) with 20 files each
+    wxFileName root(wxFileName::GetTempDir(), "");
+    root.AppendDir(wxString() << "clFilesScanner-" << wxGetProcessId());
+    root.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    for(int i = 0; i < 200; ++i) {
+        wxFileName folder(root);
+        folder.AppendDir(wxString() << "a" << (i % 5));
+        folder.AppendDir(wxString() << "b" << (i % 10));
+        folder.AppendDir(wxString() << "c" << i);
+        folder.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+        for(int j = 0; j < 20; ++j) {
+            const char* exts[] = { ".cpp", ".h", ".txt", ".o" };
+            wxFileName file(folder.GetPath(), wxString() << "file" << j << exts[j % 4]);
+            wxFFile(file.GetFullPath(), "wb").Close();
+        }
+    }
+
+    wxArrayString allFiles;
+    wxStopWatch sw;
+    wxDir::GetAllFiles(root.GetPath(), &allFiles);
+    long dirTime = sw.Time();
+
+    std::vector<wxString> expected;
+    for(size_t i = 0; i < allFiles.size(); ++i) {
+        if(FileUtils::WildMatch("*.cpp;*.h", allFiles.Item(i))) { expected.push_back(allFiles.Item(i)); }
+    }
+
+    clFilesScanner scanner;
+    std::vector<wxString> actual;
+    sw.Start();
+    scanner.Scan(root.GetPath(), actual, "*.cpp;*.h");
+    long scanTime = sw.Time();
+
+    // The streaming version
+    size_t streamed = 0;
+    size_t batches = 0;
+    scanner.Scan(root.GetPath(),
+                 [&](const std::vector<wxString>& files) {
+                     streamed += files.size();
+                     ++batches;
+                     return true;
+                 },
+                 "*.cpp;*.h");
+
+    // Exclude a folder
+    wxStringSet_t excludeFolders;
+    wxFileName excluded(root);
+    excluded.AppendDir("a0");
+    excludeFolders.insert(FileUtils::RealPath(excluded.GetPath()));
+    std::vector<wxString> partial;
+    scanner.Scan(root.GetPath(), partial, "*.cpp;*.h", "", excludeFolders);
+
+    root.Rmdir(wxPATH_RMDIR_RECURSIVE);
+
+    printf("files scanner (%d files): wxDir %ldms, clFilesScanner %ldms (%d batches)\n", (int)allFiles.size(), dirTime,
+           scanTime, (int)batches);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    CHECK_SIZE((int)expected.size(), 2000);
+    CHECK_BOOL(expected == actual);
+    CHECK_SIZE((int)streamed, expected.size());
+    CHECK_SIZE((int)partial.size(), 1600);
+    return true;
+}
@@ -1,7 +1,12 @@
 #include "CxxTokenizer.h"
 #include "CxxVariableScanner.h"
+#include "LSP/MessageReader.h"
+#include "clFuzzyIndex.h"
+#include "clFuzzyMatcher.h"
+#include "clTrigramIndex.h"
 #include "ctags_manager.h"
 #include "fileutils.h"
+#include "tags_storage_sqlite3.h"
 #include "tester.h"
 #include <iostream>
 #include <stdio.h>
@@ -188,11 +193,144 @@ TEST_FUNC(test_local_in_std_for_each)
     return true;
 }
 
+TEST_FUNC(test_tags_cache_lru)
+{
+    std::vector<TagEntryPtr> tags;
+    for(size_t i = 0; i < 3; ++i) {
+        TagEntryPtr tag(new TagEntry());
+        tag->SetFile(wxString() << "/src/file" << i << ".cpp");
+        tags.push_back(tag);
+    }
+
+    // 2 entries of 3 tags each fit in a cache of 8 (each entry counts as an extra tag)
+    TagsStorageSQLiteCache cache;
+    cache.SetMaxTags(8);
+    cache.Store("query1", tags);
+    cache.Store("query2", tags);
+
+    std::vector<TagEntryPtr> result;
+    CHECK_BOOL(cache.Get("query1", result));
+    CHECK_SIZE(result.size(), 3);
+
+    // query2 is the least recently used entry
+    cache.Store("query3", std::vector<TagEntryPtr>(1, tags[0]));
+    CHECK_BOOL(!cache.Get("query2", result));
+    CHECK_SIZE(cache.GetEvictions(), 1);
+    CHECK_SIZE(cache.GetHits(), 1);
+    CHECK_SIZE(cache.GetMisses(), 1);
+
+    cache.Clear();
+    CHECK_BOOL(!cache.Get("query3", result));
+    CHECK_SIZE(cache.GetTagsCount(), 0);
+    return true;
+}
+
+TEST_FUNC(test_lsp_message_reader)
+{
+    // Content-Length counts bytes: "\xC3\xA9" is a single character
+    std::string body1 = "{\"id\":1,\"result\":\"h\xC3\xA9llo\"}";
+    std::string body2 = "{\"id\":2}";
+    std::string stream;
+    stream += "Content-Length: " + std::to_string(body1.length()) + "\r\n\r\n" + body1;
+    stream += "Content-Length: 5\r\nContent-Type: application/vscode-jsonrpc\r\n\r\n{bad}";
+    stream += "Content-Length: " + std::to_string(body2.length()) + "\r\n\r\n" + body2;
+
+    // feed the stream in chunks of every size, the messages must not depend on how the data was split
+    for(size_t chunk = 1; chunk <= stream.length(); ++chunk) {
+        LSP::MessageReader reader;
+        std::vector<int> ids;
+        for(size_t i = 0; i < stream.length(); i += chunk) {
+            reader.Append(stream.substr(i, chunk));
+            wxSharedPtr<JSON> json;
+            while(reader.Next(json)) {
+                ids.push_back(json->toElement().namedObject("id").toInt());
+            }
+        }
+        CHECK_SIZE(ids.size(), 2);
+        CHECK_SIZE(ids[0], 1);
+        CHECK_SIZE(ids[1], 2);
+        CHECK_SIZE(reader.GetPendingBytes(), 0);
+    }
+    return true;
+}
+
+TEST_FUNC(test_fuzzy_matcher)
+{
+    clFuzzyMatcher matcher("gV");
+    CHECK_BOOL(matcher.Matches("getvalue"));
+    CHECK_BOOL(!matcher.Matches("vg"));
+    CHECK_SIZE(matcher.Score("vg", "vg"), wxNOT_FOUND);
+
+    // word starts and camelCase humps rank first
+    CHECK_BOOL(matcher.Score("getValue", "getvalue") > matcher.Score("gravity", "gravity"));
+    CHECK_BOOL(matcher.Score("get_value", "get_value") > matcher.Score("gravity", "gravity"));
+    matcher.SetPattern("val");
+    CHECK_BOOL(matcher.Score("intervalValue", "intervalvalue") > matcher.Score("interval", "interval"));
+    return true;
+}
+
+TEST_FUNC(test_fuzzy_index)
+{
+    clFuzzyIndex index;
+    index.Add("/src/Plugin/workspace.cpp", "workspace.cpp");
+    index.Add("/src/wsp/main.cpp", "main.cpp");
+    index.Add("/src/Plugin/open_resource_dialog.cpp", "open_resource_dialog.cpp");
+    // enough entries to split the query between threads
+    for(size_t i = 0; i < 20000; ++i) {
+        wxString name;
+        name << "file" << i << ".h";
+        index.Add("/src/gen/" + name, name);
+    }
+
+    clFuzzyIndex::Vec_t matches;
+    index.Query("wsp", 10, matches);
+    CHECK_SIZE(matches.size(), 2);
+    // matches in the name rank first
+    CHECK_WXSTRING(index.GetText(matches[0].index), "/src/Plugin/workspace.cpp");
+
+    // every word must match
+    index.Query("ord dialog", 10, matches);
+    CHECK_SIZE(matches.size(), 1);
+
+    // the top matches are the same as the first of all the matches
+    clFuzzyIndex::Vec_t all;
+    index.Query("f12h", index.GetCount(), all);
+    index.Query("f12h", 50, matches);
+    CHECK_SIZE(matches.size(), 50);
+    for(size_t i = 0; i < matches.size(); ++i) {
+        CHECK_SIZE(matches[i].index, all[i].index);
+    }
+    return true;
+}
+
+TEST_FUNC(test_trigram_required_literals)
+{
+    std::vector<std::string> literals;
+    CHECK_BOOL(clTrigramIndex::GetRequiredLiterals("foo[^]x]bar", true, literals));
+    CHECK_SIZE(literals.size(), 2);
+    CHECK_STRING(literals[0].c_str(), "foo");
+    CHECK_STRING(literals[1].c_str(), "bar");
+
+    // an escaped ']' and a character class don't close the bracket expression
+    CHECK_BOOL(clTrigramIndex::GetRequiredLiterals("[\\]xyz]abc", true, literals));
+    CHECK_SIZE(literals.size(), 1);
+    CHECK_STRING(literals[0].c_str(), "abc");
+    CHECK_BOOL(clTrigramIndex::GetRequiredLiterals("[[:alpha:]xyz]abc", true, literals));
+    CHECK_SIZE(literals.size(), 1);
+    CHECK_STRING(literals[0].c_str(), "abc");
+
+    // the spaces of an expanded expression are not literals
+    CHECK_BOOL(!clTrigramIndex::GetRequiredLiterals("(?x) foo bar", true, literals));
+    return true;
+}
+
 int main(int argc, char** argv)
 {
     wxInitializer initializer(argc, argv);
     wxLogNull NOLOG;
-    Tester::Instance()->RunTests();
+    // The benchmarks are slow, run them only when asked to
+    bool benchmarks = (argc > 1 && strcmp(argv[1], "--benchmark") == 0);
+    Tester::Instance()->RunTests(benchmarks);
     //    fgetc(stdin);
     return 0;
 }
@@ -32,12 +32,16 @@ void Tester::AddTest(ITest *t)
     m_tests.push_back( t );
 }
 
-void Tester::RunTests()
+void Tester::RunTests(bool benchmarks)
 {
-    size_t totalTests = m_tests.size();
+    size_t totalTests = 0;
     size_t success    = 0;
     size_t errors     = 0;
     for(size_t i=0; i<m_tests.size(); i++) {
+        if(m_tests[i]->IsBenchmark() != benchmarks) {
+            continue;
+        }
+        ++totalTests;
         m_tests[i]->test() ? success++ : errors++;
     }
 
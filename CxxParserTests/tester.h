@@ -49,7 +49,12 @@ public:
     static void Release();
 
     void AddTest(ITest* t);
-    void RunTests();
+
+    /**
+     * @brief run the registered tests
+     * @param benchmarks when true, run the benchmarks (see BENCHMARK_FUNC) instead of the tests
+     */
+    void RunTests(bool benchmarks = false);
 
 private:
     Tester();
@@ -76,6 +81,7 @@ public:
     }
     virtual ~ITest() {}
     virtual bool test() = 0;
+    virtual bool IsBenchmark() const { return false; }
 };
 
 ///////////////////////////////////////////////////////////
@@ -97,6 +103,23 @@ public:
     }                                \
     bool Test_##Name::Name()
 
+// A benchmark: runs only when the tester is started with --benchmark
+#define BENCHMARK_FUNC(Name)                              \
+    class Test_##Name : public ITest                      \
+    {                                                     \
+    public:                                               \
+        virtual bool test();                              \
+        virtual bool Name();                              \
+        virtual bool IsBenchmark() const { return true; } \
+    };                                                    \
+    Test_##Name theTest##Name;                            \
+    bool Test_##Name::test()                              \
+    {                                                     \
+        printf("---->\n");                                \
+        return Name();                                    \
+    }                                                     \
+    bool Test_##Name::Name()
+
 // Check values macros
 #define CHECK_SIZE(actualSize, expcSize)                                                    \
     {                                                                                       \
@@ -0,0 +1,170 @@
+#include "BuildOutputParserThread.h"
+#include "globals.h"
+
+wxDEFINE_EVENT(wxEVT_BUILD_OUTPUT_PARSED, clCommandEvent);
+
+BuildOutputParserThread::BuildOutputParserThread(NewBuildTab* buildTab)
+    : m_generation(0)
+    , m_buildTab(buildTab)
+    , m_linesGeneration(0)
+    , m_notifyPending(false)
+{
+}
+
+BuildOutputParserThread::~BuildOutputParserThread()
+{
+    // The thread is stopped by the owner, we can safely delete the lines that were not taken
+    for(size_t i = 0; i < m_lines.size(); ++i) {
+        wxDELETE(m_lines[i].info);
+    }
+    m_lines.clear();
+}
+
+void BuildOutputParserThread::ProcessRequest(ThreadRequest* request)
+{
+    Request* req = dynamic_cast<Request*>(request);
+    if(!req) { return; }
+
+    std::vector<Line> lines;
+    switch(req->kind) {
+    case Request::kStart: {
+        m_generation = req->generation;
+        m_output.Clear();
+        m_directories.Clear();
+        m_cygwinRoot = req->cygwinRoot;
+        if(req->hasCompiler) {
+            m_matcher.Compile(req->errorPatterns, req->warningPatterns);
+        } else {
+            m_matcher.Clear();
+        }
+    } break;
+
+    case Request::kOutput:
+    case Request::kEnd: {
+        if(req->generation != m_generation) { break; }
+        m_output << req->text;
+
+        // Process only completed lines (i.e. a line that ends with '\n')
+        size_t start = 0;
+        size_t where = m_output.find('\n');
+        while(where != wxString::npos) {
+            DoProcessLine(m_output.Mid(start, where - start + 1), lines);
+            start = where + 1;
+            where = m_output.find('\n', start);
+        }
+        m_output.Remove(0, start);
+
+        bool buildEnded = (req->kind == Request::kEnd);
+        if(buildEnded && !m_output.IsEmpty()) {
+            DoProcessLine(m_output, lines);
+            m_output.Clear();
+        }
+        if(!lines.empty()) { DoPublish(lines); }
+
+        // The build end marker: queued after the last batch so the build tab takes all the lines before it completes
+        // the build
+        if(buildEnded) { m_buildTab->CallAfter(&NewBuildTab::OnParserBuildEnded, m_generation); }
+    } break;
+    }
+}
+
+void BuildOutputParserThread::DoProcessLine(const wxString& line, std::vector<Line>& lines)
+{
+    // If this is a line similar to 'Entering directory `'
+    // add the path in the directories array
+    DoSearchForDirectory(line);
+
+    BuildLineInfo* buildLineInfo = new BuildLineInfo();
+    buildLineInfo->SetSeverity(DoClassifyLine(line, buildLineInfo));
+
+    wxString buildLine = line;
+    buildLine.Trim();
+    Line parsedLine;
+    ::clStripTerminalColouring(buildLine, parsedLine.text);
+    parsedLine.info = buildLineInfo;
+    lines.push_back(parsedLine);
+}
+
+LINE_SEVERITY BuildOutputParserThread::DoClassifyLine(const wxString& line, BuildLineInfo* buildLineInfo)
+{
+    wxString lcLine = line.Lower();
+    if(lcLine.Contains("entering directory") || lcLine.Contains("leaving directory")) {
+        return SV_DIR_CHANGE;
+
+    } else if(line.StartsWith("====")) {
+        return SV_NONE;
+    }
+
+    clCompilerOutputMatcher::Match match;
+    if(!m_matcher.Matches(line, match)) { return SV_NONE; }
+
+    buildLineInfo->SetFilename(match.filename);
+    buildLineInfo->SetLineNumber(match.lineNumber);
+    buildLineInfo->NormalizeFilename(m_directories, m_cygwinRoot);
+    buildLineInfo->SetRegexLineMatch(match.length);
+    buildLineInfo->SetColumn(match.column);
+    return (match.severity == clCompilerOutputMatcher::kWarning) ? SV_WARNING : SV_ERROR;
+}
+
+void BuildOutputParserThread::DoSearchForDirectory(const wxString& line)
+{
+    // Check for makefile directory changes lines
+    if(line.Contains(wxT("Entering directory `"))) {
+        wxString currentDir = line.AfterFirst(wxT('`'));
+        currentDir = currentDir.BeforeLast(wxT('\''));
+
+        // Collect the m_baseDir
+        m_directories.Add(currentDir);
+
+    } else if(line.Contains(wxT("Entering directory '"))) {
+        wxString currentDir = line.AfterFirst(wxT('\''));
+        currentDir = currentDir.BeforeLast(wxT('\''));
+
+        // Collect the m_baseDir
+        m_directories.Add(currentDir);
+    }
+}
+
+void BuildOutputParserThread::DoPublish(std::vector<Line>& lines)
+{
+    bool notify = false;
+    {
+        wxMutexLocker locker(m_lock);
+        if(m_linesGeneration != m_generation) {
+            // nobody took the lines of the previous build
+            for(size_t i = 0; i < m_lines.size(); ++i) {
+                wxDELETE(m_lines[i].info);
+            }
+            m_lines.clear();
+            m_linesGeneration = m_generation;
+        }
+        m_lines.insert(m_lines.end(), lines.begin(), lines.end());
+        notify = !m_notifyPending;
+        m_notifyPending = true;
+    }
+    lines.clear();
+
+    // a single notification until the main thread takes the lines
+    if(notify && m_notifiedWindow) {
+        clCommandEvent event(wxEVT_BUILD_OUTPUT_PARSED);
+        m_notifiedWindow->AddPendingEvent(event);
+    }
+}
+
+bool BuildOutputParserThread::TakeLines(int generation, std::vector<Line>& lines)
+{
+    wxMutexLocker locker(m_lock);
+    m_notifyPending = false;
+    if(m_linesGeneration != generation) {
+        // left overs from a previous build
+        for(size_t i = 0; i < m_lines.size(); ++i) {
+            wxDELETE(m_lines[i].info);
+        }
+        m_lines.clear();
+        return false;
+    }
+    if(m_lines.empty()) { return false; }
+
+    lines.swap(m_lines);
+    return true;
+}
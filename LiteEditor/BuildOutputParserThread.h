@@ -0,0 +1,85 @@
+#ifndef BUILDOUTPUTPARSERTHREAD_H
+#define BUILDOUTPUTPARSERTHREAD_H
+
+#include "clCompilerOutputMatcher.h"
+#include "cl_command_event.h"
+#include "compiler.h"
+#include "new_build_tab.h"
+#include "worker_thread.h" // Base class: WorkerThread
+#include <vector>
+#include <wx/thread.h>
+
+/**
+ * @class BuildOutputParserThread
+ * @brief classify the build output lines (compiler patterns, directory changes, file name resolution) away from the
+ * main thread. The build tab collects the classified lines in batches, see TakeLines(). Once the last line of a build
+ * is published, the build tab is told so with CallAfter() (see NewBuildTab::OnParserBuildEnded)
+ */
+class BuildOutputParserThread : public WorkerThread
+{
+public:
+    struct Request : public ThreadRequest {
+        enum eKind {
+            kStart,  // a new build: reset the parser state
+            kOutput, // more build output
+            kEnd,    // the build ended: flush the last (incomplete) line
+        };
+        eKind kind;
+        int generation;
+        wxString text;
+        bool hasCompiler;
+        Compiler::CmpListInfoPattern errorPatterns;
+        Compiler::CmpListInfoPattern warningPatterns;
+        wxString cygwinRoot;
+
+        Request(eKind k, int gen)
+            : kind(k)
+            , generation(gen)
+            , hasCompiler(false)
+        {
+        }
+    };
+
+    struct Line {
+        wxString text;
+        BuildLineInfo* info;
+    };
+
+protected:
+    // Used by the worker thread only
+    clCompilerOutputMatcher m_matcher;
+    int m_generation;
+    wxString m_output;
+    wxArrayString m_directories;
+    wxString m_cygwinRoot;
+    NewBuildTab* m_buildTab;
+
+    // The results, protected by m_lock
+    wxMutex m_lock;
+    std::vector<Line> m_lines;
+    int m_linesGeneration;
+    bool m_notifyPending;
+
+protected:
+    void DoProcessLine(const wxString& line, std::vector<Line>& lines);
+    LINE_SEVERITY DoClassifyLine(const wxString& line, BuildLineInfo* buildLineInfo);
+    void DoSearchForDirectory(const wxString& line);
+    void DoPublish(std::vector<Line>& lines);
+
+public:
+    BuildOutputParserThread(NewBuildTab* buildTab);
+    virtual ~BuildOutputParserThread();
+
+    virtual void ProcessRequest(ThreadRequest* request);
+
+    /**
+     * @brief take the lines classified so far (main thread)
+     * @param generation the current build. Lines left over from older builds are discarded
+     * @return false if there was nothing to take
+     */
+    bool TakeLines(int generation, std::vector<Line>& lines);
+};
+
+wxDECLARE_EVENT(wxEVT_BUILD_OUTPUT_PARSED, clCommandEvent);
+
+#endif // BUILDOUTPUTPARSERTHREAD_H
@@ -100,6 +100,7 @@ CodeCompletionManager::CodeCompletionManager()
                                this);
     EventNotifier::Get()->Bind(wxEVT_BUILD_ENDED, &CodeCompletionManager::OnBuildEnded, this);
     EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_ADDED, &CodeCompletionManager::OnFilesAdded, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_REMOVED, &CodeCompletionManager::OnFilesRemoved, this);
     EventNotifier::Get()->Bind(wxEVT_WORKSPACE_LOADED, &CodeCompletionManager::OnWorkspaceLoaded, this);
 
     // Connect ourself to the cc event system
@@ -121,6 +122,7 @@ CodeCompletionManager::~CodeCompletionManager()
     m_preProcessorThread.Stop();
     m_usingNamespaceThread.Stop();
     EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_ADDED, &CodeCompletionManager::OnFilesAdded, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_REMOVED, &CodeCompletionManager::OnFilesRemoved, this);
     EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_LOADED, &CodeCompletionManager::OnWorkspaceLoaded, this);
     EventNotifier::Get()->Unbind(wxEVT_CC_BLOCK_COMMENT_CODE_COMPLETE,
                                  &CodeCompletionManager::OnBlockCommentCodeComplete, this);
@@ -418,6 +420,15 @@ void CodeCompletionManager::OnWorkspaceConfig(wxCommandEvent& event)
     event.Skip();
     if(clCxxWorkspaceST::Get()->IsOpen()) { clCxxWorkspaceST::Get()->ClearBacktickCache(); }
     RefreshPreProcessorColouring();
+
+    // Project settings modified: only this project's compile_commands.json entries are affected
+    clProjectSettingsEvent* projectSettingsEvent = dynamic_cast<clProjectSettingsEvent*>(&event);
+    if(projectSettingsEvent) {
+        m_compileCommandsGenerator->MarkProjectDirty(projectSettingsEvent->GetProjectName());
+    } else {
+        m_compileCommandsGenerator->MarkAllDirty();
+    }
+    m_compileCommandsGenerator->GenerateCompileCommands();
 }
 
 void CodeCompletionManager::OnFindUsingNamespaceDone(const wxArrayString& usingNamespace, const wxString& filename)
@@ -527,6 +538,7 @@ bool CodeCompletionManager::GetDefinitionsAndSearchPaths(clEditor* editor, wxArr
 void CodeCompletionManager::OnWorkspaceClosed(wxCommandEvent& event)
 {
     event.Skip();
+    m_compileCommandsGenerator->MarkAllDirty();
     LanguageST::Get()->ClearAdditionalScopesCache();
 }
 
@@ -535,6 +547,8 @@ void CodeCompletionManager::OnEnvironmentVariablesModified(clCommandEvent& event
     event.Skip();
     if(clCxxWorkspaceST::Get()->IsOpen()) { clCxxWorkspaceST::Get()->ClearBacktickCache(); }
     RefreshPreProcessorColouring();
+    m_compileCommandsGenerator->MarkAllDirty();
+    m_compileCommandsGenerator->GenerateCompileCommands();
 }
 
 void CodeCompletionManager::DoProcessCompileCommands()
@@ -628,12 +642,22 @@ void CodeCompletionManager::UpdateParserPaths()
 void CodeCompletionManager::OnFilesAdded(clCommandEvent& e)
 {
     e.Skip();
+    m_compileCommandsGenerator->MarkProjectDirty(e.GetString());
     m_compileCommandsGenerator->GenerateCompileCommands();
 }
 
+void CodeCompletionManager::OnFilesRemoved(clCommandEvent& e)
+{
+    e.Skip();
+    // This event is sent before the files are removed from the project
+    m_compileCommandsGenerator->MarkProjectDirty(e.GetString());
+    m_compileCommandsGenerator->CallAfter(&CompileCommandsGenerator::GenerateCompileCommands);
+}
+
 void CodeCompletionManager::OnWorkspaceLoaded(wxCommandEvent& e)
 {
     e.Skip();
+    m_compileCommandsGenerator->MarkAllDirty();
     m_compileCommandsGenerator->GenerateCompileCommands();
 }
 
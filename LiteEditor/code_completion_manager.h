@@ -69,6 +69,7 @@ protected:
     // Event handlers
     void OnBuildEnded(clBuildEvent& e);
     void OnFilesAdded(clCommandEvent& e);
+    void OnFilesRemoved(clCommandEvent& e);
     void OnWorkspaceLoaded(wxCommandEvent& e);
 
     void OnBuildStarted(clBuildEvent& e);
@@ -63,6 +63,7 @@
 #include "clFileSystemEvent.h"
 #include "clKeyboardManager.h"
 #include "clProfileHandler.h"
+#include "clTrigramIndex.h"
 #include "clWorkspaceManager.h"
 #include "clWorkspaceView.h"
 #include "cl_command_event.h"
@@ -269,6 +270,7 @@ Manager::~Manager(void)
     BuildManagerST::Free();
     BuildSettingsConfigST::Free();
     SearchThreadST::Free();
+    clTrigramIndex::Release();
     MenuManager::Free();
     EnvironmentConfig::Release();
 
@@ -358,6 +360,16 @@ void Manager::DoSetupWorkspace(const wxString& path)
     wxFileList_t allfiles;
     GetWorkspaceFiles(allfiles, true);
 
+    // Load the Find in Files trigram index, it is kept next to the tags database
+    {
+        wxArrayString files;
+        files.reserve(allfiles.size());
+        std::for_each(allfiles.begin(), allfiles.end(), [&](const wxFileName& fn) { files.Add(fn.GetFullPath()); });
+        wxFileName indexFile = clCxxWorkspaceST::Get()->GetTagsFileName();
+        indexFile.SetExt("trigrams");
+        clTrigramIndex::Get().Load(indexFile, files);
+    }
+
     {
         SessionEntry session;
         if(SessionManager::Get().GetSession(path, session)) {
@@ -3250,7 +3262,10 @@ void Manager::OnIncludeFilesScanDone(wxCommandEvent& event)
     // -----------------------------------------------
     // tag them
     // -----------------------------------------------
-    TagsManagerST::Get()->RetagFiles(projectFiles, event.GetInt() ? TagsManager::Retag_Quick : TagsManager::Retag_Full);
+    // The whole workspace: a full retag stores it in bulk
+    bool quickRetag = event.GetInt();
+    TagsManagerST::Get()->RetagFiles(projectFiles, quickRetag ? TagsManager::Retag_Quick : TagsManager::Retag_Full,
+                                     NULL, !quickRetag);
 
 #if !USE_PARSER_TREAD_FOR_RETAGGING_WORKSPACE
     long end = sw.Time();
@@ -23,6 +23,7 @@
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
+#include "BuildOutputParserThread.h"
 #include "BuildTabTopPanel.h"
 #include "ColoursAndFontsManager.h"
 #include "Notebook.h"
@@ -89,6 +90,9 @@ typedef std::map<int, AnnotationInfo> AnnotationInfoByLineMap_t;
 
 #define LEX_GCC_MARKER 1
 
+// Minimum time between two updates of the view while the build is running (ms)
+#define BUILD_OUTPUT_FLUSH_INTERVAL 30
+
 NewBuildTab::NewBuildTab(wxWindow* parent)
     : wxPanel(parent)
     , m_warnCount(0)
@@ -99,8 +103,11 @@ NewBuildTab::NewBuildTab(wxWindow* parent)
     , m_skipWarnings(false)
     , m_buildpaneScrollTo(ScrollToFirstError)
     , m_buildInProgress(false)
-    , m_maxlineWidth(wxNOT_FOUND)
     , m_lastLineColoured(wxNOT_FOUND)
+    , m_parser(NULL)
+    , m_generation(0)
+    , m_buildEndPending(false)
+    , m_flushTimer(NULL)
 {
     SetSize(wxNOT_FOUND, 400);
     m_curError = m_errorsAndWarningsList.end();
@@ -110,8 +117,19 @@ NewBuildTab::NewBuildTab(wxWindow* parent)
     m_view = new wxStyledTextCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxBORDER_NONE);
     // We dont really want to collect undo in the output tabs...
     InitView();
+    // Let scintilla keep the horizontal scrollbar as wide as the longest line
+    m_view->SetScrollWidthTracking(true);
     Bind(wxEVT_IDLE, &NewBuildTab::OnIdle, this);
 
+    // The build output is classified by a worker thread, we only append the results to the view
+    m_parser = new BuildOutputParserThread(this);
+    m_parser->SetNotifyWindow(this);
+    m_parser->Start();
+    Bind(wxEVT_BUILD_OUTPUT_PARSED, &NewBuildTab::OnBuildOutputParsed, this);
+
+    m_flushTimer = new wxTimer(this);
+    Bind(wxEVT_TIMER, &NewBuildTab::OnFlushTimer, this, m_flushTimer->GetId());
+
     m_view->Bind(wxEVT_STC_HOTSPOT_CLICK, &NewBuildTab::OnHotspotClicked, this);
     EventNotifier::Get()->Bind(wxEVT_CL_THEME_CHANGED, &NewBuildTab::OnThemeChanged, this);
 
@@ -155,6 +173,14 @@ NewBuildTab::~NewBuildTab()
                          wxCommandEventHandler(NewBuildTab::OnNextBuildError), NULL, this);
     wxTheApp->Disconnect(XRCID("next_build_error"), wxEVT_UPDATE_UI,
                          wxUpdateUIEventHandler(NewBuildTab::OnNextBuildErrorUI), NULL, this);
+
+    Unbind(wxEVT_BUILD_OUTPUT_PARSED, &NewBuildTab::OnBuildOutputParsed, this);
+    m_flushTimer->Stop();
+    Unbind(wxEVT_TIMER, &NewBuildTab::OnFlushTimer, this, m_flushTimer->GetId());
+    wxDELETE(m_flushTimer);
+
+    m_parser->Stop();
+    wxDELETE(m_parser);
 }
 
 void NewBuildTab::OnBuildEnded(clCommandEvent& e)
@@ -162,8 +188,24 @@ void NewBuildTab::OnBuildEnded(clCommandEvent& e)
     e.Skip();
     CL_DEBUG("Build Ended!");
     m_buildInProgress = false;
+    m_buildEndPending = true;
+    // The parser may still be classifying the output. The build is completed once it is done (see OnParserBuildEnded)
+    m_parser->Add(new BuildOutputParserThread::Request(BuildOutputParserThread::Request::kEnd, m_generation));
+}
 
-    DoProcessOutput(true, false);
+void NewBuildTab::OnParserBuildEnded(int generation)
+{
+    if(generation != m_generation || !m_buildEndPending) { return; }
+
+    // Take the last lines right away and complete the build
+    m_flushTimer->Stop();
+    DoFlushOutput();
+    DoBuildEnded();
+}
+
+void NewBuildTab::DoBuildEnded()
+{
+    m_buildEndPending = false;
 
     std::vector<clEditor*> editors;
     clMainFrame::Get()->GetMainBook()->GetAllEditors(editors, MainBook::kGetAll_Default);
@@ -183,14 +225,11 @@ void NewBuildTab::OnBuildEnded(clCommandEvent& e)
         term << wxString::Format(wxT(", %s: %02ld:%02ld:%02ld %s"), _("total time"), hours, minutes, sec, _("seconds"));
     }
 
-    m_output = term;
-    DoProcessOutput(true, true);
+    DoAppendInfoLine("====" + term + "====");
 
     if(m_buildInterrupted) {
-        wxString InterruptedMsg;
-        InterruptedMsg << _("(Build Cancelled)") << wxT("\n\n");
-        m_output = InterruptedMsg;
-        DoProcessOutput(true, false);
+        DoAppendInfoLine(_("(Build Cancelled)"));
+        DoAppendInfoLine("");
     }
 
     // Hide / Show the build tab according to the settings
@@ -247,10 +286,7 @@ void NewBuildTab::OnBuildStarted(clCommandEvent& e)
     m_showMe = (BuildTabSettingsData::ShowBuildPane)m_buildTabSettings.GetShowBuildPane();
     m_skipWarnings = m_buildTabSettings.GetSkipWarnings();
 
-    if(e.GetEventType() != wxEVT_SHELL_COMMAND_STARTED_NOCLEAN) {
-        DoClear();
-        DoCacheRegexes();
-    }
+    if(e.GetEventType() != wxEVT_SHELL_COMMAND_STARTED_NOCLEAN) { DoClear(); }
 
     // Show the tab if needed
     OutputPane* opane = clMainFrame::Get()->GetOutputPane();
@@ -282,98 +318,53 @@ void NewBuildTab::OnBuildStarted(clCommandEvent& e)
         buildEvent.SetConfigurationName(bed->GetConfiguration());
         EventNotifier::Get()->AddPendingEvent(buildEvent);
     }
+
+    // Pass the compiler patterns to the parser
+    DoStartParser();
 }
 
 void NewBuildTab::OnBuildAddLine(clCommandEvent& e)
 {
     e.Skip(); // Always call skip..
-    m_output << e.GetString();
-    DoProcessOutput(false, false);
+    DoQueueOutput(e.GetString());
 }
 
-BuildLineInfo* NewBuildTab::DoProcessLine(const wxString& line)
+void NewBuildTab::DoStartParser()
 {
-    BuildLineInfo* buildLineInfo = new BuildLineInfo();
-    LINE_SEVERITY severity;
-    // Get the matching regex for this line
-    CmpPatternPtr cmpPatterPtr = GetMatchingRegex(line, severity);
-    buildLineInfo->SetSeverity(severity);
-    BuildLineInfo bli;
-    if(cmpPatterPtr && cmpPatterPtr->Matches(line, bli)) {
-        buildLineInfo->SetFilename(bli.GetFilename());
-        buildLineInfo->SetSeverity(bli.GetSeverity());
-        buildLineInfo->SetLineNumber(bli.GetLineNumber());
-        buildLineInfo->NormalizeFilename(m_directories, m_cygwinRoot);
-        buildLineInfo->SetRegexLineMatch(bli.GetRegexLineMatch());
-        buildLineInfo->SetColumn(bli.GetColumn());
-        if(severity == SV_WARNING) {
-            // Warning
-            m_errorsAndWarningsList.push_back(buildLineInfo);
-            m_warnCount++;
-        } else {
-            // Error
-            m_errorsAndWarningsList.push_back(buildLineInfo);
-            m_errorsList.push_back(buildLineInfo);
-            m_errorCount++;
-        }
-    }
-    return buildLineInfo;
-}
-
-void NewBuildTab::DoCacheRegexes()
-{
-    m_cmpPatterns.clear();
-
-    // Loop over all known compilers and cache the regular expressions
-    BuildSettingsConfigCookie cookie;
-    CompilerPtr cmp = BuildSettingsConfigST::Get()->GetFirstCompiler(cookie);
-    while(cmp) {
-        CmpPatterns cmpPatterns;
-        const Compiler::CmpListInfoPattern& errPatterns = cmp->GetErrPatterns();
-        const Compiler::CmpListInfoPattern& warnPatterns = cmp->GetWarnPatterns();
-        Compiler::CmpListInfoPattern::const_iterator iter;
-        for(iter = errPatterns.begin(); iter != errPatterns.end(); iter++) {
-
-            CmpPatternPtr compiledPatternPtr(new CmpPattern(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE),
-                                                            iter->fileNameIndex, iter->lineNumberIndex,
-                                                            iter->columnIndex, SV_ERROR));
-            if(compiledPatternPtr->GetRegex()->IsValid()) { cmpPatterns.errorsPatterns.push_back(compiledPatternPtr); }
-        }
-
-        for(iter = warnPatterns.begin(); iter != warnPatterns.end(); iter++) {
-
-            CmpPatternPtr compiledPatternPtr(new CmpPattern(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE),
-                                                            iter->fileNameIndex, iter->lineNumberIndex,
-                                                            iter->columnIndex, SV_WARNING));
-            if(compiledPatternPtr->GetRegex()->IsValid()) { cmpPatterns.warningPatterns.push_back(compiledPatternPtr); }
-        }
-
-        m_cmpPatterns.insert(std::make_pair(cmp->GetName(), cmpPatterns));
-        cmp = BuildSettingsConfigST::Get()->GetNextCompiler(cookie);
+    BuildOutputParserThread::Request* req =
+        new BuildOutputParserThread::Request(BuildOutputParserThread::Request::kStart, m_generation);
+    req->cygwinRoot = m_cygwinRoot;
+    if(m_cmp) {
+        req->hasCompiler = true;
+        req->errorPatterns = m_cmp->GetErrPatterns();
+        req->warningPatterns = m_cmp->GetWarnPatterns();
     }
+    m_parser->Add(req);
 }
 
-bool NewBuildTab::DoGetCompilerPatterns(const wxString& compilerName, CmpPatterns& patterns)
+void NewBuildTab::DoQueueOutput(const wxString& text)
 {
-    MapCmpPatterns_t::iterator iter = m_cmpPatterns.find(compilerName);
-    if(iter == m_cmpPatterns.end()) { return false; }
-    patterns = iter->second;
-    return true;
+    BuildOutputParserThread::Request* req =
+        new BuildOutputParserThread::Request(BuildOutputParserThread::Request::kOutput, m_generation);
+    req->text = text;
+    m_parser->Add(req);
 }
 
 void NewBuildTab::DoClear()
 {
     wxFont font = DoGetFont();
     m_lastLineColoured = wxNOT_FOUND;
-    m_maxlineWidth = wxNOT_FOUND;
     m_buildInterrupted = false;
-    m_directories.Clear();
     m_buildInfoPerFile.clear();
     m_warnCount = 0;
     m_errorCount = 0;
     m_errorsAndWarningsList.clear();
     m_errorsList.clear();
-    m_cmpPatterns.clear();
+
+    // Output of the previous build that is still in the parser is discarded
+    ++m_generation;
+    m_buildEndPending = false;
+    DoStartParser();
 
     // Delete all the user data
     std::for_each(m_viewData.begin(), m_viewData.end(), [&](std::pair<int, BuildLineInfo*> p) { delete p.second; });
@@ -381,6 +372,7 @@ void NewBuildTab::DoClear()
 
     m_view->SetEditable(true);
     m_view->ClearAll();
+    m_view->SetScrollWidth(1); // the scroll width tracking only grows it
     m_view->SetEditable(false);
 
     // Clear all markers from open editors
@@ -479,25 +471,6 @@ void NewBuildTab::MarkEditor(clEditor* editor)
     editor->Refresh();
 }
 
-void NewBuildTab::DoSearchForDirectory(const wxString& line)
-{
-    // Check for makefile directory changes lines
-    if(line.Contains(wxT("Entering directory `"))) {
-        wxString currentDir = line.AfterFirst(wxT('`'));
-        currentDir = currentDir.BeforeLast(wxT('\''));
-
-        // Collect the m_baseDir
-        m_directories.Add(currentDir);
-
-    } else if(line.Contains(wxT("Entering directory '"))) {
-        wxString currentDir = line.AfterFirst(wxT('\''));
-        currentDir = currentDir.BeforeLast(wxT('\''));
-
-        // Collect the m_baseDir
-        m_directories.Add(currentDir);
-    }
-}
-
 void NewBuildTab::OnWorkspaceClosed(wxCommandEvent& e)
 {
     e.Skip();
@@ -512,72 +485,80 @@ void NewBuildTab::OnWorkspaceLoaded(wxCommandEvent& e)
     InitView();
 }
 
-void NewBuildTab::DoProcessOutput(bool compilationEnded, bool isSummaryLine)
+void NewBuildTab::DoAddLineInfo(BuildLineInfo* buildLineInfo, int lineInBuildTab)
 {
-    wxUnusedVar(isSummaryLine);
-    if(!compilationEnded && m_output.Find(wxT("\n")) == wxNOT_FOUND) {
-        // still dont have a complete line
-        return;
+    // keep the line info
+    if(buildLineInfo->GetFilename().IsEmpty() == false) {
+        m_buildInfoPerFile.insert(std::make_pair(buildLineInfo->GetFilename(), buildLineInfo));
     }
 
-    wxArrayString lines = ::wxStringTokenize(m_output, wxT("\n"), wxTOKEN_RET_DELIMS);
-    m_output.Clear();
-
-    // Process only completed lines (i.e. a line that ends with '\n')
-    for(size_t i = 0; i < lines.GetCount(); ++i) {
-        if(!compilationEnded && !lines.Item(i).EndsWith(wxT("\n"))) {
-            m_output << lines.Item(i);
-            return;
-        }
-
-        wxString buildLine = lines.Item(i); //.Trim().Trim(false);
-        // If this is a line similar to 'Entering directory `'
-        // add the path in the directories array
-        DoSearchForDirectory(buildLine);
-        BuildLineInfo* buildLineInfo = DoProcessLine(buildLine);
+    switch(buildLineInfo->GetSeverity()) {
+    case SV_WARNING:
+        m_errorsAndWarningsList.push_back(buildLineInfo);
+        m_warnCount++;
+        break;
+    case SV_ERROR:
+        m_errorsAndWarningsList.push_back(buildLineInfo);
+        m_errorsList.push_back(buildLineInfo);
+        m_errorCount++;
+        break;
+    default:
+        break;
+    }
 
-        // keep the line info
-        if(buildLineInfo->GetFilename().IsEmpty() == false) {
-            m_buildInfoPerFile.insert(std::make_pair(buildLineInfo->GetFilename(), buildLineInfo));
-        }
+    // Keep the line number in the build tab
+    buildLineInfo->SetLineInBuildTab(lineInBuildTab);
+    // Store the line info *before* we add the text
+    // it is needed in the OnStyle function
+    m_viewData.insert(std::make_pair(lineInBuildTab, buildLineInfo));
+}
 
-        if(isSummaryLine) {
-            buildLine.Trim();
-            buildLine.Prepend("====");
-            buildLine.Append("====");
-            buildLineInfo->SetSeverity(SV_NONE);
-        }
+void NewBuildTab::DoFlushOutput()
+{
+    std::vector<BuildOutputParserThread::Line> lines;
+    if(!m_parser->TakeLines(m_generation, lines)) { return; }
+    m_flushStopWatch.Start();
 
-        // Keep the line number in the build tab
-        buildLineInfo->SetLineInBuildTab(m_view->GetLineCount() - 1); // -1 because the view always has 1 extra "\n"
-        // Store the line info *before* we add the text
-        // it is needed in the OnStyle function
-        m_viewData.insert(std::make_pair(buildLineInfo->GetLineInBuildTab(), buildLineInfo));
+    // Append the whole batch at once
+    int curline = m_view->GetLineCount() - 1; // -1 because the view always has 1 extra "\n"
+    wxString text;
+    for(size_t i = 0; i < lines.size(); ++i) {
+        DoAddLineInfo(lines[i].info, curline + i);
+        text << lines[i].text << "\n";
+    }
 
-        m_view->SetEditable(true);
-        buildLine.Trim();
-        wxString modText;
-        ::clStripTerminalColouring(buildLine, modText);
+    m_view->SetEditable(true);
+    m_view->AppendText(text);
+    m_view->SetEditable(false);
 
-        int curline = m_view->GetLineCount() - 1;
-        m_view->AppendText(modText + "\n");
+    if(clConfig::Get().Read(kConfigBuildAutoScroll, true)) { m_view->ScrollToEnd(); }
+}
 
-        // get the newly added line width
-        int endPosition = m_view->GetLineEndPosition(curline); // get character position from begin
-        int beginPosition = m_view->PositionFromLine(curline); // and end of line
+void NewBuildTab::DoAppendInfoLine(const wxString& text)
+{
+    BuildLineInfo* buildLineInfo = new BuildLineInfo();
+    DoAddLineInfo(buildLineInfo, m_view->GetLineCount() - 1);
 
-        wxPoint beginPos = m_view->PointFromPosition(beginPosition);
-        wxPoint endPos = m_view->PointFromPosition(endPosition);
+    m_view->SetEditable(true);
+    m_view->AppendText(text + "\n");
+    m_view->SetEditable(false);
 
-        int curLen = (endPos.x - beginPos.x) + 10;
-        m_maxlineWidth = wxMax(m_maxlineWidth, curLen);
-        if(m_maxlineWidth > 0) { m_view->SetScrollWidth(m_maxlineWidth); }
-        m_view->SetEditable(false);
+    if(clConfig::Get().Read(kConfigBuildAutoScroll, true)) { m_view->ScrollToEnd(); }
+}
 
-        if(clConfig::Get().Read(kConfigBuildAutoScroll, true)) { m_view->ScrollToEnd(); }
+void NewBuildTab::OnBuildOutputParsed(clCommandEvent& event)
+{
+    // Don't update the view more than once per frame. The lines keep accumulating in the parser meanwhile
+    long elapsed = m_flushStopWatch.Time();
+    if(elapsed < BUILD_OUTPUT_FLUSH_INTERVAL) {
+        if(!m_flushTimer->IsRunning()) { m_flushTimer->Start(BUILD_OUTPUT_FLUSH_INTERVAL - elapsed, true); }
+        return;
     }
+    DoFlushOutput();
 }
 
+void NewBuildTab::OnFlushTimer(wxTimerEvent& event) { DoFlushOutput(); }
+
 void NewBuildTab::CenterLineInView(int line)
 {
     if(line > m_view->GetLineCount()) return;
@@ -796,11 +777,7 @@ void NewBuildTab::OnClearUI(wxUpdateUIEvent& e) { e.Enable(!m_buildInProgress &&
 
 void NewBuildTab::ScrollToBottom() { m_view->ScrollToEnd(); }
 
-void NewBuildTab::AppendLine(const wxString& text)
-{
-    m_output << text;
-    DoProcessOutput(false, false);
-}
+void NewBuildTab::AppendLine(const wxString& text) { DoQueueOutput(text); }
 
 void NewBuildTab::OnStyleNeeded(wxStyledTextEvent& event)
 {
@@ -959,10 +936,10 @@ void NewBuildTab::ColourOutput()
         m_view->StartStyling(startPos, 0x1f);
 #endif
 
-        // Run the regexes
-        wxString lineText = m_view->GetLine(i);
-        LINE_SEVERITY severity;
-        GetMatchingRegex(lineText, severity);
+        // The severity was set by the parser
+        LINE_SEVERITY severity = SV_NONE;
+        std::map<int, BuildLineInfo*>::iterator iter = m_viewData.find(i);
+        if(iter != m_viewData.end()) { severity = iter->second->GetSeverity(); }
         switch(severity) {
         case SV_WARNING:
             m_view->SetStyling((lineEndPos - startPos), LEX_GCC_WARNING);
@@ -985,101 +962,12 @@ void NewBuildTab::ColourOutput()
     m_lastLineColoured = untilLine;
 }
 
-CmpPatternPtr NewBuildTab::GetMatchingRegex(const wxString& lineText, LINE_SEVERITY& severity)
-{
-    if(lineText.Lower().Contains("entering directory") || lineText.Lower().Contains("leaving directory")) {
-        severity = SV_DIR_CHANGE;
-        return NULL;
-
-    } else if(lineText.StartsWith("====")) {
-        severity = SV_NONE;
-        return NULL;
-
-    } else {
-
-        // Find *warnings* first
-        bool isWarning = false;
-
-        if(!m_cmp) {
-            severity = SV_NONE;
-            return NULL;
-        }
-
-        CmpPatterns cmpPatterns;
-        if(!DoGetCompilerPatterns(m_cmp->GetName(), cmpPatterns)) {
-            severity = SV_NONE;
-            return NULL;
-        }
-
-        // If it is not an error, maybe it's a warning
-        for(size_t i = 0; i < cmpPatterns.warningPatterns.size(); i++) {
-            CmpPatternPtr cmpPatterPtr = cmpPatterns.warningPatterns.at(i);
-            BuildLineInfo bli;
-            if(cmpPatterPtr->Matches(lineText, bli)) {
-                severity = SV_WARNING;
-                return cmpPatterPtr;
-            }
-        }
-        if(!isWarning) {
-            for(size_t i = 0; i < cmpPatterns.errorsPatterns.size(); i++) {
-                BuildLineInfo bli;
-                CmpPatternPtr cmpPatterPtr = cmpPatterns.errorsPatterns.at(i);
-                if(cmpPatterPtr->Matches(lineText, bli)) {
-                    severity = SV_ERROR;
-                    return cmpPatterPtr;
-                }
-            }
-        }
-    }
-
-    // Default
-    severity = SV_NONE;
-    return NULL;
-}
-
 void NewBuildTab::OnIdle(wxIdleEvent& event)
 {
     if(m_view->IsEmpty()) { return; }
     ColourOutput();
 }
 
-////////////////////////////////////////////
-// CmpPatter
-
-bool CmpPattern::Matches(const wxString& line, BuildLineInfo& lineInfo)
-{
-    long fidx, lidx;
-    if(!m_fileIndex.ToLong(&fidx) || !m_lineIndex.ToLong(&lidx)) return false;
-
-    if(!m_regex || !m_regex->IsValid()) return false;
-    if(!m_regex->Matches(line)) return false;
-
-    long colIndex;
-    if(!m_colIndex.ToLong(&colIndex)) return false;
-
-    lineInfo.SetSeverity(m_severity);
-    if(m_regex->GetMatchCount() > (size_t)fidx) { lineInfo.SetFilename(m_regex->GetMatch(line, fidx)); }
-
-    // keep the match length
-    lineInfo.SetRegexLineMatch(m_regex->GetMatch(line, 0).length());
-
-    if(m_regex->GetMatchCount() > (size_t)lidx) {
-        long lineNumber;
-        wxString strLine = m_regex->GetMatch(line, lidx);
-        strLine.ToLong(&lineNumber);
-        lineInfo.SetLineNumber(--lineNumber);
-    }
-
-    if(m_regex->GetMatchCount() > (size_t)colIndex) {
-        long column;
-        wxString strCol = m_regex->GetMatch(line, colIndex);
-        if(strCol.StartsWith(":")) { strCol.Remove(0, 1); }
-
-        if(!strCol.IsEmpty() && strCol.ToLong(&column)) { lineInfo.SetColumn(column); }
-    }
-    return true;
-}
-
 void BuildLineInfo::NormalizeFilename(const wxArrayString& directories, const wxString& cygwinPath)
 {
     wxFileName fn(this->GetFilename());
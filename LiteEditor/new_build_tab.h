@@ -32,6 +32,7 @@
 #include <wx/fdrepdlg.h>
 #include <wx/dataview.h>
 #include <wx/stopwatch.h>
+#include <wx/timer.h>
 #include <wx/panel.h> // Base class: wxPanel
 #include "buildtabsettingsdata.h"
 #include "compiler.h"
@@ -93,69 +94,18 @@ public:
     int GetLineInBuildTab() const { return m_lineInBuildTab; }
 };
 
-/////////////////////////////////////////////////////////////////
-
-class CmpPattern
-{
-protected:
-    wxRegEx* m_regex;
-    wxString m_fileIndex;
-    wxString m_lineIndex;
-    wxString m_colIndex;
-    LINE_SEVERITY m_severity;
-
-public:
-    CmpPattern(wxRegEx* re, const wxString& file, const wxString& line, const wxString& column, LINE_SEVERITY severity)
-        : m_regex(re)
-        , m_fileIndex(file)
-        , m_lineIndex(line)
-        , m_colIndex(column)
-        , m_severity(severity)
-    {
-    }
-
-    ~CmpPattern() { wxDELETE(m_regex); }
-
-    /**
-     * @brief return true if "line" matches this pattern
-     * @param lineInfo [output]
-     */
-    bool Matches(const wxString& line, BuildLineInfo& lineInfo);
-
-    void SetFileIndex(const wxString& fileIndex) { this->m_fileIndex = fileIndex; }
-    void SetLineIndex(const wxString& lineIndex) { this->m_lineIndex = lineIndex; }
-    void SetRegex(wxRegEx* regex) { this->m_regex = regex; }
-    void SetSeverity(LINE_SEVERITY severity) { this->m_severity = severity; }
-    const wxString& GetFileIndex() const { return m_fileIndex; }
-    const wxString& GetLineIndex() const { return m_lineIndex; }
-    void SetColIndex(const wxString& colIndex) { this->m_colIndex = colIndex; }
-    const wxString& GetColIndex() const { return m_colIndex; }
-    wxRegEx* GetRegex() { return m_regex; }
-    LINE_SEVERITY GetSeverity() const { return m_severity; }
-};
-typedef SmartPtr<CmpPattern> CmpPatternPtr;
-
-//////////////////////////////////////////////////////////////////
-
-struct CmpPatterns {
-    std::vector<CmpPatternPtr> errorsPatterns;
-    std::vector<CmpPatternPtr> warningPatterns;
-};
-
 ///////////////////////////////////////////////////////////////////
 class clEditor;
+class BuildOutputParserThread;
 class NewBuildTab : public wxPanel
 {
     enum BuildpaneScrollTo { ScrollToFirstError, ScrollToFirstItem, ScrollToEnd };
 
-    typedef std::map<wxString, CmpPatterns> MapCmpPatterns_t;
     typedef std::multimap<wxString, BuildLineInfo*> MultimapBuildInfo_t;
     typedef std::list<BuildLineInfo*> BuildInfoList_t;
 
-    wxString m_output;
     wxStyledTextCtrl* m_view;
     CompilerPtr m_cmp;
-    MapCmpPatterns_t m_cmpPatterns;
     int m_warnCount;
     int m_errorCount;
     BuildTabSettingsData m_buildTabSettings;
@@ -164,7 +114,6 @@ class NewBuildTab : public wxPanel
     BuildTabSettingsData::ShowBuildPane m_showMe;
     wxStopWatch m_sw;
     MultimapBuildInfo_t m_buildInfoPerFile;
-    wxArrayString m_directories;
     bool m_skipWarnings;
     BuildpaneScrollTo m_buildpaneScrollTo;
     BuildInfoList_t m_errorsAndWarningsList;
@@ -173,17 +122,22 @@ class NewBuildTab : public wxPanel
     bool m_buildInProgress;
     wxString m_cygwinRoot;
     std::map<int, BuildLineInfo*> m_viewData;
-    int m_maxlineWidth;
     int m_lastLineColoured;
+    BuildOutputParserThread* m_parser;
+    int m_generation;
+    bool m_buildEndPending;
+    wxTimer* m_flushTimer;
+    wxStopWatch m_flushStopWatch;
 
 protected:
     void InitView(const wxString& theme = "");
     void CenterLineInView(int line);
-    void DoCacheRegexes();
-    BuildLineInfo* DoProcessLine(const wxString& line);
-    void DoProcessOutput(bool compilationEnded, bool isSummaryLine);
-    void DoSearchForDirectory(const wxString& line);
-    bool DoGetCompilerPatterns(const wxString& compilerName, CmpPatterns& patterns);
+    void DoStartParser();
+    void DoQueueOutput(const wxString& text);
+    void DoFlushOutput();
+    void DoAddLineInfo(BuildLineInfo* buildLineInfo, int lineInBuildTab);
+    void DoAppendInfoLine(const wxString& text);
+    void DoBuildEnded();
     void DoClear();
     void MarkEditor(clEditor* editor);
     void DoToggleWindow();
@@ -191,7 +145,6 @@ protected:
     wxFont DoGetFont() const;
     void DoCentreErrorLine(BuildLineInfo* bli, clEditor* editor, bool centerLine);
     void ColourOutput();
-    CmpPatternPtr GetMatchingRegex(const wxString& lineText, LINE_SEVERITY& severity);
 
 public:
     NewBuildTab(wxWindow* parent);
@@ -210,6 +163,11 @@ public:
     wxString GetBuildContent() const;
     void AppendLine(const wxString& text);
 
+    /**
+     * @brief called (with CallAfter) by the output parser once the last line of the build 'generation' is published
+     */
+    void OnParserBuildEnded(int generation);
+
 protected:
     void OnThemeChanged(wxCommandEvent& event);
     void OnBuildStarted(clCommandEvent& e);
@@ -227,6 +185,8 @@ protected:
     void OnStyleNeeded(wxStyledTextEvent& event);
     void OnHotspotClicked(wxStyledTextEvent& event);
     void OnIdle(wxIdleEvent& event);
+    void OnBuildOutputParsed(clCommandEvent& event);
+    void OnFlushTimer(wxTimerEvent& event);
 };
 
 #endif // NEWBUILDTAB_H
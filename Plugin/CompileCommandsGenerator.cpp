@@ -1,99 +1,245 @@
 #include "CompileCommandsGenerator.h"
-#include "processreaderthread.h"
 #include "file_logger.h"
 #include "event_notifier.h"
 #include "workspace.h"
 #include "globals.h"
 #include "environmentconfig.h"
+#include "build_settings_config.h"
+#include "macromanager.h"
+#include "fileextmanager.h"
 #include "imanager.h"
-#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 #include <macros.h>
-#include "clFilesCollector.h"
 #include "fileutils.h"
 #include "JSON.h"
-#include "clcommandlineparser.h"
-#include "compiler_command_line_parser.h"
 #include "CompileFlagsTxt.h"
 #include "CompileCommandsJSON.h"
-#include "wxmd5.h"
 
 wxDEFINE_EVENT(wxEVT_COMPILE_COMMANDS_JSON_GENERATED, clCommandEvent);
 
-CompileCommandsGenerator::CompileCommandsGenerator()
+CompileCommandsGenerator::CompileCommandsGenerator() {}
+
+CompileCommandsGenerator::~CompileCommandsGenerator() { DoJoinThread(); }
+
+void CompileCommandsGenerator::MarkProjectDirty(const wxString& projectName) { m_dirtyProjects.insert(projectName); }
+
+void CompileCommandsGenerator::MarkAllDirty()
+{
+    m_allDirty = true;
+    m_dirtyProjects.clear();
+    // the environment or the compilers might have changed as well
+    m_compilersGlobalPaths.clear();
+    m_compilersGlobalPathsOk = false;
+    // whatever the worker thread is computing is now outdated
+    ++m_generation;
+}
+
+void CompileCommandsGenerator::DoJoinThread()
+{
+    if(m_thread) {
+        m_thread->join();
+        wxDELETE(m_thread);
+    }
+}
+
+void CompileCommandsGenerator::DoGeneratePending()
+{
+    if(m_generatePending) { GenerateCompileCommands(); }
+}
+
+void CompileCommandsGenerator::ThreadQueryCompilers(CompileCommandsGenerator* owner,
+                                                    std::vector<CompilerPtr> compilers, size_t generation)
+{
+    // Querying the compilers for their search paths is expensive (it runs the compilers)
+    wxStringMap_t compilersGlobalPaths;
+    for(CompilerPtr compiler : compilers) {
+        wxArrayString pathsArr = compiler->GetDefaultIncludePaths();
+        wxString paths;
+        std::for_each(pathsArr.begin(), pathsArr.end(), [&](wxString& path) {
+            path.Trim().Trim(false);
+            if(path.EndsWith("\\")) { path.RemoveLast(); }
+            paths << path << ";";
+        });
+        compilersGlobalPaths.insert({ compiler->GetName(), paths });
+    }
+    owner->CallAfter(&CompileCommandsGenerator::CompilersQueried, compilersGlobalPaths, generation);
+}
+
+void CompileCommandsGenerator::CompilersQueried(const wxStringMap_t& compilersGlobalPaths, size_t generation)
+{
+    DoJoinThread();
+    if(generation == m_generation) {
+        m_compilersGlobalPaths = compilersGlobalPaths;
+        m_compilersGlobalPathsOk = true;
+    }
+    // Now that the compilers are known, generate the projects entries
+    GenerateCompileCommands();
+}
+
+void CompileCommandsGenerator::ThreadGenerateProjects(CompileCommandsGenerator* owner, JobVec_t jobs,
+                                                      size_t generation)
+{
+    EntriesMap_t projects;
+    for(const ProjectJob& job : jobs) {
+        ProjectEntries& projectEntries = projects[job.name];
+
+        wxFileName compileFlagsFile(job.directory, "compile_flags.txt");
+        if(!FileUtils::WriteFileContent(compileFlagsFile, job.compileFlags)) {
+            clWARNING() << "Failed to write file:" << compileFlagsFile;
+        }
+
+        JSON json(cJSON_Array);
+        JSONItem arr = json.toElement();
+        for(const wxString& fullpath : job.files) {
+            wxString compilePattern;
+            FileExtManager::FileType fileType = FileExtManager::GetType(fullpath);
+            if(fileType == FileExtManager::TypeSourceC) {
+                compilePattern = job.cFilePattern;
+            } else if(fileType == FileExtManager::TypeSourceCpp) {
+                compilePattern = job.cxxFilePattern;
+            }
+            if(compilePattern.IsEmpty()) { continue; }
+
+            wxString file_name = fullpath;
+            if(file_name.Contains(" ")) { file_name.Prepend("\"").Append("\""); }
+            compilePattern.Replace("$FileName", file_name);
+
+            JSONItem item = JSONItem::createObject();
+            item.addProperty("file", fullpath);
+            item.addProperty("directory", job.directory);
+            item.addProperty("command", compilePattern);
+            arr.append(item);
+        }
+
+        int count = arr.arraySize();
+        for(int i = 0; i < count; ++i) {
+            if(i > 0) { projectEntries.entries << ",\n"; }
+            projectEntries.entries << arr.arrayItem(i).format();
+        }
+
+        CompileFlagsTxt compileFlags(compileFlagsFile);
+        projectEntries.includes = compileFlags.GetIncludes();
+    }
+    owner->CallAfter(&CompileCommandsGenerator::ProjectsGenerated, projects, generation);
+}
+
+void CompileCommandsGenerator::ProjectsGenerated(const EntriesMap_t& projects, size_t generation)
+{
+    DoJoinThread();
+    if(generation == m_generation) {
+        // Merge the new entries into the cache
+        for(const auto& vt : projects) {
+            m_projects[vt.first] = vt.second;
+        }
+        DoPatchProjects();
+    }
+    DoGeneratePending();
+}
+
+void CompileCommandsGenerator::ThreadImportCompileCommands(CompileCommandsGenerator* owner,
+                                                           wxFileName compileCommandsFile, size_t generation)
 {
-    Bind(wxEVT_ASYNC_PROCESS_TERMINATED, &CompileCommandsGenerator::OnProcessTeraminated, this);
+    JSON root(clCxxWorkspace::ImportCompileCommandsJSON(compileCommandsFile));
+    wxString content = root.isOk() ? root.toElement().format() : wxString();
+    owner->CallAfter(&CompileCommandsGenerator::CompileCommandsImported, content, generation);
 }
 
-CompileCommandsGenerator::~CompileCommandsGenerator()
+void CompileCommandsGenerator::CompileCommandsImported(const wxString& content, size_t generation)
 {
-    // If the child process is still running, detach from it. i.e. OnProcessTeraminated() event is not called
-    Unbind(wxEVT_ASYNC_PROCESS_TERMINATED, &CompileCommandsGenerator::OnProcessTeraminated, this);
-    if(m_process) { m_process->Detach(); }
-    wxDELETE(m_process);
+    DoJoinThread();
+    if(generation == m_generation && !content.IsEmpty()) {
+        if(!m_outputFile.FileExists() || content != m_content) {
+            m_content = content;
+            DoWriteFile(m_content, wxArrayString(), true);
+        }
+    }
+    DoGeneratePending();
 }
 
-typedef wxString CheckSum_t;
-static CheckSum_t ComputeFileCheckSum(const wxFileName& fn) { return wxMD5::GetDigest(fn); }
+bool CompileCommandsGenerator::DoCreateJob(const wxString& projectName, ProjectJob& job)
+{
+    ProjectPtr project = clCxxWorkspaceST::Get()->GetProject(projectName);
+    CHECK_PTR_RET_FALSE(project);
 
-void CompileCommandsGenerator::OnProcessTeraminated(clProcessEvent& event)
+    BuildConfigPtr buildConf = project->GetBuildConfiguration();
+    if(!buildConf || !buildConf->IsProjectEnabled() || buildConf->IsCustomBuild() ||
+       !buildConf->IsCompilerRequired()) {
+        return false;
+    }
+
+    job.name = projectName;
+    job.directory = project->GetFileName().GetPath();
+    job.cFilePattern = project->GetCompileLineForCXXFile(m_compilersGlobalPaths, buildConf, "$FileName", false);
+    job.cxxFilePattern = project->GetCompileLineForCXXFile(m_compilersGlobalPaths, buildConf, "$FileName", true);
+    job.compileFlags = project->GetCompileFlagsContent(m_compilersGlobalPaths);
+    project->GetFilesAsStringArray(job.files);
+    return true;
+}
+
+void CompileCommandsGenerator::DoPatchProjects()
 {
-    // dont call event.Skip() so we will delete the m_process ourself
-    wxDELETE(m_process);
-    clGetManager()->SetStatusMessage(_("Ready"));
+    wxArrayString projects;
+    clCxxWorkspaceST::Get()->GetProjectList(projects);
 
-    static std::unordered_map<wxString, CheckSum_t> m_checksumCache;
+    // Patch the projects entries together, in the workspace order
+    wxString content = "[\n";
+    wxArrayString includePaths;
+    wxStringSet_t includeSet;
+    bool first = true;
+    for(const wxString& projectName : projects) {
+        EntriesMap_t::const_iterator iter = m_projects.find(projectName);
+        if(iter == m_projects.end()) { continue; }
+        const ProjectEntries& projectEntries = iter->second;
+        if(!projectEntries.entries.IsEmpty()) {
+            if(!first) { content << ",\n"; }
+            content << projectEntries.entries;
+            first = false;
+        }
+        for(const wxString& path : projectEntries.includes) {
+            if(includeSet.insert(path).second) { includePaths.Add(path); }
+        }
+    }
+    content << "\n]\n";
+
+    if(m_outputFile.FileExists() && content == m_content) { return; }
+    m_content.swap(content);
+    DoWriteFile(m_content, includePaths, false);
+}
+
+void CompileCommandsGenerator::DoWriteFile(const wxString& content, const wxArrayString& includePaths,
+                                           bool collectIncludes)
+{
+    // Requests are served in order: a thread that was overtaken by a newer request does nothing
+    static std::mutex writeLock;
+    static std::atomic<size_t> lastRequest(0);
+    size_t request = ++lastRequest;
 
-    // Process the compile_flags.txt files starting from the "compile_commands.json" root folder
-    // Notify about completion
     std::thread thr(
         [=](const wxString& compile_commands) {
-            // Calculate the new file checksum
-            CheckSum_t ck = ComputeFileCheckSum(compile_commands);
-            CheckSum_t oldCk;
-            clDEBUG() << "New checksum is:" << ck;
-            if(m_checksumCache.count(compile_commands)) {
-                oldCk = m_checksumCache.find(compile_commands)->second;
-            } else {
-                clDEBUG() << "File:" << compile_commands << "is not found in the cache";
-            }
-            clDEBUG() << "Old checksum is:" << oldCk;
-            if(ck == oldCk) {
-                clDEBUG() << "No changes detected in file:" << compile_commands << "processing is ignored";
-                return;
-            }
+            std::lock_guard<std::mutex> locker(writeLock);
+            if(request != lastRequest) { return; }
 
-            // store the new checksum
-            m_checksumCache.erase(compile_commands);
-            m_checksumCache.insert({ compile_commands, ck });
-
-            clFilesScanner scanner;
-            wxArrayString includePaths;
-            wxStringSet_t includeSet;
-            std::vector<wxString> files;
-            if(scanner.Scan(wxFileName(compile_commands).GetPath(), files, "compile_flags.txt")) {
-                for(const wxString& file : files) {
-                    CompileFlagsTxt f(file);
-                    includePaths = f.GetIncludes();
-                    includeSet.insert(includePaths.begin(), includePaths.end());
-                }
+            if(!FileUtils::WriteFileContent(compile_commands, content)) {
+                clWARNING() << "Failed to write file:" << compile_commands;
+                return;
             }
 
-            CompileCommandsJSON compileCommands(compile_commands);
-            const wxArrayString& paths = compileCommands.GetIncludes();
-            for(const wxString& path : paths) {
-                if(includeSet.count(path) == 0) {
-                    includeSet.insert(path);
-                    includePaths.Add(path);
+            wxArrayString paths = includePaths;
+            if(collectIncludes) {
+                wxStringSet_t includeSet(paths.begin(), paths.end());
+                CompileCommandsJSON compileCommands(compile_commands);
+                for(const wxString& path : compileCommands.GetIncludes()) {
+                    if(includeSet.insert(path).second) { paths.Add(path); }
                 }
             }
-
-            clDEBUG() << "wxEVT_COMPILE_COMMANDS_JSON_GENERATED paths:\n" << includePaths;
+            clDEBUG() << "wxEVT_COMPILE_COMMANDS_JSON_GENERATED paths:\n" << paths;
 
             // Notify about it
             clCommandEvent eventCompileCommandsGenerated(wxEVT_COMPILE_COMMANDS_JSON_GENERATED);
             eventCompileCommandsGenerated.SetFileName(compile_commands); // compile_commands.json
-            eventCompileCommandsGenerated.SetStrings(
-                includePaths); // include paths found and gathered from all the compile_flags.txt files scanned
+            eventCompileCommandsGenerated.SetStrings(paths); // include paths gathered from the compile_flags.txt files
             EventNotifier::Get()->AddPendingEvent(eventCompileCommandsGenerated);
         },
         m_outputFile.GetFullPath());
@@ -102,50 +248,107 @@ void CompileCommandsGenerator::OnProcessTeraminated(clProcessEvent& event)
 
 void CompileCommandsGenerator::GenerateCompileCommands()
 {
-    // Kill any previous process running
-    if(m_process) { m_process->Detach(); }
-    wxDELETE(m_process);
-
-    wxFileName codeliteMake(clStandardPaths::Get().GetBinFolder(), "codelite-make");
-#ifdef __WXMSW__
-    codeliteMake.SetExt("exe");
-#endif
-
-    if(!clCxxWorkspaceST::Get()->IsOpen()) { return; }
-    if(!clCxxWorkspaceST::Get()->GetActiveProject()) { return; }
-
-    if(!codeliteMake.FileExists()) {
-        clWARNING() << "Could not find" << codeliteMake;
+    if(m_thread) {
+        // The worker thread is busy, this request is served once it is done
+        m_generatePending = true;
         return;
     }
+    m_generatePending = false;
 
-    wxString command;
-    command << codeliteMake.GetFullPath();
-    ::WrapWithQuotes(command);
+    clCxxWorkspace* workspace = clCxxWorkspaceST::Get();
+    if(!workspace->IsOpen()) { return; }
+    ProjectPtr activeProject = workspace->GetActiveProject();
+    if(!activeProject) { return; }
 
-    wxString workspaceFile = clCxxWorkspaceST::Get()->GetFileName().GetFullPath();
-    ::WrapWithQuotes(workspaceFile);
+    wxFileName outputFile(workspace->GetFileName().GetPath(), "compile_commands.json");
+    if(outputFile != m_outputFile) {
+        // a different workspace
+        m_outputFile = outputFile;
+        m_projects.clear();
+        m_content.Clear();
+        MarkAllDirty();
+    }
+    bool fileExists = m_outputFile.FileExists();
 
-    wxString configName =
-        clCxxWorkspaceST::Get()->GetSelectedConfig() ? clCxxWorkspaceST::Get()->GetSelectedConfig()->GetName() : "";
-    command << " --workspace=" << workspaceFile << " --verbose --json --config=" << configName;
+    EnvSetter env(activeProject);
+    BuildConfigPtr buildConf = activeProject->GetBuildConfiguration();
+    if(buildConf && buildConf->IsCustomBuild()) {
+        // The active project uses custom build: the workspace uses the compile_commands.json file generated by the
+        // build system, which can change on every build. Import it every time
+        wxString buildWorkingDirectory = MacroManager::Instance()->Expand(
+            buildConf->GetCustomBuildWorkingDir(), NULL, activeProject->GetName(), buildConf->GetName());
+        wxFileName compileCommandsFile(buildWorkingDirectory, "compile_commands.json");
+        if(compileCommandsFile.FileExists()) {
+            // the per-project entries are no longer reflected by m_content
+            m_allDirty = true;
+            m_thread = new std::thread(&CompileCommandsGenerator::ThreadImportCompileCommands, this,
+                                       compileCommandsFile, m_generation);
+            return;
+        }
+        // No such file: use the entries of the projects that are not using custom build
+    }
 
-    // since we might be activated with a different settings directory
-    // pass the build_settings.xml to codelite-make
+    wxArrayString projects;
+    workspace->GetProjectList(projects);
+    wxStringSet_t projectsSet(projects.begin(), projects.end());
 
-    wxFileName xmlFile(clStandardPaths::Get().GetUserDataDir(), "build_settings.xml");
-    xmlFile.AppendDir("config");
-    wxString xmlPath = xmlFile.GetFullPath();
-    ::WrapWithQuotes(xmlPath);
-    command << " --settings=" << xmlPath;
+    // Drop the projects that were removed from the workspace
+    bool modified = false;
+    for(auto iter = m_projects.begin(); iter != m_projects.end();) {
+        if(projectsSet.count(iter->first) == 0) {
+            iter = m_projects.erase(iter);
+            modified = true;
+        } else {
+            ++iter;
+        }
+    }
 
-    clDEBUG() << "Executing:" << command;
+    // Regenerate the modified (or new) projects only
+    wxArrayString dirtyProjects;
+    for(const wxString& projectName : projects) {
+        if(m_allDirty || m_dirtyProjects.count(projectName) || m_projects.count(projectName) == 0) {
+            dirtyProjects.Add(projectName);
+        }
+    }
 
-    EnvSetter env(clCxxWorkspaceST::Get()->GetActiveProject());
-    m_process = ::CreateAsyncProcess(this, command, IProcessCreateDefault);
+    if(!dirtyProjects.IsEmpty() && !m_compilersGlobalPathsOk) {
+        // The compilation lines need the compilers search paths: query the compilers first, in the background. The
+        // worker thread gets its own copies of the compilers
+        std::vector<CompilerPtr> compilers;
+        wxArrayString compilersNames = BuildSettingsConfigST::Get()->GetAllCompilersNames();
+        for(const wxString& name : compilersNames) {
+            CompilerPtr compiler = BuildSettingsConfigST::Get()->GetCompiler(name);
+            wxXmlNode* node = compiler->ToXml();
+            compilers.push_back(new Compiler(node));
+            wxDELETE(node);
+        }
+        m_thread = new std::thread(&CompileCommandsGenerator::ThreadQueryCompilers, this, compilers, m_generation);
+        return;
+    }
+
+    // Collect the projects settings here, the entries themselves are built by the worker thread
+    JobVec_t jobs;
+    for(const wxString& projectName : dirtyProjects) {
+        clDEBUG() << "Generating compile_commands.json entries for project:" << projectName;
+        ProjectJob job;
+        if(DoCreateJob(projectName, job)) {
+            jobs.push_back(job);
+        } else {
+            m_projects[projectName] = ProjectEntries();
+        }
+        modified = true;
+    }
+    m_allDirty = false;
+    m_dirtyProjects.clear();
 
-    m_outputFile = workspaceFile;
-    m_outputFile.SetFullName("compile_commands.json");
+    if(!jobs.empty()) {
+        m_thread = new std::thread(&CompileCommandsGenerator::ThreadGenerateProjects, this, jobs, m_generation);
+        return;
+    }
 
-    clGetManager()->SetStatusMessage(wxString() << _("Generating ") << m_outputFile.GetFullPath(), 2);
+    if(!modified && fileExists) {
+        clDEBUG() << "No changes detected in file:" << m_outputFile << "processing is ignored";
+        return;
+    }
+    DoPatchProjects();
 }
@@ -2,28 +2,96 @@
 #define COMPILECOMMANDSGENERATOR_H
 
 #include <wx/event.h>
-#include "asyncprocess.h"
 #include "cl_command_event.h"
 #include <wx/filename.h>
-#include <wx/process.h>
 #include "codelite_exports.h"
+#include "compiler.h"
 #include <macros.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_SDK, wxEVT_COMPILE_COMMANDS_JSON_GENERATED, clCommandEvent);
 
+/**
+ * @class CompileCommandsGenerator
+ * @brief generate the workspace compile_commands.json file.
+ * The entries are generated in-process, per project, and cached. Only the projects that were marked as modified
+ * (see MarkProjectDirty() / MarkAllDirty()) are regenerated. The compilers are queried and the entries are built by a
+ * worker thread, the main thread only collects the projects settings and merges the results into the cache
+ */
 class WXDLLIMPEXP_SDK CompileCommandsGenerator : public wxEvtHandler
 {
-    IProcess* m_process = nullptr;
+public:
+    struct ProjectEntries {
+        wxString entries;       // the project's JSON entries, without the enclosing array
+        wxArrayString includes; // the include paths found in the project's compile_flags.txt
+    };
+    typedef std::unordered_map<wxString, ProjectEntries> EntriesMap_t;
+
+    /// Everything the worker thread needs to generate a project's entries. Collected on the main thread since the
+    /// compilation lines depend on the environment and on the macros
+    struct ProjectJob {
+        wxString name;
+        wxString directory;      // the project folder, used as the compilation working directory
+        wxString cFilePattern;   // the compilation line of a C file, "$FileName" stands for the file
+        wxString cxxFilePattern; // the compilation line of a C++ file
+        wxString compileFlags;   // the compile_flags.txt content
+        wxArrayString files;
+    };
+    typedef std::vector<ProjectJob> JobVec_t;
+
+protected:
+    EntriesMap_t m_projects;
+    wxStringSet_t m_dirtyProjects;
+    bool m_allDirty = true;
+    wxStringMap_t m_compilersGlobalPaths;
+    bool m_compilersGlobalPathsOk = false;
+    wxString m_content;
     wxFileName m_outputFile;
-    
+    std::thread* m_thread = nullptr;
+    bool m_generatePending = false;
+    size_t m_generation = 0; // incremented by MarkAllDirty(), results of an older generation are dropped
+
 protected:
-    void OnProcessTeraminated(clProcessEvent& event);
+    static void ThreadQueryCompilers(CompileCommandsGenerator* owner, std::vector<CompilerPtr> compilers,
+                                     size_t generation);
+    static void ThreadGenerateProjects(CompileCommandsGenerator* owner, JobVec_t jobs, size_t generation);
+    static void ThreadImportCompileCommands(CompileCommandsGenerator* owner, wxFileName compileCommandsFile,
+                                            size_t generation);
+
+    void CompilersQueried(const wxStringMap_t& compilersGlobalPaths, size_t generation);
+    void ProjectsGenerated(const EntriesMap_t& projects, size_t generation);
+    void CompileCommandsImported(const wxString& content, size_t generation);
+
+    void DoJoinThread();
+    void DoGeneratePending();
+    bool DoCreateJob(const wxString& projectName, ProjectJob& job);
+    void DoPatchProjects();
+    void DoWriteFile(const wxString& content, const wxArrayString& includePaths, bool collectIncludes);
 
 public:
     typedef wxSharedPtr<CompileCommandsGenerator> Ptr_t;
     CompileCommandsGenerator();
     virtual ~CompileCommandsGenerator();
 
+    /**
+     * @brief the project's files or settings were modified, regenerate its entries on the next call to
+     * GenerateCompileCommands()
+     */
+    void MarkProjectDirty(const wxString& projectName);
+
+    /**
+     * @brief regenerate everything on the next call to GenerateCompileCommands() (workspace loaded, environment or
+     * compilers modified...)
+     */
+    void MarkAllDirty();
+
+    /**
+     * @brief update compile_commands.json. Does nothing if none of the projects was modified since the last call and
+     * the file exists. The work is done in the background, a call made while the worker thread is busy is served once
+     * it completes
+     */
     void GenerateCompileCommands();
 };
 
@@ -1,6 +1,5 @@
 #include "GotoAnythingDlg.h"
 #include "bitmap_loader.h"
-#include "clAnagram.h"
 #include "clKeyboardManager.h"
 #include "cl_config.h"
 #include "codelite_events.h"
@@ -17,6 +16,12 @@ GotoAnythingDlg::GotoAnythingDlg(wxWindow* parent, const std::vector<clGotoEntry
     : GotoAnythingBaseDlg(parent)
     , m_allEntries(entries)
 {
+    // Matches in the action name (the last part of "Menu > Sub Menu > Action") rank first
+    m_index.Reserve(m_allEntries.size());
+    for(const clGotoEntry& entry : m_allEntries) {
+        wxString name = entry.GetDesc().AfterLast('>');
+        m_index.Add(entry.GetDesc(), name.Trim(false));
+    }
     DoPopulate(m_allEntries);
     CallAfter(&GotoAnythingDlg::UpdateLastSearch);
     WindowAttrManager::Load(this);
@@ -106,16 +111,14 @@ void GotoAnythingDlg::ApplyFilter()
         DoPopulate(m_allEntries);
     } else {
 
-        // Filter the list
-        clAnagram anagram(filter);
+        // Filter the list, best match first
+        clFuzzyIndex::Vec_t matches;
+        m_index.Query(filter, m_allEntries.size(), matches);
         std::vector<clGotoEntry> matchedEntries;
         std::vector<int> matchedEntriesIndex;
-        for(size_t i = 0; i < m_allEntries.size(); ++i) {
-            const clGotoEntry& entry = m_allEntries[i];
-            if(anagram.MatchesInOrder(entry.GetDesc())) {
-                matchedEntries.push_back(entry);
-                matchedEntriesIndex.push_back(i);
-            }
+        for(const clFuzzyIndex::Match& match : matches) {
+            matchedEntries.push_back(m_allEntries[match.index]);
+            matchedEntriesIndex.push_back(match.index);
         }
 
         // And populate the list
@@ -2,6 +2,7 @@
 #define GOTOANYTHINGDLG_H
 
 #include "GotoAnythingBaseUI.h"
+#include "clFuzzyIndex.h"
 #include "clGotoAnythingManager.h"
 #include "codelite_exports.h"
 #include <vector>
@@ -20,6 +21,7 @@
 class WXDLLIMPEXP_SDK GotoAnythingDlg : public GotoAnythingBaseDlg
 {
     const std::vector<clGotoEntry>& m_allEntries;
+    clFuzzyIndex m_index;
     wxString m_currentFilter;
 
 protected:
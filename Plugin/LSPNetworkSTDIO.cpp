@@ -6,6 +6,7 @@
 #include "ChildProcess.h"
 #include "processreaderthread.h"
 #include "dirsaver.h"
+#include "fileutils.h"
 
 LSPNetworkSTDIO::LSPNetworkSTDIO() {}
 
@@ -58,6 +59,8 @@ void LSPNetworkSTDIO::OnProcessOutput(clProcessEvent& event)
     const wxString& dataRead = event.GetOutput();
     clCommandEvent evt(wxEVT_LSP_NET_DATA_READY);
     evt.SetString(dataRead);
+    // The protocol needs the bytes as they were sent by the server
+    evt.SetStringRaw(event.GetStringRaw().empty() ? FileUtils::ToStdString(dataRead) : event.GetStringRaw());
     AddPendingEvent(evt);
 }
 
@@ -1,6 +1,7 @@
 #include "LSPNetworkSocketClient.h"
 #include "file_logger.h"
 #include "dirsaver.h"
+#include "fileutils.h"
 
 LSPNetworkSocketClient::LSPNetworkSocketClient() {}
 
@@ -106,5 +107,6 @@ void LSPNetworkSocketClient::OnSocketData(clCommandEvent& event)
     const wxString& dataRead = event.GetString();
     clCommandEvent evt(wxEVT_LSP_NET_DATA_READY);
     evt.SetString(dataRead);
+    evt.SetStringRaw(event.GetStringRaw().empty() ? FileUtils::ToStdString(dataRead) : event.GetStringRaw());
     AddPendingEvent(evt);
 }
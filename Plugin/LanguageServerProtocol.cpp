@@ -29,6 +29,35 @@
 #include "LSP/Request.h"
 #include "LSPNetworkSocketClient.h"
 #include "LSP/SignatureHelpRequest.h"
+#include "LSP/CancelRequest.h"
+#include <algorithm>
+
+// The maximum number of requests sent to the server that are still waiting for a reply. When reached, new requests
+// are kept in the queue (ordered by their priority) until replies arrive
+static const size_t MAX_PENDING_REQUESTS = 8;
+// A request that the server did not reply to within this time (in seconds) is given up on
+static const time_t PENDING_REPLY_TIMEOUT = 30;
+
+// Above this number of recorded edits, sending the full document is cheaper
+static const size_t MAX_PENDING_CHANGES = 1000;
+
+// TextDocumentSyncKind.Incremental
+static const int kTextDocumentSyncIncremental = 2;
+
+/**
+ * @brief convert a Scintilla position into an LSP position. LSP columns are counted in UTF-16 code units
+ */
+static LSP::Position GetDocumentPosition(wxStyledTextCtrl* ctrl, int pos)
+{
+    int line = ctrl->LineFromPosition(pos);
+    wxString prefix = ctrl->GetTextRange(ctrl->PositionFromLine(line), pos);
+    int character = 0;
+    for(wxString::const_iterator iter = prefix.begin(); iter != prefix.end(); ++iter) {
+        // characters outside of the BMP take a surrogate pair
+        character += ((wxUint32)(*iter).GetValue() > 0xFFFF) ? 2 : 1;
+    }
+    return LSP::Position(line, character);
+}
 
 LanguageServerProtocol::LanguageServerProtocol(const wxString& name, eNetworkType netType, wxEvtHandler* owner)
     : ServiceProvider(wxString() << "LSP: " << name, eServiceType::kCodeCompletion)
@@ -124,6 +153,16 @@ std::set<wxString> LanguageServerProtocol::GetSupportedLanguages()
 void LanguageServerProtocol::QueueMessage(LSP::MessageWithParams::Ptr_t request)
 {
     if(!IsInitialized()) { return; }
+
+    // A new position dependant request (e.g. code completion) makes the older requests of the same kind stale: the
+    // user already moved on, so there is no point in waiting for their responses
+    LSP::Request* req = request->As<LSP::Request>();
+    if(req && req->IsPositionDependantRequest()) {
+        std::vector<int> staleRequests = m_Queue.TakeStaleRequests(req);
+        for(int requestId : staleRequests) {
+            SendCancelRequest(requestId);
+        }
+    }
     m_Queue.Push(request);
     ProcessQueue();
 }
@@ -171,8 +210,12 @@ void LanguageServerProtocol::Start()
 
 void LanguageServerProtocol::DoClear()
 {
-    m_filesSent.clear();
-    m_outputBuffer.clear();
+    for(auto& vt : m_documents) {
+        DoUntrackDocument(vt.second);
+    }
+    m_documents.clear();
+    m_incrementalSync = false;
+    m_reader.Clear();
     m_state = kUnInitialized;
     m_initializeRequestID = wxNOT_FOUND;
     m_Queue.Clear();
@@ -271,14 +314,8 @@ void LanguageServerProtocol::FindDefinition(IEditor* editor)
     CHECK_PTR_RET(editor);
     CHECK_COND_RET(ShouldHandleFile(editor));
 
-    // If the editor is modified, we need to tell the LSP to reparse the source file
-    const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    // Send the changes made to the editor before asking the server about it
+    DoSyncEditor(editor);
 
     LSP::GotoDefinitionRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::GotoDefinitionRequest(
         editor->GetFileName(), editor->GetCurrentLine(), editor->GetCtrl()->GetColumn(editor->GetCurrentPosition())));
@@ -292,11 +329,16 @@ void LanguageServerProtocol::SendOpenRequest(const wxFileName& filename, const w
         LSP::MessageWithParams::MakeRequest(new LSP::DidOpenTextDocumentRequest(filename, fileContent, languageId));
     req->SetStatusMessage(wxString() << GetLogPrefix() << " parsing file: " << filename.GetFullName());
     QueueMessage(req);
+
+    // The document is sent with version 1
+    DoUntrackDocument(m_documents[filename.GetFullPath()]);
+    m_documents[filename.GetFullPath()] = DocumentState();
 }
 
 void LanguageServerProtocol::SendCloseRequest(const wxFileName& filename)
 {
-    if(m_filesSent.count(filename.GetFullPath()) == 0) {
+    auto iter = m_documents.find(filename.GetFullPath());
+    if(iter == m_documents.end()) {
         clDEBUG() << GetLogPrefix() << "LanguageServerProtocol::FileClosed(): file" << filename << "is not opened";
         return;
     }
@@ -304,25 +346,83 @@ void LanguageServerProtocol::SendCloseRequest(const wxFileName& filename)
     LSP::DidCloseTextDocumentRequest::Ptr_t req =
         LSP::MessageWithParams::MakeRequest(new LSP::DidCloseTextDocumentRequest(filename));
     QueueMessage(req);
-    m_filesSent.erase(filename.GetFullPath());
+    DoUntrackDocument(iter->second);
+    m_documents.erase(iter);
 }
 
 void LanguageServerProtocol::SendChangeRequest(const wxFileName& filename, const wxString& fileContent)
 {
-    LSP::DidChangeTextDocumentRequest::Ptr_t req =
-        LSP::MessageWithParams::MakeRequest(new LSP::DidChangeTextDocumentRequest(filename, fileContent));
+    auto iter = m_documents.find(filename.GetFullPath());
+    if(iter == m_documents.end()) { return; }
+
+    // A full sync replaces whatever was recorded so far
+    DocumentState& doc = iter->second;
+    doc.changes.clear();
+    doc.fullSync = false;
+    LSP::DidChangeTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+        new LSP::DidChangeTextDocumentRequest(filename, fileContent, ++doc.version));
     req->SetStatusMessage(wxString() << GetLogPrefix() << " re-parsing file: " << filename.GetFullName());
     QueueMessage(req);
 }
 
-void LanguageServerProtocol::SendSaveRequest(const wxFileName& filename, const wxString& fileContent)
+void LanguageServerProtocol::DoSyncEditor(IEditor* editor)
 {
-    // LSP::DidSaveTextDocumentRequest req(filename, fileContent);
-    // req.Send(this);
-    // clGetManager()->SetStatusMessage(wxString() << "[LSP] re-parsing file: " << filename.GetFullName(), 1);
+    if(!IsInitialized()) { return; }
+    const wxFileName& filename = editor->GetFileName();
+    auto iter = m_documents.find(filename.GetFullPath());
+    if(iter == m_documents.end()) {
+        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
+        DoTrackEditor(editor);
+        return;
+    }
+
+    DocumentState& doc = iter->second;
+    wxStyledTextCtrl* ctrl = editor->GetCtrl();
+    if(doc.ctrl.get() != ctrl) {
+        // We did not record the modifications made to this document: send it over and start tracking its editor
+        doc.fullSync = true;
+        DoTrackEditor(editor);
+
+    } else if(!doc.fullSync && doc.length != ctrl->GetLength()) {
+        // The recorded changes do not add up to the editor content, we missed a modification somewhere
+        clDEBUG() << GetLogPrefix() << "document" << filename.GetFullName()
+                  << "is out of sync with the server. Sending its full content";
+        doc.fullSync = true;
+    }
 
-    // For now: report a change event
-    SendChangeRequest(filename, fileContent);
+    if(doc.fullSync) {
+        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
+        doc.length = ctrl->GetLength();
+
+    } else if(!doc.changes.empty()) {
+        std::vector<LSP::TextDocumentContentChangeEvent> changes;
+        changes.swap(doc.changes);
+        LSP::DidChangeTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+            new LSP::DidChangeTextDocumentRequest(filename, changes, ++doc.version));
+        QueueMessage(req);
+    }
+}
+
+void LanguageServerProtocol::DoTrackEditor(IEditor* editor)
+{
+    auto iter = m_documents.find(editor->GetFileName().GetFullPath());
+    if(iter == m_documents.end()) { return; }
+
+    DocumentState& doc = iter->second;
+    wxStyledTextCtrl* ctrl = editor->GetCtrl();
+    if(doc.ctrl.get() != ctrl) {
+        DoUntrackDocument(doc);
+        doc.ctrl = ctrl;
+        ctrl->Bind(wxEVT_STC_MODIFIED, &LanguageServerProtocol::OnEditorModified, this);
+    }
+    doc.length = ctrl->GetLength();
+}
+
+void LanguageServerProtocol::DoUntrackDocument(DocumentState& doc)
+{
+    // the editor might be gone already, in which case the weak reference is null
+    if(doc.ctrl) { doc.ctrl->Unbind(wxEVT_STC_MODIFIED, &LanguageServerProtocol::OnEditorModified, this); }
+    doc.ctrl = nullptr;
 }
 
 void LanguageServerProtocol::SendCodeCompleteRequest(const wxFileName& filename, size_t line, size_t column)
@@ -353,9 +453,45 @@ void LanguageServerProtocol::OnFileClosed(clCommandEvent& event)
 void LanguageServerProtocol::OnFileSaved(clCommandEvent& event)
 {
     event.Skip();
-    // For now, it does the same as 'OnFileLoaded'
+    // The server already has the content of the document, all we need is to send the latest changes
     IEditor* editor = clGetManager()->GetActiveEditor();
-    if(editor && ShouldHandleFile(editor)) { SendSaveRequest(editor->GetFileName(), editor->GetCtrl()->GetText()); }
+    if(editor && ShouldHandleFile(editor)) { DoSyncEditor(editor); }
+}
+
+void LanguageServerProtocol::OnEditorModified(wxStyledTextEvent& event)
+{
+    event.Skip();
+    bool isInsert = event.GetModificationType() & wxSTC_MOD_INSERTTEXT;
+    bool isDelete = event.GetModificationType() & wxSTC_MOD_BEFOREDELETE;
+    if(!isInsert && !isDelete) { return; }
+
+    wxStyledTextCtrl* ctrl = dynamic_cast<wxStyledTextCtrl*>(event.GetEventObject());
+    for(auto& vt : m_documents) {
+        DocumentState& doc = vt.second;
+        if(!ctrl || doc.ctrl.get() != ctrl) { continue; }
+        if(doc.fullSync) { break; }
+
+        if(!m_incrementalSync || doc.changes.size() >= MAX_PENDING_CHANGES) {
+            // the server wants the full content anyway (or that would be cheaper than sending the edits)
+            doc.changes.clear();
+            doc.fullSync = true;
+            break;
+        }
+
+        // Deletions are recorded before they take place, so both ends of the range are positions in the document
+        // that the server knows about
+        LSP::Position start = GetDocumentPosition(ctrl, event.GetPosition());
+        LSP::TextDocumentContentChangeEvent change;
+        if(isInsert) {
+            change.SetRange(LSP::Range(start, start)).SetText(event.GetText());
+            doc.length += event.GetLength();
+        } else {
+            change.SetRange(LSP::Range(start, GetDocumentPosition(ctrl, event.GetPosition() + event.GetLength())));
+            doc.length -= event.GetLength();
+        }
+        doc.changes.push_back(change);
+        break;
+    }
 }
 
 wxString LanguageServerProtocol::GetLogPrefix() const { return wxString() << "[" << GetName() << "] "; }
@@ -364,13 +500,14 @@ void LanguageServerProtocol::OpenEditor(IEditor* editor)
 {
     if(!IsInitialized()) { return; }
     if(editor && ShouldHandleFile(editor)) {
-        if(m_filesSent.count(editor->GetFileName().GetFullPath())) {
+        auto iter = m_documents.find(editor->GetFileName().GetFullPath());
+        if(iter != m_documents.end()) {
             clDEBUG() << "OpenEditor->SendChangeRequest called for:" << editor->GetFileName().GetFullName();
-            SendChangeRequest(editor->GetFileName(), editor->GetCtrl()->GetText());
+            iter->second.fullSync = true;
         } else {
             clDEBUG() << "OpenEditor->SendOpenRequest called for:" << editor->GetFileName().GetFullName();
-            SendOpenRequest(editor->GetFileName(), editor->GetCtrl()->GetText(), GetLanguageId(editor->GetFileName()));
         }
+        DoSyncEditor(editor);
     }
 }
 
@@ -379,14 +516,9 @@ void LanguageServerProtocol::FunctionHelp(IEditor* editor)
     // sanity
     CHECK_PTR_RET(editor);
     CHECK_COND_RET(ShouldHandleFile(editor));
-    // If the editor is modified, we need to tell the LSP to reparse the source file
+    // Send the changes made to the editor before asking the server about it
     const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    DoSyncEditor(editor);
 
     if(ShouldHandleFile(filename)) {
         LSP::SignatureHelpRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::SignatureHelpRequest(
@@ -401,14 +533,8 @@ void LanguageServerProtocol::CodeComplete(IEditor* editor)
     CHECK_PTR_RET(editor);
     CHECK_COND_RET(ShouldHandleFile(editor));
 
-    // If the editor is modified, we need to tell the LSP to reparse the source file
-    const wxFileName& filename = editor->GetFileName();
-    if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-        // we already sent this file over, ask for change parse
-        SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-    } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-        SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-    }
+    // Send the changes made to the editor before asking the server about it
+    DoSyncEditor(editor);
     // Now request the for code completion
     SendCodeCompleteRequest(editor->GetFileName(), editor->GetCurrentLine(),
                             editor->GetCtrl()->GetColumn(editor->GetCurrentPosition()));
@@ -416,22 +542,41 @@ void LanguageServerProtocol::CodeComplete(IEditor* editor)
 
 void LanguageServerProtocol::ProcessQueue()
 {
-    if(m_Queue.IsEmpty()) { return; }
-    if(m_Queue.IsWaitingReponse()) {
-        clDEBUG() << "LSP is busy, will not send message";
-        return;
+    // Pipeline the messages: keep sending until the queue is empty or until there are too many requests waiting
+    // for a reply. Requests queued before a notification are not held back: the notification can not overtake them
+    // and it must not wait for the server replies
+    // Requests that the server never replied to must not hold back the queue forever
+    std::vector<int> expiredRequests = m_Queue.TakeExpiredRequests(PENDING_REPLY_TIMEOUT);
+    for(int requestId : expiredRequests) {
+        clDEBUG() << GetLogPrefix() << "request:" << requestId << "timed out";
+        SendCancelRequest(requestId);
     }
-    LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
-    if(!IsRunning()) {
-        clDEBUG() << GetLogPrefix() << "is down.";
-        return;
+
+    while(!m_Queue.IsEmpty()) {
+        if(!IsRunning()) {
+            clDEBUG() << GetLogPrefix() << "is down.";
+            return;
+        }
+
+        LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
+        if(req->As<LSP::Request>() && m_Queue.GetPendingReplyCount() >= MAX_PENDING_REQUESTS &&
+           !m_Queue.HasNotifications()) {
+            clDEBUG1() << GetLogPrefix() << "too many requests are waiting for a reply, will send message later";
+            return;
+        }
+
+        m_network->Send(req->ToString());
+        m_Queue.Pop();
+        if(!req->GetStatusMessage().IsEmpty()) { clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1); }
     }
+}
 
-    // Write the message length as string of 10 bytes
-    m_network->Send(req->ToString());
-    m_Queue.SetWaitingReponse(true);
-    m_Queue.Pop();
-    if(!req->GetStatusMessage().IsEmpty()) { clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1); }
+void LanguageServerProtocol::SendCancelRequest(int requestId)
+{
+    if(!IsRunning()) { return; }
+    clDEBUG1() << GetLogPrefix() << "cancelling stale request:" << requestId;
+    LSP::CancelRequest cancelRequest(requestId);
+    m_network->Send(cancelRequest.ToString());
 }
 
 void LanguageServerProtocol::CloseEditor(IEditor* editor)
@@ -450,14 +595,8 @@ void LanguageServerProtocol::FindDeclaration(IEditor* editor)
         CHECK_PTR_RET(editor);
         CHECK_COND_RET(ShouldHandleFile(editor));
 
-        // If the editor is modified, we need to tell the LSP to reparse the source file
-        const wxFileName& filename = editor->GetFileName();
-        if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-            // we already sent this file over, ask for change parse
-            SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-        } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-            SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-        }
+        // Send the changes made to the editor before asking the server about it
+        DoSyncEditor(editor);
 
         LSP::GotoDeclarationRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
             new LSP::GotoDeclarationRequest(editor->GetFileName(), editor->GetCurrentLine(),
@@ -468,7 +607,9 @@ void LanguageServerProtocol::FindDeclaration(IEditor* editor)
 
 void LanguageServerProtocol::OnNetConnected(clCommandEvent& event)
 {
-    // The process started successfully
+    // The process started successfully. Requests sent to a previous instance of the server will never be replied to
+    m_Queue.ClearPendingReplies();
+
     // Send the 'initialize' request
     LSP::InitializeRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::InitializeRequest());
     req->As<LSP::InitializeRequest>()->SetRootUri(m_rootFolder);
@@ -493,19 +634,22 @@ void LanguageServerProtocol::OnNetError(clCommandEvent& event)
 
 void LanguageServerProtocol::OnNetDataReady(clCommandEvent& event)
 {
-    clDEBUG() << GetLogPrefix() << event.GetString();
-    wxString buffer = std::move(event.GetString());
-    m_outputBuffer << buffer;
-    m_Queue.SetWaitingReponse(false);
+    clDEBUG1() << GetLogPrefix() << "received" << event.GetStringRaw().length() << "bytes";
+    m_reader.Append(event.GetStringRaw());
 
-    while(true) {
-        // Did we get a complete message?
-        LSP::ResponseMessage res(m_outputBuffer);
+    // Process all the complete messages
+    wxSharedPtr<JSON> json;
+    while(m_reader.Next(json)) {
+        LSP::ResponseMessage res(json);
         if(res.IsOk()) {
             if(IsInitialized()) {
                 LSP::MessageWithParams::Ptr_t msg_ptr = m_Queue.TakePendingReplyMessage(res.GetId());
                 // Is this an error message?
-                if(res.Has("error")) {
+                if(res.Has("error") && !msg_ptr) {
+                    // the reply of a request that we cancelled
+                    clDEBUG1() << GetLogPrefix() << "ignoring the error response of request:" << res.GetId();
+
+                } else if(res.Has("error")) {
                     clDEBUG() << GetLogPrefix() << "received an error message";
                     LSP::ResponseError errMsg(res.GetMessageString());
                     switch(errMsg.GetErrorCode()) {
@@ -577,6 +721,15 @@ void LanguageServerProtocol::OnNetDataReady(clCommandEvent& event)
                 // we only accept initialization responses here
                 if(res.GetId() == m_initializeRequestID) {
                     clDEBUG() << GetLogPrefix() << "initialization completed";
+                    m_Queue.TakePendingReplyMessage(res.GetId());
+
+                    // The server capabilities: 'textDocumentSync' is either a TextDocumentSyncKind or an object
+                    JSONItem capabilities = res.Get("result").namedObject("capabilities");
+                    JSONItem textDocumentSync = capabilities.namedObject("textDocumentSync");
+                    int syncKind = textDocumentSync.isNumber() ? textDocumentSync.toInt()
+                                                               : textDocumentSync.namedObject("change").toInt();
+                    m_incrementalSync = (syncKind == kTextDocumentSyncIncremental);
+                    clDEBUG() << GetLogPrefix() << "incremental document sync:" << (m_incrementalSync ? "yes" : "no");
                     m_initializeRequestID = wxNOT_FOUND;
                     m_state = kInitialized;
 
@@ -588,10 +741,7 @@ void LanguageServerProtocol::OnNetDataReady(clCommandEvent& event)
                     clDEBUG() << GetLogPrefix() << "Server not initialized. This message is ignored";
                 }
             }
-            // A message was consumed from the buffer, see if we got more messages
-            if(!m_outputBuffer.empty()) { continue; }
         }
-        break;
     }
     ProcessQueue();
 }
@@ -619,14 +769,8 @@ void LanguageServerProtocol::FindImplementation(IEditor* editor)
         CHECK_PTR_RET(editor);
         CHECK_COND_RET(ShouldHandleFile(editor));
 
-        // If the editor is modified, we need to tell the LSP to reparse the source file
-        const wxFileName& filename = editor->GetFileName();
-        if(m_filesSent.count(filename.GetFullPath()) && editor->IsModified()) {
-            // we already sent this file over, ask for change parse
-            SendChangeRequest(filename, editor->GetTextRange(0, editor->GetLength()));
-        } else if(m_filesSent.count(filename.GetFullPath()) == 0) {
-            SendOpenRequest(filename, editor->GetTextRange(0, editor->GetLength()), GetLanguageId(filename));
-        }
+        // Send the changes made to the editor before asking the server about it
+        DoSyncEditor(editor);
 
         LSP::GotoImplementationRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
             new LSP::GotoImplementationRequest(editor->GetFileName(), editor->GetCurrentLine(),
@@ -639,41 +783,120 @@ void LanguageServerProtocol::FindImplementation(IEditor* editor)
 // LSPRequestMessageQueue
 //===------------------------------------------------------------------
 
-void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message)
+int LSPRequestMessageQueue::GetPriority(LSP::MessageWithParams::Ptr_t message)
 {
-    m_Queue.push(message);
-
-    // Messages of type 'Request' require responses from the server
     LSP::Request* req = message->As<LSP::Request>();
-    if(req) { m_pendingReplyMessages.insert({ req->GetId(), message }); }
+    // Notifications are never reordered
+    return req ? (int)req->GetPriority() : 0;
+}
+
+void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message)
+{
+    bool notification = (message->As<LSP::Request>() == nullptr);
+    if(m_Queue.empty() || m_Queue.back().notifications != notification) {
+        m_Queue.push_back(Batch());
+        m_Queue.back().notifications = notification;
+    }
+    m_Queue.back().messages[GetPriority(message)].push_back(message);
 }
 
 void LSPRequestMessageQueue::Pop()
 {
-    if(!m_Queue.empty()) { m_Queue.pop(); }
-    SetWaitingReponse(false);
+    if(m_Queue.empty()) { return; }
+    PriorityQueue_t& messages = m_Queue.front().messages;
+    auto iter = messages.begin();
+    LSP::MessageWithParams::Ptr_t message = iter->second.front();
+    iter->second.pop_front();
+    if(iter->second.empty()) { messages.erase(iter); }
+    if(messages.empty()) { m_Queue.pop_front(); }
+
+    // Messages of type 'Request' require responses from the server
+    LSP::Request* req = message->As<LSP::Request>();
+    if(req) {
+        PendingReply pendingReply;
+        pendingReply.message = message;
+        pendingReply.sentTime = time(nullptr);
+        m_pendingReplyMessages.insert({ req->GetId(), pendingReply });
+    }
 }
 
 LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::Get()
 {
     if(m_Queue.empty()) { return LSP::MessageWithParams::Ptr_t(nullptr); }
-    return m_Queue.front();
+    return m_Queue.front().messages.begin()->second.front();
+}
+
+bool LSPRequestMessageQueue::HasNotifications() const
+{
+    return std::any_of(m_Queue.begin(), m_Queue.end(), [](const Batch& batch) { return batch.notifications; });
 }
 
 void LSPRequestMessageQueue::Clear()
 {
-    while(!m_Queue.empty()) {
-        m_Queue.pop();
-    }
-    SetWaitingReponse(false);
+    m_Queue.clear();
     m_pendingReplyMessages.clear();
 }
 
+std::vector<int> LSPRequestMessageQueue::TakeStaleRequests(const LSP::Request* request)
+{
+    const wxString& method = request->GetMethod();
+    auto isStale = [&](LSP::MessageWithParams::Ptr_t message) {
+        LSP::Request* req = message->As<LSP::Request>();
+        return req && req != request && req->GetMethod() == method;
+    };
+
+    // Requests that were not sent yet
+    for(auto batchIter = m_Queue.begin(); batchIter != m_Queue.end();) {
+        PriorityQueue_t& batch = batchIter->messages;
+        for(auto iter = batch.begin(); iter != batch.end();) {
+            std::deque<LSP::MessageWithParams::Ptr_t>& messages = iter->second;
+            messages.erase(std::remove_if(messages.begin(), messages.end(), isStale), messages.end());
+            if(messages.empty()) {
+                iter = batch.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        if(batch.empty()) {
+            batchIter = m_Queue.erase(batchIter);
+        } else {
+            ++batchIter;
+        }
+    }
+
+    // Requests that are waiting for a reply. Forget about them, their replies will be ignored
+    std::vector<int> staleRequests;
+    for(auto iter = m_pendingReplyMessages.begin(); iter != m_pendingReplyMessages.end();) {
+        if(isStale(iter->second.message)) {
+            staleRequests.push_back(iter->first);
+            iter = m_pendingReplyMessages.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    return staleRequests;
+}
+
 LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::TakePendingReplyMessage(int msgid)
 {
     if(m_pendingReplyMessages.empty()) { return LSP::MessageWithParams::Ptr_t(nullptr); }
     if(m_pendingReplyMessages.count(msgid) == 0) { return LSP::MessageWithParams::Ptr_t(nullptr); }
-    LSP::MessageWithParams::Ptr_t msgptr = m_pendingReplyMessages[msgid];
+    LSP::MessageWithParams::Ptr_t msgptr = m_pendingReplyMessages[msgid].message;
     m_pendingReplyMessages.erase(msgid);
     return msgptr;
 }
+
+std::vector<int> LSPRequestMessageQueue::TakeExpiredRequests(time_t timeoutSeconds)
+{
+    std::vector<int> expiredRequests;
+    time_t now = time(nullptr);
+    for(auto iter = m_pendingReplyMessages.begin(); iter != m_pendingReplyMessages.end();) {
+        if((now - iter->second.sentTime) > timeoutSeconds) {
+            expiredRequests.push_back(iter->first);
+            iter = m_pendingReplyMessages.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    return expiredRequests;
+}
@@ -8,21 +8,49 @@
 #include <wx/sharedptr.h>
 #include "macros.h"
 #include <map>
-#include <queue>
+#include <deque>
+#include <functional>
 #include <string>
 #include "LSP/MessageWithParams.h"
+#include "LSP/Request.h"
+#include "LSP/basic_types.h"
+#include "LSP/MessageReader.h"
 #include <unordered_map>
+#include <vector>
+#include <ctime>
 #include "SocketAPI/clSocketClientAsync.h"
 #include "LSPNetwork.h"
 #include <wx/filename.h>
+#include <wx/stc/stc.h>
+#include <wx/weakref.h>
 #include "ServiceProvider.h"
 
 class IEditor;
 class WXDLLIMPEXP_SDK LSPRequestMessageQueue
 {
-    std::queue<LSP::MessageWithParams::Ptr_t> m_Queue;
-    std::unordered_map<int, LSP::MessageWithParams::Ptr_t> m_pendingReplyMessages;
-    bool m_waitingReponse = false;
+    typedef std::map<int, std::deque<LSP::MessageWithParams::Ptr_t>, std::greater<int> > PriorityQueue_t;
+
+    // A run of consecutive requests or of consecutive notifications
+    struct Batch {
+        bool notifications = false;
+        PriorityQueue_t messages;
+    };
+
+    // Outgoing messages. A notification changes the document state seen by the server, so no message is ever moved
+    // across a notification: the queue is a list of batches, sent in FIFO order. Within a batch, the requests are
+    // ordered by priority (highest first), requests with the same priority are kept in FIFO order
+    std::deque<Batch> m_Queue;
+    // A request that was sent to the server and is waiting for a reply
+    struct PendingReply {
+        LSP::MessageWithParams::Ptr_t message;
+        time_t sentTime = 0;
+    };
+
+    // Requests that were sent to the server and are waiting for a reply, keyed by the request ID
+    std::unordered_map<int, PendingReply> m_pendingReplyMessages;
+
+protected:
+    static int GetPriority(LSP::MessageWithParams::Ptr_t message);
 
 public:
     LSPRequestMessageQueue() {}
@@ -30,12 +58,39 @@ public:
 
     LSP::MessageWithParams::Ptr_t TakePendingReplyMessage(int msgid);
     void Push(LSP::MessageWithParams::Ptr_t message);
+    /**
+     * @brief remove the next message from the queue. If the message is a request, it is moved to the pending replies
+     * table
+     */
     void Pop();
+    /**
+     * @brief return the next message to send (the oldest message with the highest priority)
+     */
     LSP::MessageWithParams::Ptr_t Get();
     void Clear();
+    /**
+     * @brief forget about all the requests that are waiting for a reply
+     */
+    void ClearPendingReplies() { m_pendingReplyMessages.clear(); }
     bool IsEmpty() const { return m_Queue.empty(); }
-    void SetWaitingReponse(bool waitingReponse) { this->m_waitingReponse = waitingReponse; }
-    bool IsWaitingReponse() const { return m_waitingReponse; }
+    /**
+     * @brief return true if a notification is waiting to be sent
+     */
+    bool HasNotifications() const;
+    size_t GetPendingReplyCount() const { return m_pendingReplyMessages.size(); }
+
+    /**
+     * @brief drop all the requests that were made stale by 'request' (older requests of the same method).
+     * Requests that were not sent yet are simply removed from the queue
+     * @return the IDs of the stale requests that were already sent to the server and should be cancelled
+     */
+    std::vector<int> TakeStaleRequests(const LSP::Request* request);
+
+    /**
+     * @brief drop the requests that are waiting for a reply for more than 'timeoutSeconds'
+     * @return the IDs of the expired requests
+     */
+    std::vector<int> TakeExpiredRequests(time_t timeoutSeconds);
 };
 
 class WXDLLIMPEXP_SDK LanguageServerProtocol : public ServiceProvider
@@ -45,14 +100,25 @@ class WXDLLIMPEXP_SDK LanguageServerProtocol : public ServiceProvider
         kInitialized,
     };
 
+    // A document that was sent to the server. Edits made to it are recorded from its editor's modification events
+    // so only the changed ranges are sent to the server (incremental sync)
+    struct DocumentState {
+        wxWeakRef<wxStyledTextCtrl> ctrl;
+        int version = 1;
+        int length = 0; // the document length (in bytes) as known by the server after applying 'changes'
+        bool fullSync = false; // the changes are unknown, the next sync should send the entire document
+        std::vector<LSP::TextDocumentContentChangeEvent> changes;
+    };
+
     wxString m_name;
     wxEvtHandler* m_owner = nullptr;
     LSPNetwork::Ptr_t m_network;
     wxArrayString m_lspCommand;
     wxString m_workingDirectory;
-    wxStringSet_t m_filesSent;
+    std::unordered_map<wxString, DocumentState> m_documents;
+    bool m_incrementalSync = false;
     wxStringSet_t m_languages;
-    wxString m_outputBuffer;
+    LSP::MessageReader m_reader;
     wxString m_rootFolder;
     wxString m_connectionString;
 
@@ -82,6 +148,7 @@ protected:
     void OnFindSymbolImpl(clCodeCompletionEvent& event);
     void OnFindSymbol(clCodeCompletionEvent& event);
     void OnFunctionCallTip(clCodeCompletionEvent& event);
+    void OnEditorModified(wxStyledTextEvent& event);
 
 protected:
     void DoClear();
@@ -89,6 +156,7 @@ protected:
     bool ShouldHandleFile(IEditor* editor) const;
     wxString GetLogPrefix() const;
     void ProcessQueue();
+    void SendCancelRequest(int requestId);
     static wxString GetLanguageId(const wxFileName& fn) { return GetLanguageId(fn.GetFullName()); }
     static wxString GetLanguageId(const wxString& fn);
 
@@ -109,9 +177,17 @@ protected:
     void SendChangeRequest(const wxFileName& filename, const wxString& fileContent);
 
     /**
-     * @brief report a file-save notification
+     * @brief make sure that the server sees the current content of the editor: open the document or send the
+     * changes made to it since the last sync. The entire document is sent only when the recorded changes can not be
+     * trusted
+     */
+    void DoSyncEditor(IEditor* editor);
+
+    /**
+     * @brief start recording the modifications made to the editor's document
      */
-    void SendSaveRequest(const wxFileName& filename, const wxString& fileContent);
+    void DoTrackEditor(IEditor* editor);
+    void DoUntrackDocument(DocumentState& doc);
 
     /**
      * @brief request for a code completion at a given doc/position
@@ -0,0 +1,119 @@
+#include "clCompilerOutputMatcher.h"
+
+clCompilerOutputMatcher::clCompilerOutputMatcher()
+    : m_useFilter(false)
+{
+}
+
+clCompilerOutputMatcher::~clCompilerOutputMatcher() {}
+
+void clCompilerOutputMatcher::Clear()
+{
+    m_patterns.clear();
+    m_filter = clRegexDFA();
+    m_useFilter = false;
+}
+
+void clCompilerOutputMatcher::Compile(CompilerPtr compiler)
+{
+    if(!compiler) {
+        Clear();
+        return;
+    }
+    Compile(compiler->GetErrPatterns(), compiler->GetWarnPatterns());
+}
+
+void clCompilerOutputMatcher::Compile(const Compiler::CmpListInfoPattern& errorPatterns,
+                                      const Compiler::CmpListInfoPattern& warningPatterns)
+{
+    Clear();
+
+    wxString combined;
+    DoAddPatterns(warningPatterns, kWarning, combined);
+    DoAddPatterns(errorPatterns, kError, combined);
+    if(m_patterns.empty()) { return; }
+
+    // A pattern that the automaton does not support disables the filter: every line is matched against the patterns
+    m_useFilter = m_filter.Compile(combined, wxRE_ADVANCED | wxRE_ICASE) && !m_filter.MatchesEmpty();
+}
+
+void clCompilerOutputMatcher::DoAddPatterns(const Compiler::CmpListInfoPattern& patterns, eSeverity severity,
+                                            wxString& combined)
+{
+    Compiler::CmpListInfoPattern::const_iterator iter = patterns.begin();
+    for(; iter != patterns.end(); ++iter) {
+        Pattern pattern;
+        // A pattern with bad indexes never matches, don't bother keeping it
+        if(!iter->fileNameIndex.ToLong(&pattern.fileIndex) || !iter->lineNumberIndex.ToLong(&pattern.lineIndex) ||
+           !iter->columnIndex.ToLong(&pattern.columnIndex)) {
+            continue;
+        }
+
+        pattern.regex.reset(new wxRegEx(iter->pattern, wxRE_ADVANCED | wxRE_ICASE));
+        if(!pattern.regex->IsValid()) { continue; }
+        pattern.severity = severity;
+        m_patterns.push_back(pattern);
+
+        if(!combined.IsEmpty()) { combined << "|"; }
+        combined << "(" << iter->pattern << ")";
+    }
+}
+
+bool clCompilerOutputMatcher::DoPassFilter(const wxString& line)
+{
+    if(!m_useFilter) { return true; }
+
+    // The automaton works on UTF-8. Build output is mostly ASCII, so avoid the conversion when possible
+    m_buffer.clear();
+    m_buffer.reserve(line.length());
+    for(wxString::const_iterator iter = line.begin(); iter != line.end(); ++iter) {
+        wxUniChar ch = *iter;
+        if(!ch.IsAscii()) {
+            const wxScopedCharBuffer utf8 = line.utf8_str();
+            m_buffer.assign(utf8.data(), utf8.length());
+            break;
+        }
+        m_buffer.push_back((char)ch.GetValue());
+    }
+    return m_filter.Find(m_buffer.c_str(), m_buffer.c_str() + m_buffer.length()) != nullptr;
+}
+
+bool clCompilerOutputMatcher::DoMatch(Pattern& pattern, const wxString& line, Match& match)
+{
+    wxRegEx& re = *pattern.regex;
+    if(!re.Matches(line)) { return false; }
+
+    match.severity = pattern.severity;
+    size_t count = re.GetMatchCount();
+    if(pattern.fileIndex >= 0 && count > (size_t)pattern.fileIndex) {
+        match.filename = re.GetMatch(line, pattern.fileIndex);
+    }
+
+    // keep the match length
+    match.length = re.GetMatch(line, 0).length();
+
+    if(pattern.lineIndex >= 0 && count > (size_t)pattern.lineIndex) {
+        long lineNumber = 0;
+        re.GetMatch(line, pattern.lineIndex).ToLong(&lineNumber);
+        match.lineNumber = lineNumber - 1;
+    }
+
+    if(pattern.columnIndex >= 0 && count > (size_t)pattern.columnIndex) {
+        long column;
+        wxString strCol = re.GetMatch(line, pattern.columnIndex);
+        if(strCol.StartsWith(":")) { strCol.Remove(0, 1); }
+        if(!strCol.IsEmpty() && strCol.ToLong(&column)) { match.column = column; }
+    }
+    return true;
+}
+
+bool clCompilerOutputMatcher::Matches(const wxString& line, Match& match)
+{
+    match = Match();
+    if(m_patterns.empty() || !DoPassFilter(line)) { return false; }
+
+    for(size_t i = 0; i < m_patterns.size(); ++i) {
+        if(DoMatch(m_patterns[i], line, match)) { return true; }
+    }
+    return false;
+}
@@ -0,0 +1,95 @@
+#ifndef CLCOMPILEROUTPUTMATCHER_H
+#define CLCOMPILEROUTPUTMATCHER_H
+
+#include "clRegexDFA.h"
+#include "codelite_exports.h"
+#include "compiler.h"
+#include <string>
+#include <vector>
+#include <wx/regex.h>
+#include <wx/sharedptr.h>
+#include <wx/string.h>
+
+/**
+ * @class clCompilerOutputMatcher
+ * @brief match compiler output lines against all the error and warning patterns of a compiler.
+ * All the patterns are combined into a single automaton (clRegexDFA) that scans the line once and rejects the lines
+ * that can not match any of the patterns (compilation commands, progress messages...), which are the vast majority of
+ * the build output. Only the lines that pass this filter are matched against the patterns themselves (wxRegEx), in
+ * the usual order: warnings first, then errors
+ *
+ * This class is not thread safe, use an instance per thread
+ */
+class WXDLLIMPEXP_SDK clCompilerOutputMatcher
+{
+public:
+    enum eSeverity {
+        kNone = 0,
+        kWarning,
+        kError,
+    };
+
+    struct Match {
+        eSeverity severity;
+        wxString filename;
+        int lineNumber; // 0 based, -1 if the pattern does not capture it
+        int column;     // -1 if the pattern does not capture it
+        int length;     // the length of the text matched by the pattern
+
+        Match()
+            : severity(kNone)
+            , lineNumber(-1)
+            , column(wxNOT_FOUND)
+            , length(0)
+        {
+        }
+    };
+
+protected:
+    struct Pattern {
+        wxSharedPtr<wxRegEx> regex;
+        long fileIndex;
+        long lineIndex;
+        long columnIndex;
+        eSeverity severity;
+    };
+
+    std::vector<Pattern> m_patterns; // warnings first
+    clRegexDFA m_filter;
+    bool m_useFilter;
+    std::string m_buffer;
+
+protected:
+    void DoAddPatterns(const Compiler::CmpListInfoPattern& patterns, eSeverity severity, wxString& combined);
+    bool DoPassFilter(const wxString& line);
+    bool DoMatch(Pattern& pattern, const wxString& line, Match& match);
+
+public:
+    clCompilerOutputMatcher();
+    virtual ~clCompilerOutputMatcher();
+
+    /**
+     * @brief compile the patterns. Invalid patterns are ignored
+     */
+    void Compile(const Compiler::CmpListInfoPattern& errorPatterns, const Compiler::CmpListInfoPattern& warningPatterns);
+    void Compile(CompilerPtr compiler);
+
+    /**
+     * @brief remove all the patterns
+     */
+    void Clear();
+
+    /**
+     * @brief are there any patterns?
+     */
+    bool IsEmpty() const { return m_patterns.empty(); }
+
+    /**
+     * @brief match 'line' against the compiler patterns
+     * @param match [output]
+     * @return true if one of the patterns matched the line
+     */
+    bool Matches(const wxString& line, Match& match);
+};
+
+#endif // CLCOMPILEROUTPUTMATCHER_H
@@ -19,6 +19,7 @@
 #include <wx/log.h>
 #include <wx/menu.h>
 #include <wx/richmsgdlg.h>
+#include <wx/tokenzr.h>
 #include <wx/wupdlock.h>
 #include <wx/xrc/xmlres.h>
 #include "clToolBar.h"
@@ -53,6 +54,11 @@ clTreeCtrlPanel::clTreeCtrlPanel(wxWindow* parent)
     EventNotifier::Get()->Bind(wxEVT_ACTIVE_EDITOR_CHANGED, &clTreeCtrlPanel::OnActiveEditorChanged, this);
     EventNotifier::Get()->Bind(wxEVT_INIT_DONE, &clTreeCtrlPanel::OnInitDone, this);
     EventNotifier::Get()->Bind(wxEVT_FINDINFILES_DLG_SHOWING, &clTreeCtrlPanel::OnFindInFilesShowing, this);
+
+    m_watcher.reset(new clFileSystemWatcher());
+    m_watcher->SetOwner(this);
+    Bind(wxEVT_FILE_MODIFIED, &clTreeCtrlPanel::OnFolderContentChanged, this);
+    Bind(wxEVT_FILE_NOT_FOUND, &clTreeCtrlPanel::OnFolderContentChanged, this);
     m_defaultView = new clTreeCtrlPanelDefaultPage(this);
     GetSizer()->Add(m_defaultView, 1, wxEXPAND);
     GetTreeCtrl()->Hide();
@@ -66,6 +72,9 @@ clTreeCtrlPanel::~clTreeCtrlPanel()
     EventNotifier::Get()->Unbind(wxEVT_ACTIVE_EDITOR_CHANGED, &clTreeCtrlPanel::OnActiveEditorChanged, this);
     EventNotifier::Get()->Unbind(wxEVT_INIT_DONE, &clTreeCtrlPanel::OnInitDone, this);
     EventNotifier::Get()->Unbind(wxEVT_FINDINFILES_DLG_SHOWING, &clTreeCtrlPanel::OnFindInFilesShowing, this);
+    Unbind(wxEVT_FILE_MODIFIED, &clTreeCtrlPanel::OnFolderContentChanged, this);
+    Unbind(wxEVT_FILE_NOT_FOUND, &clTreeCtrlPanel::OnFolderContentChanged, this);
+    m_watcher->Clear();
 }
 
 void clTreeCtrlPanel::OnContextMenu(wxTreeEvent& event)
@@ -267,6 +276,10 @@ void clTreeCtrlPanel::AddFolder(const wxString& path)
     wxTreeItemId itemFolder = DoAddFolder(GetTreeCtrl()->GetRootItem(), path);
     DoExpandItem(itemFolder, false);
     ToggleView();
+#if CL_FSW_USE_INOTIFY
+    m_watcher->AddFolder(path);
+    if(!m_watcher->IsRunning()) { m_watcher->Start(); }
+#endif
 }
 
 wxTreeItemId clTreeCtrlPanel::DoAddFile(const wxTreeItemId& parent, const wxString& path)
@@ -374,6 +387,7 @@ void clTreeCtrlPanel::OnCloseFolder(wxCommandEvent& event)
     for(size_t i = 0; i < items.GetCount(); ++i) {
         DoCloseFolder(items.Item(i));
     }
+    DoWatchFolders();
 }
 
 bool clTreeCtrlPanel::IsTopLevelFolder(const wxTreeItemId& item)
@@ -801,6 +815,7 @@ void clTreeCtrlPanel::Clear()
         DoCloseFolder(item);
         item = GetTreeCtrl()->GetNextChild(GetTreeCtrl()->GetRootItem(), cookie);
     }
+    DoWatchFolders();
 }
 
 void clTreeCtrlPanel::DoCloseFolder(const wxTreeItemId& item)
@@ -875,6 +890,7 @@ void clTreeCtrlPanel::OnRefresh(wxCommandEvent& event)
         }
         GetTreeCtrl()->SortChildren(GetTreeCtrl()->GetRootItem());
         ToggleView();
+        DoWatchFolders();
     }
 }
 
@@ -1020,4 +1036,77 @@ void clTreeCtrlPanel::RefreshTree()
 
     GetTreeCtrl()->SortChildren(GetTreeCtrl()->GetRootItem());
     ToggleView();
+    DoWatchFolders();
+}
+
+void clTreeCtrlPanel::DoWatchFolders()
+{
+#if CL_FSW_USE_INOTIFY
+    m_watcher->Clear();
+    wxArrayString paths;
+    wxArrayTreeItemIds items;
+    GetTopLevelFolders(paths, items);
+    for(size_t i = 0; i < paths.size(); ++i) {
+        m_watcher->AddFolder(paths.Item(i));
+    }
+    if(!paths.IsEmpty()) { m_watcher->Start(); }
+#endif
+}
+
+bool clTreeCtrlPanel::IsFolderPopulated(const wxTreeItemId& item) const
+{
+    if(!m_treeCtrl->ItemHasChildren(item)) { return true; }
+    wxTreeItemIdValue cookie;
+    clTreeCtrlData* cd = GetItemData(m_treeCtrl->GetFirstChild(item, cookie));
+    return !(cd && cd->IsDummy());
+}
+
+void clTreeCtrlPanel::OnFolderContentChanged(clFileSystemEvent& event)
+{
+    // Only the files and folders that were created or deleted outside of CodeLite change the view. Folders that were
+    // not expanded yet are read from the disk when they are expanded
+    wxArrayString topFolders;
+    wxArrayTreeItemIds topFoldersItems;
+    GetTopLevelFolders(topFolders, topFoldersItems);
+
+    for(size_t i = 0; i < topFolders.size(); ++i) {
+        wxString relativePath;
+        if(!event.GetPath().StartsWith(topFolders.Item(i) + wxFILE_SEP_PATH, &relativePath)) { continue; }
+
+        // Walk down to the item of the changed path
+        wxString path = topFolders.Item(i);
+        wxTreeItemId item = topFoldersItems.Item(i);
+        wxArrayString parts = ::wxStringTokenize(relativePath, wxString(wxFILE_SEP_PATH), wxTOKEN_STRTOK);
+        for(size_t j = 0; j < parts.size(); ++j) {
+            clTreeCtrlData* d = GetItemData(item);
+            if(!d || !d->IsFolder() || !d->GetIndex() || !IsFolderPopulated(item)) { return; }
+
+            path << wxFILE_SEP_PATH << parts.Item(j);
+            // with kShowRootFullPath, the folders are indexed by their full path
+            wxTreeItemId child = d->GetIndex()->Find(parts.Item(j));
+            if(!child.IsOk() && (m_options & kShowRootFullPath)) { child = d->GetIndex()->Find(path); }
+
+            bool exists = wxFileName::Exists(path);
+            if(child.IsOk() && !exists) {
+                UpdateItemDeleted(child);
+                GetTreeCtrl()->Delete(child);
+                return;
+
+            } else if(!child.IsOk()) {
+                if(!exists) { return; }
+                bool isFolder = wxFileName::DirExists(path);
+                if(!(m_options & (isFolder ? kShowHiddenFolders : kShowHiddenFiles)) && FileUtils::IsHidden(path)) {
+                    return;
+                }
+                if(isFolder) {
+                    DoAddFolder(item, path);
+                } else {
+                    DoAddFile(item, path);
+                }
+                return;
+            }
+            item = child;
+        }
+        return;
+    }
 }
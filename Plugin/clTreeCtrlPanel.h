@@ -27,6 +27,7 @@
 #define CLTREECTRLPANEL_H
 
 #include "bitmap_loader.h"
+#include "clFileSystemWatcher.h"
 #include "clFileViwerTreeCtrl.h"
 #include "cl_command_event.h"
 #include "cl_config.h"
@@ -48,6 +49,7 @@ protected:
     size_t m_newfileTemplateHighlightLen;
     int m_options;
     clToolBar* m_toolbar;
+    clFileSystemWatcher::Ptr_t m_watcher; // reports the changes made to the opened folders outside of CodeLite
 
 public:
     enum {
@@ -177,5 +179,15 @@ protected:
     wxTreeItemId DoAddFolder(const wxTreeItemId& parent, const wxString& path);
     wxTreeItemId DoAddFile(const wxTreeItemId& parent, const wxString& path);
     void DoCloseFolder(const wxTreeItemId& item);
+
+    /**
+     * @brief watch the top level folders (Linux only: other platforms would have to poll every file)
+     */
+    void DoWatchFolders();
+    /**
+     * @brief was the folder content read from the disk? (i.e. the folder was expanded at least once)
+     */
+    bool IsFolderPopulated(const wxTreeItemId& item) const;
+    void OnFolderContentChanged(clFileSystemEvent& event);
 };
 #endif // CLTREECTRLPANEL_H
@@ -0,0 +1,171 @@
+#include "clWorkspaceResourceIndex.h"
+#include "codelite_events.h"
+#include "ctags_manager.h"
+#include "event_notifier.h"
+#include "file_logger.h"
+#include "macros.h"
+#include "project.h"
+#include "tags_storage_sqlite3.h"
+#include "workspace.h"
+#include <wx/filename.h>
+#include <wx/stopwatch.h>
+
+clWorkspaceResourceIndex::clWorkspaceResourceIndex()
+    : m_filesDirty(true)
+    , m_symbolsDirty(true)
+    , m_symbolsThread(NULL)
+    , m_symbolsGeneration(0)
+{
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_LOADED, &clWorkspaceResourceIndex::OnWorkspaceChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_CLOSED, &clWorkspaceResourceIndex::OnWorkspaceChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_ADDED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_REMOVED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_ADDED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_PROJ_FILE_REMOVED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_RETAGGED, &clWorkspaceResourceIndex::OnSymbolsChanged, this);
+    EventNotifier::Get()->Bind(wxEVT_CMD_RETAG_COMPLETED, &clWorkspaceResourceIndex::OnSymbolsChanged, this);
+}
+
+clWorkspaceResourceIndex::~clWorkspaceResourceIndex()
+{
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_LOADED, &clWorkspaceResourceIndex::OnWorkspaceChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_CLOSED, &clWorkspaceResourceIndex::OnWorkspaceChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_ADDED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_REMOVED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_ADDED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_PROJ_FILE_REMOVED, &clWorkspaceResourceIndex::OnFilesChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_RETAGGED, &clWorkspaceResourceIndex::OnSymbolsChanged, this);
+    EventNotifier::Get()->Unbind(wxEVT_CMD_RETAG_COMPLETED, &clWorkspaceResourceIndex::OnSymbolsChanged, this);
+    DoJoinSymbolsThread();
+}
+
+clWorkspaceResourceIndex& clWorkspaceResourceIndex::Get()
+{
+    static clWorkspaceResourceIndex index;
+    return index;
+}
+
+void clWorkspaceResourceIndex::OnWorkspaceChanged(wxCommandEvent& e)
+{
+    e.Skip();
+    // Free the memory when the workspace is closed, not on the next query
+    ++m_symbolsGeneration;
+    m_files.Clear();
+    m_symbols.Clear();
+    m_filesDirty = true;
+    m_symbolsDirty = true;
+}
+
+void clWorkspaceResourceIndex::OnFilesChanged(wxCommandEvent& e)
+{
+    e.Skip();
+    m_filesDirty = true;
+}
+
+void clWorkspaceResourceIndex::OnSymbolsChanged(wxCommandEvent& e)
+{
+    e.Skip();
+    m_symbolsDirty = true;
+    // Build the first index as soon as there are symbols so the dialog does not open with an empty one
+    if(m_symbols.IsEmpty()) { DoBuildSymbols(); }
+}
+
+void clWorkspaceResourceIndex::DoBuildFiles()
+{
+    m_filesDirty = false;
+    m_files.Clear();
+    if(!clCxxWorkspaceST::Get()->IsOpen()) { return; }
+
+    wxStopWatch sw;
+    wxArrayString projects;
+    clCxxWorkspaceST::Get()->GetProjectList(projects);
+
+    // The same file can be part of multiple projects
+    wxStringSet_t added;
+    for(size_t i = 0; i < projects.GetCount(); ++i) {
+        ProjectPtr p = clCxxWorkspaceST::Get()->GetProject(projects.Item(i));
+        if(!p) { continue; }
+        const Project::FilesMap_t& files = p->GetFiles();
+        for(const Project::FilesMap_t::value_type& vt : files) {
+            const wxString& fullpath = vt.second->GetFilename();
+            if(!added.insert(fullpath).second) { continue; }
+            m_files.Add(fullpath, wxFileName(fullpath).GetFullName());
+        }
+    }
+    clDEBUG() << "Workspace resource index:" << m_files.GetCount() << "files indexed in" << sw.Time() << "ms";
+}
+
+void clWorkspaceResourceIndex::DoBuildSymbols()
+{
+    // A change made while the worker thread is busy leaves the index dirty, it is rebuilt by the next query
+    if(m_symbolsThread) { return; }
+
+    m_symbolsDirty = false;
+    ITagsStoragePtr db = TagsManagerST::Get()->GetDatabase();
+    if(!db || !db->IsOpen()) {
+        m_symbols.Clear();
+        return;
+    }
+    m_symbolsThread = new std::thread(&clWorkspaceResourceIndex::ThreadBuildSymbols, this,
+                                      db->GetDatabaseFileName(), m_symbolsGeneration);
+}
+
+void clWorkspaceResourceIndex::ThreadBuildSymbols(clWorkspaceResourceIndex* owner, wxFileName dbfile,
+                                                  size_t generation)
+{
+    wxStopWatch sw;
+    clFuzzyIndex* symbols = new clFuzzyIndex();
+    ITagsStoragePtr db(new TagsStorageSQLite());
+    db->OpenDatabase(dbfile);
+
+    std::vector<wxString> paths;
+    db->GetAllTagsPaths(paths);
+    symbols->Reserve(paths.size());
+    for(const wxString& path : paths) {
+        // the paths are passed back to the database as literals
+        if(path.Contains("'")) { continue; }
+        symbols->Add(path, path.AfterLast(':'));
+    }
+    clDEBUG() << "Workspace resource index:" << symbols->GetCount() << "symbols indexed in" << sw.Time() << "ms";
+    owner->CallAfter(&clWorkspaceResourceIndex::SymbolsBuilt, symbols, generation);
+}
+
+void clWorkspaceResourceIndex::SymbolsBuilt(clFuzzyIndex* symbols, size_t generation)
+{
+    DoJoinSymbolsThread();
+    // Drop the result if the workspace was closed or reloaded meanwhile
+    if(generation == m_symbolsGeneration) { m_symbols.Swap(*symbols); }
+    wxDELETE(symbols);
+}
+
+void clWorkspaceResourceIndex::DoJoinSymbolsThread()
+{
+    if(m_symbolsThread) {
+        m_symbolsThread->join();
+        wxDELETE(m_symbolsThread);
+    }
+}
+
+void clWorkspaceResourceIndex::QueryFiles(const wxString& pattern, size_t maxResults, wxArrayString& files)
+{
+    if(m_filesDirty) { DoBuildFiles(); }
+
+    clFuzzyIndex::Vec_t matches;
+    m_files.Query(pattern, maxResults, matches);
+    files.Alloc(files.GetCount() + matches.size());
+    for(const clFuzzyIndex::Match& match : matches) {
+        files.Add(m_files.GetText(match.index));
+    }
+}
+
+void clWorkspaceResourceIndex::QuerySymbols(const wxString& pattern, size_t maxResults, wxArrayString& paths)
+{
+    if(m_symbolsDirty) { DoBuildSymbols(); }
+
+    clFuzzyIndex::Vec_t matches;
+    m_symbols.Query(pattern, maxResults, matches);
+    paths.Alloc(paths.GetCount() + matches.size());
+    for(const clFuzzyIndex::Match& match : matches) {
+        paths.Add(m_symbols.GetText(match.index));
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef CLWORKSPACERESOURCEINDEX_H
+#define CLWORKSPACERESOURCEINDEX_H
+
+#include "clFuzzyIndex.h"
+#include "codelite_exports.h"
+#include <wx/arrstr.h>
+#include <thread>
+#include <wx/event.h>
+#include <wx/filename.h>
+
+/**
+ * @class clWorkspaceResourceIndex
+ * @brief fuzzy search indexes over the workspace files and the symbols found in the tags database, used by the
+ * "Open Resource" dialog. The indexes are marked as stale when the workspace changes (projects / files added or
+ * removed, files retagged...) and rebuilt by the next query. The symbols index is rebuilt by a worker thread, the
+ * queries keep using the previous index until the new one is ready
+ */
+class WXDLLIMPEXP_SDK clWorkspaceResourceIndex : public wxEvtHandler
+{
+    clFuzzyIndex m_files;   // full path + file name
+    clFuzzyIndex m_symbols; // tag path (scope::name) + name
+    bool m_filesDirty;
+    bool m_symbolsDirty;
+    std::thread* m_symbolsThread;
+    size_t m_symbolsGeneration; // incremented when the workspace changes, older results are dropped
+
+    clWorkspaceResourceIndex();
+    virtual ~clWorkspaceResourceIndex();
+
+protected:
+    static void ThreadBuildSymbols(clWorkspaceResourceIndex* owner, wxFileName dbfile, size_t generation);
+    void SymbolsBuilt(clFuzzyIndex* symbols, size_t generation);
+
+    void OnWorkspaceChanged(wxCommandEvent& e);
+    void OnFilesChanged(wxCommandEvent& e);
+    void OnSymbolsChanged(wxCommandEvent& e);
+
+    void DoBuildFiles();
+    void DoBuildSymbols();
+    void DoJoinSymbolsThread();
+
+public:
+    static clWorkspaceResourceIndex& Get();
+
+    /**
+     * @brief mark the symbols index as stale (i.e. after the parser thread updated the tags database)
+     */
+    void SetSymbolsDirty() { m_symbolsDirty = true; }
+
+    /**
+     * @brief return the full path of the (at most) 'maxResults' workspace files that match 'pattern', best first
+     */
+    void QueryFiles(const wxString& pattern, size_t maxResults, wxArrayString& files);
+
+    /**
+     * @brief return the path (scope::name) of the (at most) 'maxResults' symbols that match 'pattern', best first
+     */
+    void QuerySymbols(const wxString& pattern, size_t maxResults, wxArrayString& paths);
+};
+
+#endif // CLWORKSPACERESOURCEINDEX_H
@@ -0,0 +1,340 @@
+#include "clWorkspaceSnapshot.h"
+#include "file_logger.h"
+#include <algorithm>
+#include <string.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+
+// Bump this whenever the format changes
+#define SNAPSHOT_MAGIC "CLPRJSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_MAX_DEPTH 512
+
+namespace
+{
+class Writer
+{
+    std::string& m_buffer;
+
+public:
+    Writer(std::string& buffer)
+        : m_buffer(buffer)
+    {
+    }
+
+    template <typename T> void Write(T value) { m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+    void WriteString(const wxString& str)
+    {
+        const wxCharBuffer utf8 = str.utf8_str();
+        Write<wxUint32>(utf8.length());
+        m_buffer.append(utf8.data(), utf8.length());
+    }
+};
+
+class Reader
+{
+    const char* m_ptr;
+    const char* m_end;
+    bool m_ok = true;
+
+public:
+    Reader(const char* data, size_t size)
+        : m_ptr(data)
+        , m_end(data + size)
+    {
+    }
+
+    bool IsOk() const { return m_ok; }
+
+    template <typename T> T Read()
+    {
+        T value = T();
+        const char* p = ReadBytes(sizeof(T));
+        if(p) { memcpy(&value, p, sizeof(T)); }
+        return value;
+    }
+
+    const char* ReadBytes(size_t len)
+    {
+        if(!m_ok || (size_t)(m_end - m_ptr) < len) {
+            m_ok = false;
+            return nullptr;
+        }
+        const char* p = m_ptr;
+        m_ptr += len;
+        return p;
+    }
+
+    wxString ReadString()
+    {
+        wxUint32 len = Read<wxUint32>();
+        const char* p = ReadBytes(len);
+        return p ? wxString::FromUTF8(p, len) : wxString();
+    }
+};
+
+/// Serialize a document: the strings table followed by the nodes tree (pre-order)
+class DocumentSerializer
+{
+    std::unordered_map<wxString, wxUint32> m_index;
+    std::vector<const wxString*> m_strings;
+    std::string m_nodes;
+    Writer m_writer;
+
+    wxUint32 Intern(const wxString& str)
+    {
+        auto where = m_index.insert({ str, (wxUint32)m_strings.size() });
+        if(where.second) { m_strings.push_back(&where.first->first); }
+        return where.first->second;
+    }
+
+    void WriteNode(const wxXmlNode* node)
+    {
+        m_writer.Write<wxUint8>(node->GetType());
+        m_writer.Write<wxUint32>(Intern(node->GetName()));
+        m_writer.Write<wxUint32>(Intern(node->GetContent()));
+
+        wxUint32 count = 0;
+        for(const wxXmlAttribute* attr = node->GetAttributes(); attr; attr = attr->GetNext()) {
+            ++count;
+        }
+        m_writer.Write<wxUint32>(count);
+        for(const wxXmlAttribute* attr = node->GetAttributes(); attr; attr = attr->GetNext()) {
+            m_writer.Write<wxUint32>(Intern(attr->GetName()));
+            m_writer.Write<wxUint32>(Intern(attr->GetValue()));
+        }
+
+        count = 0;
+        for(const wxXmlNode* child = node->GetChildren(); child; child = child->GetNext()) {
+            ++count;
+        }
+        m_writer.Write<wxUint32>(count);
+        for(const wxXmlNode* child = node->GetChildren(); child; child = child->GetNext()) {
+            WriteNode(child);
+        }
+    }
+
+public:
+    DocumentSerializer()
+        : m_writer(m_nodes)
+    {
+    }
+
+    void Serialize(const wxXmlDocument& doc, std::string& data)
+    {
+        m_writer.Write<wxUint32>(Intern(doc.GetVersion()));
+        m_writer.Write<wxUint32>(Intern(doc.GetFileEncoding()));
+        WriteNode(doc.GetDocumentNode());
+
+        data.clear();
+        Writer writer(data);
+        writer.Write<wxUint32>(m_strings.size());
+        for(const wxString* str : m_strings) {
+            writer.WriteString(*str);
+        }
+        data.append(m_nodes);
+    }
+};
+
+class DocumentDeserializer
+{
+    Reader m_reader;
+    std::vector<wxString> m_strings;
+
+    const wxString* ReadStringRef()
+    {
+        wxUint32 index = m_reader.Read<wxUint32>();
+        if(!m_reader.IsOk() || index >= m_strings.size()) { return nullptr; }
+        return &m_strings[index];
+    }
+
+    wxXmlNode* ReadNode(size_t depth)
+    {
+        if(depth > SNAPSHOT_MAX_DEPTH) { return nullptr; }
+        wxUint8 type = m_reader.Read<wxUint8>();
+        const wxString* name = ReadStringRef();
+        const wxString* content = ReadStringRef();
+        if(!name || !content || type < wxXML_ELEMENT_NODE || type > wxXML_HTML_DOCUMENT_NODE) { return nullptr; }
+
+        wxXmlNode* node = new wxXmlNode((wxXmlNodeType)type, *name, *content);
+        // Link the attributes and the children directly: AddAttribute() / AddChild() walk the whole list every time
+        wxUint32 count = m_reader.Read<wxUint32>();
+        wxXmlAttribute* lastAttr = nullptr;
+        for(wxUint32 i = 0; i < count; ++i) {
+            const wxString* attrName = ReadStringRef();
+            const wxString* attrValue = ReadStringRef();
+            if(!attrName || !attrValue) {
+                delete node;
+                return nullptr;
+            }
+            wxXmlAttribute* attr = new wxXmlAttribute(*attrName, *attrValue);
+            if(lastAttr) {
+                lastAttr->SetNext(attr);
+            } else {
+                node->SetAttributes(attr);
+            }
+            lastAttr = attr;
+        }
+
+        count = m_reader.Read<wxUint32>();
+        wxXmlNode* lastChild = nullptr;
+        for(wxUint32 i = 0; i < count; ++i) {
+            wxXmlNode* child = m_reader.IsOk() ? ReadNode(depth + 1) : nullptr;
+            if(!child) {
+                delete node;
+                return nullptr;
+            }
+            child->SetParent(node);
+            if(lastChild) {
+                lastChild->SetNext(child);
+            } else {
+                node->SetChildren(child);
+            }
+            lastChild = child;
+        }
+        if(!m_reader.IsOk()) {
+            delete node;
+            return nullptr;
+        }
+        return node;
+    }
+
+public:
+    DocumentDeserializer(const char* data, size_t size)
+        : m_reader(data, size)
+    {
+    }
+
+    bool Deserialize(wxXmlDocument& doc)
+    {
+        wxUint32 count = m_reader.Read<wxUint32>();
+        // the count is not trusted before the strings are actually read
+        m_strings.reserve(std::min<wxUint32>(count, 1 << 16));
+        for(wxUint32 i = 0; i < count && m_reader.IsOk(); ++i) {
+            m_strings.push_back(m_reader.ReadString());
+        }
+
+        const wxString* version = ReadStringRef();
+        const wxString* encoding = ReadStringRef();
+        if(!version || !encoding) { return false; }
+
+        wxXmlNode* docNode = ReadNode(0);
+        if(!docNode) { return false; }
+        if(docNode->GetType() != wxXML_DOCUMENT_NODE) {
+            delete docNode;
+            return false;
+        }
+
+        doc.SetDocumentNode(docNode);
+        doc.SetVersion(*version);
+        doc.SetFileEncoding(*encoding);
+        return doc.IsOk();
+    }
+};
+} // namespace
+
+clWorkspaceSnapshot::clWorkspaceSnapshot() {}
+
+clWorkspaceSnapshot::~clWorkspaceSnapshot() { Close(); }
+
+bool clWorkspaceSnapshot::Open(const wxFileName& file)
+{
+    Close();
+    if(!file.FileExists() || !m_file.Open(file)) { return false; }
+
+    Reader reader(m_file.data(), m_file.size());
+    const char* magic = reader.ReadBytes(strlen(SNAPSHOT_MAGIC));
+    wxUint32 version = reader.Read<wxUint32>();
+    wxUint32 byteOrder = reader.Read<wxUint32>();
+    wxUint32 count = reader.Read<wxUint32>();
+    if(!reader.IsOk() || memcmp(magic, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC)) != 0 || version != SNAPSHOT_VERSION ||
+       byteOrder != SNAPSHOT_BYTE_ORDER) {
+        clDEBUG() << "Ignoring workspace snapshot:" << file << "(unknown version)";
+        Close();
+        return false;
+    }
+
+    for(wxUint32 i = 0; i < count; ++i) {
+        wxString path = reader.ReadString();
+        Slot slot;
+        slot.lastModified = reader.Read<wxInt64>();
+        slot.fileSize = reader.Read<wxUint64>();
+        slot.size = reader.Read<wxUint64>();
+        slot.data = reader.ReadBytes(slot.size);
+        if(!reader.IsOk()) {
+            clWARNING() << "Workspace snapshot:" << file << "is corrupted";
+            Close();
+            return false;
+        }
+        m_slots.insert({ path, slot });
+    }
+    return true;
+}
+
+void clWorkspaceSnapshot::Close()
+{
+    m_slots.clear();
+    m_file.Close();
+}
+
+bool clWorkspaceSnapshot::Restore(Entry& entry, wxXmlDocument& doc) const
+{
+    auto iter = m_slots.find(entry.path);
+    if(iter == m_slots.end()) { return false; }
+
+    const Slot& slot = iter->second;
+    if(slot.lastModified != entry.lastModified || slot.fileSize != entry.size) { return false; }
+
+    DocumentDeserializer deserializer(slot.data, slot.size);
+    if(!deserializer.Deserialize(doc)) {
+        clWARNING() << "Failed to restore project" << entry.path << "from the workspace snapshot";
+        return false;
+    }
+    entry.data.assign(slot.data, slot.size);
+    return true;
+}
+
+void clWorkspaceSnapshot::Serialize(const wxXmlDocument& doc, std::string& data)
+{
+    DocumentSerializer serializer;
+    serializer.Serialize(doc, data);
+}
+
+bool clWorkspaceSnapshot::Save(const wxFileName& file, const Vec_t& entries)
+{
+    // Write into a temporary file and replace the snapshot when done, so a partially written snapshot is never used
+    wxString tmpfile = file.GetFullPath() + ".tmp";
+    wxFFile fp(tmpfile, "wb");
+    if(!fp.IsOpened()) {
+        clWARNING() << "Failed to open file:" << tmpfile;
+        return false;
+    }
+
+    std::string buffer;
+    Writer writer(buffer);
+    buffer.append(SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC));
+    writer.Write<wxUint32>(SNAPSHOT_VERSION);
+    writer.Write<wxUint32>(SNAPSHOT_BYTE_ORDER);
+    writer.Write<wxUint32>(entries.size());
+    bool ok = fp.Write(buffer.c_str(), buffer.length()) == buffer.length();
+
+    for(size_t i = 0; ok && i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        buffer.clear();
+        writer.WriteString(entry.path);
+        writer.Write<wxInt64>(entry.lastModified);
+        writer.Write<wxUint64>(entry.size);
+        writer.Write<wxUint64>(entry.data.length());
+        ok = fp.Write(buffer.c_str(), buffer.length()) == buffer.length() &&
+             fp.Write(entry.data.c_str(), entry.data.length()) == entry.data.length();
+    }
+    ok = fp.Close() && ok;
+
+    if(!ok || !::wxRenameFile(tmpfile, file.GetFullPath(), true)) {
+        clWARNING() << "Failed to write workspace snapshot:" << file;
+        ::wxRemoveFile(tmpfile);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef CLWORKSPACESNAPSHOT_H
+#define CLWORKSPACESNAPSHOT_H
+
+#include "clMappedFile.h"
+#include "codelite_exports.h"
+#include "macros.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wx/filename.h>
+#include <wx/xml/xml.h>
+
+/**
+ * @class clWorkspaceSnapshot
+ * @brief a binary snapshot of the parsed projects XML documents, stored in the workspace private folder.
+ * Each document is stored as a node tree that refers to a table of its unique strings, together with the .project file
+ * modification time and size. When the workspace is loaded again, the projects that did not change are restored from
+ * the (memory mapped) snapshot instead of being parsed
+ */
+class WXDLLIMPEXP_SDK clWorkspaceSnapshot
+{
+public:
+    struct Entry {
+        wxString path; // the .project file
+        wxInt64 lastModified = 0;
+        wxUint64 size = 0;
+        std::string data; // the serialized XML document
+    };
+    typedef std::vector<Entry> Vec_t;
+
+protected:
+    struct Slot {
+        const char* data;
+        size_t size;
+        wxInt64 lastModified;
+        wxUint64 fileSize;
+    };
+
+    clMappedFile m_file;
+    std::unordered_map<wxString, Slot> m_slots;
+
+public:
+    clWorkspaceSnapshot();
+    virtual ~clWorkspaceSnapshot();
+
+    /**
+     * @brief map the snapshot file. Return false if the file does not exist, or was written by a different version
+     */
+    bool Open(const wxFileName& file);
+
+    /**
+     * @brief unmap the snapshot file
+     */
+    void Close();
+
+    /**
+     * @brief number of projects in the snapshot
+     */
+    size_t GetCount() const { return m_slots.size(); }
+
+    /**
+     * @brief restore the XML document of entry.path into 'doc'. This fails if the snapshot does not contain the project,
+     * or if entry.lastModified / entry.size do not match the ones recorded in the snapshot. On success, the snapshot data
+     * is copied into entry.data. Can be called from multiple threads
+     */
+    bool Restore(Entry& entry, wxXmlDocument& doc) const;
+
+    /**
+     * @brief serialize 'doc' into 'data'
+     */
+    static void Serialize(const wxXmlDocument& doc, std::string& data);
+
+    /**
+     * @brief write the snapshot file
+     */
+    static bool Save(const wxFileName& file, const Vec_t& entries);
+};
+
+#endif // CLWORKSPACESNAPSHOT_H
@@ -24,6 +24,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "bitmap_loader.h"
+#include "clWorkspaceResourceIndex.h"
 #include "ctags_manager.h"
 #include "editor_config.h"
 #include "event_notifier.h"
@@ -95,24 +96,6 @@ OpenResourceDialog::OpenResourceDialog(wxWindow* parent, IManager* manager, cons
     SetName("OpenResourceDialog");
     WindowAttrManager::Load(this);
 
-    // load all files from the workspace
-    if(m_manager->IsWorkspaceOpen()) {
-        wxArrayString projects;
-        m_manager->GetWorkspace()->GetProjectList(projects);
-
-        for(size_t i = 0; i < projects.GetCount(); i++) {
-            ProjectPtr p = m_manager->GetWorkspace()->GetProject(projects.Item(i));
-            if(p) {
-                const Project::FilesMap_t& files = p->GetFiles();
-                // convert std::vector to wxArrayString
-                std::for_each(files.begin(), files.end(), [&](const Project::FilesMap_t::value_type& vt) {
-                    wxFileName fn(vt.second->GetFilename());
-                    m_files.insert(std::make_pair(fn.GetFullName(), fn.GetFullPath()));
-                });
-            }
-        }
-    }
-
     wxString lastStringTyped = clConfig::Get().Read("OpenResourceDialog/SearchString", wxString());
     // Set the initial selection
     // We use here 'SetValue' so an event will get fired and update the control
@@ -195,26 +178,41 @@ void OpenResourceDialog::DoPopulateList()
     }
 
     // Build the filter class
-    if(m_checkBoxFiles->IsChecked()) { DoPopulateWorkspaceFile(); }
-    if(m_checkBoxShowSymbols->IsChecked() && (nLineNumber == -1)) { DoPopulateTags(); }
+    if(m_checkBoxFiles->IsChecked()) { DoPopulateWorkspaceFile(name); }
+    if(m_checkBoxShowSymbols->IsChecked() && (nLineNumber == -1)) { DoPopulateTags(name); }
 }
 
-void OpenResourceDialog::DoPopulateTags()
+void OpenResourceDialog::DoPopulateTags(const wxString& filter)
 {
     // Next, add the tags
-    TagEntryPtrVector_t tags;
     if(m_userFilters.IsEmpty()) return;
-    m_manager->GetTagsManager()->GetTagsByPartialNames(m_userFilters, tags);
+
+    // Rank the symbols in memory, then fetch the best ones from the database
+    wxArrayString paths;
+    clWorkspaceResourceIndex::Get().QuerySymbols(filter, MAX_SEARCH_LIMIT, paths);
+    if(paths.IsEmpty()) return;
+
+    TagEntryPtrVector_t tags;
+    m_manager->GetTagsManager()->GetTagsByPaths(paths, tags);
+
+    // The database returns the tags in its own order, keep the order of the ranked paths
+    std::unordered_map<wxString, size_t> ranks;
+    for(size_t i = 0; i < paths.GetCount(); ++i) {
+        ranks.insert({ paths.Item(i), i });
+    }
+    auto rankOf = [&](const TagEntryPtr& tag) {
+        std::unordered_map<wxString, size_t>::const_iterator iter = ranks.find(tag->GetPath());
+        return iter == ranks.end() ? paths.GetCount() : iter->second;
+    };
+    std::stable_sort(tags.begin(), tags.end(),
+                     [&](const TagEntryPtr& a, const TagEntryPtr& b) { return rankOf(a) < rankOf(b); });
+
     for(size_t i = 0; i < tags.size(); i++) {
         TagEntryPtr tag = tags.at(i);
 
         // Filter out non relevanting entries
         if(!m_filters.IsEmpty() && m_filters.Index(tag->GetKind()) == wxNOT_FOUND) continue;
 
-        if(!MatchesFilter(tag->GetFullDisplayName())) { continue; }
-
-        wxString name(tag->GetName());
-
         // keep the fullpath
         wxString fullname;
         if(tag->IsMethod()) {
@@ -233,35 +231,30 @@ void OpenResourceDialog::DoPopulateTags()
                          DoGetTagImg(tag));
         }
     }
-    wxString filter = (m_userFilters.GetCount() == 1) ? m_userFilters.Item(0) : "";
-    if(!filter.IsEmpty()) {
+    wxString exactName = (m_userFilters.GetCount() == 1) ? m_userFilters.Item(0) : "";
+    if(!exactName.IsEmpty()) {
         wxDataViewItem matchedItem =
-            m_dataview->FindNext(wxDataViewItem(nullptr), filter, 0,
+            m_dataview->FindNext(wxDataViewItem(nullptr), exactName, 0,
                                  wxDV_SEARCH_ICASE | wxDV_SEARCH_METHOD_EXACT | wxDV_SEARCH_INCLUDE_CURRENT_ITEM);
         if(matchedItem.IsOk()) { DoSelectItem(matchedItem); }
     }
 }
 
-void OpenResourceDialog::DoPopulateWorkspaceFile()
+void OpenResourceDialog::DoPopulateWorkspaceFile(const wxString& filter)
 {
     // do we need to include files?
     if(!m_filters.IsEmpty() && m_filters.Index(KIND_FILE) == wxNOT_FOUND) return;
 
     if(!m_userFilters.IsEmpty()) {
-
-        std::unordered_multimap<wxString, wxString>::iterator iter = m_files.begin();
-        const int maxFileSize = 100;
-        int counter = 0;
-        for(; (iter != m_files.end()) && (counter < maxFileSize); iter++) {
-            const wxString& fullpath = iter->second;
-            if(!MatchesFilter(fullpath)) continue;
-
-            wxFileName fn(iter->second);
+        const size_t maxFileSize = 100;
+        wxArrayString files;
+        clWorkspaceResourceIndex::Get().QueryFiles(filter, maxFileSize, files);
+        for(size_t i = 0; i < files.GetCount(); ++i) {
+            wxFileName fn(files.Item(i));
             int imgId = clGetManager()->GetStdIcons()->GetMimeImageId(fn.GetFullName());
             DoAppendLine(fn.GetFullName(), fn.GetFullPath(), false,
                          new OpenResourceDialogItemData(fn.GetFullPath(), -1, wxT(""), fn.GetFullName(), wxT("")),
                          imgId);
-            ++counter;
         }
     }
 }
@@ -370,13 +363,6 @@ int OpenResourceDialog::DoGetTagImg(TagEntryPtr tag)
     return clGetManager()->GetStdIcons()->GetImageIndex(imgId);
 }
 
-bool OpenResourceDialog::MatchesFilter(const wxString& name)
-{
-    wxString filter = m_textCtrlResourceName->GetValue();
-    if(filter.Contains(':') == true) { filter = filter.BeforeLast(':'); }
-    return FileUtils::FuzzyMatch(filter, name);
-}
-
 void OpenResourceDialog::OnCheckboxfilesCheckboxClicked(wxCommandEvent& event) { DoPopulateList(); }
 void OpenResourceDialog::OnCheckboxshowsymbolsCheckboxClicked(wxCommandEvent& event) { DoPopulateList(); }
 
@@ -79,7 +79,6 @@ public:
 class WXDLLIMPEXP_SDK OpenResourceDialog : public OpenResourceDialogBase
 {
     IManager* m_manager;
-    std::unordered_multimap<wxString, wxString> m_files;
     std::unordered_map<wxString, int> m_fileTypeHash;
     wxTimer* m_timer;
     bool m_needRefresh;
@@ -94,9 +93,8 @@ protected:
     virtual void OnCheckboxfilesCheckboxClicked(wxCommandEvent& event);
     virtual void OnCheckboxshowsymbolsCheckboxClicked(wxCommandEvent& event);
     void DoPopulateList();
-    void DoPopulateWorkspaceFile();
-    bool MatchesFilter(const wxString& name);
-    void DoPopulateTags();
+    void DoPopulateWorkspaceFile(const wxString& filter);
+    void DoPopulateTags(const wxString& filter);
     void DoSelectItem(const wxDataViewItem& item);
     void Clear();
     void DoAppendLine(const wxString& name, const wxString& fullname, bool boldFont,
@@ -127,6 +127,20 @@ bool Project::Load(const wxString& path)
     GetAllPluginsData(pluginsData);
     SetAllPluginsData(pluginsData, false);
 
+    DoInitFromXml(path);
+    return true;
+}
+
+bool Project::LoadFromSnapshot(const clWorkspaceSnapshot& snapshot, clWorkspaceSnapshot::Entry& entry)
+{
+    // The snapshot is taken after Load() (with the plugins data already fixed)
+    if(!snapshot.Restore(entry, m_doc)) { return false; }
+    DoInitFromXml(entry.path);
+    return true;
+}
+
+void Project::DoInitFromXml(const wxString& path)
+{
     m_fileName = path;
     m_fileName.MakeAbsolute();
     m_projectPath = m_fileName.GetPath();
@@ -135,8 +149,11 @@ bool Project::Load(const wxString& path)
     SetModified(true);
     SetProjectLastModifiedTime(GetFileLastModifiedTime());
 
-    DoUpdateProjectSettings();
-    return true;
+    // A project file without settings keeps the default settings created by the constructor. Creating them here would
+    // query the build settings and the debuggers manager, while this function is called from worker threads (see
+    // clCxxWorkspace::DoLoadProjects)
+    wxXmlNode* settingsNode = XmlUtils::FindFirstByTagName(m_doc.GetRoot(), wxT("Settings"));
+    if(settingsNode) { m_settings.Reset(new ProjectSettings(settingsNode)); }
 }
 
 wxXmlNode* Project::GetVirtualDir(const wxString& vdFullPath)
@@ -1854,14 +1871,25 @@ void Project::CreateCompileFlags(const wxStringMap_t& compilersGlobalPaths)
     BuildConfigPtr buildConf = GetBuildConfiguration();
     if(!buildConf) { return; }
 
+    // Write the file content
+    wxFileName compile_flags(GetFileName());
+    compile_flags.SetFullName("compile_flags.txt");
+    FileUtils::WriteFileContent(compile_flags, GetCompileFlagsContent(compilersGlobalPaths));
+}
+
+wxString Project::GetCompileFlagsContent(const wxStringMap_t& compilersGlobalPaths)
+{
+    BuildConfigPtr buildConf = GetBuildConfiguration();
+    if(!buildConf) { return ""; }
+
     CompilerPtr cmp = (buildConf) ? buildConf->GetCompiler() : nullptr;
     wxStringSet_t macroSet;
     std::vector<wxString> pathsVec;
     wxString compile_flags_content;
     if(buildConf->IsCustomBuild() && (buildConf->GetBuilder() != "CMake")) {
         // Probably just plain old Makefile build system
-        CHECK_PTR_RET(GetWorkspace());
-        CHECK_PTR_RET(GetWorkspace()->GetLocalWorkspace());
+        CHECK_PTR_RET_EMPTY_STRING(GetWorkspace());
+        CHECK_PTR_RET_EMPTY_STRING(GetWorkspace()->GetLocalWorkspace());
 
         wxStringSet_t cookie;
         wxArrayString workspacePaths, dummy;
@@ -1911,11 +1939,7 @@ void Project::CreateCompileFlags(const wxStringMap_t& compilersGlobalPaths)
 
     // Add the target flag
     if(cmp) { GetExtraFlags(compile_flags_content, buildConf->GetCompiler()); }
-
-    // Write the file content
-    wxFileName compile_flags(GetFileName());
-    compile_flags.SetFullName("compile_flags.txt");
-    FileUtils::WriteFileContent(compile_flags, compile_flags_content);
+    return compile_flags_content;
 }
 
 bool clProjectFolder::RenameFile(Project* project, const wxString& fullpath, const wxString& newName)
@@ -27,6 +27,7 @@
 
 #include "codelite_exports.h"
 #include "JSON.h"
+#include "clWorkspaceSnapshot.h"
 #include "localworkspace.h"
 #include "macros.h"
 #include "optionsconfig.h"
@@ -327,6 +328,7 @@ private:
 private:
     void DoUpdateProjectSettings();
     void DoBuildCacheFromXml();
+    void DoInitFromXml(const wxString& path);
     clProjectFile::Ptr_t FileFromXml(wxXmlNode* node, const wxString& vd);
     wxArrayString DoGetCompilerOptions(bool cxxOptions, bool clearCache = false, bool noDefines = true,
                                        bool noIncludePaths = true);
@@ -457,6 +459,12 @@ public:
      * \return
      */
     bool Load(const wxString& path);
+
+    /**
+     * @brief load the project from the workspace snapshot instead of parsing the file. This fails if the snapshot is
+     * not up to date with the project file (entry.path)
+     */
+    bool LoadFromSnapshot(const clWorkspaceSnapshot& snapshot, clWorkspaceSnapshot::Entry& entry);
     /**
      * \brief Create new project
      * \param name project name
@@ -833,6 +841,11 @@ public:
      */
     void CreateCompileFlags(const wxStringMap_t& compilersGlobalPaths);
 
+    /**
+     * @brief return the content of this project's compile_flags.txt file, without writing it
+     */
+    wxString GetCompileFlagsContent(const wxStringMap_t& compilersGlobalPaths);
+
     void SetWorkspaceFolder(const wxString& workspaceFolders) { this->m_workspaceFolder = workspaceFolders; }
     const wxString& GetWorkspaceFolder() const { return m_workspaceFolder; }
 
@@ -34,14 +34,19 @@
 #include "plugin.h"
 #include "project.h"
 #include "workspace.h"
+#include "clWorkspaceSnapshot.h"
 #include "wx/regex.h"
 #include "wx_xml_compatibility.h"
 #include "xmlutils.h"
 #include <wx/app.h>
 #include <wx/log.h>
 #include <wx/msgdlg.h>
+#include <wx/stopwatch.h>
 #include <wx/thread.h>
 #include <wx/tokenzr.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "file_logger.h"
 #include "macromanager.h"
 #include "build_settings_config.h"
@@ -1003,6 +1008,16 @@ wxFileName clCxxWorkspace::GetTagsFileName() const
     return fn_tags;
 }
 
+wxFileName clCxxWorkspace::GetProjectsSnapshotFile() const
+{
+    if(!IsOpen()) { return wxFileName(); }
+
+    wxFileName fn(GetPrivateFolder(), GetWorkspaceFileName().GetFullName());
+    fn.SetName(fn.GetName() + "-projects");
+    fn.SetExt("snapshot");
+    return fn;
+}
+
 cJSON* clCxxWorkspace::CreateCompileCommandsJSON() const
 {
     // Build the global compiler paths, we will need this later on...
@@ -1029,33 +1044,8 @@ cJSON* clCxxWorkspace::CreateCompileCommandsJSON() const
             wxString buildWorkingDirectory = MacroManager::Instance()->Expand(
                 buildConf->GetCustomBuildWorkingDir(), NULL, activeProject->GetName(), buildConf->GetName());
             wxFileName fnWorkingDirectory(buildWorkingDirectory, "compile_commands.json");
-            if(fnWorkingDirectory.FileExists()) {
-
-                JSON root(fnWorkingDirectory);
-                if(root.isOk()) {
-                    JSON newFile(cJSON_Array);
-                    JSONItem newArr = newFile.toElement();
-                    JSONItem arr = root.toElement();
-                    int size = arr.arraySize();
-                    for(int i = 0; i < size; ++i) {
-                        JSONItem file = arr.arrayItem(i);
-                        wxString command = file.namedObject("command").toString();
-                        wxString filename = file.namedObject("file").toString();
-                        wxString directory = file.namedObject("directory").toString();
-
-                        JSONItem fileItem = JSONItem::createObject();
-                        fileItem.addProperty("file", filename).addProperty("directory", directory);
-
-                        // Fix the build command
-                        CompilerCommandLineParser cclp(command, directory);
-                        cclp.MakeAbsolute(directory);
-                        fileItem.addProperty("command", wxString()
-                                                            << "clang " << cclp.GetCompileLine() << " -c " << filename);
-                        newArr.arrayAppend(fileItem);
-                    }
-                    return newFile.release();
-                }
-            }
+            cJSON* compile_commands = ImportCompileCommandsJSON(fnWorkingDirectory);
+            if(compile_commands) { return compile_commands; }
         }
     }
 
@@ -1071,6 +1061,35 @@ cJSON* clCxxWorkspace::CreateCompileCommandsJSON() const
     return compile_commands.release();
 }
 
+cJSON* clCxxWorkspace::ImportCompileCommandsJSON(const wxFileName& compileCommandsFile)
+{
+    if(!compileCommandsFile.FileExists()) { return NULL; }
+
+    JSON root(compileCommandsFile);
+    if(!root.isOk()) { return NULL; }
+
+    JSON newFile(cJSON_Array);
+    JSONItem newArr = newFile.toElement();
+    JSONItem arr = root.toElement();
+    int size = arr.arraySize();
+    for(int i = 0; i < size; ++i) {
+        JSONItem file = arr.arrayItem(i);
+        wxString command = file.namedObject("command").toString();
+        wxString filename = file.namedObject("file").toString();
+        wxString directory = file.namedObject("directory").toString();
+
+        JSONItem fileItem = JSONItem::createObject();
+        fileItem.addProperty("file", filename).addProperty("directory", directory);
+
+        // Fix the build command
+        CompilerCommandLineParser cclp(command, directory);
+        cclp.MakeAbsolute(directory);
+        fileItem.addProperty("command", wxString() << "clang " << cclp.GetCompileLine() << " -c " << filename);
+        newArr.arrayAppend(fileItem);
+    }
+    return newFile.release();
+}
+
 ProjectPtr clCxxWorkspace::GetActiveProject() const { return GetProject(GetActiveProjectName()); }
 
 ProjectPtr clCxxWorkspace::GetProject(const wxString& name) const
@@ -1228,20 +1247,125 @@ void clCxxWorkspace::DoUnselectActiveProject()
 
 void clCxxWorkspace::DoLoadProjectsFromXml(wxXmlNode* parentNode, const wxString& folder,
                                            std::vector<wxXmlNode*>& removedChildren)
+{
+    std::vector<ProjectLoadRequest> projects;
+    DoCollectProjectsFromXml(parentNode, folder, projects);
+    DoLoadProjects(projects, removedChildren);
+}
+
+void clCxxWorkspace::DoLoadProjects(const std::vector<ProjectLoadRequest>& projects,
+                                    std::vector<wxXmlNode*>& removedChildren)
+{
+    wxStopWatch sw;
+    wxFileName snapshotFile = GetProjectsSnapshotFile();
+    clWorkspaceSnapshot snapshot;
+    snapshot.Open(snapshotFile);
+
+    // The projects are constructed here, on the main thread: a new project gets default settings, which query the
+    // build settings (the default compiler) and the debuggers manager
+    std::vector<ProjectPtr> created(projects.size());
+    for(size_t i = 0; i < projects.size(); ++i) {
+        created[i].Reset(new Project());
+    }
+
+    std::vector<ProjectPtr> loaded(projects.size());
+    clWorkspaceSnapshot::Vec_t entries(projects.size());
+    std::atomic_size_t restored(0);
+    auto loadProject = [&](size_t index) {
+        // Take the file attributes before the file is read: if it changes meanwhile, the snapshot is simply outdated
+        clWorkspaceSnapshot::Entry& entry = entries[index];
+        entry.path = projects[index].path;
+        wxStructStat st;
+        if(wxStat(entry.path, &st) == 0) {
+            entry.lastModified = st.st_mtime;
+            entry.size = st.st_size;
+        }
+
+        ProjectPtr proj = created[index];
+        if(proj->LoadFromSnapshot(snapshot, entry)) {
+            loaded[index] = proj;
+            ++restored;
+        } else if(proj->Load(entry.path)) {
+            clWorkspaceSnapshot::Serialize(proj->m_doc, entry.data);
+            loaded[index] = proj;
+        }
+    };
+
+    size_t workers = std::min<size_t>(projects.size(), std::max(1u, std::min(8u, std::thread::hardware_concurrency())));
+    if(workers <= 1) {
+        for(size_t i = 0; i < projects.size(); ++i) {
+            loadProject(i);
+        }
+    } else {
+        // Project::Load() only touches the project itself (XML document, files and folders cache, settings read from
+        // the XML). The default settings, which need the global build settings, were created on the main thread
+        std::atomic_size_t nextProject(0);
+        std::vector<std::thread> threads;
+        threads.reserve(workers);
+        for(size_t w = 0; w < workers; ++w) {
+            threads.push_back(std::thread([&]() {
+                size_t index;
+                while((index = nextProject.fetch_add(1)) < projects.size()) {
+                    loadProject(index);
+                }
+            }));
+        }
+        for(std::thread& thr : threads) {
+            thr.join();
+        }
+    }
+    long loadTime = sw.Time();
+
+    // Update the snapshot if any of the projects had to be parsed
+    bool updateSnapshot = restored != projects.size() || snapshot.GetCount() != projects.size();
+    snapshot.Close();
+    if(updateSnapshot && snapshotFile.IsOk()) {
+        clWorkspaceSnapshot::Vec_t validEntries;
+        validEntries.reserve(entries.size());
+        for(size_t i = 0; i < entries.size(); ++i) {
+            if(loaded[i]) { validEntries.push_back(std::move(entries[i])); }
+        }
+        clWorkspaceSnapshot::Save(snapshotFile, validEntries);
+    }
+
+    // Publish the projects, in the workspace order
+    sw.Start();
+    for(size_t i = 0; i < projects.size(); ++i) {
+        ProjectPtr proj = loaded[i];
+        if(!proj) {
+            clWARNING() << "Corrupted project file:" << projects[i].path;
+            removedChildren.push_back(projects[i].node);
+            continue;
+        }
+        m_projects.insert(std::make_pair(proj->GetName(), proj));
+        proj->AssociateToWorkspace(this);
+        proj->SetWorkspaceFolder(projects[i].folder);
+    }
+    clDEBUG() << "Loaded" << projects.size() << "projects (" << (size_t)restored << "from snapshot) in" << loadTime
+              << "ms (" << workers << "threads), published in" << sw.Time() << "ms";
+}
+
+void clCxxWorkspace::DoCollectProjectsFromXml(wxXmlNode* parentNode, const wxString& folder,
+                                              std::vector<ProjectLoadRequest>& projects)
 {
     wxXmlNode* child = parentNode->GetChildren();
     while(child) {
         if(child->GetName() == wxT("Project")) {
-            wxString projectPath = child->GetPropVal(wxT("Path"), wxEmptyString);
-            wxString errmsg;
-            if(!DoAddProject(projectPath, folder, errmsg)) { removedChildren.push_back(child); }
+            // Convert the path to absolute path
+            wxFileName projectFile(child->GetPropVal(wxT("Path"), wxEmptyString));
+            if(projectFile.IsRelative()) { projectFile.MakeAbsolute(m_fileName.GetPath()); }
+            ProjectLoadRequest request;
+            request.node = child;
+            request.path = projectFile.GetFullPath();
+            request.folder = folder;
+            projects.push_back(request);
         } else if(child->GetName() == wxT("VirtualDirectory")) {
             // Virtual directory
             wxString currentFolder = folder;
             wxString vdName = child->GetAttribute("Name", wxEmptyString);
             if(!currentFolder.IsEmpty()) { currentFolder << "/"; }
             currentFolder << vdName;
-            DoLoadProjectsFromXml(child, currentFolder, removedChildren);
+            DoCollectProjectsFromXml(child, currentFolder, projects);
         } else if((child->GetName() == wxT("WorkspaceParserPaths")) ||
                   (child->GetName() == wxT("WorkspaceParserMacros"))) {
             wxString swtlw = XmlUtils::ReadString(m_doc.GetRoot(), "SWTLW");
@@ -1334,6 +1458,10 @@ bool clCxxWorkspace::CreateWorkspaceFolder(const wxString& path) { return (DoCre
 
 bool clCxxWorkspace::DoLoadWorkspace(const wxString& fileName, wxString& errMsg)
 {
+    // Time the phases of the workspace loading
+    wxStopWatch sw;
+    wxStopWatch swTotal;
+
     CloseWorkspace();
     m_buildMatrix.Reset(NULL);
     wxFileName workSpaceFile(fileName);
@@ -1341,13 +1469,16 @@ bool clCxxWorkspace::DoLoadWorkspace(const wxString& fileName, wxString& errMsg)
         errMsg = wxString::Format(wxT("Could not open workspace file: '%s'"), fileName.c_str());
         return false;
     }
+    long closeTime = sw.Time();
 
+    sw.Start();
     m_fileName = workSpaceFile;
     m_doc.Load(m_fileName.GetFullPath());
     if(!m_doc.IsOk()) {
         errMsg = wxT("Corrupted workspace file");
         return false;
     }
+    long workspaceXmlTime = sw.Time();
 
     // Make sure we have the WORKSPACE/.codelite folder exists
     {
@@ -1361,6 +1492,7 @@ bool clCxxWorkspace::DoLoadWorkspace(const wxString& fileName, wxString& errMsg)
     ::wxSetWorkingDirectory(m_fileName.GetPath());
 
     // Load all projects from the XML file
+    sw.Start();
     std::vector<wxXmlNode*> removedChildren;
     DoLoadProjectsFromXml(m_doc.GetRoot(), wxEmptyString, removedChildren);
 
@@ -1370,14 +1502,24 @@ bool clCxxWorkspace::DoLoadWorkspace(const wxString& fileName, wxString& errMsg)
         ch->GetParent()->RemoveChild(ch);
         wxDELETE(ch);
     }
+    long projectsTime = sw.Time();
 
+    sw.Start();
     errMsg.Clear();
     TagsManager* mgr = TagsManagerST::Get();
     mgr->CloseDatabase();
     mgr->OpenDatabase(GetTagsFileName().GetFullPath());
+    long tagsTime = sw.Time();
 
     // Update the build matrix
+    sw.Start();
     DoUpdateBuildMatrix();
+    long buildMatrixTime = sw.Time();
+
+    clDEBUG() << "Workspace" << m_fileName.GetFullName() << "loaded in" << swTotal.Time()
+              << "ms. Close previous:" << closeTime << "ms, workspace XML:" << workspaceXmlTime
+              << "ms, projects:" << projectsTime << "ms, tags database:" << tagsTime
+              << "ms, build matrix:" << buildMatrixTime << "ms";
     return true;
 }
 
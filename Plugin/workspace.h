@@ -105,11 +105,30 @@ private:
      */
     void DoUnselectActiveProject();
 
+    struct ProjectLoadRequest {
+        wxXmlNode* node;
+        wxString path;   // absolute path to the .project file
+        wxString folder; // the workspace folder
+    };
+
     /**
      * @brief load projects from the XML file
      */
     void DoLoadProjectsFromXml(wxXmlNode* parentNode, const wxString& folder, std::vector<wxXmlNode*>& removedChildren);
 
+    /**
+     * @brief collect the projects of the XML file (recursively)
+     */
+    void DoCollectProjectsFromXml(wxXmlNode* parentNode, const wxString& folder,
+                                  std::vector<ProjectLoadRequest>& projects);
+
+    /**
+     * @brief load the projects on a pool of threads (each project is independent: the XML is parsed and its cache
+     * is built by the worker). The loaded projects are added to the workspace once all of them are ready.
+     * Projects that did not change since the last time are restored from the projects snapshot
+     */
+    void DoLoadProjects(const std::vector<ProjectLoadRequest>& projects, std::vector<wxXmlNode*>& removedChildren);
+
     // return the wxXmlNode instance for the give path
     // the path is separated by "/"
     // return NULL if no such virtual directory exists
@@ -166,6 +185,13 @@ public:
      */
     cJSON* CreateCompileCommandsJSON() const;
 
+    /**
+     * @brief load a compile_commands.json file generated by a build system and fix its compilation lines for clang.
+     * Returns NULL if the file can not be loaded. This function does not access the workspace and can be called from
+     * a worker thread
+     */
+    static cJSON* ImportCompileCommandsJSON(const wxFileName& compileCommandsFile);
+
     /**
      * @brief generate compile_flags.txt for each project
      */
@@ -463,6 +489,11 @@ public:
      */
     wxFileName GetTagsFileName() const;
 
+    /**
+     * @brief return the projects snapshot file (see clWorkspaceSnapshot)
+     */
+    wxFileName GetProjectsSnapshotFile() const;
+
     /**
      * @brief return project by name
      */
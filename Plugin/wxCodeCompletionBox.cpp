@@ -21,6 +21,7 @@
 #include "ieditor.h"
 #include "imanager.h"
 #include <wx/display.h>
+#include <algorithm>
 
 static int LINES_PER_PAGE = 8;
 static int Y_SPACER = 2;
@@ -328,6 +329,7 @@ void wxCodeCompletionBox::ShowCompletionBox(wxStyledTextCtrl* ctrl, const wxCode
     }
     // Filter all duplicate entries from the list (based on simple string match)
     RemoveDuplicateEntries();
+    DoBuildFilterKeys();
 
     // Filter results based on user input
     FilterResults();
@@ -481,52 +483,75 @@ bool wxCodeCompletionBox::FilterResults()
     wxString word = GetFilter();
     if(word.IsEmpty()) {
         m_entries = m_allEntries;
+        m_lastFilter.Clear();
         return false;
     }
 
-    m_entries.clear();
-    wxString lcFilter = word.Lower();
     // Smart sorting:
     // We preare the list of matches in the following order:
     // Exact matches
     // Starts with
     // Contains
-    wxCodeCompletionBoxEntry::Vec_t exactMatches, exactMatchesI, startsWith, startsWithI, contains, containsI;
-    for(size_t i = 0; i < m_allEntries.size(); ++i) {
-        wxString entryText = m_allEntries.at(i)->GetText().BeforeFirst('(');
-        entryText.Trim().Trim(false);
-        wxString lcEntryText = entryText.Lower();
-
-        // Exact match:
-        if(word == entryText) {
-            exactMatches.push_back(m_allEntries.at(i));
-
-        } else if(lcEntryText == lcFilter) {
-            exactMatchesI.push_back(m_allEntries.at(i));
-
-        } else if(entryText.StartsWith(word)) {
-            startsWith.push_back(m_allEntries.at(i));
-
-        } else if(lcEntryText.StartsWith(lcFilter)) {
-            startsWithI.push_back(m_allEntries.at(i));
-
-        } else if(entryText.Contains(word)) {
-            contains.push_back(m_allEntries.at(i));
-
-        } else if(lcEntryText.Contains(lcFilter)) {
-            containsI.push_back(m_allEntries.at(i));
+    // Fuzzy matches (the filter is a subsequence of the entry), best score first
+    // All of the above are fuzzy matches as well, so while the user keeps typing, only the previous matches need to
+    // be checked
+    bool narrow = !m_lastFilter.IsEmpty() && word.StartsWith(m_lastFilter);
+    m_matcher.SetPattern(word);
+    const wxString& lcFilter = m_matcher.GetLowerPattern();
+
+    m_rankedMatches.clear();
+    bool hasPrefixMatch = false;
+    size_t count = narrow ? m_filterMatches.size() : m_allEntries.size();
+    for(size_t i = 0; i < count; ++i) {
+        size_t index = narrow ? m_filterMatches[i] : i;
+        const FilterKey& key = m_filterKeys[index];
+        FilterMatch match = { 0, 0, index };
+        if(word == key.text) {
+            match.rank = 0;
+        } else if(key.lcText == lcFilter) {
+            match.rank = 1;
+        } else if(key.text.StartsWith(word)) {
+            match.rank = 2;
+        } else if(key.lcText.StartsWith(lcFilter)) {
+            match.rank = 3;
+        } else if(key.text.Contains(word)) {
+            match.rank = 4;
+        } else if(key.lcText.Contains(lcFilter)) {
+            match.rank = 5;
+        } else {
+            match.rank = 6;
+            match.score = m_matcher.Score(key.text, key.lcText);
+            if(match.score == wxNOT_FOUND) { continue; }
         }
+        hasPrefixMatch = hasPrefixMatch || (match.rank <= 3);
+        m_rankedMatches.push_back(match);
     }
+    std::sort(m_rankedMatches.begin(), m_rankedMatches.end());
 
-    // Merge the results
-    m_entries.insert(m_entries.end(), exactMatches.begin(), exactMatches.end());
-    m_entries.insert(m_entries.end(), exactMatchesI.begin(), exactMatchesI.end());
-    m_entries.insert(m_entries.end(), startsWith.begin(), startsWith.end());
-    m_entries.insert(m_entries.end(), startsWithI.begin(), startsWithI.end());
-    m_entries.insert(m_entries.end(), contains.begin(), contains.end());
-    m_entries.insert(m_entries.end(), containsI.begin(), containsI.end());
+    m_entries.clear();
+    m_filterMatches.clear();
+    for(const FilterMatch& match : m_rankedMatches) {
+        m_entries.push_back(m_allEntries[match.index]);
+        m_filterMatches.push_back(match.index);
+    }
+    m_lastFilter = word;
     m_index = 0;
-    return exactMatches.empty() && exactMatchesI.empty() && startsWith.empty() && startsWithI.empty();
+    return !hasPrefixMatch;
+}
+
+void wxCodeCompletionBox::DoBuildFilterKeys()
+{
+    m_filterKeys.clear();
+    m_filterKeys.reserve(m_allEntries.size());
+    for(const wxCodeCompletionBoxEntry::Ptr_t& entry : m_allEntries) {
+        FilterKey key;
+        key.text = entry->GetText().BeforeFirst('(');
+        key.text.Trim().Trim(false);
+        key.lcText = key.text.Lower();
+        m_filterKeys.push_back(key);
+    }
+    m_filterMatches.clear();
+    m_lastFilter.Clear();
 }
 
 void wxCodeCompletionBox::InsertSelection()
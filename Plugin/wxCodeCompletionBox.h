@@ -39,6 +39,7 @@
 #include <wx/event.h>
 #include <wx/bitmap.h>
 #include "LSP/CompletionItem.h"
+#include "clFuzzyMatcher.h"
 #include <wxStringHash.h>
 
 class CCBoxTipWindow;
@@ -60,8 +61,31 @@ public:
     };
 
 protected:
+    struct FilterKey {
+        wxString text;   // the entry text, without the function signature
+        wxString lcText; // lower case form of 'text'
+    };
+
+    struct FilterMatch {
+        int rank; // exact match, starts with, contains (case sensitive first) and finally fuzzy matches
+        int score;
+        size_t index;
+        bool operator<(const FilterMatch& other) const
+        {
+            if(rank != other.rank) { return rank < other.rank; }
+            if(score != other.score) { return score > other.score; }
+            return index < other.index;
+        }
+    };
+
     wxCodeCompletionBoxEntry::Vec_t m_allEntries;
     wxCodeCompletionBoxEntry::Vec_t m_entries;
+    // Filtering state, computed once per list and reused on every keystroke
+    std::vector<FilterKey> m_filterKeys;  // one per entry in m_allEntries
+    std::vector<size_t> m_filterMatches;  // indexes in m_allEntries of the entries matching m_lastFilter
+    std::vector<FilterMatch> m_rankedMatches;
+    wxString m_lastFilter;
+    clFuzzyMatcher m_matcher;
     wxCodeCompletionBox::BmpVec_t m_bitmaps;
     static wxCodeCompletionBox::BmpVec_t m_defaultBitmaps;
     std::unordered_map<int, int> m_lspCompletionItemImageIndexMap;
@@ -178,6 +202,7 @@ protected:
      */
     bool FilterResults();
     void RemoveDuplicateEntries();
+    void DoBuildFilterKeys();
     void InsertSelection();
     wxString GetFilter();
 
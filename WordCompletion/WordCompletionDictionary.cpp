@@ -11,7 +11,6 @@ WordCompletionDictionary::WordCompletionDictionary()
 {
     EventNotifier::Get()->Bind(wxEVT_ACTIVE_EDITOR_CHANGED, &WordCompletionDictionary::OnEditorChanged, this);
     EventNotifier::Get()->Bind(wxEVT_ALL_EDITORS_CLOSED, &WordCompletionDictionary::OnAllEditorsClosed, this);
-    EventNotifier::Get()->Bind(wxEVT_FILE_SAVED, &WordCompletionDictionary::OnFileSaved, this);
 
     m_thread = new WordCompletionThread(this);
     m_thread->Start();
@@ -21,7 +20,13 @@ WordCompletionDictionary::~WordCompletionDictionary()
 {
     EventNotifier::Get()->Unbind(wxEVT_ACTIVE_EDITOR_CHANGED, &WordCompletionDictionary::OnEditorChanged, this);
     EventNotifier::Get()->Unbind(wxEVT_ALL_EDITORS_CLOSED, &WordCompletionDictionary::OnAllEditorsClosed, this);
-    EventNotifier::Get()->Unbind(wxEVT_FILE_SAVED, &WordCompletionDictionary::OnFileSaved, this);
+
+    // Stop tracking the editors that are still open
+    for(EditorsMap_t::value_type& vt : m_files) {
+        if(vt.second.ctrl) {
+            vt.second.ctrl->Unbind(wxEVT_STC_MODIFIED, &WordCompletionDictionary::OnEditorModified, this);
+        }
+    }
 
     m_thread->Stop();   // Stop the thread
     wxDELETE(m_thread); // Delete it
@@ -31,93 +36,200 @@ void WordCompletionDictionary::OnEditorChanged(wxCommandEvent& event)
 {
     event.Skip();
 
-    // 1) Get a list of all open editors and set the compare it to the current cached files
-    //    and delete all "closed" editors
+    // 1) Drop the editors that were closed
     // 2) Request to cache the newly opened file's words
     IEditor::List_t allEditors;
-    wxArrayString openEditors, cachedEditors, closedEditors;
+    wxStringSet_t openEditors;
     ::clGetManager()->GetAllEditors(allEditors);
-
     std::for_each(allEditors.begin(), allEditors.end(), [&](IEditor* editor) {
-        openEditors.Add(editor->GetFileName().GetFullPath());
+        openEditors.insert(editor->GetFileName().GetFullPath());
     });
 
-    std::for_each(m_files.begin(), m_files.end(), [&](const std::pair<wxString, wxStringSet_t>& p) {
-        cachedEditors.Add(p.first);
-    });
-
-    // std::set_difference requires that both arrays will be sorted
-    openEditors.Sort();
-    cachedEditors.Sort();
-
-    // Create a new array "closedEditors" which contains list of files that exists
-    // in the cachedEditors but not in openEditors list
-    std::set_difference(cachedEditors.begin(),
-                        cachedEditors.end(),
-                        openEditors.begin(),
-                        openEditors.end(),
-                        std::back_inserter(closedEditors));
-
-    for(size_t i = 0; i < closedEditors.size(); ++i) {
-        m_files.erase(closedEditors.Item(i));
+    for(EditorsMap_t::iterator iter = m_files.begin(); iter != m_files.end();) {
+        if(!iter->second.ctrl || openEditors.count(iter->first) == 0) {
+            DoRemoveEditor(iter++);
+        } else {
+            ++iter;
+        }
     }
 
     // 2: cache the active editor
-    DoCacheActiveEditor(false);
+    DoCacheActiveEditor();
 }
 
 void WordCompletionDictionary::OnSuggestThread(const WordCompletionThreadReply& reply)
 {
-    // Remove the current file's dictionary
-    std::map<wxString, wxStringSet_t>::iterator iter = m_files.find(reply.filename.GetFullPath());
-    if(iter != m_files.end()) m_files.erase(iter);
+    EditorsMap_t::iterator iter = m_files.find(reply.filename.GetFullPath());
+    if(iter == m_files.end()) return; // the editor was closed meanwhile
+
+    EditorWords& editor = iter->second;
+    if(!editor.ctrl) {
+        DoRemoveEditor(iter);
+        return;
+    }
+
+    if(editor.ready) return;
+    if(reply.generation != editor.generation) {
+        // The editor was modified while it was parsed
+        DoParseEditor(iter->first, editor);
+        return;
+    }
 
     // Keep the words
-    m_files.insert(std::make_pair(reply.filename.GetFullPath(), reply.suggest));
+    editor.lines = reply.lines;
+    std::for_each(editor.lines.begin(), editor.lines.end(),
+                  [&](const std::vector<wxString>& words) { DoAddWords(words); });
+    editor.ready = true;
 }
 
 void WordCompletionDictionary::OnAllEditorsClosed(wxCommandEvent& event)
 {
     event.Skip();
+    for(EditorsMap_t::value_type& vt : m_files) {
+        if(vt.second.ctrl) {
+            vt.second.ctrl->Unbind(wxEVT_STC_MODIFIED, &WordCompletionDictionary::OnEditorModified, this);
+        }
+    }
     m_files.clear();
+    m_words.clear();
 }
 
-void WordCompletionDictionary::DoCacheActiveEditor(bool overwrite)
+void WordCompletionDictionary::OnEditorModified(wxStyledTextEvent& event)
+{
+    event.Skip();
+    if(!(event.GetModificationType() & (wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT))) return;
+
+    wxStyledTextCtrl* ctrl = dynamic_cast<wxStyledTextCtrl*>(event.GetEventObject());
+    CHECK_PTR_RET(ctrl);
+
+    EditorsMap_t::iterator iter = std::find_if(m_files.begin(), m_files.end(), [&](const EditorsMap_t::value_type& vt) {
+        return vt.second.ctrl.get() == ctrl;
+    });
+    if(iter == m_files.end()) return;
+
+    EditorWords& editor = iter->second;
+    ++editor.generation;
+    if(!editor.ready) return; // the full buffer is being parsed
+
+    // The event is sent once the document was modified. Only the lines touched by the change are parsed again
+    size_t firstLine = ctrl->LineFromPosition(event.GetPosition());
+    int linesAdded = event.GetLinesAdded();
+    if(linesAdded > 0 && firstLine < editor.lines.size()) {
+        editor.lines.insert(editor.lines.begin() + firstLine + 1, linesAdded, std::vector<wxString>());
+
+    } else if(linesAdded < 0 && (firstLine + 1 + (size_t)-linesAdded) <= editor.lines.size()) {
+        WordCompletionLines_t::iterator from = editor.lines.begin() + firstLine + 1;
+        WordCompletionLines_t::iterator to = from + (-linesAdded);
+        std::for_each(from, to, [&](const std::vector<wxString>& words) { DoRemoveWords(words); });
+        editor.lines.erase(from, to);
+    }
+
+    if(editor.lines.size() != (size_t)ctrl->GetLineCount()) {
+        // we missed a modification somewhere, parse the whole editor again
+        DoParseEditor(iter->first, editor);
+        return;
+    }
+    DoUpdateLines(iter->first, editor, firstLine, firstLine + std::max(linesAdded, 0));
+}
+
+void WordCompletionDictionary::DoCacheActiveEditor()
 {
     // Step 2: cache the active editor (if not already cached)
     IEditor* activeEditor = ::clGetManager()->GetActiveEditor();
     CHECK_PTR_RET(activeEditor);
 
-    if(!overwrite && m_files.count(activeEditor->GetFileName().GetFullPath()))
-        return; // we already have this file in the cache
-        
-    m_files.erase(activeEditor->GetFileName().GetFullPath());
-    
-    // Insert a dummy entry, so we won't queue this file if not needed
-    m_files.insert(std::make_pair(activeEditor->GetFileName().GetFullPath(), wxStringSet_t()));
-    
-    // Queue this file
+    wxString filename = activeEditor->GetFileName().GetFullPath();
     wxStyledTextCtrl* stc = activeEditor->GetCtrl();
-    
+    EditorsMap_t::iterator iter = m_files.find(filename);
+    if(iter != m_files.end()) {
+        if(iter->second.ctrl.get() == stc) return; // we already have this file in the cache
+        DoRemoveEditor(iter);
+    }
+
+    // From now on, the modifications made to the editor are applied to the index
+    EditorWords& editor = m_files[filename];
+    editor.ctrl = stc;
+    stc->Bind(wxEVT_STC_MODIFIED, &WordCompletionDictionary::OnEditorModified, this);
+    DoParseEditor(filename, editor);
+}
+
+void WordCompletionDictionary::DoParseEditor(const wxString& filename, EditorWords& editor)
+{
+    if(editor.ready) {
+        std::for_each(editor.lines.begin(), editor.lines.end(),
+                      [&](const std::vector<wxString>& words) { DoRemoveWords(words); });
+        editor.ready = false;
+    }
+    editor.lines.clear();
+
     // Invoke the thread to parse and suggets words for this file
     WordCompletionThreadRequest* req = new WordCompletionThreadRequest;
-    req->buffer = stc->GetText();
-    req->filename = activeEditor->GetFileName();
+    req->buffer = editor.ctrl->GetText();
+    req->filename = filename;
     req->filter = "filter";
+    req->generation = editor.generation;
     m_thread->Add(req);
 }
 
-void WordCompletionDictionary::OnFileSaved(clCommandEvent& event)
+void WordCompletionDictionary::DoRemoveEditor(EditorsMap_t::iterator iter)
 {
-    event.Skip();
-    DoCacheActiveEditor(true);
+    EditorWords& editor = iter->second;
+    if(editor.ready) {
+        std::for_each(editor.lines.begin(), editor.lines.end(),
+                      [&](const std::vector<wxString>& words) { DoRemoveWords(words); });
+    }
+    if(editor.ctrl) { editor.ctrl->Unbind(wxEVT_STC_MODIFIED, &WordCompletionDictionary::OnEditorModified, this); }
+    m_files.erase(iter);
 }
 
-wxStringSet_t WordCompletionDictionary::GetWords() const
+void WordCompletionDictionary::DoUpdateLines(const wxString& filename, EditorWords& editor, int firstLine,
+                                             int lastLine)
 {
-    wxStringSet_t words;
-    std::for_each(m_files.begin(), m_files.end(), [&](const std::pair<wxString, wxStringSet_t>& p){
-        words.insert(p.second.begin(), p.second.end());
-    });
-    return words;
+    wxStyledTextCtrl* stc = editor.ctrl.get();
+    wxString text = stc->GetTextRange(stc->PositionFromLine(firstLine), stc->GetLineEndPosition(lastLine));
+
+    WordCompletionLines_t lines;
+    WordCompletionThread::ParseBuffer(text, lines);
+    if(lines.size() != (size_t)(lastLine - firstLine + 1)) {
+        // the lines are split like the editor does, this should not happen
+        DoParseEditor(filename, editor);
+        return;
+    }
+
+    for(size_t i = 0; i < lines.size(); ++i) {
+        std::vector<wxString>& words = editor.lines[firstLine + i];
+        DoRemoveWords(words);
+        words.swap(lines[i]);
+        DoAddWords(words);
+    }
+}
+
+void WordCompletionDictionary::DoAddWords(const std::vector<wxString>& words)
+{
+    for(const wxString& word : words) {
+        ++m_words[std::make_pair(word.Lower(), word)];
+    }
+}
+
+void WordCompletionDictionary::DoRemoveWords(const std::vector<wxString>& words)
+{
+    for(const wxString& word : words) {
+        WordsIndex_t::iterator iter = m_words.find(std::make_pair(word.Lower(), word));
+        if(iter != m_words.end() && --iter->second == 0) { m_words.erase(iter); }
+    }
+}
+
+void WordCompletionDictionary::GetWords(const wxString& filter, bool startsWith, wxStringSet_t& words) const
+{
+    if(startsWith) {
+        // The words starting with 'filter' are next to each other in the index
+        for(WordsIndex_t::const_iterator iter = m_words.lower_bound(std::make_pair(filter, wxString()));
+            iter != m_words.end() && iter->first.first.StartsWith(filter); ++iter) {
+            words.insert(iter->first.second);
+        }
+    } else {
+        for(const WordsIndex_t::value_type& vt : m_words) {
+            if(vt.first.first.Contains(filter)) { words.insert(vt.first.second); }
+        }
+    }
 }
@@ -27,24 +27,46 @@
 #define WORDCOMPLETIONDICTIONARY_H
 
 #include "macros.h"
+#include <map>
 #include <wx/string.h>
 #include <wx/event.h>
+#include <wx/stc/stc.h>
+#include <wx/weakref.h>
 #include "WordCompletionThread.h"
 #include "WordCompletionRequestReply.h"
 #include "cl_command_event.h"
 
 class WordCompletionDictionary : public wxEvtHandler
 {
-    std::map<wxString, wxStringSet_t> m_files;
+public:
+    // The words of all the open editors, sorted by their lower case form: (lower case word, word) -> occurrences
+    typedef std::map<std::pair<wxString, wxString>, size_t> WordsIndex_t;
+
+protected:
+    struct EditorWords {
+        wxWeakRef<wxStyledTextCtrl> ctrl;
+        WordCompletionLines_t lines; // the words of each line of the editor
+        size_t generation = 0;       // incremented on every modification of the editor
+        bool ready = false;          // the editor was parsed and its words are in the index
+    };
+    typedef std::map<wxString, EditorWords> EditorsMap_t;
+
+    EditorsMap_t m_files;
+    WordsIndex_t m_words;
     WordCompletionThread* m_thread;
 
 protected:
     void OnEditorChanged(wxCommandEvent& event);
     void OnAllEditorsClosed(wxCommandEvent& event);
-    void OnFileSaved(clCommandEvent& event);
+    void OnEditorModified(wxStyledTextEvent& event);
 
 private:
-    void DoCacheActiveEditor(bool overwrite);
+    void DoCacheActiveEditor();
+    void DoParseEditor(const wxString& filename, EditorWords& editor);
+    void DoRemoveEditor(EditorsMap_t::iterator iter);
+    void DoUpdateLines(const wxString& filename, EditorWords& editor, int firstLine, int lastLine);
+    void DoAddWords(const std::vector<wxString>& words);
+    void DoRemoveWords(const std::vector<wxString>& words);
 
 public:
     WordCompletionDictionary();
@@ -57,9 +79,10 @@ public:
     void OnSuggestThread(const WordCompletionThreadReply& reply);
     
     /**
-     * @brief return a set of words from the current editors
+     * @brief add to 'words' the words of the open editors that match 'filter' (lower case). With 'startsWith', this
+     * is a range lookup in the index, otherwise all the words containing 'filter' are returned
      */
-    wxStringSet_t GetWords() const;
+    void GetWords(const wxString& filter, bool startsWith, wxStringSet_t& words) const;
 };
 
 #endif // WORDCOMPLETIONDICTIONARY_H
@@ -27,18 +27,24 @@
 #define WordCompletionRequestReply_H__
 
 #include "worker_thread.h"
+#include <vector>
+
+// The words found in a buffer, one entry per line
+typedef std::vector<std::vector<wxString> > WordCompletionLines_t;
 
 struct WordCompletionThreadRequest : public ThreadRequest {
     wxString buffer;
     wxString filter;
     wxFileName filename;
+    size_t generation = 0;
     bool insertSingleMatch;
 };
 
 struct WordCompletionThreadReply {
-    wxStringSet_t suggest;
+    WordCompletionLines_t lines;
     wxFileName filename;
     wxString filter;
+    size_t generation = 0;
     bool insertSingleMatch;
 };
 
@@ -16,41 +16,42 @@ void WordCompletionThread::ProcessRequest(ThreadRequest* request)
     WordCompletionThreadRequest* req = dynamic_cast<WordCompletionThreadRequest*>(request);
     CHECK_PTR_RET(req);
 
-    wxStringSet_t suggestsions;
-    ParseBuffer(req->buffer, suggestsions);
+    WordCompletionLines_t lines;
+    ParseBuffer(req->buffer, lines);
 
     // Parse and send back the reply
     WordCompletionThreadReply reply;
     reply.filename = req->filename;
     reply.filter = req->filter;
+    reply.generation = req->generation;
     reply.insertSingleMatch = req->insertSingleMatch;
-    reply.suggest.swap(suggestsions);
+    reply.lines.swap(lines);
     m_dict->CallAfter(&WordCompletionDictionary::OnSuggestThread, reply);
 }
 
-void WordCompletionThread::ParseBuffer(const wxString& buffer, wxStringSet_t& suggest)
+void WordCompletionThread::ParseBuffer(const wxString& buffer, WordCompletionLines_t& lines)
 {
-#if 0
-    wxArrayString filteredWords;
-    wxArrayString words = ::wxStringTokenize(buffer, "\r\n \t->./\\'\"[]()<>*&^%#!@+=:,;{}|/", wxTOKEN_STRTOK);
-    for(size_t i=0; i<words.size(); ++i) {
-        if(!wxIsdigit(words.Item(i).at(0))) {
-            filteredWords.Add(words.Item(i));
-        }
-    }
-    suggest.insert(filteredWords.begin(), filteredWords.end());
-#else
+    lines.clear();
+    lines.push_back(std::vector<wxString>());
+
     WordScanner_t scanner = ::WordLexerNew(buffer);
     if(!scanner) return;
     WordLexerToken token;
     std::string curword;
+    bool afterCR = false;
     while(::WordLexerNext(scanner, token)) {
+        // Split the lines the way the editor does: CR, LF and CRLF all end a line
+        bool newLine = (token.type == kWordDelim) && (token.text[0] == '\r' || (token.text[0] == '\n' && !afterCR));
+        afterCR = (token.type == kWordDelim) && (token.text[0] == '\r');
         switch(token.type) {
         case kWordDelim:
             if(!curword.empty()) {
-                suggest.insert(curword);
+                lines.back().push_back(wxString::FromUTF8(curword.c_str(), curword.length()));
             }
             curword.clear();
+            if(newLine) {
+                lines.push_back(std::vector<wxString>());
+            }
             break;
 
         case kWordNumber: {
@@ -64,6 +65,8 @@ void WordCompletionThread::ParseBuffer(const wxString& buffer, wxStringSet_t& su
             break;
         }
     }
+    if(!curword.empty()) {
+        lines.back().push_back(wxString::FromUTF8(curword.c_str(), curword.length()));
+    }
     ::WordLexerDestroy(&scanner);
-#endif
 }
@@ -45,9 +45,10 @@ public:
     virtual void ProcessRequest(ThreadRequest* request);
     
     /**
-     * @brief parse 'buffer' and return set of words to complete
+     * @brief parse 'buffer' and return the words found in each of its lines. CR, LF and CRLF are all line endings,
+     * like in the editor
      */
-    static void ParseBuffer(const wxString& buffer, wxStringSet_t& suggest);
+    static void ParseBuffer(const wxString& buffer, WordCompletionLines_t& lines);
 };
 
 #endif // WORDCOMPLETIONTHREAD_H
@@ -1,7 +1,6 @@
 #include "ColoursAndFontsManager.h"
 #include "WordCompletionDictionary.h"
 #include "WordCompletionSettingsDlg.h"
-#include "WordCompletionThread.h"
 #include "clKeyboardManager.h"
 #include "cl_command_event.h"
 #include "event_notifier.h"
@@ -103,22 +102,10 @@ void WordCompletionPlugin::OnWordComplete(clCodeCompletionEvent& event)
 
     wxString filter = event.GetWord().Lower(); // stc->GetTextRange(start, curPos);
 
-    wxStringSet_t words = m_dictionary->GetWords();
-    // Parse the current bufer (if modified), to include non saved words
-    if(activeEditor->IsModified()) {
-        // For performance (this parsing is done in the main thread)
-        // only parse the visible area of the document
-        wxStringSet_t unsavedBufferWords;
-        wxStyledTextCtrl* stc = activeEditor->GetCtrl();
-        int startPos = stc->PositionFromLine(stc->GetFirstVisibleLine());
-        int endPos = stc->GetCurrentPos();
-
-        wxString buffer = stc->GetTextRange(startPos, endPos);
-        WordCompletionThread::ParseBuffer(buffer, unsavedBufferWords);
-
-        // Merge the results
-        words.insert(unsavedBufferWords.begin(), unsavedBufferWords.end());
-    }
+    // The index follows the modifications made to the editors, including the ones that were not saved yet
+    bool startsWith = settings.GetComparisonMethod() == WordCompletionSettings::kComparisonStartsWith;
+    wxStringSet_t filterdSet;
+    m_dictionary->GetWords(filter, startsWith, filterdSet);
 
     // Get the editor keywords and add them
     LexerConf::Ptr_t lexer = ColoursAndFontsManager::Get().GetLexerForFile(activeEditor->GetFileName().GetFullName());
@@ -128,23 +115,15 @@ void WordCompletionPlugin::OnWordComplete(clCodeCompletionEvent& event)
             keywords << lexer->GetKeyWords(i) << " ";
         }
         wxArrayString langWords = ::wxStringTokenize(keywords, "\n\t \r", wxTOKEN_STRTOK);
-        words.insert(langWords.begin(), langWords.end());
-    }
-
-    wxStringSet_t filterdSet;
-    if(filter.IsEmpty()) {
-        filterdSet.swap(words);
-    } else {
-        for(wxStringSet_t::iterator iter = words.begin(); iter != words.end(); ++iter) {
-            wxString word = *iter;
+        for(const wxString& word : langWords) {
             wxString lcWord = word.Lower();
-            if(settings.GetComparisonMethod() == WordCompletionSettings::kComparisonStartsWith) {
-                if(lcWord.StartsWith(filter) && filter != word) { filterdSet.insert(word); }
-            } else {
-                if(lcWord.Contains(filter) && filter != word) { filterdSet.insert(word); }
-            }
+            if(startsWith ? lcWord.StartsWith(filter) : lcWord.Contains(filter)) { filterdSet.insert(word); }
         }
     }
+
+    // Don't suggest what the user has typed already
+    filterdSet.erase(filter);
+
     wxCodeCompletionBoxEntry::Vec_t entries;
     for(wxStringSet_t::iterator iter = filterdSet.begin(); iter != filterdSet.end(); ++iter) {
         entries.push_back(wxCodeCompletionBoxEntry::New(*iter, sBmp));
@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
 #include "workerthread.h"
 #include "utils.h"
 #include "equeue.h"
@@ -12,63 +15,37 @@
 HINSTANCE gHandler = NULL;
 #else
 #define PIPE_NAME "/tmp/codelite_indexer.%s.sock"
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 static eQueue<clNamedPipe*> g_connectionQueue;
 
-int main(int argc, char **argv)
+/**
+ * @brief accept connections and pass them to the worker thread until 'max_requests' requests were served
+ * @param parent_pid the process to watch, when it goes down so do we (0 means: don't watch)
+ * @param remove_socket should the socket be deleted when the watched process goes down
+ */
+static int serve_connections(clNamedPipeConnectionsServer &server, const char *channel_name, long parent_pid, bool remove_socket)
 {
-#ifdef __WXMSW__
-	// No windows crash dialogs
-	SetErrorMode(SEM_FAILCRITICALERRORS|SEM_NOGPFAULTERRORBOX|SEM_NOOPENFILEERRORBOX);
-	// as described in http://jrfonseca.dyndns.org/projects/gnu-win32/software/drmingw/
-	// load the exception handler dll so we will get Dr MinGW at runtime
-	gHandler = LoadLibrary("exchndl.dll");
-#endif
-
 	int  max_requests(5000);
 	int  requests(0);
-	long parent_pid (0);
-	if(argc < 2){
-		printf("Usage: %s <string> [--pid]\n",    argv[0]);
-		printf("Usage: %s --batch <file_list> <output file>\n", argv[0]);
-		printf("   <string> - a unique string that identifies this indexer from other instances               \n");
-		printf("   --pid    - when set, <string> is handled as process number and the indexer will            \n");
-		printf("              check if this process alive. If it is down, the indexer will go down as well\n");
-		printf("   --batch  - when set, batch parsing is done using list of files set in file_list argument   \n");
-		return 1;
-	}
-
-	if ( argc == 4 && strcmp( argv[1], "--batch") == 0 ) {
-		// Batch mode
-		ctags_batch_parse(argv[2], argv[3]);
-		return 0;
-	}
-
-	if ( argc == 3 && strcmp( argv[2], "--pid") == 0 ) {
-		parent_pid = atol( argv[1] );
-		printf("INFO: parent PID is set on %s\n", argv[1]);
-	}
-
-	// create the connection factory
-	char channel_name[1024];
-	sprintf(channel_name, PIPE_NAME, argv[1]);
-
-	clNamedPipeConnectionsServer server(channel_name);
 
 	// start the worker thread
 	WorkerThread  worker( &g_connectionQueue );
 
 	// start the 'is alive thread'
-	IsAliveThread isAliveThread( parent_pid, channel_name  );
+	IsAliveThread isAliveThread( parent_pid, channel_name, remove_socket );
 	worker.run();
 	if ( parent_pid ) {
 		isAliveThread.run();
 	}
 
-	printf("INFO: codelite_indexer started\n");
-	printf("INFO: listening on %s\n", channel_name);
-
 	while (true) {
 		clNamedPipe *conn = server.waitForNewConnection(-1);
 		if (!conn) {
@@ -101,3 +78,212 @@ int main(int argc, char **argv)
 	ctags_shutdown();
 	return 0;
 }
+
+#ifndef __WXMSW__
+static char g_worker_dir[1024] = "";
+
+/**
+ * @brief the directory of a worker: libctags writes the tags into a file named 'tags' in the current directory, so
+ * each worker gets its own directory (under the temp folder) and the workers won't overwrite each other's output.
+ * The directory is named after the worker pid: a pool restarted with the same id must not share (and later delete)
+ * the directories of the workers of the previous pool
+ */
+static void get_worker_dir(const char *id, pid_t worker_pid, char *worker_dir, size_t size)
+{
+	const char *tmpdir = getenv("TMPDIR");
+	if ( !tmpdir || !*tmpdir ) {
+		tmpdir = "/tmp";
+	}
+	snprintf(worker_dir, size, "%s/codelite_indexer.%s.%ld", tmpdir, id, (long)worker_pid);
+}
+
+/**
+ * @brief delete a worker directory and the files in it
+ */
+static void remove_worker_dir(const char *worker_dir)
+{
+	DIR *dir = opendir(worker_dir);
+	if ( dir ) {
+		struct dirent *entry;
+		while ( (entry = readdir(dir)) != NULL ) {
+			if ( strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ) {
+				continue;
+			}
+			std::string path = std::string(worker_dir) + "/" + entry->d_name;
+			unlink(path.c_str());
+		}
+		closedir(dir);
+	}
+	rmdir(worker_dir);
+}
+
+static void remove_current_worker_dir()
+{
+	if ( g_worker_dir[0] ) {
+		if ( chdir("/") == 0 ) {
+			remove_worker_dir(g_worker_dir);
+		}
+	}
+}
+
+static pid_t start_worker_process(clNamedPipeConnectionsServer &server, const char *channel_name, const char *id)
+{
+	long supervisor_pid = (long)getpid();
+	pid_t pid = fork();
+	if ( pid == 0 ) {
+		get_worker_dir(id, getpid(), g_worker_dir, sizeof(g_worker_dir));
+		mkdir(g_worker_dir, 0700);
+		if ( chdir(g_worker_dir) != 0 ) {
+			perror("ERROR: chdir");
+			_exit(1);
+		}
+		// the worker also goes down with exit() when the parent process dies
+		atexit(remove_current_worker_dir);
+
+		// the worker process: serve connections until the max requests is reached or until the pool goes down.
+		// The socket belongs to the pool, so don't delete it
+		int rc = serve_connections(server, channel_name, supervisor_pid, false);
+		remove_current_worker_dir();
+		_exit(rc);
+
+	} else if ( pid < 0 ) {
+		perror("ERROR: fork");
+	}
+	return pid;
+}
+
+/**
+ * @brief run 'workers' indexer processes that accept connections from the same socket.
+ * libctags keeps its state in global variables, so each worker is a separate process. This process becomes the
+ * supervisor of the pool: it replaces workers that went down after serving their max requests and leaves the
+ * pool when the parent process dies (the workers follow it)
+ */
+static int run_workers_pool(clNamedPipeConnectionsServer &server, const char *channel_name, const char *id, long parent_pid, int workers)
+{
+	// create the listening socket before forking so all the workers share it
+	if ( server.initNewInstance() == INVALID_PIPE_HANDLE ) {
+		return 1;
+	}
+
+	// worker pid -> worker slot
+	std::map<pid_t, int> children;
+	for (int i=0; i<workers; i++) {
+		pid_t pid = start_worker_process(server, channel_name, id);
+		if ( pid > 0 ) {
+			children.insert( std::make_pair(pid, i) );
+		}
+	}
+
+	if ( children.empty() ) {
+		fprintf(stderr, "ERROR: failed to start the worker processes\n");
+		return 1;
+	}
+
+	IsAliveThread isAliveThread( parent_pid, channel_name );
+	if ( parent_pid ) {
+		isAliveThread.run();
+	}
+
+	while ( !children.empty() ) {
+		int status(0);
+		pid_t pid = waitpid(-1, &status, 0);
+		if ( pid < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			break;
+		}
+
+		std::map<pid_t, int>::iterator iter = children.find(pid);
+		if ( iter == children.end() ) {
+			continue;
+		}
+
+		// a worker went down (maybe killed before it could clean up), replace it
+		int slot = iter->second;
+		children.erase(iter);
+
+		char worker_dir[1024];
+		get_worker_dir(id, pid, worker_dir, sizeof(worker_dir));
+		remove_worker_dir(worker_dir);
+
+		pid = start_worker_process(server, channel_name, id);
+		if ( pid > 0 ) {
+			children.insert( std::make_pair(pid, slot) );
+		}
+	}
+	return 0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+#ifdef __WXMSW__
+	// No windows crash dialogs
+	SetErrorMode(SEM_FAILCRITICALERRORS|SEM_NOGPFAULTERRORBOX|SEM_NOOPENFILEERRORBOX);
+	// as described in http://jrfonseca.dyndns.org/projects/gnu-win32/software/drmingw/
+	// load the exception handler dll so we will get Dr MinGW at runtime
+	gHandler = LoadLibrary("exchndl.dll");
+#endif
+
+	long parent_pid (0);
+	int  workers (1);
+	if(argc < 2){
+		printf("Usage: %s <string> [--pid] [--workers <count>]\n",    argv[0]);
+		printf("Usage: %s --batch <file_list> <output file>\n", argv[0]);
+		printf("   <string>  - a unique string that identifies this indexer from other instances               \n");
+		printf("   --pid     - when set, <string> is handled as process number and the indexer will            \n");
+		printf("               check if this process alive. If it is down, the indexer will go down as well\n");
+		printf("   --workers - the number of files parsed in parallel. 0 means: use the number of CPUs        \n");
+		printf("   --batch   - when set, batch parsing is done using list of files set in file_list argument   \n");
+		return 1;
+	}
+
+	if ( argc == 4 && strcmp( argv[1], "--batch") == 0 ) {
+		// Batch mode
+		ctags_batch_parse(argv[2], argv[3]);
+		return 0;
+	}
+
+	for (int i=2; i<argc; i++) {
+		if ( strcmp( argv[i], "--pid") == 0 ) {
+			parent_pid = atol( argv[1] );
+			printf("INFO: parent PID is set on %s\n", argv[1]);
+
+		} else if ( strcmp( argv[i], "--workers") == 0 && (i + 1) < argc ) {
+			workers = atoi( argv[++i] );
+		}
+	}
+
+#ifdef __WXMSW__
+	// The workers pool relies on fork()
+	workers = 1;
+#else
+	// a client that goes away in the middle of a streamed reply (e.g. a cancelled parse) must not kill us, the
+	// failed write simply drops the connection
+	signal(SIGPIPE, SIG_IGN);
+
+	if ( workers <= 0 ) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = cpus > 0 ? (int)cpus : 1;
+	}
+#endif
+
+	// create the connection factory
+	char channel_name[1024];
+	sprintf(channel_name, PIPE_NAME, argv[1]);
+
+	clNamedPipeConnectionsServer server(channel_name);
+
+	printf("INFO: codelite_indexer started\n");
+	printf("INFO: listening on %s\n", channel_name);
+
+#ifndef __WXMSW__
+	if ( workers > 1 ) {
+		printf("INFO: starting %d workers\n", workers);
+		fflush(stdout);
+		return run_workers_pool(server, channel_name, argv[1], parent_pid, workers);
+	}
+#endif
+	return serve_connections(server, channel_name, parent_pid, true);
+}
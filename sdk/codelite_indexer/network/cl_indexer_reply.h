@@ -33,6 +33,13 @@ class clIndexerReply
 	std::string m_fileName;
 	std::string m_tags;
 
+public:
+	enum {
+		CLI_REPLY_NO_TAGS = 0,
+		CLI_REPLY_TAGS,
+		CLI_REPLY_END_OF_STREAM
+	};
+
 public:
 	clIndexerReply();
 	~clIndexerReply();
@@ -38,7 +38,10 @@ class clIndexerRequest
 public:
 	enum {
 		CLI_PARSE,
-		CLI_PARSE_AND_SAVE
+		CLI_PARSE_AND_SAVE,
+		// parse the files one by one and send a reply per file as soon as it is parsed. The stream is terminated
+		// with a reply that has the CLI_REPLY_END_OF_STREAM completion code
+		CLI_PARSE_BATCH
 	};
 
 public:
@@ -41,13 +41,14 @@ public:
 	virtual ~clNamedPipeConnectionsServer();
 	bool shutdown();
 	clNamedPipe *waitForNewConnection(int timeout);
+	// create the listening handle. Called by waitForNewConnection() when needed
+	PIPE_HANDLE initNewInstance();
 	NP_SERVER_ERRORS getLastError() { return this->_lastError ; }
 
 protected:
 	void setLastError(NP_SERVER_ERRORS error) { this->_lastError = error; }
 
 private:
-	PIPE_HANDLE initNewInstance();
 	NP_SERVER_ERRORS _lastError;
 	std::string _pipePath;
 	PIPE_HANDLE _listenHandle;
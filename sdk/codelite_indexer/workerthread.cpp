@@ -37,6 +37,11 @@ void WorkerThread::start()
 				continue;
 			}
 
+			if ( req.getCmd() == clIndexerRequest::CLI_PARSE_BATCH ) {
+				DoStreamReplies(conn, req);
+				continue;
+			}
+
 			char *tags(NULL);
 			// create fies for the requested files
 			for (size_t i=0; i<req.getFiles().size(); i++) {
@@ -101,6 +106,37 @@ void WorkerThread::start()
 	exit(-1);
 }
 
+void WorkerThread::DoStreamReplies(clNamedPipe *conn, const clIndexerRequest &req)
+{
+	for (size_t i=0; i<req.getFiles().size(); i++) {
+		const std::string &file = req.getFiles().at(i);
+		char *tags = ctags_make_tags(req.getCtagOptions().c_str(), file.c_str());
+
+		clIndexerReply reply;
+		reply.setFileName(file);
+		if (tags) {
+			reply.setCompletionCode(clIndexerReply::CLI_REPLY_TAGS);
+			reply.setTags(tags);
+		} else {
+			reply.setCompletionCode(clIndexerReply::CLI_REPLY_NO_TAGS);
+		}
+		ctags_free(tags);
+
+		// the client is no longer interested in the rest of the files (e.g. the parse was cancelled),
+		// drop this connection only
+		if ( !clIndexerProtocol::SendReply(conn, reply) ) {
+			fprintf(stderr, "ERROR: Protocol error: failed to send reply for file %s\n", file.c_str());
+			return;
+		}
+	}
+
+	clIndexerReply eos;
+	eos.setCompletionCode(clIndexerReply::CLI_REPLY_END_OF_STREAM);
+	if ( !clIndexerProtocol::SendReply(conn, eos) ) {
+		fprintf(stderr, "ERROR: Protocol error: failed to send the end of stream reply\n");
+	}
+}
+
 // ---------------------------------------------
 // is alive thread
 // ---------------------------------------------
@@ -117,8 +153,10 @@ void IsAliveThread::start()
 			fprintf(stderr, "INFO: parent process died, going down\n");
 #ifndef __WXMSW__
 			// Delete the local socket
-			::unlink(m_socket.c_str());
-			::remove(m_socket.c_str());
+			if ( m_removeSocket ) {
+				::unlink(m_socket.c_str());
+				::remove(m_socket.c_str());
+			}
 #endif
 			exit(0);
 		}
@@ -126,7 +164,9 @@ void IsAliveThread::start()
 	
 #ifndef __WXMSW__
 	// Delete the local socket
-	::unlink(m_socket.c_str());
-	::remove(m_socket.c_str());
+	if ( m_removeSocket ) {
+		::unlink(m_socket.c_str());
+		::remove(m_socket.c_str());
+	}
 #endif
 }
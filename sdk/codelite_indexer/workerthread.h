@@ -5,6 +5,8 @@
 #include "ethread.h"
 #include "equeue.h"
 
+class clIndexerRequest;
+
 // ---------------------------------------------
 // parsing thread
 // ---------------------------------------------
@@ -12,6 +14,12 @@
 class WorkerThread : public eThread {
 	eQueue<clNamedPipe*> *m_queue;
 
+protected:
+	/**
+	 * @brief parse the files of a CLI_PARSE_BATCH request and send the tags of each file as soon as it is ready
+	 */
+	void DoStreamReplies(clNamedPipe *conn, const clIndexerRequest &req);
+
 public:
 	WorkerThread(eQueue<clNamedPipe*> *queue);
 	~WorkerThread();
@@ -26,8 +34,9 @@ public:
 class IsAliveThread : public eThread {
 	int         m_pid;
 	std::string m_socket;
+	bool        m_removeSocket;
 public:
-	IsAliveThread(int pid, const std::string &socketName) : m_pid(pid), m_socket(socketName) {}
+	IsAliveThread(int pid, const std::string &socketName, bool removeSocket = true) : m_pid(pid), m_socket(socketName), m_removeSocket(removeSocket) {}
 	~IsAliveThread(){}
 
 public: